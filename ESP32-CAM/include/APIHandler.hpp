@@ -1,7 +1,10 @@
 #include <HTTPClient.h>
+#include <vector>
 
 #include "CommandHandler.hpp"
+#include "NutritionDB.hpp"
 #include "WiFiConfig.hpp"
+#include "config.h"
 
 class APIHandler
 {
@@ -12,13 +15,70 @@ class APIHandler
 
     typedef int api_response_code_t;
 
-    err_wifi_t init(const WiFiConfig &config);
+    // Start connecting to WiFi and return at once, the connection comes up
+    // in the background. A cache of an earlier connection to the same
+    // network skips the scan. The address is the static one of config if it
+    // has one, DHCP gives it otherwise.
+    err_wifi_t begin(const WiFiConfig &config, const wifi_cache_t *cache);
+
+    // Wait for the connection begin() started. One made from the cache that
+    // does not come up is retried the slow way.
+    err_wifi_t waitConnected(const WiFiConfig &config);
+
+    // The connection as it is, for the next boot to start from
+    void connectionCache(const WiFiConfig &config, wifi_cache_t &cache);
+
+    // Base URL of the API, API_URL until config.txt says otherwise. Set at
+    // INIT, before any request.
+    void setURL(const String &url) { _url = url; }
 
     api_response_code_t pingAPI();
 
+    // Calories of a food, on a connection kept open between calls. 200 when
+    // result is set; otherwise the status of the response, or
+    // HTTPC_ERROR_NO_STREAM when its body does not parse.
     api_response_code_t fetchData(const String &name, float &result);
 
+    // Foods changed since a revision of the API data, at most limit of them;
+    // revision is set to the one the foods bring the table up to. Safe to
+    // call from another task than fetchData(), it has a connection of its own.
+    api_response_code_t fetchNutritionDelta(uint32_t since, uint32_t limit,
+                                            uint32_t &revision,
+                                            std::vector<NutritionDB::food_t> &foods);
+
   private:
+    // The fields of a nutrition response the firmware uses, everything else
+    // in it is skipped while it is read
+    typedef struct {
+        float calories;
+    } nutrition_t;
+
+    // The body of a response as the JSON parser reads it, counting the
+    // bytes taken so the rest can be read off before the next request
+    class BodyReader
+    {
+      public:
+        explicit BodyReader(Stream &stream) : _stream(stream) {}
+
+        int read();
+        size_t readBytes(char *buffer, size_t length);
+
+        // Read on up to size bytes of body, false if it ends before
+        bool skipTo(size_t size);
+
+      private:
+        Stream &_stream;
+        size_t _count = 0;
+    };
+
+    bool _applyStaticIP(const WiFiConfig &config);
+    bool _waitStatus(uint32_t timeoutMs);
+
     HTTPClient _http; // Single instance of HTTPClient
-    float _parseCalories(String &data);
+    String _url = API_URL;
+    bool _fromCache = false; // the connection under way was made from a cache
+    template <typename TInput>
+    bool _parseNutrition(TInput &body, nutrition_t &nutrition);
+    // From the calories the API gives to the ones the firmware reports
+    static float _toCalories(float value) { return value / 100; }
 };
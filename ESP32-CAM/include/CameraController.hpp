@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+
+// Picks the camera frame size, JPEG quality and XCLK for the next CAPTURE.
+//
+// The frames the impulse needs are far smaller than the QVGA the camera used
+// to be set to: the smallest frame whose centre crop still covers the input
+// is enough, and every pixel above that is DMA, decode and resize work. The
+// controller starts there, at the worst JPEG quality allowed, and climbs a
+// ladder of larger, better frames while the detector is unsure of what it
+// sees, as long as a frame stays within the time budget. A run of confident
+// captures steps it back down.
+class CameraController
+{
+  public:
+    typedef struct {
+        uint16_t width;
+        uint16_t height;
+        int quality;     // JPEG quality, 0-63, lower is better
+        uint32_t xclkHz;
+    } mode_t;
+
+    typedef struct {
+        uint16_t inputWidth;  // of the impulse
+        uint16_t inputHeight;
+        uint16_t maxWidth;    // largest frame, the one the camera was set up with
+        uint16_t maxHeight;
+        int bestQuality;      // JPEG quality of the largest frame
+        int qualityFloor;     // worst JPEG quality allowed, of the smallest frame
+        uint32_t frameBudgetUs;   // capture and inference of one frame
+        float acceptConfidence;   // a best box at least this strong is sure
+        int confidentStreak;      // sure captures in a row before stepping down
+    } policy_t;
+
+    static const int MAX_LEVELS = 5;
+
+    CameraController();
+
+    // Starts at the cheapest mode
+    void configure(const policy_t &policy);
+
+    const mode_t &mode() const { return _modes[_level]; }
+
+    int level() const { return _level; }
+
+    int levels() const { return _levels; }
+
+    // After a CAPTURE that was classified: the time of its last frame and
+    // the score of its best box, 0 for none. True when the mode changed.
+    bool update(uint32_t frameUs, float confidence);
+
+  private:
+    policy_t _policy;
+    mode_t _modes[MAX_LEVELS];
+    int _levels;
+    int _level;
+    int _limit;       // highest level that kept to the budget
+    int _streak;
+    uint32_t _frameUs; // smoothed
+};
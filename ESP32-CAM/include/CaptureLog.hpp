@@ -0,0 +1,198 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#if defined(ESP_PLATFORM)
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#else
+// Host build, stdio and std::thread stand in for SD_MMC and the task
+#include <stdio.h>
+#include <thread>
+#endif
+
+#include "Signal.hpp"
+
+// Append only log of captures on the SD card (the JPEG, the boxes, the weight
+// and the timings), to retrain the model on real kitchen data.
+//
+// append() copies a capture into one of two RAM buffers and returns; a task
+// of its own writes full buffers out, so the capture path never waits on the
+// card. When the card falls behind and both buffers are taken, captures are
+// dropped, not queued.
+//
+// Log files, numbered in directory, are cut at about maxFileBytes:
+//   file_header_t, in a BLOCK_BYTES block of its own
+//   buffers, each written in one go, zero padded to a multiple of BLOCK_BYTES
+//   and so at a BLOCK_BYTES aligned offset. In them records, each a
+//   record_header_t, its boxes, its JPEG and up to 3 bytes of padding.
+//   index_entry_t of every record, then an index_trailer_t.
+// A file without the index (power lost) can still be read by following the
+// record lengths, and skipping to the next block where a record magic is
+// missing.
+class CaptureLog
+{
+  public:
+    static const uint32_t BUFFER_BYTES = 64 * 1024;
+    static const uint32_t BLOCK_BYTES = 512;
+    static const int MAX_RECORDS = 128; // per buffer
+    static const int MAX_BOXES = 8;
+    static const int MAX_LABEL_LENGTH = 24;
+    static const uint32_t FILE_MAGIC = 0x4c504143;   // "CAPL"
+    static const uint32_t RECORD_MAGIC = 0x43455243; // "CREC"
+    static const uint32_t INDEX_MAGIC = 0x58444943;  // "CIDX"
+
+    typedef enum {
+        LOG_OK = 0,
+        LOG_ERR_RUNNING,
+        LOG_ERR_ALLOC,
+        LOG_ERR_FILE,
+        LOG_ERR_TASK
+    } err_log_t;
+
+    typedef struct {
+        char label[MAX_LABEL_LENGTH];
+        float value;
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+        uint32_t height;
+    } box_t;
+
+    typedef struct {
+        float weight;       // grams, negative when the scale sent none
+        uint32_t captureUs; // capture and decode of the frame
+        uint32_t inferUs;   // the impulse, DSP included
+        uint32_t totalUs;   // the CAPTURE, until its boxes are final
+        const box_t *boxes;
+        uint16_t boxCount;
+        const uint8_t *jpeg;
+        uint32_t jpegLength;
+    } capture_t;
+
+    typedef struct {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t blockBytes;
+        uint32_t reserved;
+    } file_header_t;
+
+    typedef struct {
+        uint32_t magic;
+        uint32_t length;   // of the whole record, header and padding included
+        uint32_t sequence; // numbers every append() since start(), gaps are drops
+        uint32_t timeMs;
+        float weight;
+        uint32_t captureUs;
+        uint32_t inferUs;
+        uint32_t totalUs;
+        uint16_t boxCount;
+        uint16_t reserved;
+        uint32_t jpegLength;
+    } record_header_t;
+
+    typedef struct {
+        uint32_t offset; // of the record_header_t in the file
+        uint32_t length; // of the whole record
+        uint32_t sequence;
+    } index_entry_t;
+
+    typedef struct {
+        uint32_t indexOffset;
+        uint32_t count;
+        uint32_t magic;
+    } index_trailer_t;
+
+    typedef struct {
+        uint32_t logged;  // captures taken into a buffer
+        uint32_t dropped; // captures not taken, the writer was behind
+        uint32_t written; // records on the card
+        uint32_t files;   // files finished with an index
+        uint32_t errors;  // failed opens and writes, their records are lost
+    } counters_t;
+
+    CaptureLog();
+    ~CaptureLog();
+
+    CaptureLog(const CaptureLog &) = delete;
+    CaptureLog &operator=(const CaptureLog &) = delete;
+
+    // directory is created when missing
+    err_log_t start(const char *directory, uint32_t maxFileBytes);
+
+    // Writes what is buffered, finishes the file with its index. From the
+    // task that appends.
+    void stop();
+
+    bool running() const { return _running.load(); }
+
+    // Copy a capture into the log, false if it was dropped. Never blocks,
+    // one producer task only.
+    bool append(const capture_t &capture, uint32_t timeMs);
+
+    // Hand the buffer filled so far to the writer, for when captures stop
+    // for a while
+    void flush();
+
+    counters_t counters() const;
+
+  private:
+    typedef struct {
+        uint8_t *bytes;
+        uint32_t used;
+        int count;
+        index_entry_t index[MAX_RECORDS]; // offsets within the buffer
+    } buffer_t;
+
+    static const uint32_t WAIT_MS = 100;
+
+    void _writerTask();
+    bool _handOver();
+    void _writeBuffer(buffer_t &buffer);
+    bool _openNext();
+    void _finishFile();
+    void _release();
+
+    bool _fileOpen(const char *path);
+    bool _fileIsOpen() const;
+    bool _fileWrite(const void *data, size_t length);
+    void _fileClose();
+
+    std::atomic<bool> _running;
+    std::string _directory;
+    uint32_t _maxFileBytes;
+
+    buffer_t _buffers[2];
+    int _filling;               // buffer append() writes into, producer only
+    std::atomic<int> _full;     // buffer waiting for the writer, -1 for none
+    Signal _wake;
+
+    uint32_t _sequence;
+    uint32_t _fileNumber;
+    uint32_t _fileBytes;
+    std::vector<index_entry_t> _fileIndex; // writer only
+
+    std::atomic<uint32_t> _logged;
+    std::atomic<uint32_t> _dropped;
+    std::atomic<uint32_t> _written;
+    std::atomic<uint32_t> _files;
+    std::atomic<uint32_t> _errors;
+
+#if defined(ESP_PLATFORM)
+    static void _task(void *log);
+
+    fs::File _file;
+    StaticSemaphore_t _exitedBuffer;
+    SemaphoreHandle_t _exited;
+    bool _taskRunning;
+#else
+    FILE *_file;
+    std::thread _thread;
+#endif
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(ESP_PLATFORM)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#else
+// Host build, std::thread stands in for the FreeRTOS tasks
+#include <thread>
+#endif
+
+#include "Signal.hpp"
+#include "SpscQueue.hpp"
+
+// Continuous recognition split into three stages that overlap: while the
+// network runs on one frame, the next one is captured and decoded, and the
+// calories of an earlier one are looked up. Capture runs on core 0 next to the
+// WiFi stack, inference has core 1 to itself (shared only with loop()), and
+// the lookup, which mostly waits on the network, goes back to core 0. Frames
+// then come out at the pace of the slowest stage rather than of all of them.
+//
+// Stages hand over through bounded single producer / single consumer queues.
+// Frame buffers circulate between capture and inference and are never copied;
+// results travel by value to the lookup stage and on to poll().
+class CapturePipeline
+{
+  public:
+    static const int FRAME_SLOTS = 2;  // frames between capture and inference
+    // A result waiting for the lookup. Kept short on purpose: when the lookup
+    // falls behind, results are dropped rather than queued up as latency
+    static const int LOOKUP_SLOTS = 1;
+    static const int RESULT_SLOTS = 4; // results waiting for poll()
+    static const int MAX_LABEL_LENGTH = 32;
+
+    typedef enum {
+        PIPELINE_OK = 0,
+        PIPELINE_ERR_RUNNING,
+        PIPELINE_ERR_ALLOC,
+        PIPELINE_ERR_TASK
+    } err_pipeline_t;
+
+    typedef struct {
+        uint8_t *pixels;     // frameBytes, owned by the pipeline
+        uint32_t sequence;   // numbers every captured frame
+        int64_t capturedUs;  // when the capture of the frame started
+        bool empty; // set by the capture: nothing to classify, the frame
+                    // skips inference and its result has no label
+    } frame_t;
+
+    typedef struct {
+        uint32_t sequence;
+        char label[MAX_LABEL_LENGTH]; // empty when nothing was recognised
+        float value;
+        float calories;
+        bool found; // the lookup returned calories for label
+        int64_t capturedUs;
+        int64_t inferredUs;
+        int64_t doneUs;
+    } result_t;
+
+    typedef struct {
+        uint32_t captured;  // frames handed to inference
+        uint32_t rejected;  // frames the capture stage did not pass on
+        uint32_t failed;    // frames the inference stage did not pass on
+        uint32_t completed; // results handed to poll()
+        uint32_t dropped;   // results lost to a full queue
+    } counters_t;
+
+    // Fill frame.pixels, false to skip the frame (capture failed, or not worth
+    // classifying)
+    typedef bool (*CaptureFunction)(frame_t &frame);
+    // Fill label and value of the result, false if inference failed
+    typedef bool (*InferFunction)(const frame_t &frame, result_t &result);
+    // Fill calories of a recognised label, false if the lookup failed
+    typedef bool (*LookupFunction)(result_t &result);
+
+    CapturePipeline();
+    ~CapturePipeline();
+
+    CapturePipeline(const CapturePipeline &) = delete;
+    CapturePipeline &operator=(const CapturePipeline &) = delete;
+
+    err_pipeline_t start(size_t frameBytes, CaptureFunction capture,
+                         InferFunction infer, LookupFunction lookup);
+
+    // Waits for the stage running at the time to finish its frame
+    void stop();
+
+    bool running() const { return _running.load(); }
+
+    // Next finished result, in capture order, false if there is none yet
+    bool poll(result_t &result) { return _done.pop(result); }
+
+    counters_t counters() const;
+
+    static int64_t nowUs();
+
+  private:
+    // How long a waiting stage sleeps before it looks at _running again
+    static const uint32_t WAIT_MS = 50;
+
+    void _captureStage();
+    void _inferStage();
+    void _lookupStage();
+    void _release();
+
+    std::atomic<bool> _running;
+    CaptureFunction _capture;
+    InferFunction _infer;
+    LookupFunction _lookup;
+
+    frame_t _frames[FRAME_SLOTS];
+    SpscQueue<int, FRAME_SLOTS> _free;           // inference -> capture
+    SpscQueue<int, FRAME_SLOTS> _ready;          // capture -> inference
+    SpscQueue<result_t, LOOKUP_SLOTS> _inferred; // inference -> lookup
+    SpscQueue<result_t, RESULT_SLOTS> _done;     // lookup -> poll()
+
+    Signal _captureWake;
+    Signal _inferWake;
+    Signal _lookupWake;
+
+    std::atomic<uint32_t> _captured;
+    std::atomic<uint32_t> _rejected;
+    std::atomic<uint32_t> _failed;
+    std::atomic<uint32_t> _completed;
+    std::atomic<uint32_t> _dropped;
+
+#if defined(ESP_PLATFORM)
+    static const int STAGES = 3;
+    static void _captureTask(void *pipeline);
+    static void _inferTask(void *pipeline);
+    static void _lookupTask(void *pipeline);
+
+    // Given by every stage task just before it deletes itself
+    StaticSemaphore_t _exitedBuffer;
+    SemaphoreHandle_t _exited;
+    int _tasks;
+#else
+    std::thread _threads[3];
+#endif
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "WiFiConfig.hpp"
+
+// Settings an operator can tune per site in config.txt, next to the WiFi
+// ones. Defaults come from config.h.
+typedef struct {
+    std::string apiUrl;
+    float detectionThreshold;  // weakest box reported as a recognised food
+    uint16_t frameWidth;       // camera frame size, one the sensor supports
+    uint16_t frameHeight;
+    int jpegQuality;           // 0-63, lower is better
+    bool adaptiveCamera;       // frame size and quality follow the detector
+    int qualityFloor;          // worst JPEG quality the adaptive camera takes
+    int captureFrames;         // frames a CAPTURE may take
+    uint32_t cacheTtlMs;       // result cache entries expire after this, 0 never
+    float weightWindow;        // grams within which two weights are the same
+    bool captureLog;           // keep every CAPTURE on the SD card, see CaptureLog
+    bool preview;              // live view on port 80 and 81, see PreviewServer
+} settings_t;
+
+// Single pass over config.txt: "key=value" lines, keys in any case, spaces
+// around keys and values, "#" comments and blank lines. Any number of keys,
+// unknown ones are skipped. Keys and values are handed out as views into the
+// text, nothing is copied until a value is stored.
+class ConfigParser
+{
+  public:
+    // Part of the text, not NUL terminated
+    typedef struct {
+        const char *data;
+        size_t length;
+    } token_t;
+
+    // Called for every entry, returns whether the key was known
+    typedef bool (*EntryFunction)(void *context, token_t key, token_t value);
+
+    // Number of entries handed to entry
+    static size_t parse(const char *text, size_t length, EntryFunction entry,
+                        void *context);
+
+    // Keys of config.txt, false for one that is not a WiFi key
+    static bool setWiFi(WiFiConfig &config, token_t key, token_t value);
+
+    // False for an unknown key, or a value out of range, which leaves the
+    // setting as it was
+    static bool setSetting(settings_t &settings, token_t key, token_t value);
+
+    static bool equals(token_t token, const char *key);
+
+    static bool toFloat(token_t token, float &value);
+
+    static bool toInt(token_t token, int32_t &value);
+};
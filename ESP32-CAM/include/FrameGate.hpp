@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Cheap checks on the resized frame that run before the DSP and the neural
+// network: frames that are too dark, overexposed or without any detail are not
+// worth classifying, and neither is a frame that still looks like the empty
+// platter recorded at tare time.
+class FrameGate
+{
+  public:
+    typedef enum {
+        GATE_PASS = 0,
+        GATE_TOO_DARK,
+        GATE_OVEREXPOSED,
+        GATE_NO_DETAIL,
+        GATE_EMPTY_PLATE
+    } gate_result_t;
+
+    static const int HISTOGRAM_BINS = 16;
+    static const int THUMBNAIL_SIZE = 16;
+
+    // Statistics of a frame, all computed in one pass over the luma
+    typedef struct {
+        uint16_t histogram[HISTOGRAM_BINS]; // luma histogram, 16 levels per bin
+        uint16_t pixels;                    // pixels sampled
+        float mean;                         // mean luma, 0..255
+        float variance;                     // luma variance
+        float edgeEnergy; // mean absolute luma step to the left/upper neighbour
+        // mean luma of each cell of a THUMBNAIL_SIZE x THUMBNAIL_SIZE grid
+        uint8_t thumbnail[THUMBNAIL_SIZE * THUMBNAIL_SIZE];
+    } stats_t;
+
+    typedef struct {
+        float minMean;          // darker than this is unusable
+        float maxMean;          // brighter than this is unusable
+        float maxClippedShare;  // share of pixels in the top bin, above is overexposed
+        float minVariance;      // flatter than this (and no edges) has no detail
+        float minEdgeEnergy;
+        // A frame is empty when no thumbnail cell differs from the tare
+        // reference by more than this, once both are brought to the same
+        // mean (so a change of lighting does not count)...
+        float emptyCellDelta;
+        float emptyEdgeDelta; // ...and the edge energy is this close to it
+    } policy_t;
+
+    typedef struct {
+        uint32_t passed;
+        uint32_t tooDark;
+        uint32_t overexposed;
+        uint32_t noDetail;
+        uint32_t emptyPlate;
+    } counters_t;
+
+    FrameGate();
+
+    void setPolicy(const policy_t &policy) { _policy = policy; }
+
+    const policy_t &policy() const { return _policy; }
+
+    // Frames are BGR888, as filled in by the camera capture
+    static void computeStats(const uint8_t *bgr888, size_t width, size_t height,
+                             stats_t &stats);
+
+    // Remember the empty platter, returns false if the frame itself is unusable
+    bool setReference(const uint8_t *bgr888, size_t width, size_t height);
+
+    bool hasReference() const { return _hasReference; }
+
+    void clearReference() { _hasReference = false; }
+
+    gate_result_t check(const uint8_t *bgr888, size_t width, size_t height);
+
+    // Statistics of the frame last passed to check(), its thumbnail doubles as
+    // a signature of the scene
+    const stats_t &lastStats() const { return _last; }
+
+    // Largest difference between two thumbnails once their means are aligned
+    static float thumbnailDelta(const stats_t &a, const stats_t &b);
+
+    const counters_t &counters() const { return _counters; }
+
+    void resetCounters();
+
+  private:
+    // Only every SAMPLE_STEP-th pixel of every SAMPLE_STEP-th row is looked at
+    static const size_t SAMPLE_STEP = 2;
+    static const size_t MAX_SAMPLED_WIDTH = 256;
+
+    gate_result_t _checkExposure(const stats_t &stats) const;
+
+    policy_t _policy;
+    stats_t _reference;
+    stats_t _last;
+    bool _hasReference;
+    counters_t _counters;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Read only nutrition table kept on the SD card, so the calories of a
+// recognised food are known without going to the API.
+//
+// File layout, little endian, every part starting on a BLOCK_SIZE boundary:
+//   header_t, then the first key of every record block (the block index)
+//   record blocks: record_t sorted by key, RECORDS_PER_BLOCK to a block
+//   string pool: the names, NUL terminated, that the records point into
+//
+// The block index is read once by open(). A lookup then finds the one block
+// its key can be in from memory and reads that block only. Records are keyed
+// by a 64 bit hash of the name, so the names are only needed to rebuild the
+// file, never to look a food up.
+//
+// The file itself is reached through read and write functions, which keeps
+// this class free of SD_MMC.
+class NutritionDB
+{
+  public:
+    static const uint32_t MAGIC = 0x3142444e; // "NDB1"
+    static const uint32_t BLOCK_SIZE = 512;
+    static const uint32_t MAX_BLOCKS = 256;
+    static const int MAX_NAME_LENGTH = 32;
+
+    typedef enum {
+        NDB_OK = 0,
+        NDB_ERR_IO,
+        NDB_ERR_FORMAT,
+        NDB_ERR_FULL
+    } err_ndb_t;
+
+    typedef struct {
+        uint32_t magic;
+        uint32_t revision; // of the API data the file was built from
+        uint32_t count;    // records
+        uint32_t blocks;   // record blocks
+        uint32_t recordsOffset;
+        uint32_t poolOffset;
+        uint32_t poolSize;
+        uint32_t reserved;
+    } header_t;
+
+    typedef struct {
+        uint64_t key;
+        float calories;
+        uint32_t name; // offset in the string pool
+    } record_t;
+
+    static const uint32_t RECORDS_PER_BLOCK = BLOCK_SIZE / sizeof(record_t);
+    static const uint32_t MAX_RECORDS = MAX_BLOCKS * RECORDS_PER_BLOCK;
+
+    typedef struct {
+        char name[MAX_NAME_LENGTH];
+        float calories;
+    } food_t;
+
+    // Read length bytes at offset of the file, false if it could not
+    typedef bool (*ReadFunction)(void *file, uint32_t offset, void *data,
+                                 size_t length);
+    // Append length bytes to the file, false if it could not
+    typedef bool (*WriteFunction)(void *file, const void *data, size_t length);
+
+    NutritionDB();
+
+    err_ndb_t open(ReadFunction read, void *file);
+
+    void close();
+
+    bool isOpen() const { return _read != nullptr; }
+
+    // Calories of a food, the name compared without regard to case. Reads at
+    // most one block.
+    bool lookup(const char *name, float &calories) const;
+
+    // Every food in the file, in key order
+    err_ndb_t readAll(std::vector<food_t> &foods) const;
+
+    uint32_t revision() const { return _header.revision; }
+
+    uint32_t count() const { return _header.count; }
+
+    // Write a table of foods. A name given more than once keeps its last
+    // entry, so updates can simply be appended to the foods of an older file.
+    static err_ndb_t write(WriteFunction write, void *file, uint32_t revision,
+                           std::vector<food_t> &foods);
+
+    static uint64_t key(const char *name);
+
+  private:
+    header_t _header;
+    uint64_t _firstKeys[MAX_BLOCKS];
+    ReadFunction _read;
+    void *_file;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <esp_http_server.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Live view of the camera over WiFi, for setting a scale up and for seeing
+// what the detector sees.
+//
+// Port 80 serves the camera web UI of camera_index.h ("/", "/status",
+// "/control", "/capture") and "/preview", a page with the stream and the
+// boxes drawn over it. The boxes and the weight reach the page as small JSON
+// messages on the "/ws" WebSocket, the frames are not touched.
+//
+// Port 81 serves "/stream", the camera JPEGs as a multipart stream, sent
+// straight from the frame buffer. At most one stream at a time and one frame
+// per frameIntervalMs, from a task below the capture and inference tasks.
+// The camera needs two frame buffers for it, so CAPTURE never waits on a
+// frame being sent for longer than a frame.
+class PreviewServer
+{
+  public:
+    static const int MAX_BOXES = 8;
+
+    typedef enum {
+        PREVIEW_OK = 0,
+        PREVIEW_ERR_RUNNING,
+        PREVIEW_ERR_START
+    } err_preview_t;
+
+    // A box in the frame of the impulse input
+    typedef struct {
+        const char *label;
+        float value;
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+        uint32_t height;
+    } box_t;
+
+    typedef struct {
+        uint32_t frames;    // frames sent on /stream
+        uint32_t refused;   // /stream requests while one was running
+        uint32_t published; // box messages handed to /ws
+    } counters_t;
+
+    PreviewServer();
+
+    err_preview_t begin(uint32_t frameIntervalMs);
+
+    void end();
+
+    bool running() const { return _http != nullptr; }
+
+    // Send boxes of the inputWidth x inputHeight impulse input, and the
+    // weight in grams (negative for none), to the pages that are open. Any
+    // task; costs nothing while no page is open.
+    void publish(const box_t *boxes, size_t count, uint32_t inputWidth,
+                 uint32_t inputHeight, float weight);
+
+    counters_t counters() const;
+
+  private:
+    static esp_err_t _indexHandler(httpd_req_t *req);
+    static esp_err_t _previewHandler(httpd_req_t *req);
+    static esp_err_t _statusHandler(httpd_req_t *req);
+    static esp_err_t _controlHandler(httpd_req_t *req);
+    static esp_err_t _captureHandler(httpd_req_t *req);
+    static esp_err_t _streamHandler(httpd_req_t *req);
+    static esp_err_t _eventsHandler(httpd_req_t *req);
+    static void _broadcast(void *message);
+
+    httpd_handle_t _http;
+    httpd_handle_t _stream;
+    uint32_t _frameIntervalMs;
+    std::atomic<bool> _streaming;
+    std::atomic<int> _listeners; // WebSockets open on /ws, as of the last message
+    std::atomic<uint32_t> _frames;
+    std::atomic<uint32_t> _refused;
+    std::atomic<uint32_t> _published;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "FrameGate.hpp"
+
+// Recognitions of the last few scenes, keyed by the frame signature (the gate's
+// luma thumbnail) and the weight on the scale. A CAPTURE of a scene that is
+// still there, with the same weight, is answered from here without running the
+// classifier or asking the API again.
+class ResultCache
+{
+  public:
+    static const int ENTRIES = 4;
+    static const int MAX_LABEL_LENGTH = 32;
+    static const int32_t NO_WEIGHT = INT32_MIN;
+
+    ResultCache();
+
+    // A signature matches when no thumbnail cell differs by more than
+    // maxCellDelta (brightness aligned); weights in grams are compared in
+    // buckets of weightBucket grams. Entries expire ttlMs after they were
+    // stored, never with 0.
+    void configure(float maxCellDelta, float weightBucket, uint32_t ttlMs = 0);
+
+    // Weight bucket of a reading, NO_WEIGHT for a negative (missing) weight
+    int32_t weightBucket(float grams) const;
+
+    // Look the scene up, copies the label and calories on a hit. nowMs is
+    // any millisecond clock, the same for store().
+    bool lookup(const FrameGate::stats_t &signature, int32_t weightBucket,
+                uint32_t nowMs, char *label, float &calories);
+
+    // Remember a recognition, replacing the least recently used entry
+    void store(const FrameGate::stats_t &signature, int32_t weightBucket,
+               uint32_t nowMs, const char *label, float calories);
+
+    void clear();
+
+    uint32_t hits() const { return _hits; }
+
+    uint32_t misses() const { return _misses; }
+
+  private:
+    typedef struct {
+        bool valid;
+        uint32_t lastUsed;
+        uint32_t storedMs;
+        int32_t weightBucket;
+        FrameGate::stats_t signature;
+        char label[MAX_LABEL_LENGTH];
+        float calories;
+    } entry_t;
+
+    entry_t _entries[ENTRIES];
+    uint32_t _clock;
+    uint32_t _hits;
+    uint32_t _misses;
+    float _maxCellDelta;
+    float _weightBucket;
+    uint32_t _ttlMs;
+};
@@ -1,8 +1,13 @@
 #pragma once
 
 #include <SD.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <string>
+#include <vector>
 
+#include "ConfigParser.hpp"
+#include "NutritionDB.hpp"
 #include "WiFiConfig.hpp"
 
 class SDReader
@@ -19,18 +24,71 @@ class SDReader
         RC_BAD_WIFI_CONFIG,
     } err_read_config_t;
 
-    SDReader() = default;
+    typedef enum {
+        NUTRITION_OK = 0,
+        NUTRITION_ERR_NO_FILE,
+        NUTRITION_ERR_FORMAT,
+        NUTRITION_ERR_WRITE
+    } err_nutrition_t;
+
+    SDReader();
 
     err_sd_t init();
 
-    err_read_config_t readConfig(WiFiConfig &config);
+    err_read_config_t readConfig(WiFiConfig &config, settings_t &settings);
 
     String readFile(String path);
 
+    // Connection cache of the last boot, false if there is none
+    bool readWiFiCache(wifi_cache_t &cache);
+
+    bool writeWiFiCache(const wifi_cache_t &cache);
+
+    // Open the nutrition table, kept open for lookups from then on
+    err_nutrition_t openNutrition();
+
+    // Calories of a food from the nutrition table, no network involved
+    bool lookupCalories(const char *name, float &calories);
+
+    // Revision of the API data in the table, 0 without a table
+    uint32_t nutritionRevision();
+
+    // Rebuild the table from its foods and the ones of a delta from the
+    // API, then switch lookups over to it. Lookups carry on from the old
+    // table while the new one is written.
+    err_nutrition_t updateNutrition(uint32_t revision,
+                                    const std::vector<NutritionDB::food_t> &delta);
+
   private:
+    static const size_t CONFIG_MAX_SIZE = 2048;
+
+    static bool _readNutrition(void *file, uint32_t offset, void *data,
+                               size_t length);
+    static bool _writeNutrition(void *file, const void *data, size_t length);
+    err_nutrition_t _openNutrition();
+
+    // Lookups run from the capture path while the sync task updates the
+    // table, the lock keeps the file and the index of _nutrition together
+    File _nutritionFile;
+    NutritionDB _nutrition;
+    StaticSemaphore_t _nutritionLockBuffer;
+    SemaphoreHandle_t _nutritionLock;
+
     String _defaultConfig = "SSID=\n"
                             "Password=\n"
                             "IP=\n"
                             "Gateway=\n"
-                            "MASK=\n";
+                            "MASK=\n"
+                            "# Optional, the defaults are shown\n"
+                            "# API_URL=http://192.168.1.158:8000\n"
+                            "# DETECTION_THRESHOLD=0.5\n"
+                            "# FRAME_SIZE=QVGA\n"
+                            "# JPEG_QUALITY=12\n"
+                            "# ADAPTIVE_CAMERA=1\n"
+                            "# JPEG_QUALITY_FLOOR=20\n"
+                            "# CAPTURE_FRAMES=3\n"
+                            "# CACHE_TTL_S=0\n"
+                            "# WEIGHT_WINDOW_G=5\n"
+                            "# CAPTURE_LOG=0\n"
+                            "# PREVIEW=0\n";
 };
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(ESP_PLATFORM)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#else
+// Host build, a condition variable stands in for the semaphore
+#include <condition_variable>
+#include <mutex>
+#endif
+
+// Wakes up the one task waiting on it, remembers a notify until then
+class Signal
+{
+  public:
+    Signal();
+    ~Signal();
+
+    Signal(const Signal &) = delete;
+    Signal &operator=(const Signal &) = delete;
+
+    void notify();
+    void wait(uint32_t timeoutMs);
+
+  private:
+#if defined(ESP_PLATFORM)
+    StaticSemaphore_t _buffer;
+    SemaphoreHandle_t _handle;
+#else
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _notified;
+#endif
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+// Bounded queue between exactly one producer and one consumer task, without
+// locks: the producer only writes the tail, the consumer only the head. Items
+// are copied in and out, so keep them small (a slot index, a short result).
+template <typename T, size_t CAPACITY> class SpscQueue
+{
+  public:
+    SpscQueue() : _head(0), _tail(0) {}
+
+    // Producer side, false when the queue is full
+    bool push(const T &item)
+    {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        const size_t next = _next(tail);
+        if (next == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        _items[tail] = item;
+        _tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side, false when the queue is empty
+    bool pop(T &item)
+    {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = _items[head];
+        _head.store(_next(head), std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const
+    {
+        return _head.load(std::memory_order_acquire) ==
+               _tail.load(std::memory_order_acquire);
+    }
+
+    // Only while neither side is running
+    void clear()
+    {
+        _head.store(0, std::memory_order_relaxed);
+        _tail.store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    // One slot stays empty to tell a full queue from an empty one
+    static const size_t SLOTS = CAPACITY + 1;
+
+    static size_t _next(size_t index) { return index + 1 == SLOTS ? 0 : index + 1; }
+
+    T _items[SLOTS];
+    std::atomic<size_t> _head;
+    std::atomic<size_t> _tail;
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdint.h>
 #include <string>
 
 class WiFiConfig
@@ -15,3 +16,15 @@ class WiFiConfig
     std::string ip;
     std::string mask;
 };
+
+// The access point of the last good connection, kept on the SD card so the
+// next boot can skip the scan for the network. The address still comes from
+// DHCP, or from config.txt.
+typedef struct {
+    uint32_t magic;
+    char ssid[33]; // the cache only applies to the network it was made on
+    uint8_t bssid[6];
+    int32_t channel;
+} wifi_cache_t;
+
+const uint32_t WIFI_CACHE_MAGIC = 0x32434657; // "WFC2"
@@ -18,4 +18,91 @@ typedef enum status_e {
     STATUS_ERROR = -1
 } status_t;
 
+// Defaults of the settings config.txt can override (ConfigParser), API_URL
+// included
 const String API_URL("http://192.168.1.158:8000");
+
+// A CAPTURE reports the strongest box only when it scores at least this
+const float DETECTION_THRESHOLD = 0.5f;
+
+// Camera frame, QVGA, and its JPEG quality (0-63, lower is better)
+const uint16_t CAMERA_FRAME_WIDTH = 320;
+const uint16_t CAMERA_FRAME_HEIGHT = 240;
+const int CAMERA_JPEG_QUALITY = 12;
+
+// The adaptive camera starts a CAPTURE at the smallest frame that covers the
+// impulse input and at CAMERA_QUALITY_FLOOR, and takes larger, better frames
+// (up to the ones above) while the detector is unsure, as long as capturing
+// and classifying one takes at most CAMERA_FRAME_BUDGET_US.
+// CAMERA_CONFIDENT_STREAK sure CAPTUREs in a row step it down again.
+const bool CAMERA_ADAPTIVE = true;
+const int CAMERA_QUALITY_FLOOR = 20;
+const uint32_t CAMERA_FRAME_BUDGET_US = 400000;
+const int CAMERA_CONFIDENT_STREAK = 3;
+
+// WiFi connection at INIT: a full one (scan and DHCP), and one to the access
+// point and channel of the last boot, retried in full when it does not come up
+const uint32_t WIFI_CONNECT_TIMEOUT_MS = 10000;
+const uint32_t WIFI_FAST_CONNECT_TIMEOUT_MS = 3000;
+
+// The SD nutrition table (SDReader) is brought up to date with the API every
+// NUTRITION_SYNC_INTERVAL_MS, NUTRITION_SYNC_PAGE foods per request
+const uint32_t NUTRITION_SYNC_INTERVAL_MS = 10 * 60 * 1000;
+const uint32_t NUTRITION_SYNC_PAGE = 64;
+// Stack of the task that pings the API after INIT and runs the sync
+const uint32_t NETWORK_TASK_STACK = 8 * 1024;
+
+// Time budget for one run_classifier call, checked between DSP pages and NN layers
+const uint64_t INFERENCE_BUDGET_US = 1000000;
+
+// A CAPTURE fuses the FOMO output of up to FUSION_MAX_FRAMES frames, stopping early once
+// the fused grid holds a box of at least FUSION_ACCEPT_CONFIDENCE
+const int FUSION_MAX_FRAMES = 3;
+const float FUSION_ACCEPT_CONFIDENCE = 0.8f;
+// Share of the fused grid carried over into the next frame
+const float FUSION_HISTORY_WEIGHT = 0.5f;
+
+// Pre-inference frame gate (FrameGate), on the mean luma (0..255) of the resized frame
+const float GATE_MIN_MEAN = 25.0f;
+const float GATE_MAX_MEAN = 235.0f;
+// Share of pixels at the top of the histogram above which the frame is overexposed
+const float GATE_MAX_CLIPPED_SHARE = 0.5f;
+// A frame with both a lower luma variance and edge energy has nothing in it
+const float GATE_MIN_VARIANCE = 20.0f;
+const float GATE_MIN_EDGE_ENERGY = 1.5f;
+// A frame whose 16x16 luma thumbnail (brightness aligned) and edge energy are
+// this close to the ones stored with TARE shows the empty platter
+const float GATE_EMPTY_CELL_DELTA = 16.0f;
+const float GATE_EMPTY_EDGE_DELTA = 1.0f;
+
+// A CAPTURE whose scene signature (gate thumbnail) is within CACHE_MAX_CELL_DELTA
+// of an earlier one, at the same weight in CACHE_WEIGHT_BUCKET_G gram buckets,
+// reuses that recognition
+const float CACHE_MAX_CELL_DELTA = 10.0f;
+const float CACHE_WEIGHT_BUCKET_G = 5.0f;
+// Cached recognitions expire after this, 0 keeps them until TARE
+const uint32_t CACHE_TTL_MS = 0;
+
+// With CAPTURE_LOG on, every CAPTURE (its last JPEG, the boxes, the weight and
+// the timings) is logged to CAPTURE_LOG_DIR, in files of about
+// CAPTURE_LOG_FILE_BYTES. What is buffered goes to the card at least every
+// CAPTURE_LOG_FLUSH_MS.
+const bool CAPTURE_LOG = false;
+const char *const CAPTURE_LOG_DIR = "/captures";
+const uint32_t CAPTURE_LOG_FILE_BYTES = 4 * 1024 * 1024;
+const uint32_t CAPTURE_LOG_FLUSH_MS = 10000;
+
+// With PREVIEW on, http://<scale>/preview shows the camera with the boxes of
+// the last inference, at most one frame every PREVIEW_FRAME_INTERVAL_MS
+const bool PREVIEW = false;
+const uint32_t PREVIEW_FRAME_INTERVAL_MS = 200;
+
+// Second stage cascade, built in with -DCASCADE_IMPULSE=<handle of a second
+// impulse>. A crop of the full resolution frame around each of the strongest
+// CASCADE_MAX_CROPS boxes, grown by CASCADE_CONTEXT of the box size on every
+// side and at least CASCADE_MIN_CROP pixels, is classified again; a score of
+// CASCADE_MIN_VALUE or more relabels the box
+const float CASCADE_CONTEXT = 0.5f;
+const uint32_t CASCADE_MIN_CROP = 96;
+const uint32_t CASCADE_MAX_CROPS = 2;
+const float CASCADE_MIN_VALUE = 0.6f;
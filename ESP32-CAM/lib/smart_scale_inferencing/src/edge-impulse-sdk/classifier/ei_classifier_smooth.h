@@ -18,18 +18,20 @@
 #ifndef _EI_CLASSIFIER_SMOOTH_H_
 #define _EI_CLASSIFIER_SMOOTH_H_
 
-#if EI_CLASSIFIER_OBJECT_DETECTION != 1
-
 #include <stdint.h>
+#include <string.h>
 
 typedef struct ei_classifier_smooth {
-    int *last_readings;
+    int *last_readings;         // ring buffer, last_readings[next_reading] is the oldest reading
     size_t last_readings_size;
+    size_t next_reading = 0;
     uint8_t min_readings_same;
     float classifier_confidence;
     float anomaly_confidence;
-    uint8_t count[EI_CLASSIFIER_LABEL_COUNT + 2] = { 0 };
+    uint8_t count[EI_CLASSIFIER_LABEL_COUNT + 2] = { 0 }; // readings per label in the window, then uncertain, anomaly
     size_t count_size = EI_CLASSIFIER_LABEL_COUNT + 2;
+    float ema_alpha = 0;        // 0 for the majority vote, otherwise weight of a new reading in the EMA
+    float ema[EI_CLASSIFIER_LABEL_COUNT + 1] = { 0 }; // smoothed score per label, then the anomaly score
 } ei_classifier_smooth_t;
 
 /**
@@ -38,7 +40,7 @@ typedef struct ei_classifier_smooth {
  * (e.g. 7 / 10 readings should be the same before I draw any ML conclusions).
  * This allocates memory on the heap!
  * @param smooth Pointer to an uninitialized ei_classifier_smooth_t struct
- * @param n_readings Number of readings you want to store
+ * @param n_readings Number of readings you want to store (at most 255)
  * @param min_readings_same Minimum readings that need to be the same before concluding (needs to be lower than n_readings)
  * @param classifier_confidence Minimum confidence in a class (default 0.8)
  * @param anomaly_confidence Maximum error for anomalies (default 0.3)
@@ -51,56 +53,97 @@ void ei_classifier_smooth_init(ei_classifier_smooth_t *smooth, size_t n_readings
         smooth->last_readings[ix] = -1; // -1 == uncertain
     }
     smooth->last_readings_size = n_readings;
+    smooth->next_reading = 0;
     smooth->min_readings_same = min_readings_same;
     smooth->classifier_confidence = classifier_confidence;
     smooth->anomaly_confidence = anomaly_confidence;
     smooth->count_size = EI_CLASSIFIER_LABEL_COUNT + 2;
+    smooth->ema_alpha = 0;
+
+    // the window starts out uncertain
+    memset(smooth->count, 0, sizeof(smooth->count));
+    smooth->count[EI_CLASSIFIER_LABEL_COUNT] = (uint8_t)n_readings;
 }
 
 /**
- * Call when a new reading comes in.
- * @param smooth Pointer to an initialized ei_classifier_smooth_t struct
- * @param result Pointer to a result structure (after calling ei_run_classifier)
- * @returns Label, either 'uncertain', 'anomaly', or a label from the result struct
+ * Initialize a smooth structure that keeps an exponential moving average of the scores
+ * instead of counting votes. A reading then weighs in with its confidence rather than
+ * as one vote, and there is no window to store, so this suits a continuous stream of
+ * frames. A label is reported once its average reaches classifier_confidence.
+ * For object detection models the score of a label is its strongest box in the frame.
+ * @param smooth Pointer to an uninitialized ei_classifier_smooth_t struct
+ * @param alpha Weight of a new reading, between 0 and 1 (e.g. 0.2 averages roughly the last 9 frames)
+ * @param classifier_confidence Minimum averaged confidence in a class (default 0.8)
+ * @param anomaly_confidence Maximum averaged error for anomalies (default 0.3)
  */
-const char* ei_classifier_smooth_update(ei_classifier_smooth_t *smooth, ei_impulse_result_t *result) {
-    // clear out the count array
-    memset(smooth->count, 0, EI_CLASSIFIER_LABEL_COUNT + 2);
-
-    // roll through the last_readings buffer
-    numpy::roll(smooth->last_readings, smooth->last_readings_size, -1);
-
-    int reading = -1; // uncertain
+void ei_classifier_smooth_init_ema(ei_classifier_smooth_t *smooth, float alpha,
+                                   float classifier_confidence = 0.8, float anomaly_confidence = 0.3) {
+    smooth->last_readings = nullptr;
+    smooth->last_readings_size = 0;
+    smooth->next_reading = 0;
+    smooth->min_readings_same = 0;
+    smooth->classifier_confidence = classifier_confidence;
+    smooth->anomaly_confidence = anomaly_confidence;
+    smooth->count_size = EI_CLASSIFIER_LABEL_COUNT + 2;
+    smooth->ema_alpha = alpha;
+    memset(smooth->count, 0, sizeof(smooth->count));
+    memset(smooth->ema, 0, sizeof(smooth->ema));
+}
 
-    // print the predictions
-    // printf("[");
+/**
+ * Score of every label in a result: the classification value, or for object detection
+ * the value of the strongest box with that label (0 if there is none)
+ */
+static void ei_classifier_smooth_scores(const ei_impulse_result_t *result, float *scores) {
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
     for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
-        if (result->classification[ix].value >= smooth->classifier_confidence) {
-            reading = (int)ix;
+        scores[ix] = 0;
+    }
+    for (uint32_t i = 0; i < result->bounding_boxes_count; i++) {
+        const ei_impulse_result_bounding_box_t *bb = &result->bounding_boxes[i];
+        if (bb->value == 0) {
+            continue;
+        }
+        for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+            if (bb->label == ei_classifier_inferencing_categories[ix] ||
+                strcmp(bb->label, ei_classifier_inferencing_categories[ix]) == 0) {
+                if (bb->value > scores[ix]) {
+                    scores[ix] = bb->value;
+                }
+                break;
+            }
         }
     }
-#if EI_CLASSIFIER_HAS_ANOMALY
-    if (result->anomaly >= smooth->anomaly_confidence) {
-        reading = -2; // anomaly
+#else
+    for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+        scores[ix] = result->classification[ix].value;
     }
 #endif
+}
 
-    smooth->last_readings[smooth->last_readings_size - 1] = reading;
-
-    // now count last 10 readings and see what we actually see...
-    for (size_t ix = 0; ix < smooth->last_readings_size; ix++) {
-        if (smooth->last_readings[ix] >= 0) {
-            smooth->count[smooth->last_readings[ix]]++;
-        }
-        else if (smooth->last_readings[ix] == -1) { // uncertain
-            smooth->count[EI_CLASSIFIER_LABEL_COUNT]++;
+/**
+ * Current conclusion of a smooth structure, in O(labels)
+ * @returns Label, either 'uncertain', 'anomaly', or a label of the model
+ */
+const char* ei_classifier_smooth_label(const ei_classifier_smooth_t *smooth) {
+    if (smooth->ema_alpha > 0) {
+#if EI_CLASSIFIER_HAS_ANOMALY
+        if (smooth->ema[EI_CLASSIFIER_LABEL_COUNT] >= smooth->anomaly_confidence) {
+            return "anomaly";
         }
-        else if (smooth->last_readings[ix] == -2) { // anomaly
-            smooth->count[EI_CLASSIFIER_LABEL_COUNT + 1]++;
+#endif
+        int top_result = -1;
+        float top_score = smooth->classifier_confidence;
+        for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+            if (smooth->ema[ix] >= top_score) {
+                top_result = (int)ix;
+                top_score = smooth->ema[ix];
+            }
         }
+        return top_result >= 0 ? ei_classifier_inferencing_categories[top_result] : "uncertain";
     }
 
-    // then loop over the count and see which is highest
+    // loop over the count and see which is highest
     uint8_t top_result = 0;
     uint8_t top_count = 0;
     bool met_confidence_threshold = false;
@@ -123,19 +166,60 @@ const char* ei_classifier_smooth_update(ei_classifier_smooth_t *smooth, ei_impul
             return "anomaly";
         }
         else {
-            return result->classification[top_result].label;
+            return ei_classifier_inferencing_categories[top_result];
         }
     }
     return "uncertain";
 }
 
+/**
+ * Call when a new reading comes in. The update itself is O(1), the window is not recounted.
+ * @param smooth Pointer to an initialized ei_classifier_smooth_t struct
+ * @param result Pointer to a result structure (after calling ei_run_classifier)
+ * @returns Label, either 'uncertain', 'anomaly', or a label from the result struct
+ */
+const char* ei_classifier_smooth_update(ei_classifier_smooth_t *smooth, ei_impulse_result_t *result) {
+    float scores[EI_CLASSIFIER_LABEL_COUNT + 1];
+    ei_classifier_smooth_scores(result, scores);
+
+    if (smooth->ema_alpha > 0) {
+        scores[EI_CLASSIFIER_LABEL_COUNT] = result->anomaly;
+        for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT + 1; ix++) {
+            smooth->ema[ix] += smooth->ema_alpha * (scores[ix] - smooth->ema[ix]);
+        }
+        return ei_classifier_smooth_label(smooth);
+    }
+
+    int reading = -1; // uncertain
+    for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+        if (scores[ix] >= smooth->classifier_confidence) {
+            reading = (int)ix;
+        }
+    }
+#if EI_CLASSIFIER_HAS_ANOMALY
+    if (result->anomaly >= smooth->anomaly_confidence) {
+        reading = -2; // anomaly
+    }
+#endif
+
+    // the oldest reading leaves the window, the new one takes its place
+    int *slot = &smooth->last_readings[smooth->next_reading];
+    smooth->count[*slot >= 0 ? *slot : *slot == -1 ? EI_CLASSIFIER_LABEL_COUNT : EI_CLASSIFIER_LABEL_COUNT + 1]--;
+    smooth->count[reading >= 0 ? reading : reading == -1 ? EI_CLASSIFIER_LABEL_COUNT : EI_CLASSIFIER_LABEL_COUNT + 1]++;
+    *slot = reading;
+    smooth->next_reading = (smooth->next_reading + 1) % smooth->last_readings_size;
+
+    return ei_classifier_smooth_label(smooth);
+}
+
 /**
  * Clear up a smooth structure
  */
 void ei_classifier_smooth_free(ei_classifier_smooth_t *smooth) {
-    ei_free(smooth->last_readings);
+    if (smooth->last_readings) {
+        ei_free(smooth->last_readings);
+        smooth->last_readings = nullptr;
+    }
 }
 
-#endif // #if EI_CLASSIFIER_OBJECT_DETECTION != 1
-
 #endif // _EI_CLASSIFIER_SMOOTH_H_
@@ -19,6 +19,7 @@
 #define _EDGE_IMPULSE_RUN_CLASSIFIER_TYPES_H_
 
 #include <stdint.h>
+#include <string.h>
 // needed for standalone C example
 #include "model-parameters/model_metadata.h"
 
@@ -242,6 +243,29 @@ typedef struct {
      */
     uint32_t bounding_boxes_count;
 
+    /**
+     * Number of entries of the caller owned array that `bounding_boxes` points at, when
+     * the array was handed to `run_classifier_with_buffers()`. Detections beyond the
+     * capacity are dropped. With 0 the boxes are stored in `bounding_boxes_storage` (if
+     * `EI_MAX_BOXES` is defined) or in per-thread buffers that the next inference on the
+     * same thread overwrites.
+     */
+    uint32_t bounding_boxes_capacity;
+
+#if defined(EI_MAX_BOXES) || __DOXYGEN__
+    /**
+     * Boxes stored in the result itself, so they stay valid until the result is reused.
+     */
+    ei_impulse_result_bounding_box_t bounding_boxes_storage[EI_MAX_BOXES];
+#endif
+
+    /**
+     * FOMO models only: the fusion state handed to `run_classifier_with_buffers()`, the
+     * output is fused with that of the previous frames (see `ei_fomo_fusion_t`) and the
+     * boxes come from the fused grid. nullptr decodes every frame on its own.
+     */
+    struct ei_fomo_fusion *fomo_fusion;
+
     /**
      * Array of classification results. If object detection is enabled, this will be
      * empty.
@@ -302,6 +326,24 @@ typedef struct {
 #endif
 } ei_impulse_result_t;
 
+/**
+ * Clear a result before the impulse fills it in, then point it at the caller's box
+ * storage (NULL and 0 for none) and FOMO fusion state (NULL for none). Nothing
+ * is read from the result, it may be uninitialized.
+ */
+static inline void ei_impulse_result_reset(ei_impulse_result_t *result,
+                                           ei_impulse_result_bounding_box_t *boxes,
+                                           uint32_t max_boxes,
+                                           struct ei_fomo_fusion *fomo_fusion) {
+    memset(result, 0, sizeof(ei_impulse_result_t));
+
+    result->fomo_fusion = fomo_fusion;
+    if (boxes != NULL && max_boxes > 0) {
+        result->bounding_boxes = boxes;
+        result->bounding_boxes_capacity = max_boxes;
+    }
+}
+
 /** @} */
 
 #endif // _EDGE_IMPULSE_RUN_CLASSIFIER_TYPES_H_
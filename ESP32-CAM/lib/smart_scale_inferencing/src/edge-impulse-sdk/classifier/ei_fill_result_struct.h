@@ -63,6 +63,51 @@ __attribute__((unused)) inline float sigmoid(float a) {
     return 1.0f / (1.0f + exp(-a));
 }
 
+/**
+ * Storage the result asks boxes to be written to: the caller's array when it set
+ * bounding_boxes_capacity, bounding_boxes_storage when EI_MAX_BOXES is defined.
+ * nullptr if the boxes should stay in the filling function's own buffer.
+ */
+__attribute__((unused)) static ei_impulse_result_bounding_box_t *ei_result_box_storage(ei_impulse_result_t *result, size_t *capacity) {
+    if (result->bounding_boxes_capacity > 0 && result->bounding_boxes) {
+        *capacity = result->bounding_boxes_capacity;
+        return result->bounding_boxes;
+    }
+#ifdef EI_MAX_BOXES
+    *capacity = EI_MAX_BOXES;
+    return result->bounding_boxes_storage;
+#else
+    *capacity = 0;
+    return nullptr;
+#endif
+}
+
+/**
+ * Hands boxes to the result. `count` are detections, `size` includes the zero-value
+ * padding up to object_detection_count. When the result brings its own storage they
+ * are copied there (truncated to its capacity), otherwise it points at `boxes`.
+ */
+__attribute__((unused)) static void ei_result_set_bounding_boxes(ei_impulse_result_t *result,
+                                                                 ei_impulse_result_bounding_box_t *boxes,
+                                                                 size_t count,
+                                                                 size_t size) {
+    size_t capacity;
+    ei_impulse_result_bounding_box_t *storage = ei_result_box_storage(result, &capacity);
+    if (!storage) {
+        result->bounding_boxes = boxes;
+        result->bounding_boxes_count = count;
+        return;
+    }
+
+    if (size > capacity) size = capacity;
+    if (count > capacity) count = capacity;
+    if (size > 0 && storage != boxes) {
+        memmove(storage, boxes, size * sizeof(ei_impulse_result_bounding_box_t));
+    }
+    result->bounding_boxes = storage;
+    result->bounding_boxes_count = count;
+}
+
 #ifdef EI_HAS_FOMO
 typedef struct cube {
     size_t x;
@@ -83,15 +128,15 @@ __attribute__((unused)) static bool ei_cube_check_overlap(ei_classifier_cube_t *
 
     // if we overlap, but the x of the new box is lower than the x of the current box
     if (x < c->x) {
-        // update x to match new box and make width larger (by the diff between the boxes)
-        c->x = x;
+        // make width larger (by the diff between the boxes) and update x to match new box
         c->width += c->x - x;
+        c->x = x;
     }
     // if we overlap, but the y of the new box is lower than the y of the current box
     if (y < c->y) {
-        // update y to match new box and make height larger (by the diff between the boxes)
-        c->y = y;
+        // make height larger (by the diff between the boxes) and update y to match new box
         c->height += c->y - y;
+        c->y = y;
     }
     // if we overlap, and x+width of the new box is higher than the x+width of the current box
     if (x + width > c->x + c->width) {
@@ -141,7 +186,7 @@ __attribute__((unused)) static void ei_handle_cube(std::vector<ei_classifier_cub
 
 __attribute__((unused)) static void fill_result_struct_from_cubes(ei_impulse_result_t *result, std::vector<ei_classifier_cube_t*> *cubes, int out_width_factor, uint32_t object_detection_count) {
     std::vector<ei_classifier_cube_t*> bbs;
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    static thread_local std::vector<ei_impulse_result_bounding_box_t> results;
     int added_boxes_count = 0;
     results.clear();
 
@@ -196,18 +241,20 @@ __attribute__((unused)) static void fill_result_struct_from_cubes(ei_impulse_res
         delete c;
     }
 
-    result->bounding_boxes = results.data();
-    result->bounding_boxes_count = added_boxes_count;
+    ei_result_set_bounding_boxes(result, results.data(), added_boxes_count, results.size());
 }
-#endif
 
-__attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_fomo(const ei_impulse_t *impulse,
-                                                                            const ei_learning_block_config_tflite_graph_t *block_config,
-                                                                            ei_impulse_result_t *result,
-                                                                            float *data,
-                                                                            int out_width,
-                                                                            int out_height) {
-#ifdef EI_HAS_FOMO
+/**
+ * Cube based FOMO decoder, grows a box per class from every above-threshold cell.
+ * Allocates per cell; the decoders below only fall back to it when the grid does
+ * not fit EI_FOMO_MAX_GRID_CELLS / EI_FOMO_MAX_COMPONENTS.
+ */
+__attribute__((unused)) static void fill_result_struct_f32_fomo_cubes(const ei_impulse_t *impulse,
+                                                                     const ei_learning_block_config_tflite_graph_t *block_config,
+                                                                     ei_impulse_result_t *result,
+                                                                     float *data,
+                                                                     int out_width,
+                                                                     int out_height) {
     std::vector<ei_classifier_cube_t*> cubes;
 
     int out_width_factor = impulse->input_width / out_width;
@@ -226,22 +273,16 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_fomo(cons
     }
 
     fill_result_struct_from_cubes(result, &cubes, out_width_factor, impulse->object_detection_count);
-
-    return EI_IMPULSE_OK;
-#else
-    return EI_IMPULSE_LAST_LAYER_NOT_AVAILABLE;
-#endif
 }
 
-__attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_i8_fomo(const ei_impulse_t *impulse,
-                                                                           const ei_learning_block_config_tflite_graph_t *block_config,
-                                                                           ei_impulse_result_t *result,
-                                                                           int8_t *data,
-                                                                           float zero_point,
-                                                                           float scale,
-                                                                           int out_width,
-                                                                           int out_height) {
-#ifdef EI_HAS_FOMO
+__attribute__((unused)) static void fill_result_struct_i8_fomo_cubes(const ei_impulse_t *impulse,
+                                                                    const ei_learning_block_config_tflite_graph_t *block_config,
+                                                                    ei_impulse_result_t *result,
+                                                                    int8_t *data,
+                                                                    float zero_point,
+                                                                    float scale,
+                                                                    int out_width,
+                                                                    int out_height) {
     std::vector<ei_classifier_cube_t*> cubes;
 
     int out_width_factor = impulse->input_width / out_width;
@@ -261,6 +302,353 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_i8_fomo(const
     }
 
     fill_result_struct_from_cubes(result, &cubes, out_width_factor, impulse->object_detection_count);
+}
+
+// Grid cells the allocation free decoder handles, the default fits a FOMO model at this
+// input size (1/8th resolution). Larger grids use the cube decoder.
+#ifndef EI_FOMO_MAX_GRID_CELLS
+#define EI_FOMO_MAX_GRID_CELLS ((EI_CLASSIFIER_INPUT_WIDTH / 8) * (EI_CLASSIFIER_INPUT_HEIGHT / 8))
+#endif
+
+// Connected components (over all classes) the allocation free decoder can hold
+#ifndef EI_FOMO_MAX_COMPONENTS
+#define EI_FOMO_MAX_COMPONENTS 64
+#endif
+
+template<typename T>
+struct ei_fomo_component_t {
+    uint16_t first_cell;    // raster index of the top-left-most cell, the component's union-find root
+    uint8_t label_ix;
+    bool merged;
+    uint8_t x0, y0, x1, y1; // inclusive cell extents
+    T max_value;
+};
+
+static inline uint16_t ei_fomo_find(uint16_t *parent, uint16_t cell) {
+    while (parent[cell] != cell) {
+        parent[cell] = parent[parent[cell]];
+        cell = parent[cell];
+    }
+    return cell;
+}
+
+// the smaller raster index stays the root, so a root is always the first cell of its component
+static inline void ei_fomo_union(uint16_t *parent, uint16_t a, uint16_t b) {
+    a = ei_fomo_find(parent, a);
+    b = ei_fomo_find(parent, b);
+    if (a < b) {
+        parent[b] = a;
+    }
+    else {
+        parent[a] = b;
+    }
+}
+
+/**
+ * Allocation free FOMO decoder. Per class, one raster pass labels the 8-connected
+ * cells that pass the threshold with union-find (only the W, NW, N and NE neighbours
+ * are visited yet), a second pass collects the bounding rectangle and the highest raw
+ * value of every component. Boxes come out in the order the cube decoder creates them
+ * (first cell, then class), and a component touching an earlier box of the same
+ * class is merged into that box, as the cube decoder does. Only the highest value
+ * of a box is converted to a confidence.
+ *
+ * Returns false, without touching the result, when the grid or the number of
+ * components does not fit the fixed capacity.
+ */
+template<typename T, typename Threshold, typename Confidence>
+static bool ei_fomo_decode(const ei_impulse_t *impulse,
+                           ei_impulse_result_t *result,
+                           const T *data,
+                           Threshold threshold,
+                           Confidence to_confidence,
+                           int out_width,
+                           int out_height) {
+    // same layout as the cube decoder: out_width rows of out_height cells
+    const size_t rows = out_width;
+    const size_t cols = out_height;
+    const size_t cells = rows * cols;
+    const size_t stride = impulse->label_count + 1;
+
+    if (cells > EI_FOMO_MAX_GRID_CELLS || rows > 255 || cols > 255 || impulse->label_count > 16) {
+        return false;
+    }
+
+    uint16_t class_mask[EI_FOMO_MAX_GRID_CELLS];
+    uint16_t parent[EI_FOMO_MAX_GRID_CELLS];
+    uint16_t component_of[EI_FOMO_MAX_GRID_CELLS];
+    ei_fomo_component_t<T> components[EI_FOMO_MAX_COMPONENTS];
+    size_t component_count = 0;
+
+    const uint16_t background = 0xffff;
+
+    // one sequential pass over the tensor, classes without any cell are skipped below
+    uint16_t any_class = 0;
+    for (size_t cell = 0; cell < cells; cell++) {
+        const T *cell_data = data + cell * stride + 1;
+        uint16_t mask = 0;
+        for (size_t ix = 0; ix < impulse->label_count; ix++) {
+            if (!(cell_data[ix] < threshold)) {
+                mask |= 1 << ix;
+            }
+        }
+        class_mask[cell] = mask;
+        any_class |= mask;
+    }
+
+    for (size_t ix = 0; ix < impulse->label_count; ix++) {
+        if (!(any_class & (1 << ix))) {
+            continue;
+        }
+        const T *class_data = data + ix + 1;
+
+        for (size_t y = 0; y < rows; y++) {
+            for (size_t x = 0; x < cols; x++) {
+                const uint16_t cell = y * cols + x;
+                if (!(class_mask[cell] & (1 << ix))) {
+                    parent[cell] = background;
+                    continue;
+                }
+                parent[cell] = cell;
+                if (x > 0 && parent[cell - 1] != background) {
+                    ei_fomo_union(parent, cell, cell - 1);
+                }
+                if (y > 0) {
+                    const uint16_t up = cell - cols;
+                    if (x > 0 && parent[up - 1] != background) {
+                        ei_fomo_union(parent, cell, up - 1);
+                    }
+                    if (parent[up] != background) {
+                        ei_fomo_union(parent, cell, up);
+                    }
+                    if (x + 1 < cols && parent[up + 1] != background) {
+                        ei_fomo_union(parent, cell, up + 1);
+                    }
+                }
+            }
+        }
+
+        for (size_t y = 0; y < rows; y++) {
+            for (size_t x = 0; x < cols; x++) {
+                const uint16_t cell = y * cols + x;
+                if (parent[cell] == background) {
+                    continue;
+                }
+                const T v = class_data[cell * stride];
+                const uint16_t root = ei_fomo_find(parent, cell);
+                if (root == cell) {
+                    if (component_count == EI_FOMO_MAX_COMPONENTS) {
+                        return false;
+                    }
+                    component_of[cell] = component_count;
+                    components[component_count++] = { cell, (uint8_t)ix, false,
+                        (uint8_t)x, (uint8_t)y, (uint8_t)x, (uint8_t)y, v };
+                    continue;
+                }
+                ei_fomo_component_t<T> &c = components[component_of[root]];
+                if (x < c.x0) c.x0 = x;
+                if (x > c.x1) c.x1 = x;
+                if (y > c.y1) c.y1 = y;
+                if (v > c.max_value) c.max_value = v;
+            }
+        }
+    }
+
+    // components are grouped by class, order them by first cell (stable, so class order within a cell)
+    for (size_t i = 1; i < component_count; i++) {
+        ei_fomo_component_t<T> c = components[i];
+        size_t j = i;
+        while (j > 0 && components[j - 1].first_cell > c.first_cell) {
+            components[j] = components[j - 1];
+            j--;
+        }
+        components[j] = c;
+    }
+
+    // a component touching an earlier box of the same class is part of that object, the same
+    // test fill_result_struct_from_cubes() applies. Folded in before anything is reported.
+    for (size_t i = 0; i < component_count; i++) {
+        ei_fomo_component_t<T> &c = components[i];
+
+        for (size_t j = 0; j < i; j++) {
+            ei_fomo_component_t<T> &kept = components[j];
+            if (kept.merged || kept.label_ix != c.label_ix) continue;
+            if (kept.x1 + 1 < c.x0 || kept.y1 + 1 < c.y0 || kept.x0 > c.x1 + 1 || kept.y0 > c.y1 + 1) continue;
+
+            if (c.x0 < kept.x0) kept.x0 = c.x0;
+            if (c.y0 < kept.y0) kept.y0 = c.y0;
+            if (c.x1 > kept.x1) kept.x1 = c.x1;
+            if (c.y1 > kept.y1) kept.y1 = c.y1;
+            if (c.max_value > kept.max_value) kept.max_value = c.max_value;
+            c.merged = true;
+            break;
+        }
+    }
+
+    // boxes go straight into the result's storage, or into a per-thread buffer that keeps its size
+    size_t capacity;
+    ei_impulse_result_bounding_box_t *boxes = ei_result_box_storage(result, &capacity);
+    if (!boxes) {
+        static thread_local std::vector<ei_impulse_result_bounding_box_t> results;
+        results.resize(std::max<size_t>(component_count, impulse->object_detection_count));
+        boxes = results.data();
+        capacity = results.size();
+    }
+
+    const int out_width_factor = impulse->input_width / out_width;
+    size_t added_boxes_count = 0;
+
+    for (size_t i = 0; i < component_count && added_boxes_count < capacity; i++) {
+        const ei_fomo_component_t<T> &c = components[i];
+        if (c.merged) {
+            continue;
+        }
+
+        boxes[added_boxes_count++] = {
+            .label = impulse->categories[c.label_ix],
+            .x = (uint32_t)(c.x0 * out_width_factor),
+            .y = (uint32_t)(c.y0 * out_width_factor),
+            .width = (uint32_t)((c.x1 - c.x0 + 1) * out_width_factor),
+            .height = (uint32_t)((c.y1 - c.y0 + 1) * out_width_factor),
+            .value = to_confidence(c.max_value)
+        };
+    }
+
+    // if we didn't detect min required objects, fill the rest with fixed value
+    for (size_t ix = added_boxes_count; ix < impulse->object_detection_count && ix < capacity; ix++) {
+        boxes[ix] = { };
+    }
+
+    result->bounding_boxes = boxes;
+    result->bounding_boxes_count = added_boxes_count;
+    return true;
+}
+
+/**
+ * Smallest raw value that dequantizes to at least the threshold, so cells can be
+ * compared without converting them. 128 if no int8 value reaches it.
+ */
+__attribute__((unused)) static int ei_fomo_quantize_threshold(float threshold, float zero_point, float scale) {
+    float q = ceilf(threshold / scale + zero_point);
+    int v = q < -128.0f ? -128 : q > 128.0f ? 128 : (int)q;
+    // step over rounding differences with the dequantization the cube decoder does
+    while (v > -128 && static_cast<float>((v - 1) - zero_point) * scale >= threshold) {
+        v--;
+    }
+    while (v < 128 && static_cast<float>(v - zero_point) * scale < threshold) {
+        v++;
+    }
+    return v;
+}
+
+/**
+ * Running fusion of the FOMO output over consecutive frames. Pass one to
+ * run_classifier_with_buffers() for every frame, and every frame's
+ * confidences are blended into an exponential moving average that is decoded instead of
+ * the single frame. Cells that light up in most frames gain confidence, one-off noise
+ * fades, and a frame that just misses the threshold still counts towards the next.
+ */
+typedef struct ei_fomo_fusion {
+    float history_weight;   // share of the fused grid carried into the next frame, 0..1
+    uint32_t frames;        // frames fused since ei_fomo_fusion_init()
+    float grid[EI_FOMO_MAX_GRID_CELLS * (EI_CLASSIFIER_LABEL_COUNT + 1)];
+} ei_fomo_fusion_t;
+
+__attribute__((unused)) static void ei_fomo_fusion_init(ei_fomo_fusion_t *fusion, float history_weight) {
+    fusion->history_weight = history_weight;
+    fusion->frames = 0;
+}
+
+/**
+ * Blends one frame into the fusion grid (same layout as the output tensor), returns the
+ * grid, or nullptr when the output does not fit it.
+ */
+template<typename T, typename Confidence>
+static float *ei_fomo_fuse(ei_fomo_fusion_t *fusion, const ei_impulse_t *impulse, const T *data,
+                           Confidence to_confidence, int out_width, int out_height) {
+    const size_t stride = impulse->label_count + 1;
+    const size_t size = (size_t)out_width * out_height * stride;
+    if (impulse->label_count > EI_CLASSIFIER_LABEL_COUNT || (size_t)out_width * out_height > EI_FOMO_MAX_GRID_CELLS) {
+        return nullptr;
+    }
+
+    // the first frame starts the average, the grid may hold anything before it
+    if (fusion->frames == 0) {
+        for (size_t i = 0; i < size; i++) {
+            fusion->grid[i] = to_confidence(data[i]);
+        }
+    }
+    else {
+        const float keep = fusion->history_weight;
+        for (size_t i = 0; i < size; i++) {
+            fusion->grid[i] = keep * fusion->grid[i] + (1.0f - keep) * to_confidence(data[i]);
+        }
+    }
+    fusion->frames++;
+    return fusion->grid;
+}
+
+__attribute__((unused)) static void ei_fomo_decode_f32(const ei_impulse_t *impulse,
+                                                       const ei_learning_block_config_tflite_graph_t *block_config,
+                                                       ei_impulse_result_t *result,
+                                                       float *data,
+                                                       int out_width,
+                                                       int out_height) {
+    if (!ei_fomo_decode(impulse, result, data, block_config->threshold,
+                        [](float v) { return v; }, out_width, out_height)) {
+        fill_result_struct_f32_fomo_cubes(impulse, block_config, result, data, out_width, out_height);
+    }
+}
+#endif
+
+__attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_fomo(const ei_impulse_t *impulse,
+                                                                            const ei_learning_block_config_tflite_graph_t *block_config,
+                                                                            ei_impulse_result_t *result,
+                                                                            float *data,
+                                                                            int out_width,
+                                                                            int out_height) {
+#ifdef EI_HAS_FOMO
+    if (result->fomo_fusion) {
+        float *fused = ei_fomo_fuse(result->fomo_fusion, impulse, data, [](float v) { return v; }, out_width, out_height);
+        if (fused) {
+            data = fused;
+        }
+    }
+
+    ei_fomo_decode_f32(impulse, block_config, result, data, out_width, out_height);
+
+    return EI_IMPULSE_OK;
+#else
+    return EI_IMPULSE_LAST_LAYER_NOT_AVAILABLE;
+#endif
+}
+
+__attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_i8_fomo(const ei_impulse_t *impulse,
+                                                                           const ei_learning_block_config_tflite_graph_t *block_config,
+                                                                           ei_impulse_result_t *result,
+                                                                           int8_t *data,
+                                                                           float zero_point,
+                                                                           float scale,
+                                                                           int out_width,
+                                                                           int out_height) {
+#ifdef EI_HAS_FOMO
+    auto dequantize = [zero_point, scale](int8_t v) { return static_cast<float>(v - zero_point) * scale; };
+
+    if (result->fomo_fusion) {
+        float *fused = ei_fomo_fuse(result->fomo_fusion, impulse, data, dequantize, out_width, out_height);
+        if (fused) {
+            ei_fomo_decode_f32(impulse, block_config, result, fused, out_width, out_height);
+            return EI_IMPULSE_OK;
+        }
+    }
+
+    // a non-positive scale would flip the comparison, leave those to the cube decoder
+    bool decoded = scale > 0.0f &&
+        ei_fomo_decode(impulse, result, data, ei_fomo_quantize_threshold(block_config->threshold, zero_point, scale),
+                       dequantize, out_width, out_height);
+    if (!decoded) {
+        fill_result_struct_i8_fomo_cubes(impulse, block_config, result, data, zero_point, scale, out_width, out_height);
+    }
 
     return EI_IMPULSE_OK;
 #else
@@ -280,7 +668,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_object_de
                                                                                         float *labels,
                                                                                         bool debug) {
 #ifdef EI_HAS_SSD
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    static thread_local std::vector<ei_impulse_result_bounding_box_t> results;
     int added_boxes_count = 0;
     results.clear();
     results.resize(impulse->object_detection_count);
@@ -336,8 +724,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_object_de
             results[ix].value = 0.0f;
         }
     }
-    result->bounding_boxes = results.data();
-    result->bounding_boxes_count = added_boxes_count;
+    ei_result_set_bounding_boxes(result, results.data(), added_boxes_count, results.size());
 
     return EI_IMPULSE_OK;
 #else
@@ -423,7 +810,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_visual_ad_struct_f32
     result->visual_ad_result.mean_value = sum_val / (impulse->visual_ad_grid_size_x * impulse->visual_ad_grid_size_y);
     result->visual_ad_result.max_value = max_val;
 
-    static ei_vector<ei_impulse_result_bounding_box_t> results;
+    static thread_local ei_vector<ei_impulse_result_bounding_box_t> results;
 
     int added_boxes_count = 0;
     results.clear();
@@ -471,7 +858,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolov5(co
                                                                               size_t output_features_count,
                                                                               bool debug = false) {
 #ifdef EI_HAS_YOLOV5
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    static thread_local std::vector<ei_impulse_result_bounding_box_t> results;
     results.clear();
 
     size_t col_size = 5 + impulse->label_count;
@@ -548,8 +935,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolov5(co
         }
     }
 
-    result->bounding_boxes = results.data();
-    result->bounding_boxes_count = added_boxes_count;
+    ei_result_set_bounding_boxes(result, results.data(), added_boxes_count, results.size());
 
     return EI_IMPULSE_OK;
 #else
@@ -571,7 +957,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_quantized_yol
                                                                                     size_t output_features_count,
                                                                                     bool debug = false) {
 #ifdef EI_HAS_YOLOV5
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    static thread_local std::vector<ei_impulse_result_bounding_box_t> results;
     results.clear();
 
     size_t col_size = 5 + impulse->label_count;
@@ -648,8 +1034,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_quantized_yol
         }
     }
 
-    result->bounding_boxes = results.data();
-    result->bounding_boxes_count = added_boxes_count;
+    ei_result_set_bounding_boxes(result, results.data(), added_boxes_count, results.size());
 
     return EI_IMPULSE_OK;
 #else
@@ -668,7 +1053,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolox(con
                                                                              size_t output_features_count,
                                                                              bool debug = false) {
 #ifdef EI_HAS_YOLOX
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    static thread_local std::vector<ei_impulse_result_bounding_box_t> results;
     results.clear();
 
     // START: def yolox_postprocess()
@@ -853,8 +1238,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolox(con
         }
     }
 
-    result->bounding_boxes = results.data();
-    result->bounding_boxes_count = added_boxes_count;
+    ei_result_set_bounding_boxes(result, results.data(), added_boxes_count, results.size());
 
     return EI_IMPULSE_OK;
 #else
@@ -872,7 +1256,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolox_det
                                                                              float *data,
                                                                              size_t output_features_count) {
 #ifdef EI_HAS_YOLOX
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    static thread_local std::vector<ei_impulse_result_bounding_box_t> results;
     results.clear();
 
     // expected format [xmin ymin xmax ymax score label]
@@ -923,8 +1307,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolox_det
         }
     }
 
-    result->bounding_boxes = results.data();
-    result->bounding_boxes_count = results.size();
+    ei_result_set_bounding_boxes(result, results.data(), results.size(), results.size());
 
     return EI_IMPULSE_OK;
 #else
@@ -942,7 +1325,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolov7(co
                                                                               float *data,
                                                                               size_t output_features_count) {
 #ifdef EI_HAS_YOLOV7
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    static thread_local std::vector<ei_impulse_result_bounding_box_t> results;
     results.clear();
 
     size_t col_size = 7;
@@ -982,8 +1365,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolov7(co
         }
     }
 
-    result->bounding_boxes = results.data();
-    result->bounding_boxes_count = results.size();
+    ei_result_set_bounding_boxes(result, results.data(), results.size(), results.size());
 
     return EI_IMPULSE_OK;
 #else
@@ -1020,8 +1402,7 @@ __attribute__((unused)) static void prepare_tao_results_common(const ei_impulse_
         results->erase(results->begin() + EI_CLASSIFIER_OBJECT_DETECTION_KEEP_TOPK, results->end());
     }
 
-    result->bounding_boxes = results->data();
-    result->bounding_boxes_count = results->size();
+    ei_result_set_bounding_boxes(result, results->data(), results->size(), results->size());
 }
 
 
@@ -1044,8 +1425,8 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_tao_decode_de
     size_t col_size = 12 + impulse->label_count + 1;
     size_t row_count = output_features_count / col_size;
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    static thread_local std::vector<ei_impulse_result_bounding_box_t> results;
+    static thread_local std::vector<ei_impulse_result_bounding_box_t> class_results;
     results.clear();
 
     for (size_t cls_idx = 1; cls_idx < (size_t)(impulse->label_count + 1); cls_idx++)  {
@@ -1213,8 +1594,8 @@ __attribute__((unused)) static EI_IMPULSE_ERROR  fill_result_struct_tao_yolov3_c
     size_t col_size = 11 + impulse->label_count;
     size_t row_count = output_features_count / col_size;
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    static thread_local std::vector<ei_impulse_result_bounding_box_t> results;
+    static thread_local std::vector<ei_impulse_result_bounding_box_t> class_results;
 
     results.clear();
     for (size_t cls_idx = 0; cls_idx < (size_t)impulse->label_count; cls_idx++)  {
@@ -1307,8 +1688,8 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_tao_yolov4_co
     size_t col_size = 11 + impulse->label_count;
     size_t row_count = output_features_count / col_size;
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    static thread_local std::vector<ei_impulse_result_bounding_box_t> results;
+    static thread_local std::vector<ei_impulse_result_bounding_box_t> class_results;
     results.clear();
 
     const float grid_scale_xy = 1.0f;
@@ -1560,7 +1941,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolov2(co
                                                                               size_t output_features_count,
                                                                               bool debug = false) {
 #ifdef EI_HAS_YOLOV2
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    static thread_local std::vector<ei_impulse_result_bounding_box_t> results;
     results.clear();
 
     // Example output shape: (7, 7, 5, 7)
@@ -1712,8 +2093,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolov2(co
         }
     }
 
-    result->bounding_boxes = results.data();
-    result->bounding_boxes_count = added_boxes_count;
+    ei_result_set_bounding_boxes(result, results.data(), added_boxes_count, results.size());
 
     return EI_IMPULSE_OK;
 #else
@@ -136,7 +136,7 @@ typedef struct {
 typedef struct {
     uint32_t blockId;
     bool keep_output;
-    EI_IMPULSE_ERROR (*infer_fn)(const ei_impulse *impulse, ei_feature_t *fmatrix, uint32_t learn_block_index, uint32_t* input_block_ids, uint32_t input_block_ids_size, ei_impulse_result_t *result, void *config, bool debug);
+    EI_IMPULSE_ERROR (*infer_fn)(ei_impulse_handle_t *handle, ei_feature_t *fmatrix, uint32_t learn_block_index, uint32_t* input_block_ids, uint32_t input_block_ids_size, ei_impulse_result_t *result, void *config, bool debug);
     void *config;
     int image_scaling;
     const uint32_t* input_block_ids;
@@ -193,6 +193,14 @@ typedef struct {
     TfLiteStatus (*model_reset)(void (*free)(void* ptr));
     TfLiteStatus (*model_input)(int, TfLiteTensor*);
     TfLiteStatus (*model_output)(int, TfLiteTensor*);
+    // v1 ends here
+    // v2: same calls on a caller owned session, so several handles can run the model at once
+    size_t (*session_size)();
+    TfLiteStatus (*model_init_session)(void*, void*(*alloc_fnc)(size_t, size_t));
+    TfLiteStatus (*model_invoke_session)(void*);
+    TfLiteStatus (*model_reset_session)(void*, void (*free)(void* ptr));
+    TfLiteStatus (*model_input_session)(void*, int, TfLiteTensor*);
+    TfLiteStatus (*model_output_session)(void*, int, TfLiteTensor*);
 } ei_config_tflite_eon_graph_t;
 
 typedef struct {
@@ -298,6 +306,11 @@ typedef DspHandle* _dsp_handle_ptr_t;
 public:
     const ei_impulse_t *impulse; // keep a pointer to the impulse
     _dsp_handle_ptr_t *dsp_handles;
+    void **learning_block_sessions; // engine runtime state per learning block (EON sessions), ei_calloc'd by the engine
+    bool keep_learning_block_sessions = false; // sessions stay set up between runs, see run_classifier_keep_model()
+    uint32_t learning_block_sessions_ready = 0; // one bit per learning block whose session is set up and kept
+    ei::matrix_t *continuous_features = nullptr; // sliding window of run_classifier_continuous(), allocated on first use
+    uint64_t continuous_features_written = 0;
     bool is_temp_handle = false; // to know if we're using the old (stateless) API
     ei_impulse_state_t(const ei_impulse_t *impulse)
         : impulse(impulse)
@@ -307,6 +320,11 @@ public:
         for(size_t ix = 0; ix < num_dsp_blocks; ix++) {
             dsp_handles[ix] = nullptr;
         }
+        const auto num_learning_blocks = impulse->learning_blocks_size;
+        learning_block_sessions = (void**)ei_malloc(sizeof(void*)*num_learning_blocks);
+        for(size_t ix = 0; ix < num_learning_blocks; ix++) {
+            learning_block_sessions[ix] = nullptr;
+        }
     }
 
     DspHandle* get_dsp_handle(size_t ix) {
@@ -324,6 +342,7 @@ public:
                 dsp_handles[ix] = nullptr;
             }
         }
+        continuous_features_written = 0;
     }
 
     void* operator new(size_t size) {
@@ -346,6 +365,11 @@ public:
     {
         reset();
         ei_free(dsp_handles);
+        for (size_t ix = 0; ix < impulse->learning_blocks_size; ix++) {
+            ei_free(learning_block_sessions[ix]);
+        }
+        ei_free(learning_block_sessions);
+        delete continuous_features;
     }
 };
 
@@ -23,8 +23,6 @@
 #include "edge-impulse-sdk/classifier/ei_classifier_types.h"
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
 
-#if (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOV5) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOV5_V5_DRPAI) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOX) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_TAO_RETINANET) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_TAO_SSD) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_TAO_YOLOV3) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_TAO_YOLOV4) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOV2)
-
 // The code below comes from tensorflow/lite/kernels/internal/reference/non_max_suppression.h
 // Copyright 2019 The TensorFlow Authors.  All rights reserved.
 // Licensed under the Apache License, Version 2.0
@@ -197,6 +195,255 @@ static inline void NonMaxSuppression(const float* boxes, const int num_boxes,
   }
 }
 
+// Grid based NMS ---------------------------------------------------------------
+//
+// Gives the same selection as NonMaxSuppression() with soft_nms_sigma = 0 (candidates
+// with equal scores are taken in index order), but scales to thousands of candidates
+// and never allocates: everything lives in a workspace the caller provides.
+//  - candidates are popped from a heap by score, so only as many are ordered as it
+//    takes to fill max_output_size
+//  - kept boxes are registered in a grid over the candidates' extent with cells about
+//    the size of an average box, a candidate is only compared with kept boxes sharing
+//    a grid cell (boxes covering more than four cells are kept in a list every
+//    candidate checks)
+//  - boxes are stored as separate coordinate arrays and compared in fixed size blocks
+//    without branches, so the IoU loops vectorize on targets with float SIMD
+//  - with class_aware set, candidates are grouped by class and every class gets its
+//    own grid, i.e. per-class NMS for all classes in one call
+
+#define EI_NMS_GRID_SIZE 16
+#define EI_NMS_BLOCK     8
+
+typedef struct {
+    float *x0, *y0, *x1, *y1, *area;   // candidates, min/max corners
+    float *score;
+    int32_t *index, *cls;
+    int32_t *order;                    // candidate slots, grouped by class, then a heap per group
+    float *kx0, *ky0, *kx1, *ky1, *karea; // kept boxes of the current group, in selection order
+    int32_t *cell_head;                // per grid cell: first node
+    int32_t *node_next, *node_kept;    // up to 4 nodes per kept box
+    int32_t *large;                    // kept boxes covering more than 4 cells
+} ei_nms_workspace_t;
+
+/**
+ * Bytes of workspace ei_nms_grid() needs for up to max_candidates boxes
+ */
+static inline size_t ei_nms_workspace_size(size_t max_candidates) {
+    // 11 float and 4 int32 arrays of max_candidates, 2 int32 node arrays of 4x, the grid
+    // (plus slack to align the start of the buffer)
+    return (11 + 4 + 8) * sizeof(float) * max_candidates +
+        EI_NMS_GRID_SIZE * EI_NMS_GRID_SIZE * sizeof(int32_t) + sizeof(float);
+}
+
+static inline void ei_nms_carve_workspace(void *buffer, size_t n, ei_nms_workspace_t *ws) {
+    uintptr_t p = ((uintptr_t)buffer + sizeof(float) - 1) & ~(uintptr_t)(sizeof(float) - 1);
+    auto take_f = [&p](size_t count) { float *r = (float*)p; p += count * sizeof(float); return r; };
+    auto take_i = [&p](size_t count) { int32_t *r = (int32_t*)p; p += count * sizeof(int32_t); return r; };
+    ws->x0 = take_f(n); ws->y0 = take_f(n); ws->x1 = take_f(n); ws->y1 = take_f(n); ws->area = take_f(n);
+    ws->score = take_f(n);
+    ws->kx0 = take_f(n); ws->ky0 = take_f(n); ws->kx1 = take_f(n); ws->ky1 = take_f(n); ws->karea = take_f(n);
+    ws->index = take_i(n); ws->cls = take_i(n); ws->order = take_i(n); ws->large = take_i(n);
+    ws->node_next = take_i(4 * n); ws->node_kept = take_i(4 * n);
+    ws->cell_head = take_i(EI_NMS_GRID_SIZE * EI_NMS_GRID_SIZE);
+}
+
+// IoU as ComputeIntersectionOverUnion() computes it, on min/max corners
+static inline float ei_nms_iou(float ax0, float ay0, float ax1, float ay1, float aarea,
+                               float bx0, float by0, float bx1, float by1, float barea) {
+    const float inter =
+        std::max<float>(std::min<float>(ay1, by1) - std::max<float>(ay0, by0), 0.0) *
+        std::max<float>(std::min<float>(ax1, bx1) - std::max<float>(ax0, bx0), 0.0);
+    const float iou = inter / (aarea + barea - inter);
+    return (aarea <= 0 || barea <= 0) ? 0.0f : iou;
+}
+
+// Does any kept box suppress candidate c, checked in blocks
+static inline bool ei_nms_suppressed_linear(const ei_nms_workspace_t *ws, int32_t kept, int32_t c, float iou_threshold) {
+    const float cx0 = ws->x0[c], cy0 = ws->y0[c], cx1 = ws->x1[c], cy1 = ws->y1[c], carea = ws->area[c];
+    for (int32_t k = 0; k < kept; k += EI_NMS_BLOCK) {
+        const int32_t n = std::min<int32_t>(EI_NMS_BLOCK, kept - k);
+        int hit = 0;
+        for (int32_t i = 0; i < n; i++) {
+            hit |= ei_nms_iou(cx0, cy0, cx1, cy1, carea,
+                ws->kx0[k + i], ws->ky0[k + i], ws->kx1[k + i], ws->ky1[k + i], ws->karea[k + i]) >= iou_threshold;
+        }
+        if (hit) return true;
+    }
+    return false;
+}
+
+static inline bool ei_nms_suppressed_by(const ei_nms_workspace_t *ws, int32_t k, int32_t c, float iou_threshold) {
+    return ei_nms_iou(ws->x0[c], ws->y0[c], ws->x1[c], ws->y1[c], ws->area[c],
+        ws->kx0[k], ws->ky0[k], ws->kx1[k], ws->ky1[k], ws->karea[k]) >= iou_threshold;
+}
+
+// NMS over the candidates in order[begin, end), appends to the selection
+static inline int ei_nms_grid_group(ei_nms_workspace_t *ws, int32_t begin, int32_t end, int max_output_size,
+                                    float iou_threshold, int *selected_indices, float *selected_scores) {
+    int32_t *order = ws->order + begin;
+    const int32_t count = end - begin;
+
+    float gx0 = ws->x0[order[0]], gy0 = ws->y0[order[0]], gx1 = ws->x1[order[0]], gy1 = ws->y1[order[0]];
+    float sum_w = 0, sum_h = 0;
+    for (int32_t i = 0; i < count; i++) {
+        const int32_t c = order[i];
+        gx0 = std::min(gx0, ws->x0[c]); gy0 = std::min(gy0, ws->y0[c]);
+        gx1 = std::max(gx1, ws->x1[c]); gy1 = std::max(gy1, ws->y1[c]);
+        sum_w += ws->x1[c] - ws->x0[c];
+        sum_h += ws->y1[c] - ws->y0[c];
+    }
+
+    // cells about the size of an average box, so most boxes land in at most 2x2 cells.
+    // IoU 0 passes a threshold <= 0, then every kept box has to be checked.
+    const bool use_grid = iou_threshold > 0;
+    auto cells_for = [](float extent, float box) {
+        const float cells = box > 0 ? std::ceil(extent / box) : 1.0f;
+        return (int)std::min(std::max(cells, 1.0f), (float)EI_NMS_GRID_SIZE);
+    };
+    const int grid_w = cells_for(gx1 - gx0, sum_w / count);
+    const int grid_h = cells_for(gy1 - gy0, sum_h / count);
+    const float cell_w = std::max((gx1 - gx0) / grid_w, 1e-6f);
+    const float cell_h = std::max((gy1 - gy0) / grid_h, 1e-6f);
+    auto cell_x = [&](float x) { return std::min(std::max((int)((x - gx0) / cell_w), 0), grid_w - 1); };
+    auto cell_y = [&](float y) { return std::min(std::max((int)((y - gy0) / cell_h), 0), grid_h - 1); };
+    for (int i = 0; i < grid_w * grid_h; i++) {
+        ws->cell_head[i] = -1;
+    }
+
+    // max-heap on score, lower index first on ties
+    const float *score = ws->score;
+    auto lower = [score](int32_t a, int32_t b) {
+        return score[a] < score[b] || (score[a] == score[b] && a > b);
+    };
+    std::make_heap(order, order + count, lower);
+
+    int32_t kept = 0, large_count = 0, node_count = 0;
+    int32_t heap_size = count;
+    while (kept < max_output_size && heap_size > 0) {
+        std::pop_heap(order, order + heap_size, lower);
+        const int32_t c = order[--heap_size];
+
+        const int cx0 = cell_x(ws->x0[c]), cx1 = cell_x(ws->x1[c]);
+        const int cy0 = cell_y(ws->y0[c]), cy1 = cell_y(ws->y1[c]);
+        const bool small = use_grid && (cx1 - cx0 + 1) * (cy1 - cy0 + 1) <= 4;
+
+        bool suppressed = false;
+        if (!small) {
+            suppressed = ei_nms_suppressed_linear(ws, kept, c, iou_threshold);
+        }
+        else {
+            for (int y = cy0; y <= cy1 && !suppressed; y++) {
+                for (int x = cx0; x <= cx1 && !suppressed; x++) {
+                    for (int32_t n = ws->cell_head[y * grid_w + x]; n >= 0; n = ws->node_next[n]) {
+                        if (ei_nms_suppressed_by(ws, ws->node_kept[n], c, iou_threshold)) {
+                            suppressed = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            for (int32_t i = 0; i < large_count && !suppressed; i++) {
+                suppressed = ei_nms_suppressed_by(ws, ws->large[i], c, iou_threshold);
+            }
+        }
+        if (suppressed) continue;
+
+        ws->kx0[kept] = ws->x0[c]; ws->ky0[kept] = ws->y0[c]; ws->kx1[kept] = ws->x1[c]; ws->ky1[kept] = ws->y1[c];
+        ws->karea[kept] = ws->area[c];
+        if (small) {
+            for (int y = cy0; y <= cy1; y++) {
+                for (int x = cx0; x <= cx1; x++) {
+                    int32_t &head = ws->cell_head[y * grid_w + x];
+                    ws->node_kept[node_count] = kept;
+                    ws->node_next[node_count] = head;
+                    head = node_count++;
+                }
+            }
+        }
+        else {
+            ws->large[large_count++] = kept;
+        }
+
+        selected_indices[kept] = ws->index[c];
+        if (selected_scores) {
+            selected_scores[kept] = ws->score[c];
+        }
+        kept++;
+    }
+    return kept;
+}
+
+/**
+ * Non-max suppression without heap use.
+ *
+ * @param boxes           box encodings [y1, x1, y2, x2], shape [num_boxes, 4]
+ * @param scores          scores, shape [num_boxes]
+ * @param classes         class per box (only read when class_aware is set)
+ * @param num_boxes       number of candidates, at most the workspace's max_candidates
+ * @param max_output_size maximum number of selections
+ * @param iou_threshold   a candidate is dropped if its IoU with a kept box is >= this
+ * @param score_threshold only candidates scoring above this are considered
+ * @param class_aware     suppress only within the same class
+ * @param workspace       ei_nms_workspace_size(num_boxes) bytes
+ * @param selected_indices, selected_scores  outputs, max_output_size entries (num_boxes
+ *                        with class_aware), highest score first
+ * @return number of selected boxes
+ */
+static inline int ei_nms_grid(const float *boxes, int num_boxes, const float *scores, const int *classes,
+                              int max_output_size, float iou_threshold, float score_threshold, bool class_aware,
+                              void *workspace, int *selected_indices, float *selected_scores) {
+    ei_nms_workspace_t ws;
+    ei_nms_carve_workspace(workspace, num_boxes, &ws);
+
+    int32_t count = 0;
+    for (int i = 0; i < num_boxes; i++) {
+        if (!(scores[i] > score_threshold)) continue;
+        auto &b = reinterpret_cast<const BoxCornerEncoding*>(boxes)[i];
+        const float x0 = std::min<float>(b.x1, b.x2), x1 = std::max<float>(b.x1, b.x2);
+        const float y0 = std::min<float>(b.y1, b.y2), y1 = std::max<float>(b.y1, b.y2);
+        ws.x0[count] = x0; ws.y0[count] = y0; ws.x1[count] = x1; ws.y1[count] = y1;
+        ws.area[count] = (y1 - y0) * (x1 - x0);
+        ws.score[count] = scores[i];
+        ws.index[count] = i;
+        ws.cls[count] = class_aware && classes ? classes[i] : 0;
+        ws.order[count] = count;
+        count++;
+    }
+    if (count == 0 || max_output_size <= 0) return 0;
+
+    if (!class_aware) {
+        return ei_nms_grid_group(&ws, 0, count, max_output_size, iou_threshold, selected_indices, selected_scores);
+    }
+
+    const int32_t *cls = ws.cls;
+    std::sort(ws.order, ws.order + count, [cls](int32_t a, int32_t b) { return cls[a] < cls[b]; });
+
+    // every class keeps up to max_output_size boxes, the best of all of them are returned
+    int selected = 0;
+    for (int32_t begin = 0; begin < count; ) {
+        int32_t end = begin + 1;
+        while (end < count && cls[ws.order[end]] == cls[ws.order[begin]]) end++;
+        selected += ei_nms_grid_group(&ws, begin, end, max_output_size, iou_threshold,
+            selected_indices + selected, selected_scores ? selected_scores + selected : nullptr);
+        begin = end;
+    }
+
+    // merge the classes by score (lower index first on ties); scores are looked up by
+    // index since selected_scores is optional
+    std::sort(selected_indices, selected_indices + selected, [scores](int a, int b) {
+        return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+    });
+    if (selected > max_output_size) selected = max_output_size;
+    if (selected_scores) {
+        for (int i = 0; i < selected; i++) {
+            selected_scores[i] = scores[selected_indices[i]];
+        }
+    }
+    return selected;
+}
+
+#if (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOV5) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOV5_V5_DRPAI) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOX) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_TAO_RETINANET) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_TAO_SSD) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_TAO_YOLOV3) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_TAO_YOLOV4) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOV2)
+
 /**
  * Run non-max suppression over the results array (for bounding boxes)
  */
@@ -214,38 +461,33 @@ EI_IMPULSE_ERROR ei_run_nms(
         return EI_IMPULSE_OK;
     }
 
-    int *selected_indices = (int*)ei_malloc(1 * bb_count * sizeof(int));
-    float *selected_scores = (float*)ei_malloc(1 * bb_count * sizeof(float));
+    // one allocation for the outputs and the NMS workspace
+    uint8_t *buffer = (uint8_t*)ei_malloc(bb_count * (sizeof(int) + sizeof(float)) + ei_nms_workspace_size(bb_count));
 
-    if (!scores || !boxes || !selected_indices || !selected_scores || !classes) {
-        ei_free(selected_indices);
-        ei_free(selected_scores);
+    if (!scores || !boxes || !buffer || !classes) {
+        ei_free(buffer);
         return EI_IMPULSE_OUT_OF_MEMORY;
     }
 
-    //  boxes: box encodings in format [y1, x1, y2, x2], shape: [num_boxes, 4]
-    //  num_boxes: number of candidates
-    //  scores: scores for candidate boxes, in the same order. shape: [num_boxes]
-    //  max_output_size: the maximum number of selections.
-    //  iou_threshold: Intersection-over-Union (IoU) threshold for NMS
-    //  score_threshold: All candidate scores below this value are rejected
-    //  soft_nms_sigma: Soft NMS parameter, used for decaying scores
+    int *selected_indices = (int*)buffer;
+    float *selected_scores = (float*)(buffer + bb_count * sizeof(int));
+    void *workspace = buffer + bb_count * (sizeof(int) + sizeof(float));
 
-    int num_selected_indices;
-
-    NonMaxSuppression(
-        (const float*)boxes, // boxes
-        bb_count, // num_boxes
-        (const float*)scores, // scores
+    // class agnostic, like NonMaxSuppression() over all boxes
+    int num_selected_indices = ei_nms_grid(
+        (const float*)boxes,
+        bb_count,
+        (const float*)scores,
+        classes,
         bb_count, // max_output_size
-        impulse->object_detection_nms.iou_threshold, // iou_threshold
-        impulse->object_detection_nms.confidence_threshold, // score_threshold
-        0.0f, // soft_nms_sigma
+        impulse->object_detection_nms.iou_threshold,
+        impulse->object_detection_nms.confidence_threshold,
+        false, // class_aware
+        workspace,
         selected_indices,
-        selected_scores,
-        &num_selected_indices);
+        selected_scores);
 
-    std::vector<ei_impulse_result_bounding_box_t> new_results;
+    results->clear();
 
     for (size_t ix = 0; ix < (size_t)num_selected_indices; ix++) {
 
@@ -270,7 +512,7 @@ EI_IMPULSE_ERROR ei_run_nms(
         bb.x      = static_cast<uint32_t>(xmin);
         bb.height = static_cast<uint32_t>(ymax) - bb.y;
         bb.width  = static_cast<uint32_t>(xmax) - bb.x;
-        new_results.push_back(bb);
+        results->push_back(bb);
 
         if (debug) {
           ei_printf("Found bb with label %s\n", bb.label);
@@ -278,14 +520,7 @@ EI_IMPULSE_ERROR ei_run_nms(
 
     }
 
-    results->clear();
-
-    for (size_t ix = 0; ix < new_results.size(); ix++) {
-        results->push_back(new_results[ix]);
-    }
-
-    ei_free(selected_indices);
-    ei_free(selected_scores);
+    ei_free(buffer);
 
     return EI_IMPULSE_OK;
 
@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS
+ * IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language
+ * governing permissions and limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _EI_RUN_CASCADE_H_
+#define _EI_RUN_CASCADE_H_
+
+/*
+ * Two stage cascade: an object detection impulse finds the food at low resolution,
+ * a second (classification) impulse then looks at a crop of the full resolution frame
+ * around each of the strongest boxes and relabels them.
+ *
+ * Included from ei_run_classifier.h (inside its anonymous namespace), it builds on
+ * process_impulse(). Both impulses run one after the other through their own handle;
+ * each releases its tensor arena (and DSP buffers) before the next one sets up, so
+ * with heap allocation they take turns on the same memory.
+ */
+
+#if EIDSP_SIGNAL_C_FN_POINTER == 0 && !defined(__MBED__)
+
+#ifndef EI_CASCADE_MAX_CROPS
+#define EI_CASCADE_MAX_CROPS 4 /**< Upper bound of ei_cascade_config_t::max_crops */
+#endif
+
+/**
+ * Full resolution frame the first stage input was made from, by a center crop to
+ * the aspect ratio of the first impulse and a resize (crop_and_interpolate_rgb888).
+ */
+typedef struct {
+    const uint8_t *pixels; /**< 3 bytes per pixel, rows packed */
+    uint32_t width;
+    uint32_t height;
+    bool bgr;              /**< Channel order is B, G, R (as decoded by the ESP32 camera driver) */
+} ei_cascade_frame_t;
+
+typedef struct {
+    float context;      /**< Crop grows the box by this share of its size on every side */
+    uint32_t min_crop;  /**< Shortest side of a crop, in frame pixels */
+    uint32_t max_crops; /**< Only this many of the strongest boxes go to the second stage */
+    float min_value;    /**< Second stage score needed to relabel a box */
+} ei_cascade_config_t;
+
+/** Region of the full resolution frame, in frame pixels */
+typedef struct {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+} ei_cascade_region_t;
+
+/**
+ * @brief Region of the frame the second stage looks at for a first stage box.
+ *
+ * The box is mapped back from first stage input coordinates to the frame, grown by
+ * the context share, stretched to the aspect ratio of the second stage input (so
+ * nothing is squashed), brought up to min_crop and shifted to lie inside the frame.
+ */
+__attribute__((unused)) static void ei_cascade_crop_region(
+    const ei_impulse_t *first,
+    const ei_impulse_t *second,
+    const ei_cascade_frame_t *frame,
+    const ei_impulse_result_bounding_box_t *box,
+    const ei_cascade_config_t *config,
+    ei_cascade_region_t *region)
+{
+    int crop_width, crop_height;
+    ei::image::processing::calculate_crop_dims(frame->width, frame->height,
+        first->input_width, first->input_height, crop_width, crop_height);
+
+    const float scale = (float)crop_width / first->input_width;
+    const float center_x = (frame->width - crop_width) / 2 + (box->x + box->width / 2.0f) * scale;
+    const float center_y = (frame->height - crop_height) / 2 + (box->y + box->height / 2.0f) * scale;
+
+    const float aspect = (float)second->input_width / second->input_height;
+    float width = box->width * scale * (1 + 2 * config->context);
+    float height = box->height * scale * (1 + 2 * config->context);
+    if (width < height * aspect) {
+        width = height * aspect;
+    }
+    else {
+        height = width / aspect;
+    }
+
+    const float shortest = width < height ? width : height;
+    if (shortest < config->min_crop) {
+        width *= config->min_crop / shortest;
+        height *= config->min_crop / shortest;
+    }
+    if (width > frame->width) {
+        width = frame->width;
+        height = width / aspect;
+    }
+    if (height > frame->height) {
+        height = frame->height;
+        width = height * aspect;
+    }
+
+    region->width = (uint32_t)width;
+    region->height = (uint32_t)height;
+    float x = center_x - width / 2;
+    float y = center_y - height / 2;
+    x = x < 0 ? 0 : (x > frame->width - region->width ? frame->width - region->width : x);
+    y = y < 0 ? 0 : (y > frame->height - region->height ? frame->height - region->height : y);
+    region->x = (uint32_t)x;
+    region->y = (uint32_t)y;
+}
+
+/**
+ * @brief Bilinear resample of a frame region into a packed 3 byte per pixel buffer
+ *  of out_width x out_height, read straight from the frame without a copy of the region.
+ */
+__attribute__((unused)) static void ei_cascade_sample_region(
+    const ei_cascade_frame_t *frame,
+    const ei_cascade_region_t *region,
+    uint8_t *out,
+    uint32_t out_width,
+    uint32_t out_height)
+{
+    const float step_x = (float)region->width / out_width;
+    const float step_y = (float)region->height / out_height;
+    const size_t stride = frame->width * 3;
+
+    for (uint32_t oy = 0; oy < out_height; oy++) {
+        float sy = region->y + (oy + 0.5f) * step_y - 0.5f;
+        sy = sy < 0 ? 0 : sy;
+        uint32_t y0 = (uint32_t)sy;
+        if (y0 >= frame->height - 1) {
+            y0 = frame->height - 1;
+        }
+        const uint32_t y1 = y0 + 1 < frame->height ? y0 + 1 : y0;
+        const float fy = sy - y0;
+
+        for (uint32_t ox = 0; ox < out_width; ox++) {
+            float sx = region->x + (ox + 0.5f) * step_x - 0.5f;
+            sx = sx < 0 ? 0 : sx;
+            uint32_t x0 = (uint32_t)sx;
+            if (x0 >= frame->width - 1) {
+                x0 = frame->width - 1;
+            }
+            const uint32_t x1 = x0 + 1 < frame->width ? x0 + 1 : x0;
+            const float fx = sx - x0;
+
+            const uint8_t *p00 = frame->pixels + y0 * stride + x0 * 3;
+            const uint8_t *p01 = frame->pixels + y0 * stride + x1 * 3;
+            const uint8_t *p10 = frame->pixels + y1 * stride + x0 * 3;
+            const uint8_t *p11 = frame->pixels + y1 * stride + x1 * 3;
+            for (int c = 0; c < 3; c++) {
+                const float top = p00[c] + (p01[c] - p00[c]) * fx;
+                const float bottom = p10[c] + (p11[c] - p10[c]) * fx;
+                *out++ = (uint8_t)(top + (bottom - top) * fy + 0.5f);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Run an object detection impulse, then refine its strongest boxes with a
+ *  classifier impulse on full resolution crops.
+ *
+ * The first impulse runs as in run_classifier_with_buffers(), with the FOMO fusion
+ * state if one is given. Its strongest boxes (up to
+ * `config->max_crops`) are each cropped from `frame` (see ei_cascade_crop_region()),
+ * resampled to the input size of the second impulse and classified. When the best
+ * second stage score reaches `config->min_value` the box takes over that label and
+ * score, otherwise it keeps the first stage ones. Box coordinates are not changed.
+ * The time of the second stage runs is added to `result->timing`.
+ *
+ * **Blocking**: yes
+ *
+ * @param[in] first Handle of the object detection impulse.
+ * @param[in] second Handle of the classification impulse.
+ * @param[in] signal Signal with the first stage input, as for run_classifier().
+ * @param[out] result Result of the first stage, with the boxes relabeled.
+ * @param[in] frame Full resolution frame the first stage input was made from.
+ * @param[in] config Crop and acceptance settings.
+ * @param[in] crop_buffer Room for one second stage input,
+ *  `second->impulse->input_width * second->impulse->input_height * 3` bytes.
+ * @param[out] boxes Array for the first stage boxes, nullptr for the SDK's.
+ * @param[in] max_boxes Number of entries in `boxes`.
+ * @param[in,out] fomo_fusion FOMO fusion state of the first stage, nullptr to decode
+ *  every frame on its own.
+ * @param[in] deadline_us Absolute deadline for the whole cascade in `ei_read_timer_us()`
+ *  time, 0 disables it. Boxes still waiting for the second stage when it passes keep
+ *  their first stage labels.
+ * @param[in] debug Print internal preprocessing and inference debugging information via `ei_printf()`.
+ *
+ * @return `EI_IMPULSE_CANCELED` if the deadline passed during the first stage, otherwise
+ *  the error of the first failing stage, or `EI_IMPULSE_OK`.
+ */
+__attribute__((unused)) static EI_IMPULSE_ERROR run_classifier_cascade(
+    ei_impulse_handle_t *first,
+    ei_impulse_handle_t *second,
+    signal_t *signal,
+    ei_impulse_result_t *result,
+    const ei_cascade_frame_t *frame,
+    const ei_cascade_config_t *config,
+    uint8_t *crop_buffer,
+    ei_impulse_result_bounding_box_t *boxes = nullptr,
+    uint32_t max_boxes = 0,
+    ei_fomo_fusion_t *fomo_fusion = nullptr,
+    uint64_t deadline_us = 0,
+    bool debug = false)
+{
+    ei_run_impulse_set_deadline_us(deadline_us);
+    EI_IMPULSE_ERROR res = process_impulse_with_buffers(first, signal, result, boxes, max_boxes,
+        fomo_fusion, debug);
+    if (res != EI_IMPULSE_OK) {
+        ei_run_impulse_set_deadline_us(0);
+        return res;
+    }
+
+    const ei_impulse_t *second_impulse = second->impulse;
+    const uint32_t crop_width = second_impulse->input_width;
+    const uint32_t crop_height = second_impulse->input_height;
+
+    signal_t crop_signal;
+    crop_signal.total_length = crop_width * crop_height;
+    crop_signal.get_data = [crop_buffer, frame](size_t offset, size_t length, float *out_ptr) {
+        const uint8_t *p = crop_buffer + offset * 3;
+        for (size_t i = 0; i < length; i++, p += 3) {
+            out_ptr[i] = frame->bgr ? (float)((p[2] << 16) + (p[1] << 8) + p[0])
+                                    : (float)((p[0] << 16) + (p[1] << 8) + p[2]);
+        }
+        return EIDSP_OK;
+    };
+
+    // Pick the strongest boxes up front, refining one changes its score
+    uint32_t picked[EI_CASCADE_MAX_CROPS];
+    uint32_t picked_count = 0;
+    const uint32_t max_crops = config->max_crops < EI_CASCADE_MAX_CROPS ? config->max_crops : EI_CASCADE_MAX_CROPS;
+    for (uint32_t i = 0; i < result->bounding_boxes_count; i++) {
+        const ei_impulse_result_bounding_box_t &box = result->bounding_boxes[i];
+        if (box.value <= 0 || box.width == 0 || box.height == 0) {
+            continue;
+        }
+        // insertion into the short list, strongest first
+        uint32_t at = picked_count;
+        while (at > 0 && result->bounding_boxes[picked[at - 1]].value < box.value) {
+            at--;
+        }
+        if (at >= max_crops) {
+            continue;
+        }
+        if (picked_count < max_crops) {
+            picked_count++;
+        }
+        for (uint32_t j = picked_count - 1; j > at; j--) {
+            picked[j] = picked[j - 1];
+        }
+        picked[at] = i;
+    }
+
+    for (uint32_t n = 0; n < picked_count; n++) {
+        ei_impulse_result_bounding_box_t *box = &result->bounding_boxes[picked[n]];
+
+        ei_cascade_region_t region;
+        ei_cascade_crop_region(first->impulse, second_impulse, frame, box, config, &region);
+        ei_cascade_sample_region(frame, &region, crop_buffer, crop_width, crop_height);
+
+        // Boxes of the second stage go into storage of their own, the SDK owned
+        // boxes may still hold the result of the first stage
+        ei_impulse_result_bounding_box_t crop_boxes[EI_CLASSIFIER_MAX_OBJECT_DETECTION_COUNT];
+        ei_impulse_result_t crop_result;
+        res = process_impulse_with_buffers(second, &crop_signal, &crop_result, crop_boxes,
+            EI_CLASSIFIER_MAX_OBJECT_DETECTION_COUNT, nullptr, debug);
+        if (res == EI_IMPULSE_CANCELED) {
+            break; // out of time, the remaining boxes keep their first stage labels
+        }
+        if (res != EI_IMPULSE_OK) {
+            ei_run_impulse_set_deadline_us(0);
+            return res;
+        }
+
+        result->timing.dsp += crop_result.timing.dsp;
+        result->timing.classification += crop_result.timing.classification;
+        result->timing.dsp_us += crop_result.timing.dsp_us;
+        result->timing.classification_us += crop_result.timing.classification_us;
+
+        const char *label = nullptr;
+        float value = 0;
+        for (uint32_t i = 0; i < crop_result.bounding_boxes_count; i++) {
+            if (crop_result.bounding_boxes[i].value > value) {
+                label = crop_result.bounding_boxes[i].label;
+                value = crop_result.bounding_boxes[i].value;
+            }
+        }
+        const uint32_t label_count = sizeof(crop_result.classification) / sizeof(crop_result.classification[0]);
+        for (uint32_t i = 0; i < second_impulse->label_count && i < label_count; i++) {
+            if (crop_result.classification[i].value > value) {
+                label = crop_result.classification[i].label;
+                value = crop_result.classification[i].value;
+            }
+        }
+
+        if (label != nullptr && value >= config->min_value) {
+            box->label = label;
+            box->value = value;
+        }
+    }
+
+    ei_run_impulse_set_deadline_us(0);
+    return EI_IMPULSE_OK;
+}
+
+#endif // EIDSP_SIGNAL_C_FN_POINTER == 0 && !defined(__MBED__)
+
+#endif // _EI_RUN_CASCADE_H_
@@ -22,12 +22,14 @@
 #include "model-parameters/model_metadata.h"
 
 #include "ei_run_dsp.h"
+#include "ei_run_deadline.h"
 #include "ei_classifier_types.h"
 #include "ei_signal_with_axes.h"
 #include "postprocessing/ei_postprocessing.h"
 
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
 #include "edge-impulse-sdk/porting/ei_logging.h"
+#include "edge-impulse-sdk/dsp/image/processing.hpp"
 #include <memory>
 
 #if EI_CLASSIFIER_HAS_ANOMALY
@@ -75,7 +77,7 @@ namespace {
 
 /* Function prototypes ----------------------------------------------------- */
 extern "C" EI_IMPULSE_ERROR run_inference(ei_impulse_handle_t *handle, ei_feature_t *fmatrix, ei_impulse_result_t *result, bool debug);
-extern "C" EI_IMPULSE_ERROR run_classifier_image_quantized(const ei_impulse_t *impulse, signal_t *signal, ei_impulse_result_t *result, bool debug);
+extern "C" EI_IMPULSE_ERROR run_classifier_image_quantized(ei_impulse_handle_t *handle, signal_t *signal, ei_impulse_result_t *result, bool debug);
 static EI_IMPULSE_ERROR can_run_classifier_image_quantized(const ei_impulse_t *impulse, ei_learning_block_t block_ptr);
 
 #if EI_CLASSIFIER_LOAD_IMAGE_SCALING
@@ -85,8 +87,6 @@ EI_IMPULSE_ERROR ei_unscale_fmatrix(ei_learning_block_t *block, ei::matrix_t *fm
 
 /* Private variables ------------------------------------------------------- */
 
-static uint64_t classifier_continuous_features_written = 0;
-
 /* Private functions ------------------------------------------------------- */
 
 /* These functions (up to Public functions section) are not exposed to end-user,
@@ -188,7 +188,7 @@ extern "C" EI_IMPULSE_ERROR run_inference(
 
         result->copy_output = block.keep_output;
 
-        EI_IMPULSE_ERROR res = block.infer_fn(impulse, fmatrix, ix, (uint32_t*)block.input_block_ids, block.input_block_ids_size, result, block.config, debug);
+        EI_IMPULSE_ERROR res = block.infer_fn(handle, fmatrix, ix, (uint32_t*)block.input_block_ids, block.input_block_ids_size, result, block.config, debug);
         if (res != EI_IMPULSE_OK) {
             return res;
         }
@@ -202,7 +202,7 @@ extern "C" EI_IMPULSE_ERROR run_inference(
 #endif
     }
 
-    if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
+    if (ei_run_impulse_check_interrupted() == EI_IMPULSE_CANCELED) {
         return EI_IMPULSE_CANCELED;
     }
 
@@ -210,30 +210,41 @@ extern "C" EI_IMPULSE_ERROR run_inference(
 }
 
 /**
- * @brief      Process a complete impulse
+ * @brief      Process a complete impulse, with the box storage and FOMO fusion state
+ *             of the caller
  *
- * @param      impulse  struct with information about model and DSP
- * @param      signal   Sample data
- * @param      result   Output classifier results
- * @param      handle   Handle from open_impulse. nullptr for backward compatibility
- * @param[in]  debug    Debug output enable
+ * @param      handle       Handle from open_impulse. nullptr for backward compatibility
+ * @param      signal       Sample data
+ * @param      result       Output classifier results, cleared first
+ * @param      boxes        Caller owned array for the bounding boxes, nullptr for the SDK's
+ * @param      max_boxes    Number of entries in boxes
+ * @param      fomo_fusion  FOMO fusion state, nullptr to decode the frame on its own
+ * @param[in]  debug        Debug output enable
  *
  * @return     The ei impulse error.
  */
-extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
-                                            signal_t *signal,
-                                            ei_impulse_result_t *result,
-                                            bool debug = false)
+extern "C" EI_IMPULSE_ERROR process_impulse_with_buffers(ei_impulse_handle_t *handle,
+                                                         signal_t *signal,
+                                                         ei_impulse_result_t *result,
+                                                         ei_impulse_result_bounding_box_t *boxes,
+                                                         uint32_t max_boxes,
+                                                         ei_fomo_fusion_t *fomo_fusion,
+                                                         bool debug = false)
 {
     if(!handle) {
         return EI_IMPULSE_INFERENCE_ERROR;
     }
 
+#ifndef EI_DSP_RESULT_OVERRIDE
+    // Don't wipe in CI, as we store a pointer
+    ei_impulse_result_reset(result, boxes, max_boxes, fomo_fusion);
+#endif
+
 #if (EI_CLASSIFIER_QUANTIZATION_ENABLED == 1 && (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE || EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TENSAIFLOW || EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_ONNX_TIDL)) || EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_DRPAI
     // Shortcut for quantized image models
     ei_learning_block_t block = handle->impulse->learning_blocks[0];
     if (can_run_classifier_image_quantized(handle->impulse, block) == EI_IMPULSE_OK) {
-        EI_IMPULSE_ERROR res = run_classifier_image_quantized(handle->impulse, signal, result, debug);
+        EI_IMPULSE_ERROR res = run_classifier_image_quantized(handle, signal, result, debug);
         if (res != EI_IMPULSE_OK) {
             return res;
         }
@@ -242,10 +253,6 @@ extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
     }
 #endif
 
-#ifndef EI_DSP_RESULT_OVERRIDE
-    // Don't wipe in CI, as we store a pointer
-    memset(result, 0, sizeof(ei_impulse_result_t));
-#endif
     uint32_t block_num = handle->impulse->dsp_blocks_size + handle->impulse->learning_blocks_size;
 
     // smart pointer to features array
@@ -309,12 +316,16 @@ extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
             ret = block.extract_fn(internal_signal, features[ix].matrix, block.config, handle->impulse->frequency);
         }
 
+        if (ret == EIDSP_CANCELED) {
+            return EI_IMPULSE_CANCELED;
+        }
+
         if (ret != EIDSP_OK) {
             ei_printf("ERR: Failed to run DSP process (%d)\n", ret);
             return EI_IMPULSE_DSP_ERROR;
         }
 
-        if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
+        if (ei_run_impulse_check_interrupted() == EI_IMPULSE_CANCELED) {
             return EI_IMPULSE_CANCELED;
         }
 
@@ -366,6 +377,24 @@ extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
 #endif
 }
 
+/**
+ * @brief      Process a complete impulse
+ *
+ * @param      handle   Handle from open_impulse. nullptr for backward compatibility
+ * @param      signal   Sample data
+ * @param      result   Output classifier results
+ * @param[in]  debug    Debug output enable
+ *
+ * @return     The ei impulse error.
+ */
+extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
+                                            signal_t *signal,
+                                            ei_impulse_result_t *result,
+                                            bool debug = false)
+{
+    return process_impulse_with_buffers(handle, signal, result, nullptr, 0, nullptr, debug);
+}
+
 /**
  * @brief      Opens an impulse
  *
@@ -397,12 +426,15 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
                                             bool debug)
 {
     auto impulse = handle->impulse;
-    static ei::matrix_t static_features_matrix(1, impulse->nn_input_frame_size);
-    if (!static_features_matrix.buffer) {
+    if (!handle->state.continuous_features) {
+        handle->state.continuous_features = new ei::matrix_t(1, impulse->nn_input_frame_size);
+    }
+    ei::matrix_t &continuous_features = *handle->state.continuous_features;
+    if (!continuous_features.buffer) {
         return EI_IMPULSE_ALLOC_FAILED;
     }
 
-    memset(result, 0, sizeof(ei_impulse_result_t));
+    ei_impulse_result_reset(result, nullptr, 0, nullptr);
 
     EI_IMPULSE_ERROR ei_impulse_error = EI_IMPULSE_OK;
 
@@ -419,7 +451,7 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
         }
 
         ei::matrix_t fm(1, block.n_output_features,
-                        static_features_matrix.buffer + out_features_index);
+                        continuous_features.buffer + out_features_index);
 
         int (*extract_fn_slice)(ei::signal_t *signal, ei::matrix_t *output_matrix, void *config, const float frequency, matrix_size_t *out_matrix_size);
 
@@ -451,16 +483,20 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
         int ret = extract_fn_slice(swa.get_signal(), &fm, block.config, impulse->frequency, &features_written);
 #endif
 
+        if (ret == EIDSP_CANCELED) {
+            return EI_IMPULSE_CANCELED;
+        }
+
         if (ret != EIDSP_OK) {
             ei_printf("ERR: Failed to run DSP process (%d)\n", ret);
             return EI_IMPULSE_DSP_ERROR;
         }
 
-        if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
+        if (ei_run_impulse_check_interrupted() == EI_IMPULSE_CANCELED) {
             return EI_IMPULSE_CANCELED;
         }
 
-        classifier_continuous_features_written += (features_written.rows * features_written.cols);
+        handle->state.continuous_features_written += (features_written.rows * features_written.cols);
 
         out_features_index += block.n_output_features;
     }
@@ -473,7 +509,7 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
         result->classification[i].label = impulse->categories[(uint32_t)i];
     }
 
-    if (classifier_continuous_features_written >= impulse->nn_input_frame_size) {
+    if (handle->state.continuous_features_written >= impulse->nn_input_frame_size) {
         dsp_start_us = ei_read_timer_us();
 
         uint32_t block_num = impulse->dsp_blocks_size + impulse->learning_blocks_size;
@@ -496,7 +532,7 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
 
             /* Create a copy of the matrix for normalization */
             for (size_t m_ix = 0; m_ix < block.n_output_features; m_ix++) {
-                features[ix].matrix->buffer[m_ix] = static_features_matrix.buffer[out_features_index + m_ix];
+                features[ix].matrix->buffer[m_ix] = continuous_features.buffer[out_features_index + m_ix];
             }
 
             if (block.extract_fn == extract_mfcc_features) {
@@ -574,17 +610,15 @@ __attribute__((unused)) static EI_IMPULSE_ERROR can_run_classifier_image_quantiz
 /**
  * Special function to run the classifier on images, only works on TFLite models (either interpreter, EON, tensaiflow, drpai, tidl, memryx)
  * that allocates a lot less memory by quantizing in place. This only works if 'can_run_classifier_image_quantized'
- * returns EI_IMPULSE_OK.
+ * returns EI_IMPULSE_OK. The result is cleared by the caller (see ei_impulse_result_reset()).
  */
 extern "C" EI_IMPULSE_ERROR run_classifier_image_quantized(
-    const ei_impulse_t *impulse,
+    ei_impulse_handle_t *handle,
     signal_t *signal,
     ei_impulse_result_t *result,
     bool debug = false)
 {
-    memset(result, 0, sizeof(ei_impulse_result_t));
-
-    return run_nn_inference_image_quantized(impulse, signal, result, impulse->learning_blocks[0].config, debug);
+    return run_nn_inference_image_quantized(handle, signal, result, handle->impulse->learning_blocks[0].config, debug);
 }
 
 #endif // #if EI_CLASSIFIER_QUANTIZATION_ENABLED == 1 && (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE || EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TENSAIFLOW || EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_DRPAI)
@@ -742,8 +776,6 @@ will be documented by Doxygen. */
  */
 extern "C" void run_classifier_init(void)
 {
-
-    classifier_continuous_features_written = 0;
     ei_dsp_clear_continuous_audio_state();
     init_impulse(&ei_default_impulse);
     init_postprocessing(&ei_default_impulse);
@@ -765,7 +797,6 @@ extern "C" void run_classifier_init(void)
  */
 __attribute__((unused)) void run_classifier_init(ei_impulse_handle_t *handle)
 {
-    classifier_continuous_features_written = 0;
     ei_dsp_clear_continuous_audio_state();
     init_impulse(handle);
     init_postprocessing(handle);
@@ -971,8 +1002,198 @@ __attribute__((unused)) EI_IMPULSE_ERROR run_classifier(
     return process_impulse(impulse, signal, result, debug);
 }
 
+/**
+ * @brief Run the classifier, giving up once a deadline has passed.
+ *
+ * Same as [run_classifier()](#run_classifier), but the impulse is abandoned as soon as
+ * `ei_read_timer_us()` reaches `deadline_us`. The deadline is checked between DSP pages,
+ * between blocks and between the layers of an EON compiled model, so the overshoot is bounded
+ * by the slowest single layer rather than by the whole impulse.
+ *
+ * **Blocking**: yes, until the impulse completes or the deadline passes
+ *
+ * @param[in] signal Pointer to a `signal_t` struct that contains the total length of the raw
+ *  feature array and a pointer to a callback that reads in the raw features.
+ * @param[out] result  Pointer to an ei_impulse_result_t struct that will contain the various output
+ *  results from inference. Contents are undefined when the call is canceled.
+ * @param[in] deadline_us Absolute deadline in `ei_read_timer_us()` time, 0 disables the deadline.
+ * @param[in] debug Print internal preprocessing and inference debugging information via `ei_printf()`.
+ *
+ * @return `EI_IMPULSE_CANCELED` if the deadline passed, otherwise the same error codes as
+ *  `run_classifier()`.
+ */
+extern "C" EI_IMPULSE_ERROR run_classifier_with_deadline(
+    signal_t *signal,
+    ei_impulse_result_t *result,
+    uint64_t deadline_us,
+    bool debug = false)
+{
+    ei_run_impulse_set_deadline_us(deadline_us);
+    EI_IMPULSE_ERROR res = process_impulse(&ei_default_impulse, signal, result, debug);
+    ei_run_impulse_set_deadline_us(0);
+    return res;
+}
+
+/**
+ * @brief Run the classifier, giving up once a deadline has passed.
+ *
+ * Overloaded function [run_classifier_with_deadline()](#run_classifier_with_deadline) that
+ * takes an impulse handle.
+ *
+ * @param[in] impulse Pointer to an `ei_impulse_handle_t` struct that contains the model and
+ *  preprocessing information.
+ * @param[in] signal Pointer to a `signal_t` struct with the raw features.
+ * @param[out] result  Pointer to an ei_impulse_result_t struct for the output.
+ * @param[in] deadline_us Absolute deadline in `ei_read_timer_us()` time, 0 disables the deadline.
+ * @param[in] debug Print internal preprocessing and inference debugging information via `ei_printf()`.
+ *
+ * @return `EI_IMPULSE_CANCELED` if the deadline passed, otherwise the same error codes as
+ *  `run_classifier()`.
+ */
+__attribute__((unused)) EI_IMPULSE_ERROR run_classifier_with_deadline(
+    ei_impulse_handle_t *impulse,
+    signal_t *signal,
+    ei_impulse_result_t *result,
+    uint64_t deadline_us,
+    bool debug = false)
+{
+    ei_run_impulse_set_deadline_us(deadline_us);
+    EI_IMPULSE_ERROR res = process_impulse(impulse, signal, result, debug);
+    ei_run_impulse_set_deadline_us(0);
+    return res;
+}
+
+/**
+ * @brief Run the classifier, writing bounding boxes into a caller owned array.
+ *
+ * Same as [run_classifier()](#run_classifier), but the detections are stored in `boxes`
+ * instead of in buffers inside the SDK, so they stay valid across later inferences and
+ * can be handed to another thread. Nothing is allocated for the result. Classification
+ * scores are always stored in `result->classification`. With `fomo_fusion`, the output of
+ * a FOMO model is fused with that of the previous frames before it is decoded, and with
+ * `deadline_us` the impulse gives up as in
+ * [run_classifier_with_deadline()](#run_classifier_with_deadline).
+ *
+ * Everything the call needs comes from its arguments: `result` is cleared first and may
+ * be uninitialized.
+ *
+ * **Blocking**: yes
+ *
+ * @param[in] signal Pointer to a `signal_t` struct that contains the total length of the raw
+ *  feature array and a pointer to a callback that reads in the raw features.
+ * @param[out] result  Pointer to an ei_impulse_result_t struct that will contain the various output
+ *  results from inference. `result->bounding_boxes` will point at `boxes`.
+ * @param[out] boxes Array for the bounding boxes, `EI_CLASSIFIER_OBJECT_DETECTION_COUNT` entries
+ *  hold every box the model reports. nullptr keeps the boxes in the SDK as `run_classifier()` does.
+ * @param[in] max_boxes Number of entries in `boxes`, detections beyond it are dropped.
+ * @param[in,out] fomo_fusion FOMO fusion state (see `ei_fomo_fusion_t`), nullptr to decode every
+ *  frame on its own.
+ * @param[in] deadline_us Absolute deadline in `ei_read_timer_us()` time, 0 disables the deadline.
+ * @param[in] debug Print internal preprocessing and inference debugging information via `ei_printf()`.
+ *
+ * @return Error code as defined by `EI_IMPULSE_ERROR` enum. Will be `EI_IMPULSE_OK` if inference
+ *  completed successfully, `EI_IMPULSE_CANCELED` if the deadline passed.
+ */
+extern "C" EI_IMPULSE_ERROR run_classifier_with_buffers(
+    signal_t *signal,
+    ei_impulse_result_t *result,
+    ei_impulse_result_bounding_box_t *boxes,
+    uint32_t max_boxes,
+    ei_fomo_fusion_t *fomo_fusion = nullptr,
+    uint64_t deadline_us = 0,
+    bool debug = false)
+{
+    ei_run_impulse_set_deadline_us(deadline_us);
+    EI_IMPULSE_ERROR res = process_impulse_with_buffers(&ei_default_impulse, signal, result,
+        boxes, max_boxes, fomo_fusion, debug);
+    ei_run_impulse_set_deadline_us(0);
+    return res;
+}
+
+/**
+ * @brief Run the classifier, writing bounding boxes into a caller owned array.
+ *
+ * Overloaded function [run_classifier_with_buffers()](#run_classifier_with_buffers) that
+ * takes an impulse handle.
+ *
+ * @param[in] impulse Pointer to an `ei_impulse_handle_t` struct that contains the model and
+ *  preprocessing information.
+ * @param[in] signal Pointer to a `signal_t` struct with the raw features.
+ * @param[out] result  Pointer to an ei_impulse_result_t struct for the output.
+ * @param[out] boxes Array for the bounding boxes, nullptr for the SDK's.
+ * @param[in] max_boxes Number of entries in `boxes`, detections beyond it are dropped.
+ * @param[in,out] fomo_fusion FOMO fusion state, nullptr to decode every frame on its own.
+ * @param[in] deadline_us Absolute deadline in `ei_read_timer_us()` time, 0 disables the deadline.
+ * @param[in] debug Print internal preprocessing and inference debugging information via `ei_printf()`.
+ *
+ * @return Error code as defined by `EI_IMPULSE_ERROR` enum. Will be `EI_IMPULSE_OK` if inference
+ *  completed successfully, `EI_IMPULSE_CANCELED` if the deadline passed.
+ */
+__attribute__((unused)) EI_IMPULSE_ERROR run_classifier_with_buffers(
+    ei_impulse_handle_t *impulse,
+    signal_t *signal,
+    ei_impulse_result_t *result,
+    ei_impulse_result_bounding_box_t *boxes,
+    uint32_t max_boxes,
+    ei_fomo_fusion_t *fomo_fusion = nullptr,
+    uint64_t deadline_us = 0,
+    bool debug = false)
+{
+    ei_run_impulse_set_deadline_us(deadline_us);
+    EI_IMPULSE_ERROR res = process_impulse_with_buffers(impulse, signal, result,
+        boxes, max_boxes, fomo_fusion, debug);
+    ei_run_impulse_set_deadline_us(0);
+    return res;
+}
+
+/**
+ * @brief Set the model up now and keep it set up between runs.
+ *
+ * Normally every run sets the model up (tensor arena, kernel data) and releases it
+ * afterwards. After this call the runs on `handle` skip both, which takes the setup
+ * off the first and every later inference. Call it while there is time to spare,
+ * e.g. while waiting for the network. The tensor arena stays allocated until
+ * run_classifier_release_model(); other impulses running next to it need memory of
+ * their own. Only compiled (EON) models keep anything, for the others this does
+ * nothing.
+ *
+ * **Blocking**: yes
+ *
+ * @param[in] handle Impulse handle whose model to keep set up.
+ *
+ * @return Error code as defined by `EI_IMPULSE_ERROR` enum. Will be `EI_IMPULSE_OK` if the
+ *  model is set up, runs set it up themselves otherwise.
+ */
+__attribute__((unused)) EI_IMPULSE_ERROR run_classifier_keep_model(
+    ei_impulse_handle_t *handle = &ei_default_impulse)
+{
+#if EI_CLASSIFIER_COMPILED == 1
+    return eon_keep_sessions(handle);
+#else
+    (void)handle;
+    return EI_IMPULSE_OK;
+#endif
+}
+
+/**
+ * @brief Release the model run_classifier_keep_model() kept set up.
+ *
+ * @param[in] handle Impulse handle passed to run_classifier_keep_model().
+ */
+__attribute__((unused)) void run_classifier_release_model(
+    ei_impulse_handle_t *handle = &ei_default_impulse)
+{
+#if EI_CLASSIFIER_COMPILED == 1
+    eon_release_sessions(handle);
+#else
+    (void)handle;
+#endif
+}
+
 /** @} */ // end of ei_functions Doxygen group
 
+#include "ei_run_cascade.h"
+
 /* Deprecated functions ------------------------------------------------------- */
 
 /* These functions are being deprecated and possibly will be removed or moved in future.
@@ -1031,7 +1252,7 @@ __attribute__((unused)) EI_IMPULSE_ERROR run_impulse(
         }
 #endif
 
-        if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
+        if (ei_run_impulse_check_interrupted() == EI_IMPULSE_CANCELED) {
             free(x);
             return EI_IMPULSE_CANCELED;
         }
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS
+ * IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language
+ * governing permissions and limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _EI_RUN_DEADLINE_H_
+#define _EI_RUN_DEADLINE_H_
+
+#include <stdint.h>
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+/**
+ * Deadline of the impulse that is currently running on this thread, in ei_read_timer_us()
+ * time. 0 means no deadline. Header-only, the function local static is shared by all
+ * translation units.
+ */
+inline uint64_t& ei_run_impulse_deadline_us() {
+    static thread_local uint64_t deadline_us = 0;
+    return deadline_us;
+}
+
+/**
+ * Set (or with 0, clear) the deadline for the impulse that is about to run on this thread
+ */
+inline void ei_run_impulse_set_deadline_us(uint64_t deadline_us) {
+    ei_run_impulse_deadline_us() = deadline_us;
+}
+
+/**
+ * Polled between DSP pages, between DSP/learning blocks and between the layers of
+ * the neural network. Returns EI_IMPULSE_CANCELED when the deadline has passed or
+ * when the application cancels through ei_run_impulse_check_canceled().
+ */
+inline EI_IMPULSE_ERROR ei_run_impulse_check_interrupted() {
+    const uint64_t deadline_us = ei_run_impulse_deadline_us();
+    if (deadline_us != 0 && ei_read_timer_us() >= deadline_us) {
+        return EI_IMPULSE_CANCELED;
+    }
+    return ei_run_impulse_check_canceled();
+}
+
+#endif // _EI_RUN_DEADLINE_H_
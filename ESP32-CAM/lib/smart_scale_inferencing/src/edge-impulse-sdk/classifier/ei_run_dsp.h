@@ -22,6 +22,7 @@
 #include "edge-impulse-sdk/dsp/spectral/spectral.hpp"
 #include "edge-impulse-sdk/dsp/speechpy/speechpy.hpp"
 #include "edge-impulse-sdk/classifier/ei_signal_with_range.h"
+#include "edge-impulse-sdk/classifier/ei_run_deadline.h"
 #include "edge-impulse-sdk/dsp/ei_flatten.h"
 #include "model-parameters/model_metadata.h"
 
@@ -1145,6 +1146,11 @@ __attribute__((unused)) int extract_image_features(signal_t *signal, matrix_t *o
         }
 
         bytes_left -= elements_to_read;
+
+        // callers map this to EI_IMPULSE_CANCELED instead of a DSP error
+        if (ei_run_impulse_check_interrupted() == EI_IMPULSE_CANCELED) {
+            return EIDSP_CANCELED;
+        }
     }
 
     return EIDSP_OK;
@@ -1207,6 +1213,11 @@ __attribute__((unused)) int extract_drpai_features_quantized(signal_t *signal, m
             }
         }
         bytes_left -= elements_to_read;
+
+        // callers map this to EI_IMPULSE_CANCELED instead of a DSP error
+        if (ei_run_impulse_check_interrupted() == EI_IMPULSE_CANCELED) {
+            return EIDSP_CANCELED;
+        }
     }
 
     return EIDSP_OK;
@@ -1349,6 +1360,10 @@ __attribute__((unused)) int extract_image_features_quantized(signal_t *signal, m
 
         bytes_left -= elements_to_read;
 
+        // callers map this to EI_IMPULSE_CANCELED instead of a DSP error
+        if (ei_run_impulse_check_interrupted() == EI_IMPULSE_CANCELED) {
+            return EIDSP_CANCELED;
+        }
     }
     return EIDSP_OK;
 }
@@ -254,7 +254,7 @@ void debug_print(const std::vector<T> vec, const int val_per_row = 3)
 /**
  * @brief      Do neural network inferencing over the processed feature matrix
  *
- * @param      impulse  Struct describing impulse architecture
+ * @param      handle   Impulse handle, with the impulse architecture
  * @param      fmatrix  Processed matrix
  * @param      result   Output classifier results
  * @param[in]  debug    Debug output enable
@@ -262,7 +262,7 @@ void debug_print(const std::vector<T> vec, const int val_per_row = 3)
  * @return     The ei impulse error.
  */
 EI_IMPULSE_ERROR run_nn_inference(
-    const ei_impulse_t *impulse,
+    ei_impulse_handle_t *handle,
     ei_feature_t *fmatrix,
     uint32_t learn_block_index,
     uint32_t* input_block_ids,
@@ -271,6 +271,7 @@ EI_IMPULSE_ERROR run_nn_inference(
     void *config_ptr,
     bool debug)
 {
+    const ei_impulse_t *impulse = handle->impulse;
     ei_learning_block_config_tflite_graph_t *block_config = ((ei_learning_block_config_tflite_graph_t*)config_ptr);
     ei_config_tflite_graph_t *graph_config = ((ei_config_tflite_graph_t*)block_config->graph_config);
 
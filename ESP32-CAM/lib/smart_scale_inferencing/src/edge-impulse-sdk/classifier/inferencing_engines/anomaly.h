@@ -152,7 +152,7 @@ EI_IMPULSE_ERROR extract_anomaly_input_values(
 
 
 EI_IMPULSE_ERROR run_kmeans_anomaly(
-    const ei_impulse_t *impulse,
+    ei_impulse_handle_t *handle,
     ei_feature_t *fmatrix,
     uint32_t learn_block_index,
     uint32_t* input_block_ids,
@@ -195,7 +195,7 @@ EI_IMPULSE_ERROR run_kmeans_anomaly(
 
 #if (EI_CLASSIFIER_INFERENCING_ENGINE != EI_CLASSIFIER_NONE)
 EI_IMPULSE_ERROR run_gmm_anomaly(
-    const ei_impulse_t *impulse,
+    ei_impulse_handle_t *handle,
     ei_feature_t *fmatrix,
     uint32_t learn_block_index,
     uint32_t* input_block_ids,
@@ -204,6 +204,7 @@ EI_IMPULSE_ERROR run_gmm_anomaly(
     void *config_ptr,
     bool debug = false)
 {
+    const ei_impulse_t *impulse = handle->impulse;
     ei_learning_block_config_anomaly_gmm_t *block_config = (ei_learning_block_config_anomaly_gmm_t*)config_ptr;
 
     ei_learning_block_config_tflite_graph_t ei_learning_block_config_gmm = {
@@ -248,7 +249,7 @@ EI_IMPULSE_ERROR run_gmm_anomaly(
         input_block_ids_size = 1;
     }
 
-    EI_IMPULSE_ERROR res = run_nn_inference(impulse, input, learn_block_index, input_block_ids, input_block_ids_size, &anomaly_result, (void*)&ei_learning_block_config_gmm, debug);
+    EI_IMPULSE_ERROR res = run_nn_inference(handle, input, learn_block_index, input_block_ids, input_block_ids_size, &anomaly_result, (void*)&ei_learning_block_config_gmm, debug);
     if (res != EI_IMPULSE_OK) {
         return res;
     }
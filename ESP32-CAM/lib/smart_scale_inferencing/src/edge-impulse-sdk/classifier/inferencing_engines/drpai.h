@@ -580,7 +580,7 @@ EI_IMPULSE_ERROR drpai_run_yolov5_postprocessing(
  * @return     The ei impulse error.
  */
 EI_IMPULSE_ERROR run_nn_inference(
-    const ei_impulse_t *impulse,
+    ei_impulse_handle_t *handle,
     ei_feature_t *fmatrix,
     uint32_t learn_block_index,
     uint32_t* input_block_ids,
@@ -598,12 +598,13 @@ EI_IMPULSE_ERROR run_nn_inference(
  * returns EI_IMPULSE_OK.
  */
 EI_IMPULSE_ERROR run_nn_inference_image_quantized(
-    const ei_impulse_t *impulse,
+    ei_impulse_handle_t *handle,
     signal_t *signal,
     ei_impulse_result_t *result,
     void *config_ptr,
     bool debug = false)
 {
+    const ei_impulse_t *impulse = handle->impulse;
     ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
 
     // this needs to be changed for multi-model, multi-impulse
@@ -97,7 +97,7 @@ bool init_ethos(const uint8_t *model_arr, size_t model_arr_size, bool debug)
 }
 
 EI_IMPULSE_ERROR run_nn_inference(
-    const ei_impulse_t *impulse,
+    ei_impulse_handle_t *handle,
     ei_feature_t *fmatrix,
     uint32_t learn_block_index,
     uint32_t* input_block_ids,
@@ -106,6 +106,7 @@ EI_IMPULSE_ERROR run_nn_inference(
     void *config_ptr,
     bool debug)
 {
+    const ei_impulse_t *impulse = handle->impulse;
     ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
     ei_config_ethos_graph_t *io_details = ((ei_config_ethos_graph_t*)block_config->graph_config);
     std::vector<std::shared_ptr<EthosU::Buffer>> ifm;
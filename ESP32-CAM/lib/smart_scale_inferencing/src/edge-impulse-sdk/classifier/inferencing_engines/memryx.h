@@ -182,7 +182,7 @@ bool init_memryx(bool debug, const ei_impulse_t *impulse)
 /**
  * @brief      Do neural network inferencing over the processed feature matrix
  *
- * @param      impulse  Struct describing impulse architecture
+ * @param      handle   Impulse handle, with the impulse architecture
  * @param      fmatrix  Processed matrix
  * @param      result   Output classifier results
  * @param[in]  debug    Debug output enable
@@ -191,7 +191,7 @@ bool init_memryx(bool debug, const ei_impulse_t *impulse)
  */
 #if (defined(EI_CLASSIFIER_USE_MEMRYX_HARDWARE) && (EI_CLASSIFIER_USE_MEMRYX_HARDWARE == 1))
 EI_IMPULSE_ERROR run_nn_inference(
-    const ei_impulse_t *impulse,
+    ei_impulse_handle_t *handle,
     ei_feature_t *fmatrix,
     uint32_t learn_block_index,
     uint32_t* input_block_ids,
@@ -200,6 +200,7 @@ EI_IMPULSE_ERROR run_nn_inference(
     void *config_ptr,
     bool debug = false)
 {
+    const ei_impulse_t *impulse = handle->impulse;
     ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
 
     memx_status status = MEMX_STATUS_OK;
@@ -341,7 +342,7 @@ EI_IMPULSE_ERROR run_nn_inference(
 
 #elif (defined(EI_CLASSIFIER_USE_MEMRYX_SOFTWARE) && (EI_CLASSIFIER_USE_MEMRYX_SOFTWARE == 1))
 EI_IMPULSE_ERROR run_nn_inference(
-    const ei_impulse_t *impulse,
+    ei_impulse_handle_t *handle,
     ei_feature_t *fmatrix,
     uint32_t learn_block_index,
     uint32_t* inputBlockIds,
@@ -349,6 +350,7 @@ EI_IMPULSE_ERROR run_nn_inference(
     void *config_ptr,
     bool debug = false)
 {
+    const ei_impulse_t *impulse = handle->impulse;
     ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
 
     // init Python embedded interpreter (should be called once!)
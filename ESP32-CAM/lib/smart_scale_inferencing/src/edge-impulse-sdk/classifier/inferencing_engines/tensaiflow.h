@@ -69,7 +69,7 @@ extern "C" void post_process(const void *impulse_arg, int8_t *out_buf_0, int8_t
  * @return     The ei impulse error.
  */
 EI_IMPULSE_ERROR run_nn_inference(
-    const ei_impulse_t *impulse,
+    ei_impulse_handle_t *handle,
     ei_feature_t *fmatrix,
     uint32_t learn_block_index,
     uint32_t* input_block_ids,
@@ -78,6 +78,7 @@ EI_IMPULSE_ERROR run_nn_inference(
     void *config_ptr,
     bool debug = false)
 {
+    const ei_impulse_t *impulse = handle->impulse;
     ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
     ei_config_tensaiflow_graph_t *graph_config = (ei_config_tensaiflow_graph_t*)block_config->graph_config;
 
@@ -122,12 +123,13 @@ EI_IMPULSE_ERROR run_nn_inference(
  * returns EI_IMPULSE_OK.
  */
 EI_IMPULSE_ERROR run_nn_inference_image_quantized(
-    const ei_impulse_t *impulse,
+    ei_impulse_handle_t *handle,
     signal_t *signal,
     ei_impulse_result_t *result,
     void *config_ptr,
     bool debug = false)
 {
+    const ei_impulse_t *impulse = handle->impulse;
     ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
     ei_config_tensaiflow_graph_t *graph_config = (ei_config_tensaiflow_graph_t*)block_config->graph_config;
 
@@ -62,7 +62,7 @@ inline bool file_exists(char *model_file_name)
  * @return     The ei impulse error.
  */
 EI_IMPULSE_ERROR run_nn_inference(
-    const ei_impulse_t *impulse,
+    ei_impulse_handle_t *handle,
     ei_feature_t *fmatrix,
     uint32_t learn_block_index,
     uint32_t* input_block_ids,
@@ -71,6 +71,7 @@ EI_IMPULSE_ERROR run_nn_inference(
     void *config_ptr,
     bool debug = false)
 {
+    const ei_impulse_t *impulse = handle->impulse;
     ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
     ei_config_tflite_graph_t *graph_config = (ei_config_tflite_graph_t*)block_config->graph_config;
 
@@ -306,7 +307,7 @@ EI_IMPULSE_ERROR run_nn_inference(
  * returns EI_IMPULSE_OK.
  */
 EI_IMPULSE_ERROR run_nn_inference_image_quantized(
-    const ei_impulse_t *impulse,
+    ei_impulse_handle_t *handle,
     signal_t *signal,
     ei_impulse_result_t *result,
     void *config_ptr,
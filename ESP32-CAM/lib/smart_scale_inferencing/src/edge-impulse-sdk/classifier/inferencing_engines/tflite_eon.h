@@ -27,10 +27,109 @@
 #include "edge-impulse-sdk/classifier/ei_model_types.h"
 #include "edge-impulse-sdk/classifier/inferencing_engines/tflite_helper.h"
 #include "edge-impulse-sdk/classifier/ei_run_dsp.h"
+#include "edge-impulse-sdk/classifier/ei_run_deadline.h"
+
+/**
+ * Get the EON session of an impulse handle for a learning block, allocating it on
+ * first use. Leaves session at nullptr (the model's shared state) if the model predates
+ * sessions.
+ *
+ * @param      handle              Impulse handle that owns the session
+ * @param      graph_config        EON graph
+ * @param      learn_block_index   Index of the learning block in the impulse
+ * @param      session             Set to the session
+ *
+ * @return  EI_IMPULSE_OK if successful
+ */
+static EI_IMPULSE_ERROR eon_get_session(
+    ei_impulse_handle_t *handle,
+    const ei_config_tflite_eon_graph_t *graph_config,
+    uint32_t learn_block_index,
+    void **session) {
+
+    *session = nullptr;
+
+    if (graph_config->implementation_version < 2 ||
+        learn_block_index >= handle->impulse->learning_blocks_size) {
+        return EI_IMPULSE_OK;
+    }
+
+    void *&block_session = handle->state.learning_block_sessions[learn_block_index];
+    if (block_session == nullptr) {
+        block_session = ei_calloc(1, graph_config->session_size());
+        if (block_session == nullptr) {
+            return EI_IMPULSE_ALLOC_FAILED;
+        }
+    }
+    *session = block_session;
+    return EI_IMPULSE_OK;
+}
+
+static TfLiteStatus eon_model_init(const ei_config_tflite_eon_graph_t *graph_config, void *session, void*(*alloc_fnc)(size_t, size_t)) {
+    return session ? graph_config->model_init_session(session, alloc_fnc) : graph_config->model_init(alloc_fnc);
+}
+
+static TfLiteStatus eon_model_invoke(const ei_config_tflite_eon_graph_t *graph_config, void *session) {
+    return session ? graph_config->model_invoke_session(session) : graph_config->model_invoke();
+}
+
+static TfLiteStatus eon_model_reset(const ei_config_tflite_eon_graph_t *graph_config, void *session, void (*free_fnc)(void* ptr)) {
+    return session ? graph_config->model_reset_session(session, free_fnc) : graph_config->model_reset(free_fnc);
+}
+
+static TfLiteStatus eon_model_input(const ei_config_tflite_eon_graph_t *graph_config, void *session, int index, TfLiteTensor *tensor) {
+    return session ? graph_config->model_input_session(session, index, tensor) : graph_config->model_input(index, tensor);
+}
+
+static TfLiteStatus eon_model_output(const ei_config_tflite_eon_graph_t *graph_config, void *session, int index, TfLiteTensor *tensor) {
+    return session ? graph_config->model_output_session(session, index, tensor) : graph_config->model_output(index, tensor);
+}
+
+/**
+ * Set the model up for a run, unless the handle kept it set up from an earlier one.
+ *
+ * @param      handle             Impulse handle that owns the session, nullptr for none
+ * @param      learn_block_index  Index of the learning block of the session
+ * @param      session            EON session (see eon_get_session)
+ */
+static TfLiteStatus eon_session_begin(
+    ei_impulse_handle_t *handle,
+    const ei_config_tflite_eon_graph_t *graph_config,
+    uint32_t learn_block_index,
+    void *session) {
+
+    const uint32_t ready = 1u << learn_block_index;
+    if (handle && session && (handle->state.learning_block_sessions_ready & ready)) {
+        return kTfLiteOk;
+    }
+    TfLiteStatus status = eon_model_init(graph_config, session, ei_aligned_calloc);
+    if (status == kTfLiteOk && handle && session && handle->state.keep_learning_block_sessions) {
+        handle->state.learning_block_sessions_ready |= ready;
+    }
+    return status;
+}
+
+/**
+ * Release what a run set up, unless the handle keeps it for the next run.
+ */
+static void eon_session_end(
+    ei_impulse_handle_t *handle,
+    const ei_config_tflite_eon_graph_t *graph_config,
+    uint32_t learn_block_index,
+    void *session) {
+
+    if (handle && session && (handle->state.learning_block_sessions_ready & (1u << learn_block_index))) {
+        return;
+    }
+    eon_model_reset(graph_config, session, ei_aligned_free);
+}
 
 /**
  * Setup the TFLite runtime
  *
+ * @param      handle             Impulse handle that owns the session, nullptr for none
+ * @param      learn_block_index  Index of the learning block of the session
+ * @param      session            EON session (see eon_get_session)
  * @param      ctx_start_us       Pointer to the start time
  * @param      input              Pointer to input tensor
  * @param      output             Pointer to output tensor
@@ -39,7 +138,10 @@
  * @return  EI_IMPULSE_OK if successful
  */
 static EI_IMPULSE_ERROR inference_tflite_setup(
+    ei_impulse_handle_t *handle,
     ei_learning_block_config_tflite_graph_t *block_config,
+    uint32_t learn_block_index,
+    void *session,
     uint64_t *ctx_start_us,
     TfLiteTensor* input,
     TfLiteTensor* output,
@@ -51,7 +153,7 @@ static EI_IMPULSE_ERROR inference_tflite_setup(
 
     *ctx_start_us = ei_read_timer_us();
 
-    TfLiteStatus init_status = graph_config->model_init(ei_aligned_calloc);
+    TfLiteStatus init_status = eon_session_begin(handle, graph_config, learn_block_index, session);
     if (init_status != kTfLiteOk) {
         ei_printf("Failed to initialize the model (error code %d)\n", init_status);
         return EI_IMPULSE_TFLITE_ARENA_ALLOC_FAILED;
@@ -59,21 +161,21 @@ static EI_IMPULSE_ERROR inference_tflite_setup(
 
     TfLiteStatus status;
 
-    status = graph_config->model_input(0, input);
+    status = eon_model_input(graph_config, session, 0, input);
     if (status != kTfLiteOk) {
         return EI_IMPULSE_TFLITE_ERROR;
     }
-    status = graph_config->model_output(block_config->output_data_tensor, output);
+    status = eon_model_output(graph_config, session, block_config->output_data_tensor, output);
     if (status != kTfLiteOk) {
         return EI_IMPULSE_TFLITE_ERROR;
     }
 
     if (block_config->object_detection_last_layer == EI_CLASSIFIER_LAST_LAYER_SSD) {
-        status = graph_config->model_output(block_config->output_score_tensor, output_scores);
+        status = eon_model_output(graph_config, session, block_config->output_score_tensor, output_scores);
         if (status != kTfLiteOk) {
             return EI_IMPULSE_TFLITE_ERROR;
         }
-        status = graph_config->model_output(block_config->output_labels_tensor, output_labels);
+        status = eon_model_output(graph_config, session, block_config->output_labels_tensor, output_labels);
         if (status != kTfLiteOk) {
             return EI_IMPULSE_TFLITE_ERROR;
         }
@@ -85,6 +187,7 @@ static EI_IMPULSE_ERROR inference_tflite_setup(
 /**
  * Run TFLite model
  *
+ * @param   session         EON session (see eon_get_session)
  * @param   ctx_start_us    Start time of the setup function (see above)
  * @param   output          Output tensor
  * @param   interpreter     TFLite interpreter (non-compiled models)
@@ -97,6 +200,7 @@ static EI_IMPULSE_ERROR inference_tflite_setup(
 static EI_IMPULSE_ERROR inference_tflite_run(
     const ei_impulse_t *impulse,
     ei_learning_block_config_tflite_graph_t *block_config,
+    void *session,
     uint64_t ctx_start_us,
     TfLiteTensor* output,
     TfLiteTensor* labels_tensor,
@@ -107,7 +211,11 @@ static EI_IMPULSE_ERROR inference_tflite_run(
 
     ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
 
-    if (graph_config->model_invoke() != kTfLiteOk) {
+    TfLiteStatus invoke_status = eon_model_invoke(graph_config, session);
+    if (invoke_status == kTfLiteCancelled) {
+        return EI_IMPULSE_CANCELED;
+    }
+    if (invoke_status != kTfLiteOk) {
         return EI_IMPULSE_TFLITE_ERROR;
     }
 
@@ -128,7 +236,7 @@ static EI_IMPULSE_ERROR inference_tflite_run(
         return fill_res;
     }
 
-    if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
+    if (ei_run_impulse_check_interrupted() == EI_IMPULSE_CANCELED) {
         return EI_IMPULSE_CANCELED;
     }
 
@@ -158,7 +266,10 @@ EI_IMPULSE_ERROR run_nn_inference_from_dsp(
     ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
 
     EI_IMPULSE_ERROR init_res = inference_tflite_setup(
+        nullptr,
         block_config,
+        0,
+        nullptr,
         &ctx_start_us,
         &input,
         &output,
@@ -176,8 +287,10 @@ EI_IMPULSE_ERROR run_nn_inference_from_dsp(
     }
 
     // invoke the model
-    if (graph_config->model_invoke() != kTfLiteOk) {
-        return EI_IMPULSE_TFLITE_ERROR;
+    TfLiteStatus invoke_status = graph_config->model_invoke();
+    if (invoke_status != kTfLiteOk) {
+        graph_config->model_reset(ei_aligned_free);
+        return invoke_status == kTfLiteCancelled ? EI_IMPULSE_CANCELED : EI_IMPULSE_TFLITE_ERROR;
     }
 
     auto output_res = fill_output_matrix_from_tensor(&output, output_matrix);
@@ -202,7 +315,7 @@ EI_IMPULSE_ERROR run_nn_inference_from_dsp(
  * @return     The ei impulse error.
  */
 EI_IMPULSE_ERROR run_nn_inference(
-    const ei_impulse_t *impulse,
+    ei_impulse_handle_t *handle,
     ei_feature_t *fmatrix,
     uint32_t learn_block_index,
     uint32_t* input_block_ids,
@@ -211,6 +324,7 @@ EI_IMPULSE_ERROR run_nn_inference(
     void *config_ptr,
     bool debug = false)
 {
+    const ei_impulse_t *impulse = handle->impulse;
     ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
     ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
 
@@ -219,11 +333,20 @@ EI_IMPULSE_ERROR run_nn_inference(
     TfLiteTensor output_scores;
     TfLiteTensor output_labels;
 
+    void *session;
+    EI_IMPULSE_ERROR session_res = eon_get_session(handle, graph_config, learn_block_index, &session);
+    if (session_res != EI_IMPULSE_OK) {
+        return session_res;
+    }
+
     uint64_t ctx_start_us = ei_read_timer_us();
     ei_unique_ptr_t p_tensor_arena(nullptr, ei_aligned_free);
 
     EI_IMPULSE_ERROR init_res = inference_tflite_setup(
+        handle,
         block_config,
+        learn_block_index,
+        session,
         &ctx_start_us,
         &input,
         &output,
@@ -246,6 +369,7 @@ EI_IMPULSE_ERROR run_nn_inference(
     EI_IMPULSE_ERROR run_res = inference_tflite_run(
         impulse,
         block_config,
+        session,
         ctx_start_us,
         &output,
         &output_labels,
@@ -259,7 +383,7 @@ EI_IMPULSE_ERROR run_nn_inference(
         }
     }
 
-    graph_config->model_reset(ei_aligned_free);
+    eon_session_end(handle, graph_config, learn_block_index, session);
 
     if (run_res != EI_IMPULSE_OK) {
         return run_res;
@@ -275,27 +399,35 @@ EI_IMPULSE_ERROR run_nn_inference(
  * returns EI_IMPULSE_OK.
  */
 EI_IMPULSE_ERROR run_nn_inference_image_quantized(
-    const ei_impulse_t *impulse,
+    ei_impulse_handle_t *handle,
     signal_t *signal,
     ei_impulse_result_t *result,
     void *config_ptr,
     bool debug = false) {
 
+    const ei_impulse_t *impulse = handle->impulse;
     ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
     ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
 
-    memset(result, 0, sizeof(ei_impulse_result_t));
-
     uint64_t ctx_start_us;
     TfLiteTensor input;
     TfLiteTensor output;
     TfLiteTensor output_scores;
     TfLiteTensor output_labels;
 
+    void *session;
+    EI_IMPULSE_ERROR session_res = eon_get_session(handle, graph_config, 0, &session);
+    if (session_res != EI_IMPULSE_OK) {
+        return session_res;
+    }
+
     ei_unique_ptr_t p_tensor_arena(nullptr, ei_aligned_free);
 
     EI_IMPULSE_ERROR init_res = inference_tflite_setup(
+        handle,
         block_config,
+        0,
+        session,
         &ctx_start_us,
         &input, &output,
         &output_labels,
@@ -307,6 +439,7 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
     }
 
     if (input.type != TfLiteType::kTfLiteInt8 && input.type != TfLiteType::kTfLiteUInt8) {
+        eon_session_end(handle, graph_config, 0, session);
         return EI_IMPULSE_ONLY_SUPPORTED_FOR_IMAGES;
     }
 
@@ -319,12 +452,19 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
     int ret = extract_image_features_quantized(signal, &features_matrix, impulse->dsp_blocks[0].config, input.params.scale, input.params.zero_point,
         impulse->frequency, impulse->learning_blocks[0].image_scaling);
 
+    if (ret == EIDSP_CANCELED) {
+        eon_session_end(handle, graph_config, 0, session);
+        return EI_IMPULSE_CANCELED;
+    }
+
     if (ret != EIDSP_OK) {
         ei_printf("ERR: Failed to run DSP process (%d)\n", ret);
+        eon_session_end(handle, graph_config, 0, session);
         return EI_IMPULSE_DSP_ERROR;
     }
 
-    if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
+    if (ei_run_impulse_check_interrupted() == EI_IMPULSE_CANCELED) {
+        eon_session_end(handle, graph_config, 0, session);
         return EI_IMPULSE_CANCELED;
     }
 
@@ -345,6 +485,7 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
     EI_IMPULSE_ERROR run_res = inference_tflite_run(
         impulse,
         block_config,
+        session,
         ctx_start_us,
         &output,
         &output_labels,
@@ -353,7 +494,7 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
         result,
         debug);
 
-    graph_config->model_reset(ei_aligned_free);
+    eon_session_end(handle, graph_config, 0, session);
 
     if (run_res != EI_IMPULSE_OK) {
         return run_res;
@@ -363,6 +504,66 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
 }
 #endif // EI_CLASSIFIER_QUANTIZATION_ENABLED == 1
 
+/**
+ * Set up the EON session of every learning block of the handle now (tensor arena,
+ * kernel data) and keep it set up between runs, so a run only fills the input and
+ * invokes the model. The arenas stay allocated until eon_release_sessions().
+ *
+ * @param      handle  Impulse handle that owns the sessions
+ *
+ * @return  EI_IMPULSE_OK if successful
+ */
+__attribute__((unused)) static EI_IMPULSE_ERROR eon_keep_sessions(ei_impulse_handle_t *handle) {
+    handle->state.keep_learning_block_sessions = true;
+
+    for (size_t ix = 0; ix < handle->impulse->learning_blocks_size; ix++) {
+        const ei_learning_block_t *block = &handle->impulse->learning_blocks[ix];
+        if (block->infer_fn != run_nn_inference) {
+            continue;
+        }
+        ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)block->config;
+        ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
+
+        void *session;
+        EI_IMPULSE_ERROR session_res = eon_get_session(handle, graph_config, ix, &session);
+        if (session_res != EI_IMPULSE_OK) {
+            return session_res;
+        }
+        // a model without sessions has nothing to keep, it is set up on every run
+        if (session == nullptr) {
+            continue;
+        }
+        if (eon_session_begin(handle, graph_config, ix, session) != kTfLiteOk) {
+            return EI_IMPULSE_TFLITE_ARENA_ALLOC_FAILED;
+        }
+    }
+
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * Release the sessions eon_keep_sessions() kept set up, later runs set up and
+ * release the model themselves again.
+ *
+ * @param      handle  Impulse handle that owns the sessions
+ */
+__attribute__((unused)) static void eon_release_sessions(ei_impulse_handle_t *handle) {
+    handle->state.keep_learning_block_sessions = false;
+
+    for (size_t ix = 0; ix < handle->impulse->learning_blocks_size; ix++) {
+        const uint32_t ready = 1u << ix;
+        if (!(handle->state.learning_block_sessions_ready & ready)) {
+            continue;
+        }
+        handle->state.learning_block_sessions_ready &= ~ready;
+
+        ei_learning_block_config_tflite_graph_t *block_config =
+            (ei_learning_block_config_tflite_graph_t*)handle->impulse->learning_blocks[ix].config;
+        eon_model_reset((ei_config_tflite_eon_graph_t*)block_config->graph_config,
+            handle->state.learning_block_sessions[ix], ei_aligned_free);
+    }
+}
+
 __attribute__((unused)) int extract_tflite_eon_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float frequency) {
     ei_dsp_config_tflite_eon_t *dsp_config = (ei_dsp_config_tflite_eon_t*)config_ptr;
 
@@ -31,6 +31,7 @@
 #include "edge-impulse-sdk/classifier/ei_fill_result_struct.h"
 #include "edge-impulse-sdk/classifier/ei_model_types.h"
 #include "edge-impulse-sdk/classifier/inferencing_engines/tflite_helper.h"
+#include "edge-impulse-sdk/classifier/ei_run_deadline.h"
 
 #if defined(EI_CLASSIFIER_HAS_TFLITE_OPS_RESOLVER) && EI_CLASSIFIER_HAS_TFLITE_OPS_RESOLVER == 1
 #include "tflite-model/tflite-resolver.h"
@@ -201,7 +202,7 @@ static EI_IMPULSE_ERROR inference_tflite_run(
         return fill_res;
     }
 
-    if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
+    if (ei_run_impulse_check_interrupted() == EI_IMPULSE_CANCELED) {
         return EI_IMPULSE_CANCELED;
     }
 
@@ -275,7 +276,7 @@ EI_IMPULSE_ERROR run_nn_inference_from_dsp(
  * @return     The ei impulse error.
  */
 EI_IMPULSE_ERROR run_nn_inference(
-    const ei_impulse_t *impulse,
+    ei_impulse_handle_t *handle,
     ei_feature_t *fmatrix,
     uint32_t learn_block_index,
     uint32_t* input_block_ids,
@@ -284,6 +285,7 @@ EI_IMPULSE_ERROR run_nn_inference(
     void *config_ptr,
     bool debug = false)
 {
+    const ei_impulse_t *impulse = handle->impulse;
     ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
 
     TfLiteTensor* input;
@@ -345,16 +347,15 @@ EI_IMPULSE_ERROR run_nn_inference(
  * returns EI_IMPULSE_OK.
  */
 EI_IMPULSE_ERROR run_nn_inference_image_quantized(
-    const ei_impulse_t *impulse,
+    ei_impulse_handle_t *handle,
     signal_t *signal,
     ei_impulse_result_t *result,
     void *config_ptr,
     bool debug = false)
 {
+    const ei_impulse_t *impulse = handle->impulse;
     ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
 
-    memset(result, 0, sizeof(ei_impulse_result_t));
-
     uint64_t ctx_start_us;
     TfLiteTensor* input;
     TfLiteTensor* output;
@@ -388,12 +389,16 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
     // run DSP process and quantize automatically
     int ret = extract_image_features_quantized(signal, &features_matrix, impulse->dsp_blocks[0].config, input->params.scale, input->params.zero_point,
         impulse->frequency, impulse->learning_blocks[0].image_scaling);
+    if (ret == EIDSP_CANCELED) {
+        return EI_IMPULSE_CANCELED;
+    }
+
     if (ret != EIDSP_OK) {
         ei_printf("ERR: Failed to run DSP process (%d)\n", ret);
         return EI_IMPULSE_DSP_ERROR;
     }
 
-    if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
+    if (ei_run_impulse_check_interrupted() == EI_IMPULSE_CANCELED) {
         return EI_IMPULSE_CANCELED;
     }
 
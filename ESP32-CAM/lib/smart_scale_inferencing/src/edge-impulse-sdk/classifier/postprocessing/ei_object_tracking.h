@@ -27,6 +27,8 @@
 
 extern ei_impulse_handle_t & ei_default_impulse;
 
+#include <algorithm>
+#include <tuple>
 #include <vector>
 #include "tinyEKF/tinyekf.hpp"
 #include "alignment/ei_alignment.hpp"
@@ -35,342 +37,504 @@ float clip(float num, float min_val = -3.4028235e+38, float max_val = 3.4028235e
     return std::fmax(min_val, std::fmin(num, max_val));
 }
 
-#if EI_CLASSIFIER_OBJECT_TRACKING_ENABLED == 1
+#if EI_CLASSIFIER_OBJECT_TRACKING_ENABLED == 1 || defined(EI_OBJECT_TRACKER_ONLY)
+
+/**
+ * Capacity of the tracker: open traces, and detections per frame (boxes beyond that
+ * are ignored). All storage is part of the Tracker object, a frame never allocates.
+ */
+#ifndef EI_OBJECT_TRACKING_MAX_TRACES
+#define EI_OBJECT_TRACKING_MAX_TRACES 16
+#endif
+
+#ifndef EI_OBJECT_TRACKING_MAX_DETECTIONS
+#define EI_OBJECT_TRACKING_MAX_DETECTIONS 16
+#endif
 
 typedef struct {
     float keep_grace;
 } ei_obj_tracking_params_t;
 
-class ExponentialMovingAverage {
+/**
+ * Constant velocity Kalman filter of TinyEKF with the model matrices, which are the same
+ * for every trace, computed once. A trace only keeps its state x (8) and covariance P (16).
+ */
+class TraceFilterModel {
 public:
-    ExponentialMovingAverage(int n, float gain = 2) : gain(gain / (n + 1)), ema_value(-255.0) {
+    TraceFilterModel(float dt = 0.1, float process_noise_scale = 0.1, float observation_noise_scale = 0.1) {
+        memset(F, 0, sizeof(F));
+        for (int i = 0; i < 4; ++i) {
+            F[i * 4 + i] = 1;
+        }
+        F[2] = F[7] = dt;
+        TinyEKF::_transpose(F, Ft, 4, 4);
+
+        memset(H, 0, sizeof(H));
+        H[0] = H[5] = 1;
+        TinyEKF::_transpose(H, Ht, 2, 4);
+
+        memset(Q, 0, sizeof(Q));
+        Q[0] = Q[5] = pow(dt, 4) / 4;
+        Q[2] = Q[7] = Q[8] = Q[13] = pow(dt, 3) / 2;
+        Q[10] = Q[15] = pow(dt, 2);
+        for (int i = 0; i < 16; ++i) {
+            Q[i] = Q[i] * pow(process_noise_scale, 2);
+        }
+
+        memset(R, 0, sizeof(R));
+        R[0] = R[3] = pow(observation_noise_scale, 2);
+
+        // control input, B @ u with u = [0.1, 0.1]
+        float B[8] = { 0 };
+        B[0] = B[3] = (dt * dt) / 2;
+        B[4] = B[7] = dt;
+        const float u[2] = { 0.1, 0.1 };
+        TinyEKF::_mulmat(B, u, Bu, 4, 2, 1);
     }
 
-    void update(float value) {
-        if (ema_value == -255.0) {
-            ema_value = value;
-        } else {
-            ema_value = (value * gain) + (ema_value * (1 - gain));
+    void init(float *x, float *P, const float *x0) const {
+        memset(x, 0, sizeof(float) * 8);
+        x[0] = x[2] = x0[0];
+        x[1] = x[3] = x0[1];
+
+        memset(P, 0, sizeof(float) * 16);
+        for (int i = 0; i < 4; ++i) {
+            P[i * 4 + i] = 1;
         }
     }
 
-    float smoothed_value() {
-        return ema_value;
+    void predict(float *x, float *P) const {
+        float Fx[8];
+        TinyEKF::_mulmat(F, x, Fx, 4, 4, 2);
+        x[0] = Fx[0] + Bu[0];
+        x[1] = Fx[1] + Bu[1];
+        x[2] = Fx[2] + Bu[0];
+        x[3] = Fx[3] + Bu[1];
+        x[4] = Fx[4] + Bu[2];
+        x[5] = Fx[5] + Bu[3];
+        x[6] = Fx[6] + Bu[2];
+        x[7] = Fx[7] + Bu[3];
+
+        float FP[16], FPFt[16];
+        TinyEKF::_mulmat(F, P, FP, 4, 4, 4);
+        TinyEKF::_mulmat(FP, Ft, FPFt, 4, 4, 4);
+        TinyEKF::_addmat(FPFt, Q, P, 4, 4);
+    }
+
+    bool update(float *x, float *P, const float *z, const float *hx) const {
+        float PHt[8], HP[8], HpHt[4], HpHtR[4], HPHtRinv[4];
+        TinyEKF::_mulmat(P, Ht, PHt, 4, 4, 2);
+        TinyEKF::_mulmat(H, P, HP, 2, 4, 4);
+        TinyEKF::_mulmat(HP, Ht, HpHt, 2, 4, 2);
+        TinyEKF::_addmat(HpHt, R, HpHtR, 2, 2);
+        if (!TinyEKF::invert(HpHtR, HPHtRinv, 2)) {
+            return false;
+        }
+
+        float G[8];
+        TinyEKF::_mulmat(PHt, HPHtRinv, G, 4, 2, 2);
+
+        const float z_hx[4] = { z[0] - hx[0], z[1] - hx[1], z[0] - hx[0], z[1] - hx[1] };
+        float Gz_hx[8];
+        TinyEKF::_mulmat(G, z_hx, Gz_hx, 4, 2, 2);
+        TinyEKF::_addvec(x, Gz_hx, x, 8);
+
+        float GH[16], GHP[16];
+        TinyEKF::_mulmat(G, H, GH, 4, 2, 4);
+        TinyEKF::_negate(GH, 4, 4);
+        TinyEKF::_addeye(GH, 4);
+        TinyEKF::_mulmat(GH, P, GHP, 4, 4, 4);
+        memcpy(P, GHP, sizeof(GHP));
+        return true;
     }
 
 private:
-    float gain;
-    float ema_value;
+    float F[16];
+    float Ft[16];
+    float Q[16];
+    float H[8];
+    float Ht[8];
+    float R[4];
+    float Bu[4];
 };
 
-class Trace {
+/**
+ * IoU tracker with Kalman filtered traces. Traces are stored as a structure of arrays
+ * of fixed capacity (EI_OBJECT_TRACKING_MAX_TRACES), open traces are [0, trace_count)
+ * in the order they were started. Matching uses a preallocated candidate list, so the
+ * cost of a frame only depends on the number of traces and detections.
+ */
+class Tracker {
 public:
-    Trace(int id, int t, const ei_impulse_result_bounding_box_t& initial_bbox, uint32_t max_observations = 5)
-        : id(id), last_ground_truth_update_t(t), last_prediction(initial_bbox), max_observations(max_observations) {
+    Tracker (uint32_t keep_grace = 5, uint16_t max_observations = 5, float iou_threshold = 0.5)
+            : keep_grace(keep_grace),
+              max_observations(max_observations),
+              iou_threshold(iou_threshold) {
         if (max_observations < 2) {
             EI_LOGE("%s", "max_observations needs to be at least 2 for counting");
         }
-
-        trace_label = initial_bbox.label;
-        observations.push_back(initial_bbox);
-        float initial_centroid[2] = { initial_bbox.x + static_cast<float>(initial_bbox.width) / 2,
-                                      initial_bbox.y + static_cast<float>(initial_bbox.height) / 2 };
-
-        float initial_width_height[2] = { static_cast<float>(initial_bbox.width),
-                                          static_cast<float>(initial_bbox.height) };
-
-        centroid_filter = new TinyEKF(initial_centroid, 8, 2);
-        width_height_filter = new TinyEKF(initial_width_height, 8, 2);
-
-        xyxy_emas[0] = new ExponentialMovingAverage(this->max_observations);
-        xyxy_emas[1] = new ExponentialMovingAverage(this->max_observations);
-        xyxy_emas[2] = new ExponentialMovingAverage(this->max_observations);
-        xyxy_emas[3] = new ExponentialMovingAverage(this->max_observations);
-    }
-
-    ~Trace() {
-        delete centroid_filter;
-        delete width_height_filter;
-        delete xyxy_emas[0];
-        delete xyxy_emas[1];
-        delete xyxy_emas[2];
-        delete xyxy_emas[3];
+        trace_seq_id = 0;
+        t = 0;
+        trace_count = 0;
+        object_tracking_output_count = 0;
     }
 
-    ei_impulse_result_bounding_box_t predict() {
-
-        fx_centroid[0] = centroid_filter->x[0];
-        fx_centroid[1] = centroid_filter->x[1];
-        fx_width_height[0] = width_height_filter->x[0];
-        fx_width_height[1] = width_height_filter->x[1];
-
-        centroid_filter->predict(fx_centroid);
-        width_height_filter->predict(fx_width_height);
+    /**
+     * Output of the last frame, one entry per open trace
+     */
+    ei_object_tracking_trace_t object_tracking_output[EI_OBJECT_TRACKING_MAX_TRACES];
+    uint32_t object_tracking_output_count;
+
+    void process_new_detections(const ei_impulse_result_bounding_box_t *new_detections, size_t new_detection_count) {
+        // keep a copy, without the empty boxes that pad FOMO results
+        detection_count = 0;
+        for (size_t i = 0; i < new_detection_count; i++) {
+            if (new_detections[i].value == 0) {
+                continue;
+            }
+            if (detection_count == EI_OBJECT_TRACKING_MAX_DETECTIONS) {
+                EI_LOGW("more than %d detections, ignoring the rest\n", EI_OBJECT_TRACKING_MAX_DETECTIONS);
+                break;
+            }
+            detections[detection_count++] = new_detections[i];
+        }
 
-        ei_impulse_result_bounding_box_t p_bbox = {"", 0, 0, 0, 0, 0.0};
-        p_bbox.label = trace_label;
-        p_bbox.x = clip((centroid_filter->x[0] - width_height_filter->x[0] / 2), 0);
-        p_bbox.y = clip(centroid_filter->x[1] - width_height_filter->x[1] / 2, 0);
-        p_bbox.width = clip(width_height_filter->x[0], 0);
-        p_bbox.height = clip(width_height_filter->x[1], 0);
-        p_bbox.value = 0.0;
-        last_prediction = p_bbox;
-        EI_LOGD("predict %d %d %d %d %f\n", last_prediction.x, last_prediction.y, last_prediction.width, last_prediction.height, last_prediction.value);
-        return last_prediction;
-    }
+        // firstly try an alignment with last observations...
+        for (uint32_t ix = 0; ix < trace_count; ix++) {
+            reference_boxes[ix] = trace_observations[ix][trace_observation_count[ix] - 1];
+        }
+        const float last_obs_iou = align(reference_boxes, last_obs_matches);
+        EI_LOGD("last_obs_iou %f\n", last_obs_iou);
 
-    void update(int t, const ei_impulse_result_bounding_box_t* bbox) {
-        if (bbox == nullptr) {
-            EI_LOGD("update (last prediction) %d %d %d %d %f\n", last_prediction.x, last_prediction.y, last_prediction.width, last_prediction.height, last_prediction.value);
-            bbox = &last_prediction;
-        } else {
-            EI_LOGD("update (ground truth prediction) %d %d %d %d %f\n", bbox->x, bbox->y, bbox->width, bbox->height, bbox->value);
-            last_ground_truth_update_t = t;
+        // ... then with the kalman filter predictions
+        for (uint32_t ix = 0; ix < trace_count; ix++) {
+            reference_boxes[ix] = predict(ix);
         }
+        const float predicted_iou = align(reference_boxes, predicted_matches);
+        EI_LOGD("predicted_iou %f\n", predicted_iou);
 
-        hx_centroid[0] = centroid_filter->x[0];
-        hx_centroid[1] = centroid_filter->x[1];
-        hx_width_height[0] = width_height_filter->x[0];
-        hx_width_height[1] = width_height_filter->x[1];
+        // and use whichever matching set is better
+        const int16_t *matches = last_obs_iou > predicted_iou ? last_obs_matches : predicted_matches;
+
+        memset(detection_matched, 0, sizeof(detection_matched));
+        for (uint32_t ix = 0; ix < trace_count; ix++) {
+            if (matches[ix] >= 0) {
+                EI_LOGD("t_idx=%u d_idx=%d\n", ix, matches[ix]);
+                update(ix, &detections[matches[ix]]);
+                detection_matched[matches[ix]] = 1;
+            }
+        }
 
-        float centroid[2] = { bbox->x + static_cast<float>(bbox->width) / 2,
-                              bbox->y + static_cast<float>(bbox->height) / 2 };
-        centroid_filter->update(centroid , hx_centroid);
+        // close the traces that have not been matched for too long, roll the others
+        // forward, and compact what is left (keeping the order)
+        uint32_t open_count = 0;
+        for (uint32_t ix = 0; ix < trace_count; ix++) {
+            uint32_t time_since_last_update = t - trace_last_update_t[ix];
+            if (time_since_last_update > keep_grace) {
+                // been too long since last update, close it
+                EI_LOGD("closing trace %u\n", trace_id[ix]);
+                continue;
+            }
+            if (trace_last_update_t[ix] != t) {
+                // wasn't match this step, so do rollout of filters
+                EI_LOGD("self rollout of trace %u\n", trace_id[ix]);
+                update(ix, nullptr);
+            }
+            if (open_count != ix) {
+                move_trace(ix, open_count);
+            }
+            open_count++;
+        }
+        trace_count = open_count;
 
-        float width_height[2] = { static_cast<float>(bbox->width),
-                                  static_cast<float>(bbox->height) };
-        width_height_filter->update(width_height, hx_width_height);
+        // every detection that did not match becomes a new trace
+        for (uint32_t d = 0; d < detection_count; d++) {
+            if (detection_matched[d]) {
+                continue;
+            }
+            if (trace_count == EI_OBJECT_TRACKING_MAX_TRACES) {
+                EI_LOGW("%d traces open, not starting a new one\n", EI_OBJECT_TRACKING_MAX_TRACES);
+                break;
+            }
+            EI_LOGD("unassigned detection %u => starting new trace\n", d);
+            start_trace(trace_count++, detections[d]);
+        }
 
-        observations.push_back(*bbox);
-        while (observations.size() > max_observations) {
-            observations.erase(observations.begin());
+        for (uint32_t ix = 0; ix < trace_count; ix++) {
+            ei_object_tracking_trace_t &trace_result = object_tracking_output[ix];
+            trace_result = { 0 };
+            trace_result.id = trace_id[ix];
+            trace_result.last_ground_truth_update_t = trace_last_update_t[ix];
+            trace_result.label = trace_prediction[ix].label;
+            trace_result.x = trace_prediction[ix].x;
+            trace_result.y = trace_prediction[ix].y;
+            trace_result.width = trace_prediction[ix].width;
+            trace_result.height = trace_prediction[ix].height;
+            trace_result.last_centroid_segment = last_centroid_segment(ix);
         }
+        object_tracking_output_count = trace_count;
+        t += 1;
+    }
 
-        xyxy_emas[0]->update(bbox->x);
-        xyxy_emas[1]->update(bbox->y);
-        xyxy_emas[2]->update(bbox->width);
-        xyxy_emas[3]->update(bbox->height);
+    void process_new_detections(const std::vector<ei_impulse_result_bounding_box_t> &new_detections) {
+        process_new_detections(new_detections.data(), new_detections.size());
+    }
 
+    bool set_iou_threshold(float iou_threshold) {
+        this->iou_threshold = iou_threshold;
+        return true;
     }
 
-    std::tuple<int, int, int, int> last_centroid_segment() const {
-        if (observations.size() < 2) {
-            return {};
-        }
-        auto obs_t_minus1 = observations[observations.size() - 2];
-        auto obs_t_0 = observations.back();
+    float get_iou_threshold() {
+        return iou_threshold;
+    }
 
-        return {obs_t_minus1.x + static_cast<float>(obs_t_minus1.width) / 2,
-                obs_t_minus1.y + static_cast<float>(obs_t_minus1.height) / 2,
-                obs_t_0.x + static_cast<float>(obs_t_0.width) / 2,
-                obs_t_0.y + static_cast<float>(obs_t_0.height) / 2};
+    uint32_t open_trace_count() const {
+        return trace_count;
     }
 
-    const ei_impulse_result_bounding_box_t* last_observation() const {
-        if (observations.empty()) {
-            return nullptr;
+    std::tuple<int, int, int, int> last_centroid_segment(uint32_t ix) const {
+        if (trace_observation_count[ix] < 2) {
+            return {};
         }
-        return &observations.back();
+        const ei_impulse_result_bounding_box_t &obs_t_minus1 = trace_observations[ix][0];
+        const ei_impulse_result_bounding_box_t &obs_t_0 = trace_observations[ix][1];
+
+        return std::make_tuple(
+            static_cast<int>(obs_t_minus1.x + static_cast<float>(obs_t_minus1.width) / 2),
+            static_cast<int>(obs_t_minus1.y + static_cast<float>(obs_t_minus1.height) / 2),
+            static_cast<int>(obs_t_0.x + static_cast<float>(obs_t_0.width) / 2),
+            static_cast<int>(obs_t_0.y + static_cast<float>(obs_t_0.height) / 2));
     }
 
-    ei_impulse_result_bounding_box_t smoothed_last_observation() const {
+    ei_impulse_result_bounding_box_t smoothed_last_observation(uint32_t ix) const {
         ei_impulse_result_bounding_box_t bbox = {"", 0, 0, 0, 0, 0.0};
-        if (observations.empty()) {
-            return bbox;
-        }
-
-        bbox.x = round(xyxy_emas[0]->smoothed_value());
-        bbox.y = round(xyxy_emas[1]->smoothed_value());
-        bbox.width = round(xyxy_emas[2]->smoothed_value());
-        bbox.height = round(xyxy_emas[3]->smoothed_value());
-
+        bbox.x = round(trace_ema[ix][0]);
+        bbox.y = round(trace_ema[ix][1]);
+        bbox.width = round(trace_ema[ix][2]);
+        bbox.height = round(trace_ema[ix][3]);
         return bbox;
     }
 
-    void debug_output() const {
+    void debug_output(uint32_t ix) const {
 #if EI_LOG_LEVEL == EI_LOG_LEVEL_DEBUG
         // output debug info, C-style
-        ei_printf("Trace %d:\n", id);
-        ei_printf("  Last ground truth update: %d\n", last_ground_truth_update_t);
-        ei_printf("  Last prediction: %d %d %d %d %f\n", last_prediction.x, last_prediction.y, last_prediction.width, last_prediction.height, last_prediction.value);
+        const ei_impulse_result_bounding_box_t &p = trace_prediction[ix];
+        ei_printf("Trace %u:\n", trace_id[ix]);
+        ei_printf("  Last ground truth update: %u\n", trace_last_update_t[ix]);
+        ei_printf("  Last prediction: %u %u %u %u %f\n", p.x, p.y, p.width, p.height, p.value);
         ei_printf("  Observations:\n");
-        for (const auto& obs : observations) {
-            ei_printf("%d %d %d %d %f\n", obs.x, obs.y, obs.width, obs.height, obs.value);
+        for (uint32_t i = 0; i < trace_observation_count[ix]; i++) {
+            const ei_impulse_result_bounding_box_t &obs = trace_observations[ix][i];
+            ei_printf("%u %u %u %u %f\n", obs.x, obs.y, obs.width, obs.height, obs.value);
         }
 #endif
     }
 
-    uint32_t id;
-    uint32_t last_ground_truth_update_t;
-    ei_impulse_result_bounding_box_t last_prediction;
+    uint32_t keep_grace;
+    uint16_t max_observations;
 
 private:
-    std::vector<ei_impulse_result_bounding_box_t> observations;
-    TinyEKF* centroid_filter;
-    TinyEKF* width_height_filter;
-    uint32_t max_observations;
-    float fx_centroid[2];
-    float fx_width_height[2];
-    float hx_centroid[2];
-    float hx_width_height[2];
-    const char* trace_label;
-    ExponentialMovingAverage *xyxy_emas[4];
-};
-
-class Tracker {
-public:
-    Tracker (uint32_t keep_grace = 5, uint16_t max_observations = 5, float iou_threshold = 0.5)
-            : keep_grace(keep_grace),
-              max_observations(max_observations),
-              alignment(iou_threshold) {
-        trace_seq_id = 0;
-        t = 0;
-    }
-
-    ~Tracker() {
-        for (auto trace : open_traces) {
-            delete trace;
-        }
-        for (auto trace : closed_traces) {
-            delete trace;
+    typedef struct {
+        float iou;
+        uint16_t trace_ix;
+        uint16_t detection_ix;
+    } candidate_t;
+
+    void start_trace(uint32_t ix, const ei_impulse_result_bounding_box_t &bbox) {
+        trace_id[ix] = trace_seq_id++;
+        trace_last_update_t[ix] = t;
+        trace_label[ix] = bbox.label;
+        trace_prediction[ix] = bbox;
+        trace_observations[ix][0] = bbox;
+        trace_observation_count[ix] = 1;
+
+        const float centroid[2] = { bbox.x + static_cast<float>(bbox.width) / 2,
+                                    bbox.y + static_cast<float>(bbox.height) / 2 };
+        const float width_height[2] = { static_cast<float>(bbox.width), static_cast<float>(bbox.height) };
+        filter_model.init(trace_centroid_x[ix], trace_centroid_p[ix], centroid);
+        filter_model.init(trace_size_x[ix], trace_size_p[ix], width_height);
+
+        // the averages start with the first update
+        for (int i = 0; i < 4; i++) {
+            trace_ema[ix][i] = -255.0;
         }
+        trace_ema_gain[ix] = 2.0f / (max_observations + 1);
     }
 
-    std::vector<Trace*>open_traces;
-    std::vector<Trace*>closed_traces;
-    std::vector<ei_object_tracking_trace_t> object_tracking_output;
+    void move_trace(uint32_t from, uint32_t to) {
+        trace_id[to] = trace_id[from];
+        trace_last_update_t[to] = trace_last_update_t[from];
+        trace_label[to] = trace_label[from];
+        trace_prediction[to] = trace_prediction[from];
+        memcpy(trace_observations[to], trace_observations[from], sizeof(trace_observations[0]));
+        trace_observation_count[to] = trace_observation_count[from];
+        memcpy(trace_centroid_x[to], trace_centroid_x[from], sizeof(trace_centroid_x[0]));
+        memcpy(trace_centroid_p[to], trace_centroid_p[from], sizeof(trace_centroid_p[0]));
+        memcpy(trace_size_x[to], trace_size_x[from], sizeof(trace_size_x[0]));
+        memcpy(trace_size_p[to], trace_size_p[from], sizeof(trace_size_p[0]));
+        memcpy(trace_ema[to], trace_ema[from], sizeof(trace_ema[0]));
+        trace_ema_gain[to] = trace_ema_gain[from];
+    }
 
-    void process_new_detections(std::vector<ei_impulse_result_bounding_box_t> detections) {
-        // firstly try an alignment with last observations...
-        std::vector<ei_impulse_result_bounding_box_t> last_obs_bboxes;
-        for (auto trace : open_traces) {
-            last_obs_bboxes.push_back(*trace->last_observation());
-        }
+    ei_impulse_result_bounding_box_t predict(uint32_t ix) {
+        filter_model.predict(trace_centroid_x[ix], trace_centroid_p[ix]);
+        filter_model.predict(trace_size_x[ix], trace_size_p[ix]);
 
-        std::vector<std::tuple<int, int, float>> last_obs_matches = alignment.align(last_obs_bboxes, detections);
+        const float *c = trace_centroid_x[ix], *s = trace_size_x[ix];
+        ei_impulse_result_bounding_box_t p_bbox = {"", 0, 0, 0, 0, 0.0};
+        p_bbox.label = trace_label[ix];
+        p_bbox.x = clip(c[0] - s[0] / 2, 0);
+        p_bbox.y = clip(c[1] - s[1] / 2, 0);
+        p_bbox.width = clip(s[0], 0);
+        p_bbox.height = clip(s[1], 0);
+        p_bbox.value = 0.0;
+        trace_prediction[ix] = p_bbox;
+        EI_LOGD("predict %u %u %u %u\n", p_bbox.x, p_bbox.y, p_bbox.width, p_bbox.height);
+        return p_bbox;
+    }
 
-        float last_obs_cost = 0;
-        for (auto last_obs_match : last_obs_matches) {
-            EI_LOGD("last_obs_match %d %d %f\n", std::get<0>(last_obs_match), std::get<1>(last_obs_match), std::get<2>(last_obs_match));
-            last_obs_cost += std::get<2>(last_obs_match);
+    // update with a matched detection, or with nullptr with the last prediction
+    void update(uint32_t ix, const ei_impulse_result_bounding_box_t *bbox) {
+        if (bbox == nullptr) {
+            bbox = &trace_prediction[ix];
         }
-        EI_LOGD("last_obs_cost %f\n", last_obs_cost);
-
-        // ... then with the kalman filter predictions
-        std::vector<ei_impulse_result_bounding_box_t> predicted_bboxes;
-        for (auto trace : open_traces) {
-            predicted_bboxes.push_back(trace->predict());
-            EI_LOGD("predicted %d %d %d %d %f\n", trace->last_prediction.x, trace->last_prediction.y, trace->last_prediction.width, trace->last_prediction.height, trace->last_prediction.value);
+        else {
+            trace_last_update_t[ix] = t;
         }
 
-        std::vector<std::tuple<int, int, float>> predicted_matches = alignment.align(predicted_bboxes, detections);
-        float predicted_cost = 0;
-        for (auto predicted_match : predicted_matches) {
-            EI_LOGD("predicted_match %d %d %f\n", std::get<0>(predicted_match), std::get<1>(predicted_match), std::get<2>(predicted_match));
-            predicted_cost += std::get<2>(predicted_match);
-        }
-        EI_LOGD("predicted_cost %f\n", predicted_cost);
+        const float hx_centroid[2] = { trace_centroid_x[ix][0], trace_centroid_x[ix][1] };
+        const float hx_width_height[2] = { trace_size_x[ix][0], trace_size_x[ix][1] };
 
-        // and use whichever matching set is better
-        std::vector<std::tuple<int, int, float>> matches;
+        const float centroid[2] = { bbox->x + static_cast<float>(bbox->width) / 2,
+                                    bbox->y + static_cast<float>(bbox->height) / 2 };
+        filter_model.update(trace_centroid_x[ix], trace_centroid_p[ix], centroid, hx_centroid);
+
+        const float width_height[2] = { static_cast<float>(bbox->width), static_cast<float>(bbox->height) };
+        filter_model.update(trace_size_x[ix], trace_size_p[ix], width_height, hx_width_height);
 
-        if (last_obs_cost > predicted_cost) {
-            EI_LOGD("using last_obs_matches matches\n");
-            matches = last_obs_matches;
+        // only the last two observations are ever looked at
+        const ei_impulse_result_bounding_box_t observation = *bbox;
+        if (trace_observation_count[ix] < 2 && trace_observation_count[ix] < max_observations) {
+            trace_observation_count[ix]++;
         }
         else {
-            EI_LOGD("using predicted_matches matches\n");
-            matches = predicted_matches;
+            trace_observations[ix][0] = trace_observations[ix][1];
         }
-
-        // assume all detections are unassigned and will becomes new tracks
-        // until we see otherwise ( i.e. they match an existing track )∂        //
-        std::set<uint16_t>unassigned_detection_idxs;
-        for (size_t i = 0; i < detections.size(); i++) {
-            unassigned_detection_idxs.insert(i);
-        }
-
-        // keep track of open traces idxs that haven't been updated
-        std::set<uint16_t>open_traces_idxs_to_be_updated;
-        for (size_t i = 0; i < open_traces.size(); i++) {
-            open_traces_idxs_to_be_updated.insert(i);
+        trace_observations[ix][trace_observation_count[ix] - 1] = observation;
+
+        const float values[4] = { static_cast<float>(observation.x), static_cast<float>(observation.y),
+                                  static_cast<float>(observation.width), static_cast<float>(observation.height) };
+        const float gain = trace_ema_gain[ix];
+        for (int i = 0; i < 4; i++) {
+            if (trace_ema[ix][i] == -255.0) {
+                trace_ema[ix][i] = values[i];
+            }
+            else {
+                trace_ema[ix][i] = (values[i] * gain) + (trace_ema[ix][i] * (1 - gain));
+            }
         }
+    }
 
-        // update existing traces with any matches
-        for (size_t i = 0; i < matches.size(); i++) {
-            uint32_t trace_idx = std::get<0>(matches[i]);
-            uint32_t detection_idx = std::get<1>(matches[i]);
-            EI_LOGD("t_idx=%u d_idx=%u iou=%.6f\n", trace_idx, detection_idx, std::get<2>(matches[i]));
-
-            Trace *trace = open_traces[trace_idx];
-            open_traces_idxs_to_be_updated.erase(trace_idx);
-            trace->update(t, &detections[detection_idx]);
-            unassigned_detection_idxs.erase(detection_idx);
+    /**
+     * Greedy IoU matching of the open traces (one reference box each) with the detections,
+     * highest IoU first. Pairs that do not overlap are gated out before the IoU is computed.
+     * When no trace and no detection has more than one candidate, every candidate is a
+     * match and nothing needs sorting. Returns the summed IoU of the matches, writes the
+     * matched detection (or -1) of every trace to matches.
+     */
+    float align(const ei_impulse_result_bounding_box_t *traces, int16_t *matches) {
+        for (uint32_t ix = 0; ix < trace_count; ix++) {
+            matches[ix] = -1;
         }
-
-        for (auto detection_idx : unassigned_detection_idxs ) {
-            EI_LOGD("unassigned detection %d %d %d %d %d %f => starting new trace\n", detection_idx, detections[detection_idx].x, detections[detection_idx].y, detections[detection_idx].width, detections[detection_idx].height, detections[detection_idx].value);
-            open_traces.push_back(new Trace(trace_seq_id, t, detections[detection_idx], max_observations));
-            trace_seq_id += 1;
+        if (trace_count == 0 || detection_count == 0) {
+            return 0;
         }
 
-        std::vector<Trace*>traces_tmp;
-
-        for (auto trace : open_traces) {
-            EI_LOGD("grace checking trace %d at t=%d (trace.last_ground_truth_update_t=%d)\n", trace->id, t, trace->last_ground_truth_update_t);
-            uint32_t time_since_last_update = t - trace->last_ground_truth_update_t;
-            if (time_since_last_update > keep_grace) {
-                // been too long since last update, close it
-                EI_LOGD("closing trace %d\n", trace->id);
-                closed_traces.push_back(trace);
-            }
-            else {
-                if (trace->last_ground_truth_update_t != t) {
-                    // wasn't match this step, so do rollout of filters
-                    EI_LOGD("self rollout of trace %d\n", trace->id);
-                    trace->update(t, nullptr);
+        memset(trace_candidates, 0, sizeof(trace_candidates));
+        memset(detection_candidates, 0, sizeof(detection_candidates));
+        const bool gate = iou_threshold >= 0.0f;
+        bool one_to_one = true;
+        size_t candidate_count = 0;
+
+        for (uint32_t ix = 0; ix < trace_count; ix++) {
+            const ei_impulse_result_bounding_box_t &a = traces[ix];
+            for (uint32_t d = 0; d < detection_count; d++) {
+                const ei_impulse_result_bounding_box_t &b = detections[d];
+                if (gate && (a.x >= b.x + b.width || b.x >= a.x + a.width ||
+                             a.y >= b.y + b.height || b.y >= a.y + a.height)) {
+                    continue;
+                }
+                const float iou = intersection_over_union(a, b);
+                if (iou > iou_threshold) {
+                    candidates[candidate_count++] = { iou, (uint16_t)ix, (uint16_t)d };
+                    trace_candidates[ix]++;
+                    detection_candidates[d]++;
+                    if (trace_candidates[ix] > 1 || detection_candidates[d] > 1) {
+                        one_to_one = false;
+                    }
                 }
-                EI_LOGD("trace %d still alive\n", trace->id);
-                traces_tmp.push_back(trace);
             }
         }
 
-        open_traces = traces_tmp;
-        object_tracking_output.clear();
-
-        for (auto trace : open_traces) {
-            ei_object_tracking_trace_t trace_result = { 0 };
-            trace_result.id = trace->id;
-            trace_result.last_ground_truth_update_t = trace->last_ground_truth_update_t;
-            trace_result.label = trace->last_prediction.label;
-            trace_result.x = trace->last_prediction.x;
-            trace_result.y = trace->last_prediction.y;
-            trace_result.width = trace->last_prediction.width;
-            trace_result.height = trace->last_prediction.height;
-            trace_result.last_centroid_segment = trace->last_centroid_segment();
-
-            object_tracking_output.push_back(trace_result);
+        if (!one_to_one) {
+            std::sort(candidates, candidates + candidate_count, [](const candidate_t &a, const candidate_t &b) {
+                if (a.iou != b.iou) {
+                    return a.iou > b.iou;
+                }
+                return a.trace_ix != b.trace_ix ? a.trace_ix < b.trace_ix : a.detection_ix < b.detection_ix;
+            });
         }
-        t += 1;
-    }
-
-    bool set_iou_threshold(float iou_threshold) {
-        alignment.iou_threshold = iou_threshold;
-        return true;
-    }
 
-    float get_iou_threshold() {
-        return alignment.iou_threshold;
+        float total_iou = 0;
+        memset(detection_matched, 0, sizeof(detection_matched));
+        for (size_t i = 0; i < candidate_count; i++) {
+            const candidate_t &c = candidates[i];
+            if (matches[c.trace_ix] == -1 && !detection_matched[c.detection_ix]) {
+                matches[c.trace_ix] = c.detection_ix;
+                detection_matched[c.detection_ix] = 1;
+                total_iou += c.iou;
+            }
+        }
+        return total_iou;
     }
 
-    uint32_t keep_grace;
-    uint16_t max_observations;
-private:
     uint32_t trace_seq_id;
     uint32_t t;
-    GreedyAlignment alignment;
+    float iou_threshold;
+    TraceFilterModel filter_model;
+
+    // open traces, one entry per field
+    uint32_t trace_count;
+    uint32_t trace_id[EI_OBJECT_TRACKING_MAX_TRACES];
+    uint32_t trace_last_update_t[EI_OBJECT_TRACKING_MAX_TRACES];
+    const char *trace_label[EI_OBJECT_TRACKING_MAX_TRACES];
+    ei_impulse_result_bounding_box_t trace_prediction[EI_OBJECT_TRACKING_MAX_TRACES];
+    ei_impulse_result_bounding_box_t trace_observations[EI_OBJECT_TRACKING_MAX_TRACES][2];
+    uint8_t trace_observation_count[EI_OBJECT_TRACKING_MAX_TRACES];
+    float trace_centroid_x[EI_OBJECT_TRACKING_MAX_TRACES][8];
+    float trace_centroid_p[EI_OBJECT_TRACKING_MAX_TRACES][16];
+    float trace_size_x[EI_OBJECT_TRACKING_MAX_TRACES][8];
+    float trace_size_p[EI_OBJECT_TRACKING_MAX_TRACES][16];
+    float trace_ema[EI_OBJECT_TRACKING_MAX_TRACES][4];
+    float trace_ema_gain[EI_OBJECT_TRACKING_MAX_TRACES];
+
+    // per frame workspace
+    ei_impulse_result_bounding_box_t detections[EI_OBJECT_TRACKING_MAX_DETECTIONS];
+    uint32_t detection_count;
+    ei_impulse_result_bounding_box_t reference_boxes[EI_OBJECT_TRACKING_MAX_TRACES];
+    int16_t last_obs_matches[EI_OBJECT_TRACKING_MAX_TRACES];
+    int16_t predicted_matches[EI_OBJECT_TRACKING_MAX_TRACES];
+    candidate_t candidates[EI_OBJECT_TRACKING_MAX_TRACES * EI_OBJECT_TRACKING_MAX_DETECTIONS];
+    uint16_t trace_candidates[EI_OBJECT_TRACKING_MAX_TRACES];
+    uint16_t detection_candidates[EI_OBJECT_TRACKING_MAX_DETECTIONS];
+    uint8_t detection_matched[EI_OBJECT_TRACKING_MAX_DETECTIONS];
 };
 
+#endif // EI_CLASSIFIER_OBJECT_TRACKING_ENABLED == 1 || defined(EI_OBJECT_TRACKER_ONLY)
+
+#if EI_CLASSIFIER_OBJECT_TRACKING_ENABLED == 1
+
 EI_IMPULSE_ERROR init_object_tracking(ei_impulse_handle_t *handle, void** state, void *config)
 {
     //const ei_impulse_t *impulse = handle->impulse;
@@ -411,14 +575,10 @@ EI_IMPULSE_ERROR process_object_tracking(ei_impulse_handle_t *handle,
 
     if (impulse->sensor == EI_CLASSIFIER_SENSOR_CAMERA) {
         if((void *)object_tracker != NULL) {
-            ei_impulse_result_bounding_box_t *bbs = result->bounding_boxes;
-            uint32_t bbs_num = result->bounding_boxes_count;
-            std::vector<ei_impulse_result_bounding_box_t> detections(bbs, bbs + bbs_num);
-
-            object_tracker->process_new_detections(detections);
+            object_tracker->process_new_detections(result->bounding_boxes, result->bounding_boxes_count);
 
-            result->postprocessed_output.object_tracking_output.open_traces = object_tracker->object_tracking_output.data();
-            result->postprocessed_output.object_tracking_output.open_traces_count = object_tracker->object_tracking_output.size();
+            result->postprocessed_output.object_tracking_output.open_traces = object_tracker->object_tracking_output;
+            result->postprocessed_output.object_tracking_output.open_traces_count = object_tracker->object_tracking_output_count;
         }
     }
 
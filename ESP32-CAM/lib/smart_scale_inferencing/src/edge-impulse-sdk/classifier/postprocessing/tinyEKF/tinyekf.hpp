@@ -185,6 +185,9 @@ private:
 
     void update_step3(float *GH);
 
+public:
+    // matrix helpers, also used by the fixed size trace filters in ei_object_tracking.h
+
     /// @private
     static void _mulmat(
             const float * a,
@@ -42,7 +42,8 @@ typedef enum {
     EIDSP_FFT_TABLE_NOT_LOADED = -1016,
     EIDSP_INFERENCE_ERROR = -1017,
     EIDSP_NO_HW_ACCEL = -1018,
-    EIDSP_FFT_SIZE_NOT_SUPPORTED = -1019
+    EIDSP_FFT_SIZE_NOT_SUPPORTED = -1019,
+    EIDSP_CANCELED = -1020 // ei_run_impulse_check_interrupted() asked to stop
 } EIDSP_RETURN_T;
 
 } // namespace ei
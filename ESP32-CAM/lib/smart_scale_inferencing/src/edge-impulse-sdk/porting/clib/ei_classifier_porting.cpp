@@ -19,6 +19,7 @@
 #if EI_PORTING_CLIB == 1
 #include <stdarg.h>
 #include <stdio.h>
+#include <chrono>
 
 __attribute__((weak)) EI_IMPULSE_ERROR ei_run_impulse_check_canceled() {
     return EI_IMPULSE_OK;
@@ -36,7 +37,13 @@ uint64_t ei_read_timer_ms() {
 }
 
 uint64_t ei_read_timer_us() {
+#if defined(__unix__) || defined(__APPLE__)
+    // Hosted builds have a monotonic clock, result.timing and the deadlines need one
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
     return 0;
+#endif
 }
 
 __attribute__((weak)) void ei_printf(const char *format, ...) {
@@ -19,7 +19,7 @@
 
 #include <edge-impulse-sdk/porting/espressif/ESP-NN/src/common/common_functions.h>
 
-static int16_t *scratch_buffer = NULL;
+static __thread int16_t *scratch_buffer = NULL;
 
 extern void esp_nn_depthwise_conv_s16_mult8_3x3_esp32s3(const int16_t *input_data,
                                                         const uint16_t input_wd,
@@ -17,7 +17,7 @@
 #include "softmax_common.h"
 #include <stdio.h>
 
-static int32_t *scratch_buf = NULL;
+static __thread int32_t *scratch_buf = NULL; // per thread, concurrent sessions each set their own
 
 /**
  * @brief   Get scratch buffer size needed by softmax function
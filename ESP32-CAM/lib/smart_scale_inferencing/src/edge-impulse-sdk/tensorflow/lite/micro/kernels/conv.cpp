@@ -1697,6 +1697,7 @@ limitations under the License.
 #include "edge-impulse-sdk/tensorflow/lite/kernels/kernel_util.h"
 #include "edge-impulse-sdk/tensorflow/lite/kernels/padding.h"
 #include "edge-impulse-sdk/tensorflow/lite/micro/kernels/kernel_util.h"
+#include "edge-impulse-sdk/tensorflow/lite/micro/kernels/esp_nn_node_data.h"
 #include "edge-impulse-sdk/tensorflow/lite/micro/micro_log.h"
 
 #include <esp_timer.h>
@@ -1711,12 +1712,7 @@ long long conv_total_time = 0;
 namespace tflite {
 namespace {
 
-struct NodeData {
-  OpDataConv op_data;
-#if ESP_NN
-  int buffer_idx;
-#endif
-};
+typedef EspNnConvNodeData NodeData;
 
 void* Init(TfLiteContext* context, const char* buffer, size_t length) {
   TFLITE_DCHECK(context->AllocatePersistentBuffer != nullptr);
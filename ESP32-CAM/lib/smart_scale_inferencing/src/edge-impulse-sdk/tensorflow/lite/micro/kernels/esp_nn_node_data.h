@@ -0,0 +1,38 @@
+#ifndef TENSORFLOW_LITE_MICRO_KERNELS_ESP_NN_NODE_DATA_H_
+#define TENSORFLOW_LITE_MICRO_KERNELS_ESP_NN_NODE_DATA_H_
+
+#include <cstdint>
+
+#include "edge-impulse-sdk/classifier/ei_classifier_config.h"
+#include "edge-impulse-sdk/tensorflow/lite/kernels/internal/types.h"
+#include "edge-impulse-sdk/tensorflow/lite/micro/kernels/conv.h"
+
+namespace tflite {
+
+// user_data of the nodes of the ESP-NN conv and depthwise conv kernels. Declared
+// here rather than in the kernels so that kernel data prepared ahead of time
+// (tflite-model/tflite_learn_4_prepared.h) can be checked against it.
+struct EspNnConvNodeData {
+  OpDataConv op_data;
+#if ESP_NN
+  int buffer_idx;
+#endif
+};
+
+// user_data of the nodes of the ESP-NN softmax kernel
+struct EspNnSoftmaxNodeData {
+  SoftmaxParams op_data;
+#if ESP_NN
+  int buffer_idx;
+#endif
+};
+
+// user_data of the nodes of the pad kernel
+struct PadOpData {
+  PadParams params;
+  int32_t output_zero_point;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_MICRO_KERNELS_ESP_NN_NODE_DATA_H_
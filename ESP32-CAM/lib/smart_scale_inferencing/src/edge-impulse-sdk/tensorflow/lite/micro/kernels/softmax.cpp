@@ -265,6 +265,7 @@ limitations under the License.
 #include "edge-impulse-sdk/tensorflow/lite/kernels/kernel_util.h"
 #include "edge-impulse-sdk/tensorflow/lite/kernels/op_macros.h"
 #include "edge-impulse-sdk/tensorflow/lite/micro/kernels/kernel_util.h"
+#include "edge-impulse-sdk/tensorflow/lite/micro/kernels/esp_nn_node_data.h"
 #include "edge-impulse-sdk/tensorflow/lite/micro/micro_log.h"
 
 #include <esp_timer.h>
@@ -280,12 +281,7 @@ namespace {
 // Softmax parameter data that persists in user_data
 const int kInt16LUTArraySize = 513;
 
-struct NodeData {
-  SoftmaxParams op_data;
-#if ESP_NN
-  int buffer_idx;
-#endif
-};
+typedef EspNnSoftmaxNodeData NodeData;
 
 static void* Init(TfLiteContext* context, const char* buffer, size_t length) {
   TFLITE_DCHECK(context->AllocatePersistentBuffer != nullptr);
@@ -77,12 +77,18 @@ ei_model_dsp_t ei_dsp_blocks[ei_dsp_blocks_size] = {
     }
 };
 const ei_config_tflite_eon_graph_t ei_config_tflite_graph_4 = {
-    .implementation_version = 1,
+    .implementation_version = 2,
     .model_init = &tflite_learn_4_init,
     .model_invoke = &tflite_learn_4_invoke,
     .model_reset = &tflite_learn_4_reset,
     .model_input = &tflite_learn_4_input,
     .model_output = &tflite_learn_4_output,
+    .session_size = &tflite_learn_4_session_size,
+    .model_init_session = &tflite_learn_4_init_session,
+    .model_invoke_session = &tflite_learn_4_invoke_session,
+    .model_reset_session = &tflite_learn_4_reset_session,
+    .model_input_session = &tflite_learn_4_input_session,
+    .model_output_session = &tflite_learn_4_output_session,
 };
 
 const ei_learning_block_config_tflite_graph_t ei_learning_block_config_4 = {
@@ -32,10 +32,22 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <atomic>
+#include <new>
+#include <type_traits>
 #include "edge-impulse-sdk/tensorflow/lite/c/builtin_op_data.h"
 #include "edge-impulse-sdk/tensorflow/lite/c/common.h"
 #include "edge-impulse-sdk/tensorflow/lite/micro/micro_mutable_op_resolver.h"
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+#include "edge-impulse-sdk/classifier/ei_run_deadline.h"
+#include "tflite-model/tflite_learn_4_compiled.h"
+
+// kernel data computed ahead of time by tools/eon_prepare.cpp (optional)
+#if defined __has_include
+#if __has_include("tflite-model/tflite_learn_4_prepared.h")
+#include "tflite-model/tflite_learn_4_prepared.h"
+#endif
+#endif // __has_include
 
 #if EI_CLASSIFIER_PRINT_STATE
 #if defined(__cplusplus) && EI_C_LINKAGE == 1
@@ -85,9 +97,9 @@ using namespace tflite::ops::micro;
 namespace {
 
 #if defined(EI_CLASSIFIER_ALLOCATION_STATIC_HIMAX) || defined(EI_CLASSIFIER_ALLOCATION_STATIC_HIMAX_GNU)
-constexpr int kTensorArenaSize = 242688;
+constexpr int kTensorArenaSize = 159744;
 #else
-constexpr int kTensorArenaSize = 241664;
+constexpr int kTensorArenaSize = 158720;
 #endif
 
 #if defined(EI_CLASSIFIER_ALLOCATION_STATIC)
@@ -109,9 +121,6 @@ uint8_t tensor_arena[kTensorArenaSize] ALIGN(16) __attribute__((section(".tensor
 uint8_t* tensor_arena = NULL;
 #endif
 
-static uint8_t* tensor_boundary;
-static uint8_t* current_location;
-
 template <int SZ, class T> struct TfArray {
   int sz; T elem[SZ];
 };
@@ -134,17 +143,15 @@ typedef struct {
   int16_t index;
 } TfLiteTensorWithIndex;
 
-typedef struct {
-  TfLiteEvalTensor tensor;
-  int16_t index;
-} TfLiteEvalTensorWithIndex;
-
-TfLiteContext ctx{};
 static const int MAX_TFL_TENSOR_COUNT = 4;
-static TfLiteTensorWithIndex tflTensors[MAX_TFL_TENSOR_COUNT];
-static const int MAX_TFL_EVAL_COUNT = 4;
-static TfLiteEvalTensorWithIndex tflEvalTensors[MAX_TFL_EVAL_COUNT];
-TfLiteRegistration registrations[OP_LAST];
+// in used_operators_e order
+const TfLiteRegistration registrations[OP_LAST] = {
+  Register_CONV_2D(),
+  Register_DEPTHWISE_CONV_2D(),
+  Register_PAD(),
+  Register_ADD(),
+  Register_SOFTMAX(),
+};
 
 namespace g0 {
 const TfArray<4, int> tensor_dimension0 = { 4, { 1,96,96,3 } };
@@ -1188,7 +1195,7 @@ const TfArray<1, int> outputs26 = { 1, { 70 } };
 };
 
 TensorInfo_t tensorData[] = {
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension0, 27648, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant0))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 36864), (TfLiteIntArray*)&g0::tensor_dimension0, 27648, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant0))}, },
 { kTfLiteMmapRo, kTfLiteInt32, (int32_t*)g0::tensor_data1, (TfLiteIntArray*)&g0::tensor_dimension1, 32, {kTfLiteNoQuantization, nullptr}, },
 { kTfLiteMmapRo, kTfLiteInt32, (int32_t*)g0::tensor_data2, (TfLiteIntArray*)&g0::tensor_dimension2, 28, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant2))}, },
 { kTfLiteMmapRo, kTfLiteInt8, (int32_t*)g0::tensor_data3, (TfLiteIntArray*)&g0::tensor_dimension3, 224, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant3))}, },
@@ -1232,37 +1239,37 @@ TensorInfo_t tensorData[] = {
 { kTfLiteMmapRo, kTfLiteInt8, (int32_t*)g0::tensor_data41, (TfLiteIntArray*)&g0::tensor_dimension41, 144, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant41))}, },
 { kTfLiteMmapRo, kTfLiteInt32, (int32_t*)g0::tensor_data42, (TfLiteIntArray*)&g0::tensor_dimension42, 64, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant42))}, },
 { kTfLiteMmapRo, kTfLiteInt8, (int32_t*)g0::tensor_data43, (TfLiteIntArray*)&g0::tensor_dimension43, 432, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant43))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 36864), (TfLiteIntArray*)&g0::tensor_dimension44, 36864, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant44))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension45, 36864, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant45))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 36864), (TfLiteIntArray*)&g0::tensor_dimension46, 18432, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant46))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 115248), (TfLiteIntArray*)&g0::tensor_dimension47, 110592, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant47))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension44, 36864, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant44))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 36864), (TfLiteIntArray*)&g0::tensor_dimension45, 36864, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant45))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 115248), (TfLiteIntArray*)&g0::tensor_dimension46, 18432, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant46))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 4656), (TfLiteIntArray*)&g0::tensor_dimension47, 110592, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant47))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension48, 115248, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant48))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 115248), (TfLiteIntArray*)&g0::tensor_dimension49, 27648, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant49))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 55296), (TfLiteIntArray*)&g0::tensor_dimension50, 4608, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant50))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 27648), (TfLiteIntArray*)&g0::tensor_dimension51, 27648, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant51))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension52, 27648, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant52))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 27648), (TfLiteIntArray*)&g0::tensor_dimension53, 4608, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant53))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension54, 4608, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant54))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 30000), (TfLiteIntArray*)&g0::tensor_dimension55, 27648, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant55))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension51, 27648, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant51))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 27648), (TfLiteIntArray*)&g0::tensor_dimension52, 27648, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant52))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension53, 4608, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant53))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 55296), (TfLiteIntArray*)&g0::tensor_dimension54, 4608, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant54))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 2352), (TfLiteIntArray*)&g0::tensor_dimension55, 27648, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant55))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension56, 30000, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant56))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 30000), (TfLiteIntArray*)&g0::tensor_dimension57, 6912, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant57))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 36912), (TfLiteIntArray*)&g0::tensor_dimension58, 2304, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant58))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 13824), (TfLiteIntArray*)&g0::tensor_dimension59, 13824, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant59))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension60, 13824, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant60))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 13824), (TfLiteIntArray*)&g0::tensor_dimension61, 2304, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant61))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 27648), (TfLiteIntArray*)&g0::tensor_dimension58, 2304, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant58))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension59, 13824, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant59))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 13824), (TfLiteIntArray*)&g0::tensor_dimension60, 13824, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant60))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension61, 2304, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant61))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 27648), (TfLiteIntArray*)&g0::tensor_dimension62, 2304, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant62))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 13824), (TfLiteIntArray*)&g0::tensor_dimension63, 13824, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant63))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension64, 13824, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 16128), (TfLiteIntArray*)&g0::tensor_dimension65, 2304, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant65))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 13824), (TfLiteIntArray*)&g0::tensor_dimension66, 2304, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant66))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension63, 13824, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant63))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 13824), (TfLiteIntArray*)&g0::tensor_dimension64, 13824, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension65, 2304, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant65))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 27648), (TfLiteIntArray*)&g0::tensor_dimension66, 2304, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant66))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension67, 13824, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant67))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 13824), (TfLiteIntArray*)&g0::tensor_dimension68, 4608, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant68))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 1008), (TfLiteIntArray*)&g0::tensor_dimension69, 1008, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant69))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension70, 1008, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant70))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension69, 1008, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant69))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 1008), (TfLiteIntArray*)&g0::tensor_dimension70, 1008, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant70))}, },
 };
 
 #ifndef TF_LITE_STATIC_MEMORY
-TfLiteNode tflNodes[27] = {
+const TfLiteNode tflNodes[27] = {
 { (TfLiteIntArray*)&g0::inputs0, (TfLiteIntArray*)&g0::outputs0, (TfLiteIntArray*)&g0::inputs0, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata0)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs1, (TfLiteIntArray*)&g0::outputs1, (TfLiteIntArray*)&g0::inputs1, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata1)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs2, (TfLiteIntArray*)&g0::outputs2, (TfLiteIntArray*)&g0::inputs2, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata2)), nullptr, 0, },
@@ -1292,7 +1299,7 @@ TfLiteNode tflNodes[27] = {
 { (TfLiteIntArray*)&g0::inputs26, (TfLiteIntArray*)&g0::outputs26, (TfLiteIntArray*)&g0::inputs26, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata26)), nullptr, 0, },
 };
 #else
-TfLiteNode tflNodes[27] = {
+const TfLiteNode tflNodes[27] = {
 { (TfLiteIntArray*)&g0::inputs0, (TfLiteIntArray*)&g0::outputs0, (TfLiteIntArray*)&g0::inputs0, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata0)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs1, (TfLiteIntArray*)&g0::outputs1, (TfLiteIntArray*)&g0::inputs1, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata1)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs2, (TfLiteIntArray*)&g0::outputs2, (TfLiteIntArray*)&g0::inputs2, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata2)), nullptr, 0, },
@@ -1341,32 +1348,93 @@ static const int out_tensor_indices[] = {
 };
 
 
-size_t current_subgraph_index = 0;
+typedef struct {
+  size_t bytes;
+  void *ptr;
+  int16_t node;
+} scratch_buffer_t;
+
+// Everything that is written while setting up and running the graph. The model data
+// above is read-only, so sessions on different threads can run at the same time.
+struct EonSession {
+  // first member, the kernel callbacks find their session through it
+  TfLiteContext ctx;
+  uint8_t* arena;
+  bool uses_static_arena;
+  uint8_t* tensor_boundary;
+  uint8_t* current_location;
+  TfLiteTensorWithIndex tensors[MAX_TFL_TENSOR_COUNT];
+  // Eval tensors are looked up on every kernel invoke, so they are kept in a
+  // table indexed directly by tensor index and filled once in init.
+  TfLiteEvalTensor eval_tensors[71];
+  // copy of tflNodes, init/prepare write the kernel data into it
+  TfLiteNode nodes[27];
+  void* overflow_buffers[EI_MAX_OVERFLOW_BUFFER_COUNT];
+  size_t overflow_buffers_ix;
+  scratch_buffer_t scratch_buffers[EI_MAX_SCRATCH_BUFFER_COUNT];
+  size_t scratch_buffers_ix;
+  // node that is currently being prepared, scratch buffers are only used while this node runs
+  int16_t current_node_index;
+  size_t current_subgraph_index;
+  // set with tflite_learn_4_set_layer_observer_session, kept across runs
+  tflite_learn_4_layer_observer_t layer_observer;
+  void* layer_observer_user;
+#if !TFLITE_LEARN_4_PREPARED
+  // first and last node that touch each tensor, used to find gaps in the arena for scratch buffers
+  int16_t tensor_first_use[71];
+  int16_t tensor_last_use[71];
+#endif // !TFLITE_LEARN_4_PREPARED
+};
+
+static_assert(std::is_standard_layout<EonSession>::value, "EonSession must start with its TfLiteContext");
+
+static EonSession* GetSession(const struct TfLiteContext* context) {
+  return reinterpret_cast<EonSession*>(const_cast<struct TfLiteContext*>(context));
+}
+
+// session behind the tflite_learn_4_* functions without a session argument, allocated on first use
+static EonSession* default_session = nullptr;
+
+#if !defined(EI_CLASSIFIER_ALLOCATION_HEAP)
+// the static arena belongs to one session at a time, sessions running next to it allocate their own
+static std::atomic<bool> static_arena_in_use(false);
+#endif
+
+static bool IsArenaTensor(size_t i) {
+#if defined(EI_CLASSIFIER_ALLOCATION_HEAP)
+  return tensorData[i].allocation_type == kTfLiteArenaRw;
+#else
+  return tensor_arena <= tensorData[i].data && tensorData[i].data < tensor_arena + kTensorArenaSize;
+#endif
+}
+
+static size_t TensorArenaOffset(size_t i) {
+#if defined(EI_CLASSIFIER_ALLOCATION_HEAP)
+  return (size_t)(uintptr_t)tensorData[i].data;
+#else
+  return (size_t)((uint8_t*)tensorData[i].data - tensor_arena);
+#endif
+}
 
-static void init_tflite_tensor(size_t i, TfLiteTensor *tensor) {
+static void init_tflite_tensor(EonSession *s, size_t i, TfLiteTensor *tensor) {
   tensor->type = tensorData[i].type;
   tensor->is_variable = false;
 
 #if defined(EI_CLASSIFIER_ALLOCATION_HEAP)
   tensor->allocation_type = tensorData[i].allocation_type;
 #else
-  tensor->allocation_type = (tensor_arena <= tensorData[i].data && tensorData[i].data < tensor_arena + kTensorArenaSize) ? kTfLiteArenaRw : kTfLiteMmapRo;
+  tensor->allocation_type = IsArenaTensor(i) ? kTfLiteArenaRw : kTfLiteMmapRo;
 #endif
   tensor->bytes = tensorData[i].bytes;
   tensor->dims = tensorData[i].dims;
 
-#if defined(EI_CLASSIFIER_ALLOCATION_HEAP)
-  if(tensor->allocation_type == kTfLiteArenaRw){
-    uint8_t* start = (uint8_t*) ((uintptr_t)tensorData[i].data + (uintptr_t) tensor_arena);
-
-    tensor->data.data =  start;
+  // arena tensors are placed relative to the arena of the session
+  if (IsArenaTensor(i)) {
+    tensor->data.data = s->arena + TensorArenaOffset(i);
   }
   else {
-      tensor->data.data = tensorData[i].data;
+    tensor->data.data = tensorData[i].data;
   }
-#else
-  tensor->data.data = tensorData[i].data;
-#endif // EI_CLASSIFIER_ALLOCATION_HEAP
   tensor->quantization = tensorData[i].quantization;
   if (tensor->quantization.type == kTfLiteAffineQuantization) {
     TfLiteAffineQuantization const* quant = ((TfLiteAffineQuantization const*)(tensorData[i].quantization.params));
@@ -1376,36 +1444,28 @@ static void init_tflite_tensor(size_t i, TfLiteTensor *tensor) {
 
 }
 
-static void init_tflite_eval_tensor(int i, TfLiteEvalTensor *tensor) {
+static void init_tflite_eval_tensor(EonSession *s, int i, TfLiteEvalTensor *tensor) {
 
   tensor->type = tensorData[i].type;
 
   tensor->dims = tensorData[i].dims;
 
-#if defined(EI_CLASSIFIER_ALLOCATION_HEAP)
-  auto allocation_type = tensorData[i].allocation_type;
-  if(allocation_type == kTfLiteArenaRw) {
-    uint8_t* start = (uint8_t*) ((uintptr_t)tensorData[i].data + (uintptr_t) tensor_arena);
-
-    tensor->data.data =  start;
+  if (IsArenaTensor(i)) {
+    tensor->data.data = s->arena + TensorArenaOffset(i);
   }
   else {
     tensor->data.data = tensorData[i].data;
   }
-#else
-  tensor->data.data = tensorData[i].data;
-#endif // EI_CLASSIFIER_ALLOCATION_HEAP
 }
 
-static void* overflow_buffers[EI_MAX_OVERFLOW_BUFFER_COUNT];
-static size_t overflow_buffers_ix = 0;
 static void * AllocatePersistentBufferImpl(struct TfLiteContext* ctx,
                                        size_t bytes) {
+  EonSession *s = GetSession(ctx);
   void *ptr;
   uint32_t align_bytes = (bytes % 16) ? 16 - (bytes % 16) : 0;
 
-  if (current_location - (bytes + align_bytes) < tensor_boundary) {
-    if (overflow_buffers_ix > EI_MAX_OVERFLOW_BUFFER_COUNT - 1) {
+  if (s->current_location - (bytes + align_bytes) < s->tensor_boundary) {
+    if (s->overflow_buffers_ix > EI_MAX_OVERFLOW_BUFFER_COUNT - 1) {
       ei_printf("ERR: Failed to allocate persistent buffer of size %d, does not fit in tensor arena and reached EI_MAX_OVERFLOW_BUFFER_COUNT\n",
         (int)bytes);
       return NULL;
@@ -1418,90 +1478,217 @@ static void * AllocatePersistentBufferImpl(struct TfLiteContext* ctx,
       ei_printf("ERR: Failed to allocate persistent buffer of size %d\n", (int)bytes);
       return NULL;
     }
-    overflow_buffers[overflow_buffers_ix++] = ptr;
+    s->overflow_buffers[s->overflow_buffers_ix++] = ptr;
     return ptr;
   }
 
-  current_location -= bytes;
+  s->current_location -= bytes;
 
   // align to the left aligned boundary of 16 bytes
-  current_location -= 15; // for alignment
-  current_location += 16 - ((uintptr_t)(current_location) & 15);
+  s->current_location -= 15; // for alignment
+  s->current_location += 16 - ((uintptr_t)(s->current_location) & 15);
 
-  ptr = current_location;
+  ptr = s->current_location;
   memset(ptr, 0, bytes);
 
   return ptr;
 }
 
-typedef struct {
-  size_t bytes;
-  void *ptr;
-} scratch_buffer_t;
-
-static scratch_buffer_t scratch_buffers[EI_MAX_SCRATCH_BUFFER_COUNT];
-static size_t scratch_buffers_ix = 0;
-
 static TfLiteStatus RequestScratchBufferInArenaImpl(struct TfLiteContext* ctx, size_t bytes,
                                                 int* buffer_idx) {
-  if (scratch_buffers_ix > EI_MAX_SCRATCH_BUFFER_COUNT - 1) {
+  EonSession *s = GetSession(ctx);
+  if (s->scratch_buffers_ix > EI_MAX_SCRATCH_BUFFER_COUNT - 1) {
     ei_printf("ERR: Failed to allocate scratch buffer of size %d, reached EI_MAX_SCRATCH_BUFFER_COUNT\n",
       (int)bytes);
     return kTfLiteError;
   }
 
+  // memory is assigned in PlaceScratchBuffers() once all nodes are prepared
   scratch_buffer_t b;
   b.bytes = bytes;
+  b.ptr = NULL;
+  b.node = s->current_node_index;
 
-  b.ptr = AllocatePersistentBufferImpl(ctx, b.bytes);
-  if (!b.ptr) {
-    ei_printf("ERR: Failed to allocate scratch buffer of size %d\n",
-      (int)bytes);
+  s->scratch_buffers[s->scratch_buffers_ix] = b;
+  *buffer_idx = s->scratch_buffers_ix;
+
+  s->scratch_buffers_ix++;
+
+  return kTfLiteOk;
+}
+
+#if !TFLITE_LEARN_4_PREPARED
+static void ComputeTensorLifetimes(EonSession *s) {
+  for (size_t i = 0; i < 71; i++) {
+    s->tensor_first_use[i] = -1;
+    s->tensor_last_use[i] = -1;
+  }
+  for (size_t i = 0; i < sizeof(in_tensor_indices) / sizeof(in_tensor_indices[0]); i++) {
+    s->tensor_first_use[in_tensor_indices[i]] = 0;
+    s->tensor_last_use[in_tensor_indices[i]] = 0;
+  }
+  for (int16_t n = 0; n < 27; n++) {
+    const TfLiteIntArray* lists[] = { tflNodes[n].inputs, tflNodes[n].outputs };
+    for (size_t l = 0; l < 2; l++) {
+      for (int ix = 0; ix < lists[l]->size; ix++) {
+        int t = lists[l]->data[ix];
+        if (t < 0) {
+          continue;
+        }
+        if (s->tensor_first_use[t] < 0) {
+          s->tensor_first_use[t] = n;
+        }
+        s->tensor_last_use[t] = n;
+      }
+    }
+  }
+  for (size_t i = 0; i < sizeof(out_tensor_indices) / sizeof(out_tensor_indices[0]); i++) {
+    s->tensor_last_use[out_tensor_indices[i]] = 27;
+  }
+}
+#endif // !TFLITE_LEARN_4_PREPARED
+
+#if TFLITE_LEARN_4_PREPARED || defined(EI_CLASSIFIER_EON_RUNTIME_PREPARE)
+// FNV-1a over the arena placement of all tensors, ties prepared kernel data to this layout
+// (also written out by tools/eon_prepare.cpp)
+static uint32_t TensorLayoutHash() {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < 71; i++) {
+    if (tensorData[i].allocation_type != kTfLiteArenaRw) {
+      continue;
+    }
+    const uint32_t words[] = { (uint32_t)i, (uint32_t)TensorArenaOffset(i), (uint32_t)tensorData[i].bytes };
+    for (size_t w = 0; w < 3; w++) {
+      for (size_t b = 0; b < 4; b++) {
+        hash ^= (words[w] >> (b * 8)) & 0xff;
+        hash *= 16777619u;
+      }
+    }
+  }
+  return hash;
+}
+#endif
+
+#if !TFLITE_LEARN_4_PREPARED
+// Returns the end of a tensor or scratch buffer that is in use during the node and overlaps
+// [start, start + bytes), or 0 if that range is free
+static size_t FindArenaConflict(EonSession *s, int16_t node, size_t start, size_t bytes, size_t placed_count) {
+  for (size_t i = 0; i < 71; i++) {
+    if (tensorData[i].allocation_type != kTfLiteArenaRw ||
+        s->tensor_first_use[i] > node || s->tensor_last_use[i] < node) {
+      continue;
+    }
+    size_t t_start = TensorArenaOffset(i);
+    if (start < t_start + tensorData[i].bytes && t_start < start + bytes) {
+      return t_start + tensorData[i].bytes;
+    }
+  }
+  for (size_t i = 0; i < placed_count; i++) {
+    const scratch_buffer_t& b = s->scratch_buffers[i];
+    if (b.node != node || (uint8_t*)b.ptr < s->arena || (uint8_t*)b.ptr >= s->tensor_boundary) {
+      continue;
+    }
+    size_t b_start = (size_t)((uint8_t*)b.ptr - s->arena);
+    if (start < b_start + b.bytes && b_start < start + bytes) {
+      return b_start + b.bytes;
+    }
+  }
+  return 0;
+}
+
+// Scratch buffers are only alive while their node runs, so place them in parts of the
+// tensor area that are unused during that node. Only if there's no such gap they are
+// carved out of the persistent area at the top of the arena.
+static TfLiteStatus PlaceScratchBuffers(EonSession *s) {
+  const size_t tensor_area = (size_t)(s->tensor_boundary - s->arena);
+
+  for (size_t ix = 0; ix < s->scratch_buffers_ix; ix++) {
+    scratch_buffer_t& b = s->scratch_buffers[ix];
+
+    size_t start = 0;
+    while (start + b.bytes <= tensor_area) {
+      size_t conflict_end = FindArenaConflict(s, b.node, start, b.bytes, ix);
+      if (conflict_end == 0) {
+        b.ptr = s->arena + start;
+        break;
+      }
+      start = (conflict_end + 15) & ~((size_t)15);
+    }
+
+    if (!b.ptr) {
+      b.ptr = AllocatePersistentBufferImpl(&s->ctx, b.bytes);
+      if (!b.ptr) {
+        ei_printf("ERR: Failed to allocate scratch buffer of size %d\n",
+          (int)b.bytes);
+        return kTfLiteError;
+      }
+    }
+  }
+  return kTfLiteOk;
+}
+#endif // !TFLITE_LEARN_4_PREPARED
+
+#if TFLITE_LEARN_4_PREPARED
+// Node data and scratch buffer placement were computed by running init/prepare on the host,
+// so only the pointers need to be hooked up here.
+static TfLiteStatus UsePreparedNodeData(EonSession *s) {
+  if (kTensorArenaSize != tflite_learn_4_prepared::kArenaSize ||
+      TensorLayoutHash() != tflite_learn_4_prepared::kTensorLayoutHash) {
+    ei_printf("ERR: tflite_learn_4_prepared.h does not match the model, regenerate it with tools/eon_prepare.cpp\n");
     return kTfLiteError;
   }
 
-  scratch_buffers[scratch_buffers_ix] = b;
-  *buffer_idx = scratch_buffers_ix;
+  for (size_t i = 0; i < 27; i++) {
+    s->nodes[i].user_data = const_cast<void*>(tflite_learn_4_prepared::node_data[i]);
+  }
 
-  scratch_buffers_ix++;
+  for (size_t ix = 0; ix < tflite_learn_4_prepared::scratch_buffer_count; ix++) {
+    const tflite_learn_4_prepared::ScratchBuffer& p = tflite_learn_4_prepared::scratch_buffers[ix];
+    s->scratch_buffers[ix].bytes = p.bytes;
+    s->scratch_buffers[ix].ptr = s->arena + p.offset;
+    s->scratch_buffers[ix].node = p.node;
+  }
+  s->scratch_buffers_ix = tflite_learn_4_prepared::scratch_buffer_count;
 
   return kTfLiteOk;
 }
+#endif // TFLITE_LEARN_4_PREPARED
 
 static void* GetScratchBufferImpl(struct TfLiteContext* ctx, int buffer_idx) {
-  if (buffer_idx > (int)scratch_buffers_ix) {
+  EonSession *s = GetSession(ctx);
+  if (buffer_idx > (int)s->scratch_buffers_ix) {
     return NULL;
   }
-  return scratch_buffers[buffer_idx].ptr;
+  return s->scratch_buffers[buffer_idx].ptr;
 }
 
 static const uint16_t TENSOR_IX_UNUSED = 0x7FFF;
 
-static void ResetTensors() {
+#if !TFLITE_LEARN_4_PREPARED
+static void ResetTensors(EonSession *s) {
   for (size_t ix = 0; ix < MAX_TFL_TENSOR_COUNT; ix++) {
-    tflTensors[ix].index = TENSOR_IX_UNUSED;
-  }
-  for (size_t ix = 0; ix < MAX_TFL_EVAL_COUNT; ix++) {
-    tflEvalTensors[ix].index = TENSOR_IX_UNUSED;
+    s->tensors[ix].index = TENSOR_IX_UNUSED;
   }
 }
+#endif // !TFLITE_LEARN_4_PREPARED
 
 static TfLiteTensor* GetTensorImpl(const struct TfLiteContext* context,
                                int tensor_idx) {
+  EonSession *s = GetSession(context);
 
-  tensor_idx = tflTensors_subgraph_index[current_subgraph_index] + tensor_idx;
+  tensor_idx = tflTensors_subgraph_index[s->current_subgraph_index] + tensor_idx;
 
   for (size_t ix = 0; ix < MAX_TFL_TENSOR_COUNT; ix++) {
     // already used? OK!
-    if (tflTensors[ix].index == tensor_idx) {
-      return &tflTensors[ix].tensor;
+    if (s->tensors[ix].index == tensor_idx) {
+      return &s->tensors[ix].tensor;
     }
     // passed all the ones we've used, so end of the list?
-    if (tflTensors[ix].index == TENSOR_IX_UNUSED) {
+    if (s->tensors[ix].index == TENSOR_IX_UNUSED) {
       // init the tensor
-      init_tflite_tensor(tensor_idx, &tflTensors[ix].tensor);
-      tflTensors[ix].index = tensor_idx;
-      return &tflTensors[ix].tensor;
+      init_tflite_tensor(s, tensor_idx, &s->tensors[ix].tensor);
+      s->tensors[ix].index = tensor_idx;
+      return &s->tensors[ix].tensor;
     }
   }
 
@@ -1511,47 +1698,31 @@ static TfLiteTensor* GetTensorImpl(const struct TfLiteContext* context,
 
 static TfLiteEvalTensor* GetEvalTensorImpl(const struct TfLiteContext* context,
                                        int tensor_idx) {
+  EonSession *s = GetSession(context);
 
-  tensor_idx = tflTensors_subgraph_index[current_subgraph_index] + tensor_idx;
-
-  for (size_t ix = 0; ix < MAX_TFL_EVAL_COUNT; ix++) {
-    // already used? OK!
-    if (tflEvalTensors[ix].index == tensor_idx) {
-      return &tflEvalTensors[ix].tensor;
-    }
-    // passed all the ones we've used, so end of the list?
-    if (tflEvalTensors[ix].index == TENSOR_IX_UNUSED) {
-      // init the tensor
-      init_tflite_eval_tensor(tensor_idx, &tflEvalTensors[ix].tensor);
-      tflEvalTensors[ix].index = tensor_idx;
-      return &tflEvalTensors[ix].tensor;
-    }
-  }
-
-  ei_printf("ERR: GetTensor called beyond MAX_TFL_EVAL_COUNT (%d)\n", (int)MAX_TFL_EVAL_COUNT);
-  return nullptr;
+  return &s->eval_tensors[tflTensors_subgraph_index[s->current_subgraph_index] + tensor_idx];
 }
 
 class EonMicroContext : public MicroContext {
  public:
  
-  EonMicroContext(): MicroContext(nullptr, nullptr, nullptr) { }
+  EonMicroContext(EonSession* session): MicroContext(nullptr, nullptr, nullptr), session_(session) { }
 
   void* AllocatePersistentBuffer(size_t bytes) {
-    return AllocatePersistentBufferImpl(nullptr, bytes);
+    return AllocatePersistentBufferImpl(&session_->ctx, bytes);
   }
 
   TfLiteStatus RequestScratchBufferInArena(size_t bytes,
                                            int* buffer_index) {
-  return RequestScratchBufferInArenaImpl(nullptr, bytes, buffer_index);
+  return RequestScratchBufferInArenaImpl(&session_->ctx, bytes, buffer_index);
   }
 
   void* GetScratchBuffer(int buffer_index) {
-    return GetScratchBufferImpl(nullptr, buffer_index);
+    return GetScratchBufferImpl(&session_->ctx, buffer_index);
   }
  
   TfLiteTensor* AllocateTempTfLiteTensor(int tensor_index) {
-    return GetTensorImpl(nullptr, tensor_index);
+    return GetTensorImpl(&session_->ctx, tensor_index);
   }
 
   void DeallocateTempTfLiteTensor(TfLiteTensor* tensor) {
@@ -1563,28 +1734,44 @@ class EonMicroContext : public MicroContext {
   }
 
   TfLiteEvalTensor* GetEvalTensor(int tensor_index) {
-    return GetEvalTensorImpl(nullptr, tensor_index);
+    return GetEvalTensorImpl(&session_->ctx, tensor_index);
   }
 
+ private:
+  EonSession* session_;
 };
 
 
 } // namespace
 
-TfLiteStatus tflite_learn_4_init( void*(*alloc_fnc)(size_t,size_t) ) {
+size_t tflite_learn_4_session_size() {
+  return sizeof(EonSession);
+}
+
+TfLiteStatus tflite_learn_4_init_session(void *session, void*(*alloc_fnc)(size_t,size_t) ) {
+  EonSession *s = static_cast<EonSession*>(session);
+
 #ifdef EI_CLASSIFIER_ALLOCATION_HEAP
-  tensor_arena = (uint8_t*) alloc_fnc(16, kTensorArenaSize);
-  if (!tensor_arena) {
+  s->arena = (uint8_t*) alloc_fnc(16, kTensorArenaSize);
+#else
+  s->uses_static_arena = !static_arena_in_use.exchange(true);
+  if (s->uses_static_arena) {
+    s->arena = tensor_arena;
+    memset(s->arena, 0, kTensorArenaSize);
+  }
+  else {
+    s->arena = (uint8_t*) alloc_fnc(16, kTensorArenaSize);
+  }
+#endif
+  if (!s->arena) {
     ei_printf("ERR: failed to allocate tensor arena\n");
     return kTfLiteError;
   }
-#else
-  memset(tensor_arena, 0, kTensorArenaSize);
-#endif
-  tensor_boundary = tensor_arena;
-  current_location = tensor_arena + kTensorArenaSize;
+  s->tensor_boundary = s->arena;
+  s->current_location = s->arena + kTensorArenaSize;
 
-  EonMicroContext micro_context_;
+  EonMicroContext micro_context_(s);
+  TfLiteContext& ctx = s->ctx;
   
   // Set microcontext as the context ptr
   ctx.impl_ = static_cast<void*>(&micro_context_);
@@ -1598,80 +1785,105 @@ TfLiteStatus tflite_learn_4_init( void*(*alloc_fnc)(size_t,size_t) ) {
 
   ctx.tensors_size = 71;
   for (size_t i = 0; i < 71; ++i) {
+    init_tflite_eval_tensor(s, i, &s->eval_tensors[i]);
+
     TfLiteTensor tensor;
-    init_tflite_tensor(i, &tensor);
+    init_tflite_tensor(s, i, &tensor);
     if (tensor.allocation_type == kTfLiteArenaRw) {
       auto data_end_ptr = (uint8_t*)tensor.data.data + tensorData[i].bytes;
-      if (data_end_ptr > tensor_boundary) {
-        tensor_boundary = data_end_ptr;
+      if (data_end_ptr > s->tensor_boundary) {
+        s->tensor_boundary = data_end_ptr;
       }
     }
   }
 
-  if (tensor_boundary > current_location /* end of arena size */) {
+  if (s->tensor_boundary > s->current_location /* end of arena size */) {
     ei_printf("ERR: tensor arena is too small, does not fit model - even without scratch buffers\n");
     return kTfLiteError;
   }
 
-  registrations[OP_CONV_2D] = Register_CONV_2D();
-  registrations[OP_DEPTHWISE_CONV_2D] = Register_DEPTHWISE_CONV_2D();
-  registrations[OP_PAD] = Register_PAD();
-  registrations[OP_ADD] = Register_ADD();
-  registrations[OP_SOFTMAX] = Register_SOFTMAX();
+  memcpy(s->nodes, tflNodes, sizeof(tflNodes));
+  s->current_subgraph_index = 0;
 
+#if TFLITE_LEARN_4_PREPARED
+  return UsePreparedNodeData(s);
+#else
   for (size_t g = 0; g < 1; ++g) {
-    current_subgraph_index = g;
+    s->current_subgraph_index = g;
     for(size_t i = tflNodes_subgraph_index[g]; i < tflNodes_subgraph_index[g+1]; ++i) {
       if (registrations[used_ops[i]].init) {
-        tflNodes[i].user_data = registrations[used_ops[i]].init(&ctx, (const char*)tflNodes[i].builtin_data, 0);
+        s->nodes[i].user_data = registrations[used_ops[i]].init(&ctx, (const char*)s->nodes[i].builtin_data, 0);
       }
     }
   }
-  current_subgraph_index = 0;
+  s->current_subgraph_index = 0;
 
   for(size_t g = 0; g < 1; ++g) {
-    current_subgraph_index = g;
+    s->current_subgraph_index = g;
     for(size_t i = tflNodes_subgraph_index[g]; i < tflNodes_subgraph_index[g+1]; ++i) {
       if (registrations[used_ops[i]].prepare) {
-        ResetTensors();
-        TfLiteStatus status = registrations[used_ops[i]].prepare(&ctx, &tflNodes[i]);
+        ResetTensors(s);
+        s->current_node_index = i;
+        TfLiteStatus status = registrations[used_ops[i]].prepare(&ctx, &s->nodes[i]);
         if (status != kTfLiteOk) {
           return status;
         }
       }
     }
   }
-  current_subgraph_index = 0;
+  s->current_subgraph_index = 0;
+
+  ComputeTensorLifetimes(s);
+  if (PlaceScratchBuffers(s) != kTfLiteOk) {
+    return kTfLiteError;
+  }
 
   return kTfLiteOk;
+#endif // TFLITE_LEARN_4_PREPARED
 }
 
-TfLiteStatus tflite_learn_4_input(int index, TfLiteTensor *tensor) {
-  init_tflite_tensor(in_tensor_indices[index], tensor);
+TfLiteStatus tflite_learn_4_input_session(void *session, int index, TfLiteTensor *tensor) {
+  init_tflite_tensor(static_cast<EonSession*>(session), in_tensor_indices[index], tensor);
   return kTfLiteOk;
 }
 
-TfLiteStatus tflite_learn_4_output(int index, TfLiteTensor *tensor) {
-  init_tflite_tensor(out_tensor_indices[index], tensor);
+TfLiteStatus tflite_learn_4_output_session(void *session, int index, TfLiteTensor *tensor) {
+  init_tflite_tensor(static_cast<EonSession*>(session), out_tensor_indices[index], tensor);
   return kTfLiteOk;
 }
 
-TfLiteStatus tflite_learn_4_invoke() {
-  for (size_t i = 0; i < 27; ++i) {
-    ResetTensors();
+void tflite_learn_4_set_layer_observer_session(void *session, tflite_learn_4_layer_observer_t observer, void *user) {
+  EonSession *s = static_cast<EonSession*>(session);
+  s->layer_observer = observer;
+  s->layer_observer_user = user;
+}
+
+// hands a tensor of the session to its layer observer
+static void ObserveTensor(EonSession *s, int layer, int t) {
+  TfLiteTensor tensor;
+  init_tflite_tensor(s, t, &tensor);
+  s->layer_observer(layer, &tensor, s->layer_observer_user);
+}
 
-    TfLiteStatus status = registrations[used_ops[i]].invoke(&ctx, &tflNodes[i]);
+TfLiteStatus tflite_learn_4_invoke_session(void *session) {
+  EonSession *s = static_cast<EonSession*>(session);
+  if (s->layer_observer) {
+    ObserveTensor(s, -1, in_tensor_indices[0]);
+  }
+  for (size_t i = 0; i < 27; ++i) {
+    TfLiteStatus status = registrations[used_ops[i]].invoke(&s->ctx, &s->nodes[i]);
 
 #if EI_CLASSIFIER_PRINT_STATE
     ei_printf("layer %lu\n", i);
     ei_printf("    inputs:\n");
-    for (size_t ix = 0; ix < tflNodes[i].inputs->size; ix++) {
-      auto d = tensorData[tflNodes[i].inputs->data[ix]];
+    for (size_t ix = 0; ix < s->nodes[i].inputs->size; ix++) {
+      int t = s->nodes[i].inputs->data[ix];
+      auto d = tensorData[t];
 
       size_t data_ptr = (size_t)d.data;
 
-      if (d.allocation_type == kTfLiteArenaRw) {
-        data_ptr = (size_t)tensor_arena + data_ptr;
+      if (IsArenaTensor(t)) {
+        data_ptr = (size_t)(s->arena + TensorArenaOffset(t));
       }
 
       if (d.type == TfLiteType::kTfLiteInt8) {
@@ -1693,13 +1905,14 @@ TfLiteStatus tflite_learn_4_invoke() {
     ei_printf("\n");
 
     ei_printf("    outputs:\n");
-    for (size_t ix = 0; ix < tflNodes[i].outputs->size; ix++) {
-      auto d = tensorData[tflNodes[i].outputs->data[ix]];
+    for (size_t ix = 0; ix < s->nodes[i].outputs->size; ix++) {
+      int t = s->nodes[i].outputs->data[ix];
+      auto d = tensorData[t];
 
       size_t data_ptr = (size_t)d.data;
 
-      if (d.allocation_type == kTfLiteArenaRw) {
-        data_ptr = (size_t)tensor_arena + data_ptr;
+      if (IsArenaTensor(t)) {
+        data_ptr = (size_t)(s->arena + TensorArenaOffset(t));
       }
 
       if (d.type == TfLiteType::kTfLiteInt8) {
@@ -1724,22 +1937,66 @@ TfLiteStatus tflite_learn_4_invoke() {
     if (status != kTfLiteOk) {
       return status;
     }
+    if (s->layer_observer) {
+      ObserveTensor(s, (int)i, s->nodes[i].outputs->data[0]);
+    }
+    // a layer takes a few ms on the ESP32, polling here lets a deadline stop mid-graph
+    if (ei_run_impulse_check_interrupted() == EI_IMPULSE_CANCELED) {
+      return kTfLiteCancelled;
+    }
   }
   return kTfLiteOk;
 }
 
-TfLiteStatus tflite_learn_4_reset( void (*free_fnc)(void* ptr) ) {
+TfLiteStatus tflite_learn_4_reset_session(void *session, void (*free_fnc)(void* ptr) ) {
+  EonSession *s = static_cast<EonSession*>(session);
 #ifdef EI_CLASSIFIER_ALLOCATION_HEAP
-  free_fnc(tensor_arena);
+  free_fnc(s->arena);
+#else
+  if (s->uses_static_arena) {
+    s->uses_static_arena = false;
+    static_arena_in_use = false;
+  }
+  else {
+    free_fnc(s->arena);
+  }
 #endif
+  s->arena = nullptr;
 
   // scratch buffers are allocated within the arena, so just reset the counter so memory can be reused
-  scratch_buffers_ix = 0;
+  s->scratch_buffers_ix = 0;
 
   // overflow buffers are on the heap, so free them first
-  for (size_t ix = 0; ix < overflow_buffers_ix; ix++) {
-    ei_free(overflow_buffers[ix]);
+  for (size_t ix = 0; ix < s->overflow_buffers_ix; ix++) {
+    ei_free(s->overflow_buffers[ix]);
   }
-  overflow_buffers_ix = 0;
+  s->overflow_buffers_ix = 0;
   return kTfLiteOk;
 }
+
+TfLiteStatus tflite_learn_4_init( void*(*alloc_fnc)(size_t,size_t) ) {
+  if (!default_session) {
+    default_session = static_cast<EonSession*>(ei_calloc(1, sizeof(EonSession)));
+    if (!default_session) {
+      ei_printf("ERR: failed to allocate session\n");
+      return kTfLiteError;
+    }
+  }
+  return tflite_learn_4_init_session(default_session, alloc_fnc);
+}
+
+TfLiteStatus tflite_learn_4_input(int index, TfLiteTensor *tensor) {
+  return tflite_learn_4_input_session(default_session, index, tensor);
+}
+
+TfLiteStatus tflite_learn_4_output(int index, TfLiteTensor *tensor) {
+  return tflite_learn_4_output_session(default_session, index, tensor);
+}
+
+TfLiteStatus tflite_learn_4_invoke() {
+  return tflite_learn_4_invoke_session(default_session);
+}
+
+TfLiteStatus tflite_learn_4_reset( void (*free_fnc)(void* ptr) ) {
+  return tflite_learn_4_reset_session(default_session, free_fnc);
+}
@@ -46,6 +46,21 @@ TfLiteStatus tflite_learn_4_invoke();
 //Frees memory allocated
 TfLiteStatus tflite_learn_4_reset( void (*free)(void* ptr) );
 
+// The functions above share one session. For concurrent inferences give every thread its own
+// zero initialized session of tflite_learn_4_session_size() bytes and use the *_session variants.
+size_t tflite_learn_4_session_size();
+TfLiteStatus tflite_learn_4_init_session(void *session, void*(*alloc_fnc)(size_t,size_t) );
+TfLiteStatus tflite_learn_4_input_session(void *session, int index, TfLiteTensor* tensor);
+TfLiteStatus tflite_learn_4_output_session(void *session, int index, TfLiteTensor* tensor);
+TfLiteStatus tflite_learn_4_invoke_session(void *session);
+TfLiteStatus tflite_learn_4_reset_session(void *session, void (*free)(void* ptr) );
+
+// Called with the input tensor before the first layer runs (layer -1) and with the output
+// of every layer after it ran, to compare runs layer by layer. Set per session and kept across
+// its runs; nullptr, as in a zero initialized session, observes nothing.
+typedef void (*tflite_learn_4_layer_observer_t)(int layer, const TfLiteTensor *tensor, void *user);
+void tflite_learn_4_set_layer_observer_session(void *session, tflite_learn_4_layer_observer_t observer, void *user);
+
 
 // Returns the number of input tensors.
 inline size_t tflite_learn_4_inputs() {
@@ -0,0 +1,496 @@
+// Generated by tools/eon_prepare.cpp from tflite_learn_4_compiled.cpp, do not edit.
+//
+// Kernel data of every node and the scratch buffer plan, as computed by the init/prepare
+// pass of the ESP-NN kernels (ESP32 variant). tflite_learn_4_init() uses this instead of
+// running that pass on the device.
+
+#ifndef TFLITE_LEARN_4_PREPARED_H
+#define TFLITE_LEARN_4_PREPARED_H
+
+#include "edge-impulse-sdk/classifier/ei_classifier_config.h"
+
+#if EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN == 1 && !defined(EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN_S3) && \
+    !defined(EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN_P4) && !defined(EI_CLASSIFIER_EON_RUNTIME_PREPARE)
+#define TFLITE_LEARN_4_PREPARED 1
+
+#include <cstddef>
+#include <limits>
+#include "edge-impulse-sdk/tensorflow/lite/kernels/internal/types.h"
+#include "edge-impulse-sdk/tensorflow/lite/micro/kernels/add.h"
+#include "edge-impulse-sdk/tensorflow/lite/micro/kernels/conv.h"
+#include "edge-impulse-sdk/tensorflow/lite/micro/kernels/esp_nn_node_data.h"
+
+namespace tflite_learn_4_prepared {
+
+// Same layout as the node data of the ESP-NN conv, depthwise, pad and softmax kernels
+// (kernels/esp_nn_node_data.h), checked below: the data is written for that layout
+struct ConvData {
+  tflite::OpDataConv op_data;
+  int buffer_idx;
+};
+
+struct PadData {
+  tflite::PadParams params;
+  int32_t output_zero_point;
+};
+
+struct SoftmaxData {
+  tflite::SoftmaxParams op_data;
+  int buffer_idx;
+};
+
+static_assert(sizeof(ConvData) == sizeof(tflite::EspNnConvNodeData) &&
+              offsetof(ConvData, op_data) == offsetof(tflite::EspNnConvNodeData, op_data) &&
+              offsetof(ConvData, buffer_idx) == offsetof(tflite::EspNnConvNodeData, buffer_idx),
+              "conv node data changed, run tools/eon_prepare.cpp again");
+static_assert(sizeof(PadData) == sizeof(tflite::PadOpData) &&
+              offsetof(PadData, params) == offsetof(tflite::PadOpData, params) &&
+              offsetof(PadData, output_zero_point) == offsetof(tflite::PadOpData, output_zero_point),
+              "pad node data changed, run tools/eon_prepare.cpp again");
+static_assert(sizeof(SoftmaxData) == sizeof(tflite::EspNnSoftmaxNodeData) &&
+              offsetof(SoftmaxData, op_data) == offsetof(tflite::EspNnSoftmaxNodeData, op_data) &&
+              offsetof(SoftmaxData, buffer_idx) == offsetof(tflite::EspNnSoftmaxNodeData, buffer_idx),
+              "softmax node data changed, run tools/eon_prepare.cpp again");
+
+struct ScratchBuffer {
+  uint32_t offset;
+  uint32_t bytes;
+  int16_t node;
+};
+
+const int kArenaSize = 158720;
+const uint32_t kTensorLayoutHash = 0xf6c7b12e;
+
+const int32_t node0_multiplier[16] = {
+    2006215247, 1102028332, 1861600159, 1683593795, 1696080110, 1095247830, 1512991292, 1647561964,
+    1750020165, 1997291940, 2029992016, 1204828634, 1766094577, 1691004483, 1074717653, 1523108071
+};
+const int32_t node0_shift[16] = {
+    -24, -6, -7, -9, -11, -6, -9, -6,
+    -12, -9, -8, -11, -24, -8, -9, -27
+};
+const ConvData node0 = { { { 0, 0, 1, 1 }, -128, 0, -128, 0, 0,
+    const_cast<int32_t*>(node0_multiplier), const_cast<int32_t*>(node0_shift),
+    -128, 127, 0 }, -1 };
+
+const int32_t node1_multiplier[16] = {
+    1364559872, 1901942144, 2134362752, 1602165120, 1732582144, 1631202176, 1150739200, 1358016128,
+    1531202304, 1637246080, 1117888384, 2125214720, 2123966336, 1312366080, 2114862208, 1426514688
+};
+const int32_t node1_shift[16] = {
+    -3, -8, -5, -6, -7, -7, -5, -8,
+    -10, -6, -6, -5, -5, -6, -7, -2
+};
+const ConvData node1 = { { { 1, 1, 0, 0 }, -128, 0, -128, 0, 0,
+    const_cast<int32_t*>(node1_multiplier), const_cast<int32_t*>(node1_shift),
+    -128, 127, 0 }, -1 };
+
+const int32_t node2_multiplier[8] = {
+    1943465154, 1116666535, 1272808890, 1140508824, 1977398805, 1114757786, 1321129291, 1925795414
+};
+const int32_t node2_shift[8] = {
+    -8, -7, -7, -8, -9, -7, -8, -9
+};
+const ConvData node2 = { { { 0, 0, 0, 0 }, -128, 0, 15, 0, 0,
+    const_cast<int32_t*>(node2_multiplier), const_cast<int32_t*>(node2_shift),
+    -128, 127, 0 }, -1 };
+
+const int32_t node3_multiplier[48] = {
+    1710279261, 1403124460, 2092784301, 1736614387, 1777681295, 2140724848, 1223064527, 1201263013,
+    1461351122, 1153141191, 1128608522, 1766424338, 1255909971, 1706017563, 1255919786, 1904507523,
+    1706017563, 1220780402, 1600611056, 1741394702, 1721907621, 2072745120, 1251625181, 1189629265,
+    1574405055, 2044780057, 2009597857, 2118400291, 1645153367, 1374141023, 2063224902, 1922484747,
+    1487070450, 1860769981, 1561775160, 1566963440, 1637607740, 1525408898, 2039214602, 1735301585,
+    2146830857, 1323464511, 1286044948, 1921218130, 1301809152, 2095490535, 1086248344, 1235716071
+};
+const int32_t node3_shift[48] = {
+    -5, -5, -6, -6, -6, -6, -5, -3,
+    -5, -2, -4, -3, -6, -23, -4, -7,
+    -23, -1, -5, -6, -6, -2, -5, -3,
+    -4, -5, -3, -3, -6, -3, -4, -7,
+    -6, -1, -5, -5, -2, -5, -3, -6,
+    -4, -6, -5, -1, -5, -5, -6, -6
+};
+const ConvData node3 = { { { 0, 0, 0, 0 }, 15, 0, -128, 0, 0,
+    const_cast<int32_t*>(node3_multiplier), const_cast<int32_t*>(node3_shift),
+    -128, 127, 0 }, -1 };
+
+const PadData node4 = { { 4, { 0, 0, 0, 0, 0 }, 4, { 0, 1, 1, 0, 0 },
+    static_cast<tflite::ResizingCategory>(1) }, -128 };
+
+const int32_t node5_multiplier[48] = {
+    1770893184, 1915094784, 1857568000, 1624427008, 1467600896, 1206395264, 1525749120, 1347613184,
+    1107250560, 1281418240, 1929062784, 1896891776, 1943585792, 2023072128, 1546493184, 1536754944,
+    2006741504, 1672614400, 2124864640, 1084153472, 1249219968, 1634460032, 1478603520, 1363526912,
+    1705126144, 1553076352, 1675997952, 1606988672, 1814074496, 1167873024, 2127347712, 2126402944,
+    1278372352, 1819053056, 1983135744, 1430076928, 1800554752, 1492502144, 1263295104, 2058651904,
+    1259470976, 1233856384, 1534043264, 1740724096, 1703602432, 1719884416, 1460178176, 1666922368
+};
+const int32_t node5_shift[48] = {
+    -8, -8, -7, -7, -7, -6, -7, -8,
+    -7, -9, -8, -10, -7, -2, -8, -6,
+    -3, -10, -8, -6, -7, -7, -7, -9,
+    -8, -8, -9, -9, -6, -8, -9, -7,
+    -6, -11, -8, -6, -10, -5, -9, -8,
+    -8, -6, -7, -11, -7, -8, -6, -7
+};
+const ConvData node5 = { { { 0, 0, 0, 0 }, -128, 0, -128, 0, 0,
+    const_cast<int32_t*>(node5_multiplier), const_cast<int32_t*>(node5_shift),
+    -128, 127, 0 }, -1 };
+
+const int32_t node6_multiplier[8] = {
+    1622417778, 1698338306, 1681305565, 1452135428, 1562086058, 1529350529, 1123104445, 1661989430
+};
+const int32_t node6_shift[8] = {
+    -8, -9, -8, -8, -8, -8, -8, -9
+};
+const ConvData node6 = { { { 0, 0, 0, 0 }, -128, 0, 7, 0, 0,
+    const_cast<int32_t*>(node6_multiplier), const_cast<int32_t*>(node6_shift),
+    -128, 127, 0 }, -1 };
+
+const int32_t node7_multiplier[48] = {
+    1750130863, 1758613640, 1343033088, 1386866618, 2131870158, 1111310661, 1201899189, 1742865579,
+    2074543001, 1989261024, 1842347310, 1323254396, 1638280875, 1249107547, 1789872349, 1359433539,
+    1915895507, 1145768270, 1532939859, 1613004990, 1333931188, 2007523538, 1416619954, 1319128516,
+    1276872437, 1215396085, 1110451564, 1120766691, 1984339453, 1519759277, 1506274892, 1174464048,
+    1329127613, 1785775897, 1396200672, 1692238037, 1208174586, 1738902618, 1463920434, 1517185116,
+    1128947582, 1698906233, 1363573778, 2032891828, 1529483429, 1457812363, 2050303349, 1312473114
+};
+const int32_t node7_shift[48] = {
+    -8, -6, -6, -5, -4, -5, -4, -4,
+    -5, -5, -5, -5, -5, -5, -5, -3,
+    -6, -5, -3, -7, -6, -6, -5, -4,
+    -5, -6, -6, -5, -5, -4, -5, -5,
+    -4, -7, -5, -6, -5, -6, -7, -3,
+    -4, -4, -5, -6, -6, -5, -5, -4
+};
+const ConvData node7 = { { { 0, 0, 0, 0 }, 7, 0, -128, 0, 0,
+    const_cast<int32_t*>(node7_multiplier), const_cast<int32_t*>(node7_shift),
+    -128, 127, 0 }, -1 };
+
+const int32_t node8_multiplier[48] = {
+    1860786176, 1378487424, 1136818176, 1148929280, 1495370880, 1159952896, 2124494208, 1102402304,
+    1498705920, 1718897024, 1903550720, 1622672768, 1419378432, 1418214272, 2117089792, 1527114752,
+    2079635456, 1281062528, 1392963840, 1655382528, 1389303168, 1308878592, 1696231040, 1294109056,
+    1658457728, 1488391680, 1435070336, 2047686400, 1260169728, 1597912320, 1306316416, 1269311232,
+    1945155584, 1268385536, 2066429952, 1441736448, 1813165696, 2063813376, 1531397376, 1707205632,
+    1284803584, 1199880832, 1530685696, 1793162496, 1708283776, 1390670592, 1848458880, 1824013056
+};
+const int32_t node8_shift[48] = {
+    -6, -6, -6, -6, -7, -7, -5, -7,
+    -7, -7, -8, -7, -6, -6, -8, -7,
+    -7, -6, -8, -7, -6, -6, -7, -7,
+    -7, -7, -5, -8, -6, -5, -7, -6,
+    -5, -6, -7, -7, -6, -7, -6, -10,
+    -7, -8, -7, -7, -7, -7, -7, -8
+};
+const ConvData node8 = { { { 1, 1, 0, 0 }, -128, 0, -128, 0, 0,
+    const_cast<int32_t*>(node8_multiplier), const_cast<int32_t*>(node8_shift),
+    -128, 127, 0 }, -1 };
+
+const int32_t node9_multiplier[8] = {
+    1128994803, 1653896905, 1831014892, 2054262981, 1938894410, 1803687845, 1598258802, 1083934169
+};
+const int32_t node9_shift[8] = {
+    -9, -9, -8, -8, -9, -10, -9, -8
+};
+const ConvData node9 = { { { 0, 0, 0, 0 }, -128, 0, -17, 0, 0,
+    const_cast<int32_t*>(node9_multiplier), const_cast<int32_t*>(node9_shift),
+    -128, 127, 0 }, -1 };
+
+const tflite::OpDataAdd node10 = { false, -1, 0, -128, 127,
+    1998007112, 1073741824, 1820679776, -19, 20, -7, 17, -5,
+    0.0f, 0.0f };
+
+const int32_t node11_multiplier[48] = {
+    1126490560, 1220541433, 1435950721, 1090437802, 1113708544, 1232745283, 1379183012, 1756910317,
+    1108610750, 2073833562, 1251984360, 1625361451, 1185947878, 1949277660, 1639122457, 1261126884,
+    1463068034, 1806535654, 1450175629, 1604209180, 1758257149, 1182208721, 1811493682, 1837375634,
+    2010620597, 1688443752, 1840775244, 1279853398, 1528534100, 1234971709, 1181606224, 2146435602,
+    1643415089, 1447626958, 2046571437, 2119621880, 1836071876, 1831089337, 1515974844, 1681946230,
+    1132212297, 1412682773, 1764610129, 1768240970, 1085901594, 2015669639, 1733461061, 1656555215
+};
+const int32_t node11_shift[48] = {
+    -5, -4, -6, -5, -6, -6, -5, -6,
+    -5, -5, -4, -6, -5, -5, -7, -5,
+    -6, -6, -6, -6, -6, -6, -6, -7,
+    -6, -6, -4, -5, -6, -5, -6, -7,
+    -5, -6, -5, -6, -5, -6, -6, -6,
+    -6, -6, -6, -6, -3, -6, -6, -4
+};
+const ConvData node11 = { { { 0, 0, 0, 0 }, -5, 0, -128, 0, 0,
+    const_cast<int32_t*>(node11_multiplier), const_cast<int32_t*>(node11_shift),
+    -128, 127, 0 }, -1 };
+
+const PadData node12 = { { 4, { 0, 0, 0, 0, 0 }, 4, { 0, 1, 1, 0, 0 },
+    static_cast<tflite::ResizingCategory>(1) }, -128 };
+
+const int32_t node13_multiplier[48] = {
+    1580668800, 1513556352, 2034310528, 1291297408, 1554643328, 1620691584, 1807481600, 1234708224,
+    1469518208, 1940254208, 1885569920, 2074327168, 1774739072, 1506782336, 1898346368, 1369219968,
+    2102444160, 1361569152, 1553915264, 1594032640, 1310353152, 1337752576, 1381600128, 1242004992,
+    1223658112, 2125980800, 1843780864, 1460130688, 1392873472, 1950744064, 1270166528, 1835280256,
+    1736193536, 1136459136, 1138297088, 1139573888, 1274193920, 2067371520, 1343674368, 1348887936,
+    1135475200, 1952896256, 2022404864, 1815754368, 1310630272, 1850058496, 2074147968, 1232247808
+};
+const int32_t node13_shift[48] = {
+    -8, -9, -7, -8, -7, -8, -7, -7,
+    -8, -9, -9, -8, -9, -9, -7, -6,
+    -7, -8, -7, -7, -7, -6, -7, -7,
+    -7, -8, -10, -8, -7, -8, -7, -7,
+    -9, -7, -9, -8, -7, -8, -7, -7,
+    -7, -8, -8, -8, -9, -7, -8, -9
+};
+const ConvData node13 = { { { 0, 0, 0, 0 }, -128, 0, -128, 0, 0,
+    const_cast<int32_t*>(node13_multiplier), const_cast<int32_t*>(node13_shift),
+    -128, 127, 0 }, -1 };
+
+const int32_t node14_multiplier[16] = {
+    1091524140, 1616415663, 2068516570, 1939677842, 1918116019, 2143600857, 1849018055, 1186257580,
+    1151409273, 1126249979, 1537174039, 1213166467, 1974703281, 1243338273, 1811075837, 1143474506
+};
+const int32_t node14_shift[16] = {
+    -8, -8, -8, -8, -8, -8, -8, -8,
+    -8, -8, -8, -8, -8, -7, -9, -8
+};
+const ConvData node14 = { { { 0, 0, 0, 0 }, -128, 0, 11, 0, 0,
+    const_cast<int32_t*>(node14_multiplier), const_cast<int32_t*>(node14_shift),
+    -128, 127, 0 }, -1 };
+
+const int32_t node15_multiplier[96] = {
+    1286307720, 1370848123, 1791565374, 1403077442, 1689488301, 1596400211, 2112989789, 1236520455,
+    1752630224, 2139633578, 1105669942, 1980399217, 1210345793, 2090359337, 1752807605, 1447040663,
+    1949378532, 1118226297, 1214861021, 1770834946, 1671942653, 1207596475, 1970844516, 1653611897,
+    1388276713, 2094863703, 1680319062, 1632130832, 1417811832, 1899080220, 1328391384, 1866289853,
+    1425596133, 1818164818, 1303086660, 1460893265, 1353842070, 1557870452, 1350803790, 1587805307,
+    1110587330, 1569283884, 1424010116, 1507791892, 1718525119, 1535759935, 1580576848, 1547620411,
+    1762638611, 1403552313, 1311575100, 1241998623, 1885119358, 2020946237, 1755628468, 1474818040,
+    2083907548, 1077848490, 1121575443, 2080290626, 1609975071, 1080500768, 1651536287, 1080401395,
+    1450999780, 1365096523, 1509987252, 2005198099, 1343287446, 1185491254, 1156463323, 1209989594,
+    1378605494, 1117624943, 2074321070, 1899175015, 1189647681, 1501454468, 1142596718, 1416290807,
+    1262821691, 1876665031, 1976760032, 1359235496, 1906033451, 1502377191, 1120640422, 1440386000,
+    1420125686, 1188516428, 1711973688, 1722697524, 1747446136, 1389198538, 1522432116, 1136973755
+};
+const int32_t node15_shift[96] = {
+    -7, -6, -7, -4, -6, -7, -7, -5,
+    -6, -8, -6, -6, -5, -7, -6, -5,
+    -7, -6, -6, -5, -6, -7, -6, -6,
+    -7, -6, -6, -7, -5, -6, -7, -7,
+    -7, -6, -6, -5, -7, -6, -5, -7,
+    -5, -7, -7, -7, -7, -6, -7, -7,
+    -6, -6, -5, -5, -7, -7, -6, -7,
+    -6, -6, -6, -6, -8, -6, -6, -5,
+    -7, -6, -6, -6, -7, -7, -6, -5,
+    -6, -5, -7, -6, -7, -6, -7, -5,
+    -6, -6, -7, -5, -7, -6, -6, -6,
+    -7, -5, -7, -6, -7, -7, -6, -6
+};
+const ConvData node15 = { { { 0, 0, 0, 0 }, 11, 0, -128, 0, 0,
+    const_cast<int32_t*>(node15_multiplier), const_cast<int32_t*>(node15_shift),
+    -128, 127, 0 }, -1 };
+
+const int32_t node16_multiplier[96] = {
+    1872524416, 1184551424, 1985599104, 1484791040, 1806220544, 1118158208, 1173463552, 1938811392,
+    1586073216, 1139426560, 2006593280, 2099963136, 1214572160, 1802744832, 1801617792, 1131327360,
+    1151986560, 1579053440, 1450731520, 1149953152, 1148932864, 2072598656, 1564428672, 1944109824,
+    1521239424, 1470915072, 1448935040, 1284563584, 1985955584, 1157922944, 1338397312, 1833347584,
+    1545871488, 1720106624, 1152837120, 1533041280, 1275013888, 1271714304, 2100566912, 2096996224,
+    1090623104, 1870709376, 1111732864, 1848995200, 2072186496, 1564677888, 1212894080, 1663082368,
+    1736595328, 1789911808, 1147365888, 1379560704, 1285410304, 1676635904, 2146168960, 1160997888,
+    1376148608, 1364220928, 1136450176, 1825556608, 1973636224, 1799177600, 1760199680, 1528791168,
+    1274125568, 2065227264, 1491085056, 1383116160, 1242765440, 1596277376, 1971239168, 1743483136,
+    1118095104, 1841366016, 1959914112, 1445877888, 1494760704, 1277221760, 1570642048, 1094126080,
+    2009030016, 1702104320, 1754027904, 1780448256, 1530221056, 1333422592, 1649703296, 1930706048,
+    1441590528, 1404966784, 2095145856, 1423913600, 1720421120, 1223358080, 1220862720, 1086227456
+};
+const int32_t node16_shift[96] = {
+    -7, -7, -6, -9, -7, -6, -5, -8,
+    -7, -5, -7, -6, -7, -6, -7, -7,
+    -7, -6, -8, -6, -8, -7, -7, -6,
+    -6, -6, -7, -6, -8, -7, -7, -7,
+    -7, -7, -6, -7, -5, -7, -9, -7,
+    -6, -6, -5, -7, -7, -8, -6, -7,
+    -8, -7, -6, -7, -6, -6, -6, -5,
+    -6, -6, -7, -8, -6, -7, -6, -7,
+    -6, -7, -8, -8, -5, -6, -7, -8,
+    -6, -7, -7, -6, -5, -8, -6, -6,
+    -7, -6, -7, -7, -7, -7, -7, -7,
+    -6, -7, -7, -7, -7, -5, -3, -7
+};
+const ConvData node16 = { { { 1, 1, 0, 0 }, -128, 0, -128, 0, 0,
+    const_cast<int32_t*>(node16_multiplier), const_cast<int32_t*>(node16_shift),
+    -128, 127, 0 }, -1 };
+
+const int32_t node17_multiplier[16] = {
+    1976172070, 1652848132, 1259904997, 1530326965, 1344126384, 1482125745, 1173513047, 1555610080,
+    2024855994, 2145359547, 1539241851, 1425317342, 1076872060, 1115706562, 1938551844, 1431189670
+};
+const int32_t node17_shift[16] = {
+    -9, -9, -9, -10, -9, -9, -9, -9,
+    -10, -10, -9, -8, -8, -8, -9, -9
+};
+const ConvData node17 = { { { 0, 0, 0, 0 }, -128, 0, 14, 0, 0,
+    const_cast<int32_t*>(node17_multiplier), const_cast<int32_t*>(node17_shift),
+    -128, 127, 0 }, -1 };
+
+const tflite::OpDataAdd node18 = { false, 0, -1, -128, 127,
+    1073741824, 1955263057, 2052062471, -19, 20, -11, -14, 9,
+    0.0f, 0.0f };
+
+const int32_t node19_multiplier[96] = {
+    1183176124, 1147017765, 1421877603, 1289077567, 1074730169, 1854531019, 1122280871, 1212377141,
+    1266765597, 2136835289, 1541423178, 1882152590, 1203615831, 1578345003, 1726664910, 2082034615,
+    1207376046, 1273522373, 1815386151, 1272863371, 1858602277, 1754970941, 1519682281, 1674485969,
+    1164969606, 2044123768, 2023801865, 1439934471, 1913418733, 1121036140, 1169918375, 1463405309,
+    1945278965, 1757814189, 1332904597, 2084185134, 1209684012, 1484330414, 1103371855, 1853280840,
+    1749738374, 1854332802, 1929135976, 1375730394, 1678477375, 1415693966, 1624184176, 1213578753,
+    1318014419, 1160972751, 1081394788, 2133838164, 1469951655, 2097948761, 1413105019, 1617904155,
+    1636169481, 1413895729, 1789207905, 1356493990, 1488531780, 1197706317, 1246538857, 1836980780,
+    2144357974, 1309485427, 1378551001, 1275552741, 1333922271, 1430785462, 1605679862, 2092187112,
+    1147469156, 1713058918, 1386937107, 1165339268, 1323903077, 1620497330, 1509436406, 1584974864,
+    1504028166, 1195628133, 1834532464, 1986807141, 2050882893, 1077948151, 1309990459, 1672117128,
+    1118529956, 1264492201, 1186725909, 1191541845, 2074045226, 1718040849, 1406616917, 1338136226
+};
+const int32_t node19_shift[96] = {
+    -6, -6, -7, -7, -6, -6, -5, -6,
+    -7, -6, -6, -7, -7, -7, -8, -6,
+    -6, -6, -7, -6, -6, -5, -7, -5,
+    -5, -7, -7, -7, -6, -7, -8, -7,
+    -7, -6, -6, -7, -6, -6, -7, -5,
+    -7, -7, -8, -6, -8, -6, -6, -7,
+    -8, -6, -6, -7, -6, -7, -5, -7,
+    -6, -7, -6, -7, -6, -7, -7, -7,
+    -7, -6, -6, -6, -6, -6, -6, -8,
+    -7, -7, -5, -5, -6, -6, -6, -6,
+    -8, -7, -7, -8, -6, -6, -6, -9,
+    -6, -6, -7, -5, -7, -7, -7, -7
+};
+const ConvData node19 = { { { 0, 0, 0, 0 }, 9, 0, -128, 0, 0,
+    const_cast<int32_t*>(node19_multiplier), const_cast<int32_t*>(node19_shift),
+    -128, 127, 0 }, -1 };
+
+const int32_t node20_multiplier[96] = {
+    1585592960, 1199233792, 1624905088, 1176512256, 1237104512, 1901304704, 1126909568, 2019907200,
+    1339754752, 1842466176, 1095629440, 1461683072, 1962365312, 1354142080, 1104017664, 1351607296,
+    1336151168, 1162418176, 1110072576, 1926061824, 1762697856, 1148842240, 1559706240, 1252070144,
+    1450821888, 2134414464, 1610042240, 1846274944, 1789719040, 1626346112, 1971714816, 1170973440,
+    1160369792, 1652843776, 1236728064, 1358092032, 1369076352, 1364065408, 1215424128, 1658267648,
+    1366718720, 1214880256, 1183621888, 1382718848, 1796901888, 1261273472, 2133300992, 1366726656,
+    1838755840, 1185531136, 1619772800, 1952957312, 1983963008, 1682870784, 1194102784, 1435208704,
+    1296748288, 1251047552, 1808683904, 1120707456, 1904409472, 2071357696, 1960741504, 1995075968,
+    1870219392, 1953206528, 1672505728, 1329951744, 1353190784, 1139252224, 1122808832, 1225866752,
+    1800364928, 1906091392, 1528121216, 1787730688, 1709290112, 1910153728, 1564520192, 2118514944,
+    2093934848, 1228996352, 1076982400, 1957463424, 1427692544, 1203721600, 2032597760, 1462202752,
+    1643513344, 1422096640, 1141505024, 1517249664, 1742404864, 1202757248, 1194238208, 1880735360
+};
+const int32_t node20_shift[96] = {
+    -7, -7, -7, -6, -6, -7, -8, -8,
+    -6, -7, -5, -7, -6, -6, -5, -7,
+    -6, -6, -6, -8, -8, -8, -7, -8,
+    -8, -8, -7, -7, -8, -5, -6, -6,
+    -7, -7, -6, -5, -5, -6, -6, -8,
+    -6, -6, -5, -7, -6, -7, -8, -5,
+    -5, -7, -5, -7, -7, -7, -6, -7,
+    -7, -5, -9, -6, -6, -6, -7, -7,
+    -7, -7, -6, -6, -6, -7, -6, -7,
+    -6, -7, -7, -6, -7, -8, -8, -7,
+    -7, -6, -6, -6, -8, -7, -8, -5,
+    -6, -7, -5, -9, -7, -7, -5, -6
+};
+const ConvData node20 = { { { 1, 1, 0, 0 }, -128, 0, -128, 0, 0,
+    const_cast<int32_t*>(node20_multiplier), const_cast<int32_t*>(node20_shift),
+    -128, 127, 0 }, -1 };
+
+const int32_t node21_multiplier[16] = {
+    1943887257, 1104360120, 1082297202, 1474648114, 1801997281, 1636933439, 2033118643, 1302279908,
+    1673830174, 1686956341, 2079476969, 1404427965, 1571184265, 1239522545, 1193040481, 1254623728
+};
+const int32_t node21_shift[16] = {
+    -8, -8, -9, -9, -9, -9, -9, -9,
+    -9, -9, -8, -8, -9, -9, -8, -8
+};
+const ConvData node21 = { { { 0, 0, 0, 0 }, -128, 0, 13, 0, 0,
+    const_cast<int32_t*>(node21_multiplier), const_cast<int32_t*>(node21_shift),
+    -128, 127, 0 }, -1 };
+
+const tflite::OpDataAdd node22 = { false, 0, -1, -128, 127,
+    1073741824, 1873597275, 1798914980, -19, 20, -9, -13, 12,
+    0.0f, 0.0f };
+
+const int32_t node23_multiplier[96] = {
+    1133185682, 1244510081, 1370812083, 1809262235, 1504127841, 1356557590, 2018992857, 1220970565,
+    1525145223, 1324740446, 1869666531, 1461430302, 1820623170, 1654429266, 1236246921, 1155729130,
+    1515484291, 1283351299, 1113077346, 1653850375, 1712157228, 1362632807, 1877286990, 1292959973,
+    1550498233, 1197732829, 1660709259, 1818222151, 1431433043, 1192846459, 2079639610, 1446913727,
+    1973035719, 1824286602, 1881900400, 1565777617, 1985313998, 1311569943, 1929558325, 1924420302,
+    2044926327, 1375343740, 1744181279, 1099816455, 1315139959, 1493880728, 1229287555, 1260312845,
+    1444110221, 1314577217, 1078787073, 1192829861, 1781347279, 1791022903, 1702563470, 1111893658,
+    1145292492, 1737954891, 1317220132, 1134031366, 2018507719, 2115751785, 1330146495, 1196403914,
+    1488487239, 1649475609, 1822988190, 1271415623, 1418566565, 1137250256, 1532670920, 1963420878,
+    1842995260, 1175962844, 1854227004, 1960644398, 1249328941, 2107626675, 1776882460, 1196740460,
+    1945917775, 2144705089, 1733531678, 1146692170, 1199810871, 1563536068, 1644398256, 1151561495,
+    1389405681, 1347797067, 1425001542, 1668969392, 1395045440, 1337540646, 1342662184, 1124554350
+};
+const int32_t node23_shift[96] = {
+    -6, -5, -6, -5, -6, -5, -7, -6,
+    -6, -5, -7, -6, -6, -4, -6, -6,
+    -7, -6, -5, -6, -7, -7, -7, -7,
+    -7, -5, -5, -6, -6, -5, -7, -6,
+    -7, -6, -6, -6, -7, -6, -6, -6,
+    -7, -5, -6, -6, -5, -6, -6, -6,
+    -6, -6, -6, -6, -6, -6, -6, -5,
+    -5, -6, -5, -6, -5, -6, -6, -5,
+    -5, -6, -7, -6, -5, -5, -6, -6,
+    -5, -5, -6, -7, -6, -8, -7, -6,
+    -7, -7, -7, -6, -7, -6, -5, -6,
+    -7, -5, -6, -7, -6, -5, -5, -6
+};
+const ConvData node23 = { { { 0, 0, 0, 0 }, 12, 0, -128, 0, 0,
+    const_cast<int32_t*>(node23_multiplier), const_cast<int32_t*>(node23_shift),
+    -128, 127, 0 }, -1 };
+
+const int32_t node24_multiplier[32] = {
+    1117040361, 1209753171, 1095855135, 2112186492, 1478508396, 2096030812, 1981414803, 1428013569,
+    2084146663, 1358745362, 1929971616, 1166170664, 1917172053, 1999322070, 1092585954, 2091603686,
+    1084232155, 1375174596, 1904348562, 1077242399, 2107051612, 1102252331, 1501382442, 1159015693,
+    1814084031, 1279528205, 1164464528, 1840509830, 1327066243, 1106919824, 1525636163, 1281617797
+};
+const int32_t node24_shift[32] = {
+    -9, -9, -9, -10, -9, -10, -10, -9,
+    -10, -9, -10, -9, -10, -10, -9, -10,
+    -9, -9, -10, -9, -10, -9, -9, -9,
+    -10, -9, -9, -9, -9, -9, -9, -9
+};
+const ConvData node24 = { { { 0, 0, 0, 0 }, -128, 0, -128, 0, 0,
+    const_cast<int32_t*>(node24_multiplier), const_cast<int32_t*>(node24_shift),
+    -128, 127, 0 }, -1 };
+
+const int32_t node25_multiplier[7] = {
+    1972643337, 1254612961, 1307731194, 1374188478, 1545941618, 1558568037, 1908619412
+};
+const int32_t node25_shift[7] = {
+    -9, -9, -8, -9, -9, -9, -9
+};
+const ConvData node25 = { { { 0, 0, 0, 0 }, -128, 0, 15, 0, 0,
+    const_cast<int32_t*>(node25_multiplier), const_cast<int32_t*>(node25_shift),
+    -128, 127, 0 }, -1 };
+
+const SoftmaxData node26 = { { 0, 1113285760, 24, 0, 0, -124, 0, 0.0f,
+    nullptr, nullptr, nullptr, nullptr, nullptr }, 0 };
+
+const void* const node_data[27] = {
+  &node0, &node1, &node2, &node3, &node4, &node5, &node6, &node7,
+  &node8, &node9, &node10, &node11, &node12, &node13, &node14, &node15,
+  &node16, &node17, &node18, &node19, &node20, &node21, &node22, &node23,
+  &node24, &node25, &node26
+};
+
+const size_t scratch_buffer_count = 1;
+const ScratchBuffer scratch_buffers[1] = {
+  { 2016, 48, 26 },
+};
+
+} // namespace tflite_learn_4_prepared
+
+#endif // EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN
+#endif // TFLITE_LEARN_4_PREPARED_H
@@ -5,48 +5,48 @@
 
 #include <ArduinoJson.h>
 
-APIHandler::err_wifi_t APIHandler::init(const WiFiConfig &config)
+APIHandler::err_wifi_t APIHandler::begin(const WiFiConfig &config,
+                                         const wifi_cache_t *cache)
 {
-    // Serial.println("Connecting to WiFi...");
-
     if (config.ssid.empty() || config.password.empty()) {
         // Serial.println(
         //     "ERROR: SSID or Password is missing. Cannot connect to WiFi.");
         return WIFI_ERR;
     }
 
-    // Check for static IP configuration
-    if (!config.ip.empty() && !config.gateway.empty() && !config.mask.empty()) {
-        IPAddress localIP, gateway, subnet;
-
-        if (localIP.fromString(config.ip.c_str()) &&
-            gateway.fromString(config.gateway.c_str()) &&
-            subnet.fromString(config.mask.c_str())) {
+    _fromCache = cache != nullptr && cache->magic == WIFI_CACHE_MAGIC &&
+                 config.ssid == cache->ssid;
 
-            if (!WiFi.config(localIP, gateway, subnet)) {
-                // Serial.println("ERROR: Failed to configure static IP.");
-                return WIFI_ERR;
-            }
-            // Serial.println("Static IP configuration applied.");
-        } else {
-            // Serial.println("ERROR: Invalid IP, Gateway, or Mask format.");
+    // Check for static IP configuration, without one DHCP gives the address
+    if (!config.ip.empty() && !config.gateway.empty() && !config.mask.empty()) {
+        if (!_applyStaticIP(config)) {
             return WIFI_ERR;
         }
     }
 
     // Connect to WiFi
     // Serial.println("Connecting to WiFi...");
-    WiFi.begin(config.ssid.c_str(), config.password.c_str());
+    if (_fromCache) {
+        // Straight to the access point of last time, no scan
+        WiFi.begin(config.ssid.c_str(), config.password.c_str(),
+                   cache->channel, cache->bssid);
+    } else {
+        WiFi.begin(config.ssid.c_str(), config.password.c_str());
+    }
 
-    int retryCount = 20; // Retry up to 20 times
+    return WIFI_OK;
+}
 
-    while (WiFi.status() != WL_CONNECTED && retryCount > 0) {
-        delay(500);
-        // Serial.print(".");
-        retryCount--;
+APIHandler::err_wifi_t APIHandler::waitConnected(const WiFiConfig &config)
+{
+    if (_fromCache && !_waitStatus(WIFI_FAST_CONNECT_TIMEOUT_MS)) {
+        // The access point moved or changed channel, scan for it
+        WiFi.disconnect();
+        _fromCache = false;
+        WiFi.begin(config.ssid.c_str(), config.password.c_str());
     }
 
-    if (WiFi.status() != WL_CONNECTED) {
+    if (!_waitStatus(WIFI_CONNECT_TIMEOUT_MS)) {
         // Serial.println("\nERROR: Failed to connect to WiFi.");
         return WIFI_ERR;
     }
@@ -55,15 +55,56 @@ APIHandler::err_wifi_t APIHandler::init(const WiFiConfig &config)
     return WIFI_OK;
 }
 
+void APIHandler::connectionCache(const WiFiConfig &config, wifi_cache_t &cache)
+{
+    memset(&cache, 0, sizeof(cache));
+    cache.magic = WIFI_CACHE_MAGIC;
+    strlcpy(cache.ssid, config.ssid.c_str(), sizeof(cache.ssid));
+    memcpy(cache.bssid, WiFi.BSSID(), sizeof(cache.bssid));
+    cache.channel = WiFi.channel();
+}
+
+bool APIHandler::_applyStaticIP(const WiFiConfig &config)
+{
+    IPAddress localIP, gateway, subnet;
+
+    if (localIP.fromString(config.ip.c_str()) &&
+        gateway.fromString(config.gateway.c_str()) &&
+        subnet.fromString(config.mask.c_str())) {
+
+        if (!WiFi.config(localIP, gateway, subnet)) {
+            // Serial.println("ERROR: Failed to configure static IP.");
+            return false;
+        }
+        // Serial.println("Static IP configuration applied.");
+        return true;
+    }
+
+    // Serial.println("ERROR: Invalid IP, Gateway, or Mask format.");
+    return false;
+}
+
+bool APIHandler::_waitStatus(uint32_t timeoutMs)
+{
+    const unsigned long start = millis();
+    while (WiFi.status() != WL_CONNECTED && millis() - start < timeoutMs) {
+        delay(10);
+    }
+    return WiFi.status() == WL_CONNECTED;
+}
+
 APIHandler::api_response_code_t APIHandler::pingAPI()
 {
-    String url = API_URL + "/";
+    String url = _url + "/";
 
-    _http.begin(url); // Start HTTP connection
+    // Pinged from the network task, a connection of its own keeps it clear
+    // of fetchData() on the capture path
+    HTTPClient http;
+    http.begin(url); // Start HTTP connection
 
-    int httpResponseCode = _http.GET(); // Make a GET request
+    int httpResponseCode = http.GET(); // Make a GET request
 
-    _http.end(); // End the HTTP connection
+    http.end(); // End the HTTP connection
 
     return httpResponseCode;
 }
@@ -71,16 +112,38 @@ APIHandler::api_response_code_t APIHandler::pingAPI()
 APIHandler::api_response_code_t APIHandler::fetchData(const String &name,
                                                       float &result)
 {
-    String url = API_URL + "/search/" + name;
+    String url = _url + "/search/" + name;
+
+    // HTTP/1.1 keeps the connection open from one lookup to the next
+    _http.setReuse(true);
     _http.begin(url); // Start HTTP connection
 
     int httpResponseCode = _http.GET(); // Make a GET request
 
-    if (httpResponseCode > 0) {
-        String response = _http.getString(); // Get the response
+    if (httpResponseCode == 200) {
+        nutrition_t nutrition;
+        const int size = _http.getSize();
+        bool parsed;
+        if (size >= 0) {
+            // Parsed straight off the connection, then the rest of the body
+            // is read so the next response starts where it should
+            BodyReader body(_http.getStream());
+            parsed = _parseNutrition(body, nutrition);
+            parsed = body.skipTo(size) && parsed;
+        } else {
+            // No length: a chunked body, which getString() decodes, or one
+            // that runs until the server closes the connection
+            String body = _http.getString();
+            parsed = _parseNutrition(body, nutrition);
+        }
 
-        // Parse response (extract calories value)
-        result = _parseCalories(response);
+        if (parsed) {
+            result = nutrition.calories;
+        } else {
+            // Where the next response would start is not known
+            _http.setReuse(false);
+            httpResponseCode = HTTPC_ERROR_NO_STREAM;
+        }
     } else {
         // Serial.print("Error on HTTP request: ");
         // Serial.println(httpResponseCode);
@@ -91,21 +154,96 @@ APIHandler::api_response_code_t APIHandler::fetchData(const String &name,
     return httpResponseCode;
 }
 
-float APIHandler::_parseCalories(String &data)
+APIHandler::api_response_code_t
+APIHandler::fetchNutritionDelta(uint32_t since, uint32_t limit,
+                                uint32_t &revision,
+                                std::vector<NutritionDB::food_t> &foods)
 {
-    const size_t capacity = JSON_OBJECT_SIZE(35) + 300;
-    DynamicJsonDocument doc(capacity);
+    String url = _url + "/foods?since=" + String(since) +
+                 "&limit=" + String(limit);
+
+    HTTPClient http;
+    http.useHTTP10(true);
+    http.begin(url);
+
+    int httpResponseCode = http.GET();
+
+    if (httpResponseCode == 200) {
+        JsonDocument filter;
+        filter["revision"] = true;
+        filter["foods"][0]["name"] = true;
+        filter["foods"][0]["calories"] = true;
+
+        JsonDocument doc;
+        DeserializationError error = deserializeJson(
+            doc, http.getStream(), DeserializationOption::Filter(filter));
 
-    // Parse the JSON response
-    DeserializationError error = deserializeJson(doc, data);
+        if (error) {
+            httpResponseCode = HTTPC_ERROR_NO_STREAM;
+        } else {
+            revision = doc["revision"] | since;
+            for (JsonObject item : doc["foods"].as<JsonArray>()) {
+                NutritionDB::food_t food;
+                strlcpy(food.name, item["name"] | "", sizeof(food.name));
+                food.calories = _toCalories(item["calories"].as<float>());
+                if (food.name[0] != '\0') {
+                    foods.push_back(food);
+                }
+            }
+        }
+    }
+
+    http.end();
+
+    return httpResponseCode;
+}
+
+template <typename TInput>
+bool APIHandler::_parseNutrition(TInput &body, nutrition_t &nutrition)
+{
+    nutrition.calories = 0; // 0 if parsing fails
+
+    // Only the members marked here are stored, the rest of the object is
+    // skipped as it streams by. Memory use does not depend on the size of
+    // the response.
+    JsonDocument filter;
+    filter["calories"] = true;
+
+    JsonDocument doc;
+    DeserializationError error =
+        deserializeJson(doc, body, DeserializationOption::Filter(filter));
 
     if (error) {
         // Serial.print(F("deserializeJson() failed: "));
         // Serial.println(error.f_str());
-        return 0; // Return 0 if parsing fails
+        return false;
     }
 
-    // Extract the "calories" value from the JSON response
-    float calories = doc["calories"];
-    return calories / 100;
+    nutrition.calories = _toCalories(doc["calories"].as<float>());
+    return true;
+}
+
+int APIHandler::BodyReader::read()
+{
+    char c;
+    return readBytes(&c, 1) == 1 ? (uint8_t)c : -1;
+}
+
+size_t APIHandler::BodyReader::readBytes(char *buffer, size_t length)
+{
+    const size_t read = _stream.readBytes(buffer, length);
+    _count += read;
+    return read;
+}
+
+bool APIHandler::BodyReader::skipTo(size_t size)
+{
+    char buffer[64];
+    while (_count < size) {
+        const size_t left = size - _count;
+        if (readBytes(buffer, left < sizeof(buffer) ? left : sizeof(buffer)) == 0) {
+            return false;
+        }
+    }
+    return true;
 }
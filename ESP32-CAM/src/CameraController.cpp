@@ -0,0 +1,115 @@
+#include "CameraController.hpp"
+
+// Frame sizes of the ladder, the ones of the OV2640 at or below VGA
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+} frame_size_t;
+
+static const frame_size_t FRAME_SIZES[] = {
+    {160, 120}, {240, 176}, {320, 240}, {400, 296}, {640, 480},
+};
+static const int FRAME_SIZE_COUNT = sizeof(FRAME_SIZES) / sizeof(FRAME_SIZES[0]);
+
+// Frames smaller than QVGA come out of the sensor's binned modes, far faster
+// than the impulse takes them at half the clock; larger ones keep the 20 MHz
+// the camera always had
+static const uint32_t XCLK_LOW_HZ = 10000000;
+static const uint32_t XCLK_HZ = 20000000;
+static const uint32_t XCLK_LOW_MAX_PIXELS = 240 * 176;
+
+// Whether the centre crop of a frame to the input's aspect ratio, the one
+// crop_and_interpolate takes, has at least the input's pixels
+static bool covers(const frame_size_t &frame, uint16_t width, uint16_t height)
+{
+    // frame.width / frame.height > width / height, without division
+    const bool wider = (uint32_t)frame.width * height > (uint32_t)width * frame.height;
+    const uint32_t cropWidth =
+        wider ? (uint32_t)frame.height * width / height : frame.width;
+    const uint32_t cropHeight =
+        wider ? frame.height : (uint32_t)frame.width * height / width;
+    return cropWidth >= width && cropHeight >= height;
+}
+
+CameraController::CameraController()
+    : _policy(), _levels(1), _level(0), _limit(0), _streak(0), _frameUs(0)
+{
+    _modes[0] = {320, 240, 12, XCLK_HZ};
+}
+
+void CameraController::configure(const policy_t &policy)
+{
+    _policy = policy;
+
+    // The ladder runs from the smallest frame that covers the input to the
+    // largest one allowed; at least that largest one
+    int top = 0;
+    for (int i = 0; i < FRAME_SIZE_COUNT; i++) {
+        if (FRAME_SIZES[i].width <= policy.maxWidth &&
+            FRAME_SIZES[i].height <= policy.maxHeight) {
+            top = i;
+        }
+    }
+    int bottom = top;
+    for (int i = top; i >= 0; i--) {
+        if (covers(FRAME_SIZES[i], policy.inputWidth, policy.inputHeight)) {
+            bottom = i;
+        }
+    }
+
+    _levels = top - bottom + 1;
+    for (int level = 0; level < _levels; level++) {
+        const frame_size_t &size = FRAME_SIZES[bottom + level];
+        mode_t &mode = _modes[level];
+        mode.width = size.width;
+        mode.height = size.height;
+        // From the floor at the bottom to the best quality at the top
+        mode.quality = _levels == 1
+                           ? policy.bestQuality
+                           : policy.qualityFloor +
+                                 (policy.bestQuality - policy.qualityFloor) *
+                                     level / (_levels - 1);
+        mode.xclkHz = (uint32_t)size.width * size.height <= XCLK_LOW_MAX_PIXELS
+                          ? XCLK_LOW_HZ
+                          : XCLK_HZ;
+    }
+
+    _level = 0;
+    _limit = _levels - 1;
+    _streak = 0;
+    _frameUs = 0;
+}
+
+bool CameraController::update(uint32_t frameUs, float confidence)
+{
+    // A frame time is only comparable to the others at the same level
+    _frameUs = _frameUs == 0 ? frameUs : (_frameUs * 3 + frameUs) / 4;
+
+    if (_frameUs > _policy.frameBudgetUs && _level > 0) {
+        // Too slow up here, do not come back until configured again
+        _limit = _level - 1;
+        _level--;
+        _streak = 0;
+        _frameUs = 0;
+        return true;
+    }
+
+    if (confidence >= _policy.acceptConfidence) {
+        if (++_streak >= _policy.confidentStreak && _level > 0) {
+            _level--;
+            _streak = 0;
+            _frameUs = 0;
+            return true;
+        }
+        return false;
+    }
+
+    // Unsure, or nothing found on a plate that is not empty: more pixels
+    _streak = 0;
+    if (_level < _limit) {
+        _level++;
+        _frameUs = 0;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,447 @@
+#include "CaptureLog.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(ESP_PLATFORM)
+#include "SD_MMC.h"
+#include <esp_heap_caps.h>
+
+// The writer waits on the card most of the time, it shares the core with the
+// capture stage and stays below it
+static const uint32_t WRITER_STACK = 4 * 1024;
+static const UBaseType_t WRITER_PRIORITY = 1;
+static const BaseType_t WRITER_CORE = 0;
+#else
+#include <sys/stat.h>
+#endif
+
+static const uint32_t FORMAT_VERSION = 1;
+
+// File holding the number of the next log file
+static const char *NEXT_NAME = "/NEXT";
+
+static uint32_t roundUp(uint32_t length, uint32_t multiple)
+{
+    return (length + multiple - 1) / multiple * multiple;
+}
+
+static uint8_t *allocBuffer()
+{
+#if defined(ESP_PLATFORM)
+    // Two buffers do not fit in internal RAM next to the frame buffers
+    return (uint8_t *)heap_caps_malloc(CaptureLog::BUFFER_BYTES,
+                                       MALLOC_CAP_SPIRAM);
+#else
+    return (uint8_t *)malloc(CaptureLog::BUFFER_BYTES);
+#endif
+}
+
+static bool makeDirectory(const std::string &path)
+{
+#if defined(ESP_PLATFORM)
+    return SD_MMC.exists(path.c_str()) || SD_MMC.mkdir(path.c_str());
+#else
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 || mkdir(path.c_str(), 0755) == 0;
+#endif
+}
+
+static uint32_t readNext(const std::string &path)
+{
+    char text[12] = {0};
+#if defined(ESP_PLATFORM)
+    File file = SD_MMC.open(path.c_str(), FILE_READ);
+    if (!file) {
+        return 0;
+    }
+    file.read((uint8_t *)text, sizeof(text) - 1);
+    file.close();
+#else
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return 0;
+    }
+    fread(text, 1, sizeof(text) - 1, file);
+    fclose(file);
+#endif
+    return strtoul(text, nullptr, 10);
+}
+
+static bool writeNext(const std::string &path, uint32_t number)
+{
+    char text[12];
+    const int length = snprintf(text, sizeof(text), "%u", (unsigned)number);
+#if defined(ESP_PLATFORM)
+    File file = SD_MMC.open(path.c_str(), FILE_WRITE);
+    if (!file) {
+        return false;
+    }
+    const bool written = file.write((const uint8_t *)text, length) == (size_t)length;
+    file.close();
+#else
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    const bool written = fwrite(text, 1, length, file) == (size_t)length;
+    fclose(file);
+#endif
+    return written;
+}
+
+CaptureLog::CaptureLog()
+    : _running(false), _maxFileBytes(0), _filling(0), _full(-1), _sequence(0),
+      _fileNumber(0), _fileBytes(0), _logged(0), _dropped(0), _written(0),
+      _files(0), _errors(0)
+{
+    for (buffer_t &buffer : _buffers) {
+        buffer.bytes = nullptr;
+        buffer.used = 0;
+        buffer.count = 0;
+    }
+#if defined(ESP_PLATFORM)
+    _exited = xSemaphoreCreateBinaryStatic(&_exitedBuffer);
+    _taskRunning = false;
+#else
+    _file = nullptr;
+#endif
+}
+
+CaptureLog::~CaptureLog()
+{
+    stop();
+#if defined(ESP_PLATFORM)
+    vSemaphoreDelete(_exited);
+#endif
+}
+
+CaptureLog::err_log_t CaptureLog::start(const char *directory,
+                                        uint32_t maxFileBytes)
+{
+    if (_running.load()) {
+        return LOG_ERR_RUNNING;
+    }
+
+    _directory = directory;
+    if (!makeDirectory(_directory)) {
+        return LOG_ERR_FILE;
+    }
+
+    for (buffer_t &buffer : _buffers) {
+        buffer.bytes = allocBuffer();
+        if (buffer.bytes == nullptr) {
+            _release();
+            return LOG_ERR_ALLOC;
+        }
+        buffer.used = 0;
+        buffer.count = 0;
+    }
+
+    // At least the header block and one buffer per file
+    _maxFileBytes = maxFileBytes > BLOCK_BYTES + BUFFER_BYTES
+                        ? maxFileBytes
+                        : BLOCK_BYTES + BUFFER_BYTES;
+    _filling = 0;
+    _full = -1;
+    _sequence = 0;
+    _fileNumber = readNext(_directory + NEXT_NAME);
+    _fileBytes = 0;
+    _fileIndex.clear();
+    _logged = _dropped = _written = _files = _errors = 0;
+    _running = true;
+
+#if defined(ESP_PLATFORM)
+    _taskRunning = xTaskCreatePinnedToCore(_task, "capture_log", WRITER_STACK,
+                                           this, WRITER_PRIORITY, nullptr,
+                                           WRITER_CORE) == pdPASS;
+    if (!_taskRunning) {
+        _running = false;
+        _release();
+        return LOG_ERR_TASK;
+    }
+#else
+    _thread = std::thread(&CaptureLog::_writerTask, this);
+#endif
+
+    return LOG_OK;
+}
+
+void CaptureLog::stop()
+{
+#if defined(ESP_PLATFORM)
+    if (!_taskRunning) {
+        return;
+    }
+#else
+    if (!_thread.joinable()) {
+        return;
+    }
+#endif
+
+    _running = false;
+    _wake.notify();
+
+#if defined(ESP_PLATFORM)
+    xSemaphoreTake(_exited, portMAX_DELAY);
+    _taskRunning = false;
+#else
+    _thread.join();
+#endif
+
+    _release();
+}
+
+bool CaptureLog::append(const capture_t &capture, uint32_t timeMs)
+{
+    const uint32_t sequence = _sequence++;
+    const uint32_t boxesLength = capture.boxCount * sizeof(box_t);
+    const uint32_t length = roundUp(
+        sizeof(record_header_t) + boxesLength + capture.jpegLength, 4);
+
+    if (!_running.load() || capture.boxCount > MAX_BOXES ||
+        length > BUFFER_BYTES) {
+        _dropped++;
+        return false;
+    }
+
+    buffer_t *buffer = &_buffers[_filling];
+    if (buffer->used + length > BUFFER_BYTES || buffer->count == MAX_RECORDS) {
+        if (!_handOver()) {
+            _dropped++; // The card is behind, the other buffer is still going out
+            return false;
+        }
+        buffer = &_buffers[_filling];
+    }
+
+    record_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = RECORD_MAGIC;
+    header.length = length;
+    header.sequence = sequence;
+    header.timeMs = timeMs;
+    header.weight = capture.weight;
+    header.captureUs = capture.captureUs;
+    header.inferUs = capture.inferUs;
+    header.totalUs = capture.totalUs;
+    header.boxCount = capture.boxCount;
+    header.jpegLength = capture.jpegLength;
+
+    uint8_t *record = buffer->bytes + buffer->used;
+    memcpy(record, &header, sizeof(header));
+    if (boxesLength > 0) {
+        memcpy(record + sizeof(header), capture.boxes, boxesLength);
+    }
+    if (capture.jpegLength > 0) {
+        memcpy(record + sizeof(header) + boxesLength, capture.jpeg,
+               capture.jpegLength);
+    }
+    const uint32_t end = sizeof(header) + boxesLength + capture.jpegLength;
+    memset(record + end, 0, length - end);
+
+    buffer->index[buffer->count++] = {buffer->used, length, sequence};
+    buffer->used += length;
+    _logged++;
+    return true;
+}
+
+void CaptureLog::flush()
+{
+    if (_running.load()) {
+        _handOver();
+    }
+}
+
+CaptureLog::counters_t CaptureLog::counters() const
+{
+    counters_t c;
+    c.logged = _logged.load();
+    c.dropped = _dropped.load();
+    c.written = _written.load();
+    c.files = _files.load();
+    c.errors = _errors.load();
+    return c;
+}
+
+bool CaptureLog::_handOver()
+{
+    if (_full.load() >= 0) {
+        return false;
+    }
+    if (_buffers[_filling].count == 0) {
+        return true;
+    }
+
+    // The writer is done with the other buffer, it becomes the one to fill
+    _full = _filling;
+    _filling ^= 1;
+    _buffers[_filling].used = 0;
+    _buffers[_filling].count = 0;
+    _wake.notify();
+    return true;
+}
+
+void CaptureLog::_writerTask()
+{
+    while (_running.load()) {
+        _wake.wait(WAIT_MS);
+        const int full = _full.load();
+        if (full >= 0) {
+            _writeBuffer(_buffers[full]);
+            _full = -1;
+        }
+    }
+
+    // Stopped, nothing appends anymore
+    const int full = _full.load();
+    if (full >= 0) {
+        _writeBuffer(_buffers[full]);
+        _full = -1;
+    }
+    _writeBuffer(_buffers[_filling]);
+    _finishFile();
+}
+
+void CaptureLog::_writeBuffer(buffer_t &buffer)
+{
+    if (buffer.count == 0) {
+        return;
+    }
+
+    const uint32_t length = roundUp(buffer.used, BLOCK_BYTES);
+    if (_fileIsOpen() && _fileBytes + length > _maxFileBytes) {
+        _finishFile();
+    }
+    if (!_fileIsOpen() && !_openNext()) {
+        _errors++;
+        return;
+    }
+
+    memset(buffer.bytes + buffer.used, 0, length - buffer.used);
+    if (!_fileWrite(buffer.bytes, length)) {
+        // Maybe the card was pulled, the next buffer starts a new file
+        _errors++;
+        _fileClose();
+        return;
+    }
+
+    for (int i = 0; i < buffer.count; i++) {
+        index_entry_t entry = buffer.index[i];
+        entry.offset += _fileBytes;
+        _fileIndex.push_back(entry);
+    }
+    _fileBytes += length;
+    _written += buffer.count;
+}
+
+bool CaptureLog::_openNext()
+{
+    char name[16];
+    snprintf(name, sizeof(name), "/%05u.cap", (unsigned)_fileNumber);
+    const std::string path = _directory + name;
+
+    // Count on first, a crash must not have the next start overwrite this one
+    if (!writeNext(_directory + NEXT_NAME, _fileNumber + 1) ||
+        !_fileOpen(path.c_str())) {
+        return false;
+    }
+    _fileNumber++;
+
+    uint8_t block[BLOCK_BYTES];
+    memset(block, 0, sizeof(block));
+    file_header_t header = {FILE_MAGIC, FORMAT_VERSION, BLOCK_BYTES, 0};
+    memcpy(block, &header, sizeof(header));
+    if (!_fileWrite(block, sizeof(block))) {
+        _fileClose();
+        return false;
+    }
+
+    _fileBytes = BLOCK_BYTES;
+    _fileIndex.clear();
+    return true;
+}
+
+void CaptureLog::_finishFile()
+{
+    if (!_fileIsOpen()) {
+        return;
+    }
+
+    const index_trailer_t trailer = {_fileBytes, (uint32_t)_fileIndex.size(),
+                                     INDEX_MAGIC};
+    const bool written =
+        (_fileIndex.empty() ||
+         _fileWrite(_fileIndex.data(),
+                    _fileIndex.size() * sizeof(index_entry_t))) &&
+        _fileWrite(&trailer, sizeof(trailer));
+    _fileClose();
+    _fileIndex.clear();
+
+    if (written) {
+        _files++;
+    } else {
+        _errors++;
+    }
+}
+
+void CaptureLog::_release()
+{
+    for (buffer_t &buffer : _buffers) {
+        free(buffer.bytes);
+        buffer.bytes = nullptr;
+    }
+}
+
+#if defined(ESP_PLATFORM)
+void CaptureLog::_task(void *log)
+{
+    CaptureLog *self = (CaptureLog *)log;
+    self->_writerTask();
+    xSemaphoreGive(self->_exited);
+    vTaskDelete(nullptr);
+}
+
+bool CaptureLog::_fileOpen(const char *path)
+{
+    _file = SD_MMC.open(path, FILE_WRITE);
+    return (bool)_file;
+}
+
+bool CaptureLog::_fileIsOpen() const
+{
+    return (bool)_file;
+}
+
+bool CaptureLog::_fileWrite(const void *data, size_t length)
+{
+    return _file.write((const uint8_t *)data, length) == length;
+}
+
+void CaptureLog::_fileClose()
+{
+    _file.close();
+}
+#else
+bool CaptureLog::_fileOpen(const char *path)
+{
+    _file = fopen(path, "wb");
+    return _file != nullptr;
+}
+
+bool CaptureLog::_fileIsOpen() const
+{
+    return _file != nullptr;
+}
+
+bool CaptureLog::_fileWrite(const void *data, size_t length)
+{
+    return fwrite(data, 1, length, _file) == length;
+}
+
+void CaptureLog::_fileClose()
+{
+    fclose(_file);
+    _file = nullptr;
+}
+#endif
@@ -0,0 +1,272 @@
+#include "CapturePipeline.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(ESP_PLATFORM)
+#include <esp_timer.h>
+
+// Stage tasks, stack sizes in bytes. Inference runs at the priority of the
+// Arduino loop task, so serial commands are still served between time slices.
+static const uint32_t CAPTURE_STACK = 8 * 1024;
+static const uint32_t INFER_STACK = 16 * 1024;
+static const uint32_t LOOKUP_STACK = 8 * 1024;
+static const UBaseType_t STAGE_PRIORITY = 1;
+static const BaseType_t CAPTURE_CORE = 0;
+static const BaseType_t INFER_CORE = 1;
+static const BaseType_t LOOKUP_CORE = 0;
+#else
+#include <chrono>
+#endif
+
+CapturePipeline::CapturePipeline()
+    : _running(false), _capture(nullptr), _infer(nullptr), _lookup(nullptr),
+      _captured(0), _rejected(0), _failed(0), _completed(0), _dropped(0)
+{
+    memset(_frames, 0, sizeof(_frames));
+#if defined(ESP_PLATFORM)
+    _exited = xSemaphoreCreateCountingStatic(STAGES, 0, &_exitedBuffer);
+    _tasks = 0;
+#endif
+}
+
+CapturePipeline::~CapturePipeline()
+{
+    stop();
+#if defined(ESP_PLATFORM)
+    vSemaphoreDelete(_exited);
+#endif
+}
+
+int64_t CapturePipeline::nowUs()
+{
+#if defined(ESP_PLATFORM)
+    return esp_timer_get_time();
+#else
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+CapturePipeline::err_pipeline_t
+CapturePipeline::start(size_t frameBytes, CaptureFunction capture,
+                       InferFunction infer, LookupFunction lookup)
+{
+    if (_running.load()) {
+        return PIPELINE_ERR_RUNNING;
+    }
+
+    for (int i = 0; i < FRAME_SLOTS; i++) {
+        _frames[i].pixels = (uint8_t *)malloc(frameBytes);
+        if (_frames[i].pixels == nullptr) {
+            _release();
+            return PIPELINE_ERR_ALLOC;
+        }
+    }
+
+    _free.clear();
+    _ready.clear();
+    _inferred.clear();
+    _done.clear();
+    // Every slot starts out free, before any stage runs
+    for (int i = 0; i < FRAME_SLOTS; i++) {
+        _free.push(i);
+    }
+
+    _capture = capture;
+    _infer = infer;
+    _lookup = lookup;
+    _captured = _rejected = _failed = _completed = _dropped = 0;
+    _running = true;
+
+#if defined(ESP_PLATFORM)
+    _tasks = 0;
+    if (xTaskCreatePinnedToCore(_captureTask, "capture", CAPTURE_STACK, this,
+                                STAGE_PRIORITY, nullptr,
+                                CAPTURE_CORE) == pdPASS) {
+        _tasks++;
+    }
+    if (xTaskCreatePinnedToCore(_inferTask, "infer", INFER_STACK, this,
+                                STAGE_PRIORITY, nullptr, INFER_CORE) == pdPASS) {
+        _tasks++;
+    }
+    if (xTaskCreatePinnedToCore(_lookupTask, "lookup", LOOKUP_STACK, this,
+                                STAGE_PRIORITY, nullptr,
+                                LOOKUP_CORE) == pdPASS) {
+        _tasks++;
+    }
+    if (_tasks != STAGES) {
+        stop();
+        return PIPELINE_ERR_TASK;
+    }
+#else
+    _threads[0] = std::thread(&CapturePipeline::_captureStage, this);
+    _threads[1] = std::thread(&CapturePipeline::_inferStage, this);
+    _threads[2] = std::thread(&CapturePipeline::_lookupStage, this);
+#endif
+
+    return PIPELINE_OK;
+}
+
+void CapturePipeline::stop()
+{
+#if defined(ESP_PLATFORM)
+    if (!_running.load() && _tasks == 0) {
+        return;
+    }
+#else
+    if (!_running.load() && !_threads[0].joinable()) {
+        return;
+    }
+#endif
+
+    _running = false;
+    _captureWake.notify();
+    _inferWake.notify();
+    _lookupWake.notify();
+
+#if defined(ESP_PLATFORM)
+    for (; _tasks > 0; _tasks--) {
+        xSemaphoreTake(_exited, portMAX_DELAY);
+    }
+#else
+    for (std::thread &thread : _threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+#endif
+
+    _release();
+}
+
+CapturePipeline::counters_t CapturePipeline::counters() const
+{
+    counters_t c;
+    c.captured = _captured.load();
+    c.rejected = _rejected.load();
+    c.failed = _failed.load();
+    c.completed = _completed.load();
+    c.dropped = _dropped.load();
+    return c;
+}
+
+void CapturePipeline::_captureStage()
+{
+    uint32_t sequence = 0;
+    int slot = -1; // Held on to until a frame in it is passed on
+
+    while (_running.load()) {
+        if (slot < 0 && !_free.pop(slot)) {
+            _captureWake.wait(WAIT_MS); // Inference still has every slot
+            continue;
+        }
+
+        frame_t &frame = _frames[slot];
+        frame.sequence = sequence++;
+        frame.capturedUs = nowUs();
+        frame.empty = false;
+        if (!_capture(frame)) {
+            _rejected++;
+            continue;
+        }
+
+        _captured++;
+        _ready.push(slot); // Never full, it has room for every slot
+        _inferWake.notify();
+        slot = -1;
+    }
+}
+
+void CapturePipeline::_inferStage()
+{
+    while (_running.load()) {
+        int slot;
+        if (!_ready.pop(slot)) {
+            _inferWake.wait(WAIT_MS);
+            continue;
+        }
+
+        const frame_t &frame = _frames[slot];
+        result_t result;
+        memset(&result, 0, sizeof(result));
+        result.sequence = frame.sequence;
+        result.capturedUs = frame.capturedUs;
+
+        const bool inferred = frame.empty || _infer(frame, result);
+
+        // The pixels are not needed anymore, let the capture stage refill them
+        _free.push(slot);
+        _captureWake.notify();
+
+        if (!inferred) {
+            _failed++;
+            continue;
+        }
+
+        result.label[MAX_LABEL_LENGTH - 1] = '\0';
+        result.inferredUs = nowUs();
+        if (_inferred.push(result)) {
+            _lookupWake.notify();
+        } else {
+            _dropped++; // The lookup is behind, it catches up on a later frame
+        }
+    }
+}
+
+void CapturePipeline::_lookupStage()
+{
+    while (_running.load()) {
+        result_t result;
+        if (!_inferred.pop(result)) {
+            _lookupWake.wait(WAIT_MS);
+            continue;
+        }
+
+        if (result.label[0] != '\0') {
+            result.found = _lookup(result);
+        }
+
+        result.doneUs = nowUs();
+        if (_done.push(result)) {
+            _completed++;
+        } else {
+            _dropped++; // Nobody polled the earlier results
+        }
+    }
+}
+
+void CapturePipeline::_release()
+{
+    for (int i = 0; i < FRAME_SLOTS; i++) {
+        free(_frames[i].pixels);
+        _frames[i].pixels = nullptr;
+    }
+}
+
+#if defined(ESP_PLATFORM)
+void CapturePipeline::_captureTask(void *pipeline)
+{
+    CapturePipeline *self = (CapturePipeline *)pipeline;
+    self->_captureStage();
+    xSemaphoreGive(self->_exited);
+    vTaskDelete(nullptr);
+}
+
+void CapturePipeline::_inferTask(void *pipeline)
+{
+    CapturePipeline *self = (CapturePipeline *)pipeline;
+    self->_inferStage();
+    xSemaphoreGive(self->_exited);
+    vTaskDelete(nullptr);
+}
+
+void CapturePipeline::_lookupTask(void *pipeline)
+{
+    CapturePipeline *self = (CapturePipeline *)pipeline;
+    self->_lookupStage();
+    xSemaphoreGive(self->_exited);
+    vTaskDelete(nullptr);
+}
+#endif
@@ -2,7 +2,7 @@
 
 // Constructor
 CommandHandler::CommandHandler(Stream &serialStream)
-    : serial(serialStream), numRoutes(0), bufferIndex(0)
+    : numRoutes(0), serial(serialStream), bufferIndex(0)
 {
     memset(commandBuffer, 0, sizeof(commandBuffer));
 }
@@ -0,0 +1,197 @@
+#include "ConfigParser.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Frame sizes of FRAME_SIZE, the ones of the OV2640 at or below VGA
+typedef struct {
+    const char *name;
+    uint16_t width;
+    uint16_t height;
+} frame_size_t;
+
+static const frame_size_t FRAME_SIZES[] = {
+    {"QQVGA", 160, 120}, {"HQVGA", 240, 176}, {"QVGA", 320, 240},
+    {"CIF", 400, 296},   {"VGA", 640, 480},
+};
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static ConfigParser::token_t trim(const char *begin, const char *end)
+{
+    while (begin < end && isSpace(*begin)) {
+        begin++;
+    }
+    while (end > begin && isSpace(end[-1])) {
+        end--;
+    }
+    return {begin, (size_t)(end - begin)};
+}
+
+static std::string toString(ConfigParser::token_t token)
+{
+    return std::string(token.data, token.length);
+}
+
+size_t ConfigParser::parse(const char *text, size_t length,
+                           EntryFunction entry, void *context)
+{
+    size_t entries = 0;
+    const char *end = text + length;
+
+    for (const char *line = text; line < end;) {
+        const char *eol = (const char *)memchr(line, '\n', end - line);
+        if (eol == nullptr) {
+            eol = end; // Last line without a newline
+        }
+
+        const char *equals = (const char *)memchr(line, '=', eol - line);
+        token_t key = trim(line, equals != nullptr ? equals : eol);
+        if (equals != nullptr && key.length > 0 && key.data[0] != '#') {
+            entry(context, key, trim(equals + 1, eol));
+            entries++;
+        }
+
+        line = eol + 1;
+    }
+
+    return entries;
+}
+
+bool ConfigParser::setWiFi(WiFiConfig &config, token_t key, token_t value)
+{
+    if (equals(key, "SSID")) {
+        config.ssid = toString(value);
+    } else if (equals(key, "Password")) {
+        config.password = toString(value);
+    } else if (equals(key, "Gateway")) {
+        config.gateway = toString(value);
+    } else if (equals(key, "IP")) {
+        config.ip = toString(value);
+    } else if (equals(key, "MASK")) {
+        config.mask = toString(value);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool ConfigParser::setSetting(settings_t &settings, token_t key,
+                              token_t value)
+{
+    float f;
+    int32_t i;
+
+    if (equals(key, "API_URL")) {
+        // No trailing slash, paths are appended to it
+        while (value.length > 0 && value.data[value.length - 1] == '/') {
+            value.length--;
+        }
+        if (value.length == 0) {
+            return false;
+        }
+        settings.apiUrl = toString(value);
+    } else if (equals(key, "DETECTION_THRESHOLD")) {
+        if (!toFloat(value, f) || f < 0.0f || f > 1.0f) {
+            return false;
+        }
+        settings.detectionThreshold = f;
+    } else if (equals(key, "FRAME_SIZE")) {
+        for (const frame_size_t &size : FRAME_SIZES) {
+            if (equals(value, size.name)) {
+                settings.frameWidth = size.width;
+                settings.frameHeight = size.height;
+                return true;
+            }
+        }
+        return false;
+    } else if (equals(key, "JPEG_QUALITY")) {
+        if (!toInt(value, i) || i < 0 || i > 63) {
+            return false;
+        }
+        settings.jpegQuality = i;
+    } else if (equals(key, "ADAPTIVE_CAMERA")) {
+        if (!toInt(value, i) || i < 0 || i > 1) {
+            return false;
+        }
+        settings.adaptiveCamera = i == 1;
+    } else if (equals(key, "JPEG_QUALITY_FLOOR")) {
+        if (!toInt(value, i) || i < 0 || i > 63) {
+            return false;
+        }
+        settings.qualityFloor = i;
+    } else if (equals(key, "CAPTURE_FRAMES")) {
+        if (!toInt(value, i) || i < 1 || i > 10) {
+            return false;
+        }
+        settings.captureFrames = i;
+    } else if (equals(key, "CACHE_TTL_S")) {
+        if (!toInt(value, i) || i < 0 || i > 24 * 3600) {
+            return false;
+        }
+        settings.cacheTtlMs = (uint32_t)i * 1000;
+    } else if (equals(key, "WEIGHT_WINDOW_G")) {
+        if (!toFloat(value, f) || f <= 0.0f) {
+            return false;
+        }
+        settings.weightWindow = f;
+    } else if (equals(key, "CAPTURE_LOG")) {
+        if (!toInt(value, i) || i < 0 || i > 1) {
+            return false;
+        }
+        settings.captureLog = i == 1;
+    } else if (equals(key, "PREVIEW")) {
+        if (!toInt(value, i) || i < 0 || i > 1) {
+            return false;
+        }
+        settings.preview = i == 1;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool ConfigParser::equals(token_t token, const char *key)
+{
+    size_t i = 0;
+    for (; i < token.length && key[i] != '\0'; i++) {
+        char a = token.data[i], b = key[i];
+        a = a >= 'a' && a <= 'z' ? a - 'a' + 'A' : a;
+        b = b >= 'a' && b <= 'z' ? b - 'a' + 'A' : b;
+        if (a != b) {
+            return false;
+        }
+    }
+    return i == token.length && key[i] == '\0';
+}
+
+bool ConfigParser::toFloat(token_t token, float &value)
+{
+    char number[24];
+    if (token.length == 0 || token.length >= sizeof(number)) {
+        return false;
+    }
+    memcpy(number, token.data, token.length);
+    number[token.length] = '\0';
+
+    char *end;
+    value = strtof(number, &end);
+    return *end == '\0';
+}
+
+bool ConfigParser::toInt(token_t token, int32_t &value)
+{
+    char number[16];
+    if (token.length == 0 || token.length >= sizeof(number)) {
+        return false;
+    }
+    memcpy(number, token.data, token.length);
+    number[token.length] = '\0';
+
+    char *end;
+    value = strtol(number, &end, 10);
+    return *end == '\0';
+}
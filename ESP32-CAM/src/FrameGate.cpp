@@ -0,0 +1,188 @@
+#include "FrameGate.hpp"
+
+#include <string.h>
+
+// Until setPolicy() is called every frame passes
+FrameGate::FrameGate() : _hasReference(false)
+{
+    _policy.minMean = 0.0f;
+    _policy.maxMean = 255.0f;
+    _policy.maxClippedShare = 1.0f;
+    _policy.minVariance = 0.0f;
+    _policy.minEdgeEnergy = 0.0f;
+    _policy.emptyCellDelta = 0.0f;
+    _policy.emptyEdgeDelta = 0.0f;
+
+    memset(&_reference, 0, sizeof(_reference));
+    memset(&_last, 0, sizeof(_last));
+    resetCounters();
+}
+
+void FrameGate::computeStats(const uint8_t *bgr888, size_t width,
+                             size_t height, stats_t &stats)
+{
+    memset(&stats, 0, sizeof(stats));
+
+    // Luma of the previous sampled row, for the vertical steps
+    uint8_t previousRow[MAX_SAMPLED_WIDTH];
+    const size_t columns = (width + SAMPLE_STEP - 1) / SAMPLE_STEP;
+    if (columns > MAX_SAMPLED_WIDTH) {
+        return;
+    }
+
+    // Sums and sample counts of the thumbnail cells
+    uint32_t cellSums[THUMBNAIL_SIZE * THUMBNAIL_SIZE] = {0};
+    uint16_t cellPixels[THUMBNAIL_SIZE * THUMBNAIL_SIZE] = {0};
+    uint8_t cellColumn[MAX_SAMPLED_WIDTH];
+    for (size_t x = 0, column = 0; x < width; x += SAMPLE_STEP, column++) {
+        cellColumn[column] = (uint8_t)(x * THUMBNAIL_SIZE / width);
+    }
+
+    uint32_t sum = 0;
+    uint32_t sumSquares = 0;
+    uint32_t edges = 0;
+    uint32_t pixels = 0;
+
+    for (size_t y = 0; y < height; y += SAMPLE_STEP) {
+        const uint8_t *row = bgr888 + y * width * 3;
+        const size_t cellRow = (y * THUMBNAIL_SIZE / height) * THUMBNAIL_SIZE;
+        uint8_t left = 0;
+
+        for (size_t x = 0, column = 0; x < width; x += SAMPLE_STEP, column++) {
+            const uint8_t *p = row + x * 3;
+            // BT.601 weights in 8 bit fixed point, the buffer is BGR
+            const uint8_t luma = (uint8_t)((29 * p[0] + 150 * p[1] + 77 * p[2]) >> 8);
+
+            stats.histogram[luma >> 4]++;
+            cellSums[cellRow + cellColumn[column]] += luma;
+            cellPixels[cellRow + cellColumn[column]]++;
+            sum += luma;
+            sumSquares += (uint32_t)luma * luma;
+
+            if (x > 0) {
+                edges += luma > left ? luma - left : left - luma;
+            }
+            if (y > 0) {
+                const uint8_t up = previousRow[column];
+                edges += luma > up ? luma - up : up - luma;
+            }
+            left = luma;
+            previousRow[column] = luma;
+            pixels++;
+        }
+    }
+
+    if (pixels == 0) {
+        return;
+    }
+
+    stats.pixels = (uint16_t)pixels;
+    stats.mean = (float)sum / pixels;
+    stats.variance = (float)sumSquares / pixels - stats.mean * stats.mean;
+    stats.edgeEnergy = (float)edges / pixels;
+
+    for (int i = 0; i < THUMBNAIL_SIZE * THUMBNAIL_SIZE; i++) {
+        stats.thumbnail[i] =
+            cellPixels[i] ? (uint8_t)(cellSums[i] / cellPixels[i]) : 0;
+    }
+}
+
+bool FrameGate::setReference(const uint8_t *bgr888, size_t width,
+                             size_t height)
+{
+    stats_t stats;
+    computeStats(bgr888, width, height, stats);
+
+    if (stats.pixels == 0 || _checkExposure(stats) != GATE_PASS) {
+        return false; // An unusable frame is no reference
+    }
+
+    _reference = stats;
+    _hasReference = true;
+    return true;
+}
+
+FrameGate::gate_result_t FrameGate::check(const uint8_t *bgr888, size_t width,
+                                          size_t height)
+{
+    stats_t &stats = _last;
+    computeStats(bgr888, width, height, stats);
+
+    gate_result_t result = _checkExposure(stats);
+
+    if (result == GATE_PASS && _hasReference &&
+        thumbnailDelta(stats, _reference) < _policy.emptyCellDelta) {
+        float delta = stats.edgeEnergy - _reference.edgeEnergy;
+        if (delta < 0) {
+            delta = -delta;
+        }
+        if (delta < _policy.emptyEdgeDelta) {
+            result = GATE_EMPTY_PLATE;
+        }
+    }
+
+    switch (result) {
+    case GATE_PASS:
+        _counters.passed++;
+        break;
+    case GATE_TOO_DARK:
+        _counters.tooDark++;
+        break;
+    case GATE_OVEREXPOSED:
+        _counters.overexposed++;
+        break;
+    case GATE_NO_DETAIL:
+        _counters.noDetail++;
+        break;
+    case GATE_EMPTY_PLATE:
+        _counters.emptyPlate++;
+        break;
+    }
+
+    return result;
+}
+
+void FrameGate::resetCounters()
+{
+    memset(&_counters, 0, sizeof(_counters));
+}
+
+FrameGate::gate_result_t FrameGate::_checkExposure(const stats_t &stats) const
+{
+    if (stats.pixels == 0) {
+        return GATE_NO_DETAIL;
+    }
+
+    if (stats.mean < _policy.minMean) {
+        return GATE_TOO_DARK;
+    }
+
+    const float clipped =
+        (float)stats.histogram[HISTOGRAM_BINS - 1] / stats.pixels;
+    if (stats.mean > _policy.maxMean || clipped > _policy.maxClippedShare) {
+        return GATE_OVEREXPOSED;
+    }
+
+    if (stats.variance < _policy.minVariance &&
+        stats.edgeEnergy < _policy.minEdgeEnergy) {
+        return GATE_NO_DETAIL; // Covered lens, or pointing at a wall
+    }
+
+    return GATE_PASS;
+}
+
+float FrameGate::thumbnailDelta(const stats_t &a, const stats_t &b)
+{
+    const float offset = a.mean - b.mean;
+    float maxDelta = 0;
+    for (int i = 0; i < THUMBNAIL_SIZE * THUMBNAIL_SIZE; i++) {
+        float d = (float)a.thumbnail[i] - (float)b.thumbnail[i] - offset;
+        if (d < 0) {
+            d = -d;
+        }
+        if (d > maxDelta) {
+            maxDelta = d;
+        }
+    }
+    return maxDelta;
+}
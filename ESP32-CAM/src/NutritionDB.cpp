@@ -0,0 +1,211 @@
+#include "NutritionDB.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+static uint32_t alignToBlock(uint32_t offset)
+{
+    return (offset + NutritionDB::BLOCK_SIZE - 1) / NutritionDB::BLOCK_SIZE *
+           NutritionDB::BLOCK_SIZE;
+}
+
+// Records in a block, the last one may be short
+static uint32_t recordsInBlock(const NutritionDB::header_t &header,
+                               uint32_t block)
+{
+    const uint32_t after = header.count - block * NutritionDB::RECORDS_PER_BLOCK;
+    return after < NutritionDB::RECORDS_PER_BLOCK
+               ? after
+               : (uint32_t)NutritionDB::RECORDS_PER_BLOCK;
+}
+
+NutritionDB::NutritionDB() : _read(nullptr), _file(nullptr)
+{
+    memset(&_header, 0, sizeof(_header));
+}
+
+NutritionDB::err_ndb_t NutritionDB::open(ReadFunction read, void *file)
+{
+    close();
+
+    header_t header;
+    if (!read(file, 0, &header, sizeof(header))) {
+        return NDB_ERR_IO;
+    }
+    if (header.magic != MAGIC || header.blocks > MAX_BLOCKS ||
+        header.count > header.blocks * RECORDS_PER_BLOCK ||
+        header.recordsOffset < sizeof(header) + header.blocks * sizeof(uint64_t)) {
+        return NDB_ERR_FORMAT;
+    }
+    if (!read(file, sizeof(header), _firstKeys,
+              header.blocks * sizeof(uint64_t))) {
+        return NDB_ERR_IO;
+    }
+
+    _header = header;
+    _read = read;
+    _file = file;
+    return NDB_OK;
+}
+
+void NutritionDB::close()
+{
+    memset(&_header, 0, sizeof(_header));
+    _read = nullptr;
+    _file = nullptr;
+}
+
+bool NutritionDB::lookup(const char *name, float &calories) const
+{
+    if (_read == nullptr || _header.blocks == 0) {
+        return false;
+    }
+
+    // Last block starting at or before the key
+    const uint64_t k = key(name);
+    const uint64_t *next =
+        std::upper_bound(_firstKeys, _firstKeys + _header.blocks, k);
+    if (next == _firstKeys) {
+        return false;
+    }
+    const uint32_t block = next - _firstKeys - 1;
+
+    record_t records[RECORDS_PER_BLOCK];
+    const uint32_t inBlock = recordsInBlock(_header, block);
+    if (!_read(_file, _header.recordsOffset + block * BLOCK_SIZE, records,
+               inBlock * sizeof(record_t))) {
+        return false;
+    }
+
+    const record_t *found = std::lower_bound(
+        records, records + inBlock, k,
+        [](const record_t &r, uint64_t key) { return r.key < key; });
+    if (found == records + inBlock || found->key != k) {
+        return false;
+    }
+
+    calories = found->calories;
+    return true;
+}
+
+NutritionDB::err_ndb_t
+NutritionDB::readAll(std::vector<food_t> &foods) const
+{
+    foods.clear();
+    if (_read == nullptr) {
+        return NDB_ERR_IO;
+    }
+
+    std::vector<char> pool(_header.poolSize + 1, '\0');
+    if (!_read(_file, _header.poolOffset, pool.data(), _header.poolSize)) {
+        return NDB_ERR_IO;
+    }
+
+    record_t records[RECORDS_PER_BLOCK];
+    foods.reserve(_header.count);
+    for (uint32_t block = 0; block < _header.blocks; block++) {
+        const uint32_t inBlock = recordsInBlock(_header, block);
+        if (!_read(_file, _header.recordsOffset + block * BLOCK_SIZE, records,
+                   inBlock * sizeof(record_t))) {
+            return NDB_ERR_IO;
+        }
+        for (uint32_t i = 0; i < inBlock; i++) {
+            if (records[i].name >= _header.poolSize) {
+                return NDB_ERR_FORMAT;
+            }
+            food_t food;
+            strncpy(food.name, &pool[records[i].name], MAX_NAME_LENGTH - 1);
+            food.name[MAX_NAME_LENGTH - 1] = '\0';
+            food.calories = records[i].calories;
+            foods.push_back(food);
+        }
+    }
+
+    return NDB_OK;
+}
+
+NutritionDB::err_ndb_t NutritionDB::write(WriteFunction write, void *file,
+                                          uint32_t revision,
+                                          std::vector<food_t> &foods)
+{
+    // Sort by key, the later of two entries with the same key first, then
+    // keep the first of every key
+    std::vector<record_t> records(foods.size());
+    for (size_t i = 0; i < foods.size(); i++) {
+        foods[i].name[MAX_NAME_LENGTH - 1] = '\0';
+        records[i].key = key(foods[i].name);
+        records[i].calories = foods[i].calories;
+        records[i].name = i; // Index of the food until the pool is laid out
+    }
+    std::sort(records.begin(), records.end(),
+              [](const record_t &a, const record_t &b) {
+                  return a.key < b.key || (a.key == b.key && a.name > b.name);
+              });
+    records.erase(std::unique(records.begin(), records.end(),
+                              [](const record_t &a, const record_t &b) {
+                                  return a.key == b.key;
+                              }),
+                  records.end());
+
+    if (records.size() > MAX_RECORDS) {
+        return NDB_ERR_FULL;
+    }
+
+    std::vector<char> pool;
+    for (record_t &record : records) {
+        const char *name = foods[record.name].name;
+        record.name = pool.size();
+        pool.insert(pool.end(), name, name + strlen(name) + 1);
+    }
+
+    header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = MAGIC;
+    header.revision = revision;
+    header.count = records.size();
+    header.blocks = (header.count + RECORDS_PER_BLOCK - 1) / RECORDS_PER_BLOCK;
+    header.recordsOffset =
+        alignToBlock(sizeof(header) + header.blocks * sizeof(uint64_t));
+    header.poolOffset = header.recordsOffset + header.blocks * BLOCK_SIZE;
+    header.poolSize = pool.size();
+
+    // Header and index, then the records, every block padded to full size
+    std::vector<uint8_t> block(header.recordsOffset, 0);
+    memcpy(block.data(), &header, sizeof(header));
+    for (uint32_t b = 0; b < header.blocks; b++) {
+        memcpy(&block[sizeof(header) + b * sizeof(uint64_t)],
+               &records[b * RECORDS_PER_BLOCK].key, sizeof(uint64_t));
+    }
+    if (!write(file, block.data(), block.size())) {
+        return NDB_ERR_IO;
+    }
+
+    block.assign(BLOCK_SIZE, 0);
+    for (uint32_t b = 0; b < header.blocks; b++) {
+        const uint32_t inBlock = recordsInBlock(header, b);
+        memset(block.data(), 0, BLOCK_SIZE);
+        memcpy(block.data(), &records[b * RECORDS_PER_BLOCK],
+               inBlock * sizeof(record_t));
+        if (!write(file, block.data(), BLOCK_SIZE)) {
+            return NDB_ERR_IO;
+        }
+    }
+
+    if (!pool.empty() && !write(file, pool.data(), pool.size())) {
+        return NDB_ERR_IO;
+    }
+
+    return NDB_OK;
+}
+
+uint64_t NutritionDB::key(const char *name)
+{
+    // FNV-1a over the upper case name, labels come in either case
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char *c = name; *c != '\0'; c++) {
+        const char upper = *c >= 'a' && *c <= 'z' ? *c - 'a' + 'A' : *c;
+        hash ^= (uint8_t)upper;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
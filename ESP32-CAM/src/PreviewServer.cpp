@@ -0,0 +1,485 @@
+#include "PreviewServer.hpp"
+
+#include <Arduino.h>
+#include <esp_camera.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "camera_index.h"
+
+// Both servers run on core 0 below every task of the firmware, the stream
+// only gets the time the capture and inference leave over
+static const UBaseType_t SERVER_PRIORITY = tskIDLE_PRIORITY;
+static const BaseType_t SERVER_CORE = 0;
+static const uint16_t STREAM_PORT = 81;
+// A client that does not take a frame in this time is dropped
+static const uint16_t STREAM_SEND_TIMEOUT_S = 2;
+
+#define PART_BOUNDARY "5c4e1f0a9b7d3e2f"
+static const char *STREAM_CONTENT_TYPE =
+    "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
+static const char *STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
+static const char *STREAM_PART =
+    "Content-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n";
+
+// Stream with the boxes of the last inference drawn over it. The boxes are in
+// the impulse input, a centre crop of the frame to the input's aspect ratio.
+static const char PREVIEW_PAGE[] = R"(<!doctype html>
+<html><head><meta name="viewport" content="width=device-width">
+<title>Smart scale preview</title>
+<style>
+body{margin:0;background:#181818;color:#eee;font:16px sans-serif}
+#view{position:relative;display:inline-block;max-width:100%}
+#view img{display:block;max-width:100%}
+#view canvas{position:absolute;left:0;top:0;width:100%;height:100%}
+#weight{padding:8px}
+</style></head>
+<body><div id="view"><img id="stream"><canvas id="boxes"></canvas></div>
+<div id="weight"></div>
+<script>
+const img = document.getElementById('stream');
+const canvas = document.getElementById('boxes');
+img.src = location.protocol + '//' + location.hostname + ':81/stream';
+function draw(m) {
+  const w = canvas.width = img.clientWidth, h = canvas.height = img.clientHeight;
+  const aspect = m.width / m.height;
+  const cw = w / h > aspect ? h * aspect : w, ch = cw / aspect;
+  const ox = (w - cw) / 2, oy = (h - ch) / 2;
+  const sx = cw / m.width, sy = ch / m.height;
+  const c = canvas.getContext('2d');
+  c.clearRect(0, 0, w, h);
+  c.strokeStyle = c.fillStyle = '#3f3';
+  c.lineWidth = 2;
+  c.font = '14px sans-serif';
+  for (const b of m.boxes) {
+    c.strokeRect(ox + b.x * sx, oy + b.y * sy, b.w * sx, b.h * sy);
+    c.fillText(b.label + ' ' + b.value.toFixed(2), ox + b.x * sx + 2, oy + b.y * sy + 14);
+  }
+  document.getElementById('weight').textContent =
+    m.weight < 0 ? '' : m.weight.toFixed(1) + ' g';
+}
+function connect() {
+  const ws = new WebSocket('ws://' + location.host + '/ws');
+  ws.onmessage = e => draw(JSON.parse(e.data));
+  ws.onclose = () => setTimeout(connect, 2000);
+}
+connect();
+</script></body></html>
+)";
+
+#if CONFIG_HTTPD_WS_SUPPORT
+// A /ws message on its way to the server task
+typedef struct {
+    PreviewServer *server;
+    httpd_handle_t handle;
+    size_t length;
+    char text[];
+} message_t;
+
+static const size_t MESSAGE_MAX_LENGTH = 96 + PreviewServer::MAX_BOXES * 160;
+
+// Appends a label as a JSON string; labels come from the impulse, anything
+// that would need escaping is left out
+static size_t appendLabel(char *out, size_t size, const char *label)
+{
+    size_t length = 0;
+    for (; *label != '\0' && length + 1 < size; label++) {
+        if (*label != '"' && *label != '\\' && (unsigned char)*label >= ' ') {
+            out[length++] = *label;
+        }
+    }
+    out[length] = '\0';
+    return length;
+}
+#endif
+
+PreviewServer::PreviewServer()
+    : _http(nullptr), _stream(nullptr), _frameIntervalMs(0), _streaming(false),
+      _listeners(0), _frames(0), _refused(0), _published(0)
+{
+}
+
+PreviewServer::err_preview_t PreviewServer::begin(uint32_t frameIntervalMs)
+{
+    if (running()) {
+        return PREVIEW_ERR_RUNNING;
+    }
+    _frameIntervalMs = frameIntervalMs;
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.task_priority = SERVER_PRIORITY;
+    config.core_id = SERVER_CORE;
+
+    const httpd_uri_t uris[] = {
+        {"/", HTTP_GET, _indexHandler, this},
+        {"/preview", HTTP_GET, _previewHandler, this},
+        {"/status", HTTP_GET, _statusHandler, this},
+        {"/control", HTTP_GET, _controlHandler, this},
+        {"/capture", HTTP_GET, _captureHandler, this},
+    };
+    if (httpd_start(&_http, &config) != ESP_OK) {
+        _http = nullptr;
+        return PREVIEW_ERR_START;
+    }
+    for (const httpd_uri_t &uri : uris) {
+        httpd_register_uri_handler(_http, &uri);
+    }
+#if CONFIG_HTTPD_WS_SUPPORT
+    httpd_uri_t events = {"/ws", HTTP_GET, _eventsHandler, this};
+    events.is_websocket = true;
+    httpd_register_uri_handler(_http, &events);
+#endif
+
+    // A server of its own, the stream keeps its task busy for as long as
+    // the page is open
+    config.server_port = STREAM_PORT;
+    config.ctrl_port += 1;
+    config.max_open_sockets = 2;
+    config.send_wait_timeout = STREAM_SEND_TIMEOUT_S;
+    const httpd_uri_t stream = {"/stream", HTTP_GET, _streamHandler, this};
+    if (httpd_start(&_stream, &config) != ESP_OK) {
+        _stream = nullptr;
+        end();
+        return PREVIEW_ERR_START;
+    }
+    httpd_register_uri_handler(_stream, &stream);
+
+    return PREVIEW_OK;
+}
+
+void PreviewServer::end()
+{
+    if (_stream != nullptr) {
+        httpd_stop(_stream);
+        _stream = nullptr;
+    }
+    if (_http != nullptr) {
+        httpd_stop(_http);
+        _http = nullptr;
+    }
+    _listeners = 0;
+}
+
+void PreviewServer::publish(const box_t *boxes, size_t count,
+                            uint32_t inputWidth, uint32_t inputHeight,
+                            float weight)
+{
+#if CONFIG_HTTPD_WS_SUPPORT
+    if (!running() || _listeners.load() == 0) {
+        return;
+    }
+
+    message_t *message =
+        (message_t *)malloc(sizeof(message_t) + MESSAGE_MAX_LENGTH);
+    if (message == nullptr) {
+        return;
+    }
+    message->server = this;
+    message->handle = _http;
+
+    char *text = message->text;
+    size_t length = snprintf(text, MESSAGE_MAX_LENGTH,
+                             "{\"width\":%u,\"height\":%u,\"weight\":%.1f,"
+                             "\"boxes\":[",
+                             (unsigned)inputWidth, (unsigned)inputHeight,
+                             weight < 0 ? -1.0f : weight);
+    for (size_t i = 0; i < count && i < MAX_BOXES; i++) {
+        char label[40];
+        appendLabel(label, sizeof(label), boxes[i].label);
+        length += snprintf(text + length, MESSAGE_MAX_LENGTH - length,
+                           "%s{\"label\":\"%s\",\"value\":%.3f,\"x\":%u,"
+                           "\"y\":%u,\"w\":%u,\"h\":%u}",
+                           i == 0 ? "" : ",", label, boxes[i].value,
+                           (unsigned)boxes[i].x, (unsigned)boxes[i].y,
+                           (unsigned)boxes[i].width, (unsigned)boxes[i].height);
+    }
+    length += snprintf(text + length, MESSAGE_MAX_LENGTH - length, "]}");
+    message->length = length;
+
+    // Sent from the server task, the caller does not wait on the sockets
+    if (httpd_queue_work(_http, _broadcast, message) != ESP_OK) {
+        free(message);
+        return;
+    }
+    _published++;
+#else
+    (void)boxes;
+    (void)count;
+    (void)inputWidth;
+    (void)inputHeight;
+    (void)weight;
+#endif
+}
+
+PreviewServer::counters_t PreviewServer::counters() const
+{
+    counters_t c;
+    c.frames = _frames.load();
+    c.refused = _refused.load();
+    c.published = _published.load();
+    return c;
+}
+
+esp_err_t PreviewServer::_indexHandler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "text/html");
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+
+    sensor_t *s = esp_camera_sensor_get();
+    if (s != nullptr && s->id.PID == OV3660_PID) {
+        return httpd_resp_send(req, (const char *)index_ov3660_html_gz,
+                               index_ov3660_html_gz_len);
+    }
+    if (s != nullptr && s->id.PID == OV5640_PID) {
+        return httpd_resp_send(req, (const char *)index_ov5640_html_gz,
+                               index_ov5640_html_gz_len);
+    }
+    return httpd_resp_send(req, (const char *)index_ov2640_html_gz,
+                           index_ov2640_html_gz_len);
+}
+
+esp_err_t PreviewServer::_previewHandler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "text/html");
+    return httpd_resp_send(req, PREVIEW_PAGE, sizeof(PREVIEW_PAGE) - 1);
+}
+
+// Sensor settings the web UI shows
+esp_err_t PreviewServer::_statusHandler(httpd_req_t *req)
+{
+    sensor_t *s = esp_camera_sensor_get();
+    if (s == nullptr) {
+        return httpd_resp_send_500(req);
+    }
+
+    char json[512];
+    const int length = snprintf(
+        json, sizeof(json),
+        "{\"framesize\":%u,\"quality\":%u,\"brightness\":%d,\"contrast\":%d,"
+        "\"saturation\":%d,\"sharpness\":%d,\"special_effect\":%u,"
+        "\"wb_mode\":%u,\"awb\":%u,\"awb_gain\":%u,\"aec\":%u,\"aec2\":%u,"
+        "\"ae_level\":%d,\"aec_value\":%u,\"agc\":%u,\"agc_gain\":%u,"
+        "\"gainceiling\":%u,\"bpc\":%u,\"wpc\":%u,\"raw_gma\":%u,\"lenc\":%u,"
+        "\"hmirror\":%u,\"vflip\":%u,\"dcw\":%u,\"colorbar\":%u}",
+        s->status.framesize, s->status.quality, s->status.brightness,
+        s->status.contrast, s->status.saturation, s->status.sharpness,
+        s->status.special_effect, s->status.wb_mode, s->status.awb,
+        s->status.awb_gain, s->status.aec, s->status.aec2, s->status.ae_level,
+        s->status.aec_value, s->status.agc, s->status.agc_gain,
+        s->status.gainceiling, s->status.bpc, s->status.wpc, s->status.raw_gma,
+        s->status.lenc, s->status.hmirror, s->status.vflip, s->status.dcw,
+        s->status.colorbar);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    return httpd_resp_send(req, json, length);
+}
+
+// Image settings from the web UI. Not the frame size, the capture and the
+// impulse depend on it and it comes from config.txt.
+esp_err_t PreviewServer::_controlHandler(httpd_req_t *req)
+{
+    char query[64], variable[24], value[8];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "var", variable, sizeof(variable)) != ESP_OK ||
+        httpd_query_key_value(query, "val", value, sizeof(value)) != ESP_OK) {
+        return httpd_resp_send_404(req);
+    }
+
+    sensor_t *s = esp_camera_sensor_get();
+    const int v = atoi(value);
+    int res = -1;
+    if (s == nullptr) {
+        res = -1;
+    } else if (!strcmp(variable, "quality")) {
+        res = s->set_quality(s, v);
+    } else if (!strcmp(variable, "contrast")) {
+        res = s->set_contrast(s, v);
+    } else if (!strcmp(variable, "brightness")) {
+        res = s->set_brightness(s, v);
+    } else if (!strcmp(variable, "saturation")) {
+        res = s->set_saturation(s, v);
+    } else if (!strcmp(variable, "sharpness")) {
+        res = s->set_sharpness(s, v);
+    } else if (!strcmp(variable, "special_effect")) {
+        res = s->set_special_effect(s, v);
+    } else if (!strcmp(variable, "wb_mode")) {
+        res = s->set_wb_mode(s, v);
+    } else if (!strcmp(variable, "awb")) {
+        res = s->set_whitebal(s, v);
+    } else if (!strcmp(variable, "awb_gain")) {
+        res = s->set_awb_gain(s, v);
+    } else if (!strcmp(variable, "aec")) {
+        res = s->set_exposure_ctrl(s, v);
+    } else if (!strcmp(variable, "aec2")) {
+        res = s->set_aec2(s, v);
+    } else if (!strcmp(variable, "ae_level")) {
+        res = s->set_ae_level(s, v);
+    } else if (!strcmp(variable, "aec_value")) {
+        res = s->set_aec_value(s, v);
+    } else if (!strcmp(variable, "agc")) {
+        res = s->set_gain_ctrl(s, v);
+    } else if (!strcmp(variable, "agc_gain")) {
+        res = s->set_agc_gain(s, v);
+    } else if (!strcmp(variable, "gainceiling")) {
+        res = s->set_gainceiling(s, (gainceiling_t)v);
+    } else if (!strcmp(variable, "bpc")) {
+        res = s->set_bpc(s, v);
+    } else if (!strcmp(variable, "wpc")) {
+        res = s->set_wpc(s, v);
+    } else if (!strcmp(variable, "raw_gma")) {
+        res = s->set_raw_gma(s, v);
+    } else if (!strcmp(variable, "lenc")) {
+        res = s->set_lenc(s, v);
+    } else if (!strcmp(variable, "hmirror")) {
+        res = s->set_hmirror(s, v);
+    } else if (!strcmp(variable, "vflip")) {
+        res = s->set_vflip(s, v);
+    } else if (!strcmp(variable, "dcw")) {
+        res = s->set_dcw(s, v);
+    } else if (!strcmp(variable, "colorbar")) {
+        res = s->set_colorbar(s, v);
+    }
+
+    if (res != 0) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, nullptr);
+    }
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    return httpd_resp_send(req, nullptr, 0);
+}
+
+// One frame, as the camera encoded it
+esp_err_t PreviewServer::_captureHandler(httpd_req_t *req)
+{
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (fb == nullptr) {
+        return httpd_resp_send_500(req);
+    }
+
+    httpd_resp_set_type(req, "image/jpeg");
+    httpd_resp_set_hdr(req, "Content-Disposition", "inline; filename=capture.jpg");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    const esp_err_t res = httpd_resp_send(req, (const char *)fb->buf, fb->len);
+    esp_camera_fb_return(fb);
+    return res;
+}
+
+esp_err_t PreviewServer::_streamHandler(httpd_req_t *req)
+{
+    PreviewServer *self = (PreviewServer *)req->user_ctx;
+
+    // A second viewer would double what the stream takes from the camera
+    if (self->_streaming.exchange(true)) {
+        self->_refused++;
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_send(req, nullptr, 0);
+    }
+
+    httpd_resp_set_type(req, STREAM_CONTENT_TYPE);
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+    esp_err_t res = ESP_OK;
+    uint32_t lastFrame = millis() - self->_frameIntervalMs;
+    while (res == ESP_OK) {
+        // Rate limit, counted from the start of the last frame so a slow
+        // client does not get a burst to catch up
+        const uint32_t elapsed = millis() - lastFrame;
+        if (elapsed < self->_frameIntervalMs) {
+            vTaskDelay(pdMS_TO_TICKS(self->_frameIntervalMs - elapsed));
+        }
+        lastFrame = millis();
+
+        camera_fb_t *fb = esp_camera_fb_get();
+        if (fb == nullptr) {
+            continue; // The camera is being set up again, try later
+        }
+
+        // The frame buffer goes out as it is, it is not copied
+        char part[64];
+        const int partLength = snprintf(part, sizeof(part), STREAM_PART,
+                                        (unsigned)fb->len);
+        res = httpd_resp_send_chunk(req, STREAM_BOUNDARY, strlen(STREAM_BOUNDARY));
+        if (res == ESP_OK) {
+            res = httpd_resp_send_chunk(req, part, partLength);
+        }
+        if (res == ESP_OK) {
+            res = httpd_resp_send_chunk(req, (const char *)fb->buf, fb->len);
+        }
+        esp_camera_fb_return(fb);
+
+        if (res == ESP_OK) {
+            self->_frames++;
+        }
+    }
+
+    self->_streaming = false;
+    return res;
+}
+
+#if CONFIG_HTTPD_WS_SUPPORT
+esp_err_t PreviewServer::_eventsHandler(httpd_req_t *req)
+{
+    PreviewServer *self = (PreviewServer *)req->user_ctx;
+    if (req->method == HTTP_GET) {
+        self->_listeners++; // Handshake, messages start with the next publish()
+        return ESP_OK;
+    }
+
+    // Nothing is expected from the page, frames from it are read and dropped
+    httpd_ws_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    esp_err_t res = httpd_ws_recv_frame(req, &frame, 0);
+    if (res != ESP_OK || frame.len == 0) {
+        return res;
+    }
+    uint8_t payload[32];
+    while (frame.len > 0 && res == ESP_OK) {
+        const size_t length = frame.len < sizeof(payload) ? frame.len : sizeof(payload);
+        frame.payload = payload;
+        res = httpd_ws_recv_frame(req, &frame, length);
+        frame.len -= length;
+    }
+    return res;
+}
+
+void PreviewServer::_broadcast(void *arg)
+{
+    message_t *message = (message_t *)arg;
+
+    httpd_ws_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.final = true;
+    frame.type = HTTPD_WS_TYPE_TEXT;
+    frame.payload = (uint8_t *)message->text;
+    frame.len = message->length;
+
+    int fds[CONFIG_LWIP_MAX_SOCKETS];
+    size_t count = CONFIG_LWIP_MAX_SOCKETS;
+    int listeners = 0;
+    if (httpd_get_client_list(message->handle, &count, fds) == ESP_OK) {
+        for (size_t i = 0; i < count; i++) {
+            if (httpd_ws_get_fd_info(message->handle, fds[i]) ==
+                    HTTPD_WS_CLIENT_WEBSOCKET &&
+                httpd_ws_send_frame_async(message->handle, fds[i], &frame) ==
+                    ESP_OK) {
+                listeners++;
+            }
+        }
+    }
+    // Pages that were closed stop the messages until one opens again
+    message->server->_listeners = listeners;
+
+    free(message);
+}
+#else
+esp_err_t PreviewServer::_eventsHandler(httpd_req_t *req)
+{
+    return httpd_resp_send_404(req);
+}
+
+void PreviewServer::_broadcast(void *message)
+{
+    free(message);
+}
+#endif
@@ -0,0 +1,89 @@
+#include "ResultCache.hpp"
+
+#include <math.h>
+#include <string.h>
+
+ResultCache::ResultCache()
+    : _clock(0), _hits(0), _misses(0), _maxCellDelta(0.0f), _weightBucket(1.0f),
+      _ttlMs(0)
+{
+    clear();
+}
+
+void ResultCache::configure(float maxCellDelta, float weightBucket,
+                            uint32_t ttlMs)
+{
+    _maxCellDelta = maxCellDelta;
+    _weightBucket = weightBucket > 0 ? weightBucket : 1.0f;
+    _ttlMs = ttlMs;
+    clear();
+}
+
+int32_t ResultCache::weightBucket(float grams) const
+{
+    if (grams < 0) {
+        return NO_WEIGHT;
+    }
+    return (int32_t)lroundf(grams / _weightBucket);
+}
+
+bool ResultCache::lookup(const FrameGate::stats_t &signature,
+                         int32_t weightBucket, uint32_t nowMs, char *label,
+                         float &calories)
+{
+    for (int i = 0; i < ENTRIES; i++) {
+        entry_t &entry = _entries[i];
+        if (entry.valid && _ttlMs > 0 && nowMs - entry.storedMs >= _ttlMs) {
+            entry.valid = false; // Expired, free for the next store()
+        }
+        if (!entry.valid || entry.weightBucket != weightBucket) {
+            continue;
+        }
+        // Cheap check on the mean first, the cell by cell compare only when
+        // the scene may be the same
+        if (fabsf(signature.mean - entry.signature.mean) > 4 * _maxCellDelta ||
+            FrameGate::thumbnailDelta(signature, entry.signature) >
+                _maxCellDelta) {
+            continue;
+        }
+
+        entry.lastUsed = ++_clock;
+        strcpy(label, entry.label);
+        calories = entry.calories;
+        _hits++;
+        return true;
+    }
+
+    _misses++;
+    return false;
+}
+
+void ResultCache::store(const FrameGate::stats_t &signature,
+                        int32_t weightBucket, uint32_t nowMs,
+                        const char *label, float calories)
+{
+    entry_t *target = &_entries[0];
+    for (int i = 0; i < ENTRIES; i++) {
+        if (!_entries[i].valid) {
+            target = &_entries[i];
+            break;
+        }
+        if (_entries[i].lastUsed < target->lastUsed) {
+            target = &_entries[i];
+        }
+    }
+
+    target->valid = true;
+    target->lastUsed = ++_clock;
+    target->storedMs = nowMs;
+    target->weightBucket = weightBucket;
+    target->signature = signature;
+    strncpy(target->label, label, MAX_LABEL_LENGTH - 1);
+    target->label[MAX_LABEL_LENGTH - 1] = '\0';
+    target->calories = calories;
+}
+
+void ResultCache::clear()
+{
+    memset(_entries, 0, sizeof(_entries));
+}
@@ -1,6 +1,15 @@
 #include "SDReader.hpp"
 #include "SD_MMC.h"
 
+static const char *WIFI_CACHE_PATH = "/wifi.cache";
+static const char *NUTRITION_PATH = "/nutrition.db";
+static const char *NUTRITION_UPDATE_PATH = "/nutrition.tmp";
+
+SDReader::SDReader()
+{
+    _nutritionLock = xSemaphoreCreateMutexStatic(&_nutritionLockBuffer);
+}
+
 // Initialize SD card and create the default config file if necessary
 SDReader::err_sd_t SDReader::init()
 {
@@ -24,47 +33,48 @@ SDReader::err_sd_t SDReader::init()
     return SD_OK;
 }
 
-// Read and parse the configuration file into a WiFiConfig object
-SDReader::err_read_config_t SDReader::readConfig(WiFiConfig &config)
+// Entries of config.txt go to the WiFi configuration or the settings
+typedef struct {
+    WiFiConfig *wifi;
+    settings_t *settings;
+} config_target_t;
+
+static bool setConfigEntry(void *context, ConfigParser::token_t key,
+                           ConfigParser::token_t value)
+{
+    config_target_t *target = (config_target_t *)context;
+    return ConfigParser::setWiFi(*target->wifi, key, value) ||
+           ConfigParser::setSetting(*target->settings, key, value);
+}
+
+// Read and parse the configuration file into a WiFiConfig object and the
+// runtime settings
+SDReader::err_read_config_t SDReader::readConfig(WiFiConfig &config,
+                                                 settings_t &settings)
 {
-    String configFileContent = readFile("/config.txt");
-    if (configFileContent.isEmpty()) {
-        return RC_BAD_WIFI_CONFIG; // Return error if the file is empty or
-                                   // cannot be read
+    File file = SD_MMC.open("/config.txt", FILE_READ);
+    if (!file) {
+        return RC_BAD_WIFI_CONFIG; // Return error if the file cannot be read
     }
 
-    // Split the file content into lines
-    String lines[5];
-    int index = 0;
-
-    while (configFileContent.length() > 0 && index < 5) {
-        int endOfLine = configFileContent.indexOf('\n');
-        if (endOfLine == -1) { // Handle the last line
-            lines[index++] = configFileContent;
-            break;
-        } else {
-            lines[index++] = configFileContent.substring(0, endOfLine);
-            configFileContent = configFileContent.substring(endOfLine + 1);
+    // Parsed where it was read, a config larger than the buffer loses its
+    // last, partial line
+    static char text[CONFIG_MAX_SIZE];
+    size_t length = file.read((uint8_t *)text, sizeof(text));
+    if (length == sizeof(text) && file.available()) {
+        while (length > 0 && text[length - 1] != '\n') {
+            length--;
         }
     }
+    file.close();
 
-    // Parse the lines
-    for (int i = 0; i < index; i++) {
-        lines[i].trim(); // Remove any whitespace or newline characters
-
-        if (lines[i].startsWith("SSID=")) {
-            config.ssid = lines[i].substring(5).c_str();
-        } else if (lines[i].startsWith("Password=")) {
-            config.password = lines[i].substring(9).c_str();
-        } else if (lines[i].startsWith("Gateway=")) {
-            config.gateway = lines[i].substring(8).c_str();
-        } else if (lines[i].startsWith("IP=")) {
-            config.ip = lines[i].substring(3).c_str();
-        } else if (lines[i].startsWith("MASK=")) {
-            config.mask = lines[i].substring(5).c_str();
-        }
+    if (length == 0) {
+        return RC_BAD_WIFI_CONFIG; // Return error if the file is empty
     }
 
+    config_target_t target = {&config, &settings};
+    ConfigParser::parse(text, length, setConfigEntry, &target);
+
     return RC_OK; // Successfully parsed the config
 }
 
@@ -80,3 +90,126 @@ String SDReader::readFile(String path)
     file.close();                           // Ensure the file is closed
     return fileContent;
 }
+
+bool SDReader::readWiFiCache(wifi_cache_t &cache)
+{
+    File file = SD_MMC.open(WIFI_CACHE_PATH, FILE_READ);
+    if (!file) {
+        return false;
+    }
+
+    bool read = file.read((uint8_t *)&cache, sizeof(cache)) == sizeof(cache);
+    file.close();
+    return read && cache.magic == WIFI_CACHE_MAGIC;
+}
+
+bool SDReader::writeWiFiCache(const wifi_cache_t &cache)
+{
+    File file = SD_MMC.open(WIFI_CACHE_PATH, FILE_WRITE);
+    if (!file) {
+        return false;
+    }
+
+    bool written =
+        file.write((const uint8_t *)&cache, sizeof(cache)) == sizeof(cache);
+    file.close();
+    return written;
+}
+
+SDReader::err_nutrition_t SDReader::openNutrition()
+{
+    xSemaphoreTake(_nutritionLock, portMAX_DELAY);
+    err_nutrition_t err = _openNutrition();
+    xSemaphoreGive(_nutritionLock);
+    return err;
+}
+
+bool SDReader::lookupCalories(const char *name, float &calories)
+{
+    xSemaphoreTake(_nutritionLock, portMAX_DELAY);
+    bool found = _nutrition.lookup(name, calories);
+    xSemaphoreGive(_nutritionLock);
+    return found;
+}
+
+uint32_t SDReader::nutritionRevision()
+{
+    xSemaphoreTake(_nutritionLock, portMAX_DELAY);
+    uint32_t revision = _nutrition.revision();
+    xSemaphoreGive(_nutritionLock);
+    return revision;
+}
+
+SDReader::err_nutrition_t
+SDReader::updateNutrition(uint32_t revision,
+                          const std::vector<NutritionDB::food_t> &delta)
+{
+    // The foods of the current table, read through a file and index of their
+    // own so lookups are not held up
+    std::vector<NutritionDB::food_t> foods;
+    File current = SD_MMC.open(NUTRITION_PATH, FILE_READ);
+    if (current) {
+        NutritionDB table;
+        if (table.open(_readNutrition, &current) == NutritionDB::NDB_OK) {
+            table.readAll(foods);
+        }
+        current.close();
+    }
+    foods.insert(foods.end(), delta.begin(), delta.end());
+
+    File update = SD_MMC.open(NUTRITION_UPDATE_PATH, FILE_WRITE);
+    if (!update) {
+        return NUTRITION_ERR_WRITE;
+    }
+    NutritionDB::err_ndb_t written =
+        NutritionDB::write(_writeNutrition, &update, revision, foods);
+    update.close();
+    if (written != NutritionDB::NDB_OK) {
+        SD_MMC.remove(NUTRITION_UPDATE_PATH);
+        return NUTRITION_ERR_WRITE;
+    }
+
+    xSemaphoreTake(_nutritionLock, portMAX_DELAY);
+    _nutrition.close();
+    _nutritionFile.close();
+    SD_MMC.remove(NUTRITION_PATH);
+    SD_MMC.rename(NUTRITION_UPDATE_PATH, NUTRITION_PATH);
+    err_nutrition_t err = _openNutrition();
+    xSemaphoreGive(_nutritionLock);
+    return err;
+}
+
+bool SDReader::_readNutrition(void *file, uint32_t offset, void *data,
+                              size_t length)
+{
+    File *f = (File *)file;
+    return f->seek(offset) && f->read((uint8_t *)data, length) == length;
+}
+
+bool SDReader::_writeNutrition(void *file, const void *data, size_t length)
+{
+    File *f = (File *)file;
+    return f->write((const uint8_t *)data, length) == length;
+}
+
+// Called with _nutritionLock held
+SDReader::err_nutrition_t SDReader::_openNutrition()
+{
+    _nutrition.close();
+    if (_nutritionFile) {
+        _nutritionFile.close();
+    }
+
+    _nutritionFile = SD_MMC.open(NUTRITION_PATH, FILE_READ);
+    if (!_nutritionFile) {
+        return NUTRITION_ERR_NO_FILE;
+    }
+
+    if (_nutrition.open(_readNutrition, &_nutritionFile) !=
+        NutritionDB::NDB_OK) {
+        _nutritionFile.close();
+        return NUTRITION_ERR_FORMAT;
+    }
+
+    return NUTRITION_OK;
+}
@@ -0,0 +1,48 @@
+#include "Signal.hpp"
+
+#if !defined(ESP_PLATFORM)
+#include <chrono>
+#endif
+
+Signal::Signal()
+#if defined(ESP_PLATFORM)
+{
+    _handle = xSemaphoreCreateBinaryStatic(&_buffer);
+}
+#else
+    : _notified(false)
+{
+}
+#endif
+
+Signal::~Signal()
+{
+#if defined(ESP_PLATFORM)
+    vSemaphoreDelete(_handle);
+#endif
+}
+
+void Signal::notify()
+{
+#if defined(ESP_PLATFORM)
+    xSemaphoreGive(_handle);
+#else
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _notified = true;
+    }
+    _condition.notify_one();
+#endif
+}
+
+void Signal::wait(uint32_t timeoutMs)
+{
+#if defined(ESP_PLATFORM)
+    xSemaphoreTake(_handle, pdMS_TO_TICKS(timeoutMs));
+#else
+    std::unique_lock<std::mutex> lock(_mutex);
+    _condition.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                        [this] { return _notified; });
+    _notified = false;
+#endif
+}
@@ -2,7 +2,13 @@
 #include "WiFiConfig.hpp"
 
 #include "APIHandler.hpp"
+#include "CameraController.hpp"
+#include "CaptureLog.hpp"
+#include "CapturePipeline.hpp"
 #include "CommandHandler.hpp"
+#include "FrameGate.hpp"
+#include "PreviewServer.hpp"
+#include "ResultCache.hpp"
 
 #include "config.h"
 #include "edge-impulse-sdk/dsp/image/image.hpp"
@@ -16,8 +22,6 @@
 #include "camera_pins.h"
 
 /* Constant defines -------------------------------------------------------- */
-#define EI_CAMERA_RAW_FRAME_BUFFER_COLS 320
-#define EI_CAMERA_RAW_FRAME_BUFFER_ROWS 240
 #define EI_CAMERA_FRAME_BYTE_SIZE 3
 
 // Instantiate CommandHandler for communication with ESP32
@@ -25,16 +29,64 @@ CommandHandler commandHandler(Serial);
 
 SDReader sdReader;
 APIHandler apiHandler;
+FrameGate frameGate;
+ResultCache resultCache;
+CapturePipeline pipeline;
+CaptureLog captureLog;
+PreviewServer preview;
 
 status_t status = STATUS_BOOT;
 
+settings_t settings; // config.h defaults, then config.txt at INIT
+
+// Size of the frames the camera delivers, set by ei_camera_init() and
+// ei_camera_apply_mode()
+static uint32_t rawFrameCols = CAMERA_FRAME_WIDTH;
+static uint32_t rawFrameRows = CAMERA_FRAME_HEIGHT;
+// Size the camera was set up with, no frame is larger
+static uint32_t maxFrameCols = CAMERA_FRAME_WIDTH;
+static uint32_t maxFrameRows = CAMERA_FRAME_HEIGHT;
+
+CameraController cameraController;
+static bool cameraModeChanged = false; // applied at the next CAPTURE
+
 camera_config_t cameraConfig;
 
 static bool debug_nn = false; // Set this to true to see e.g. features generated
                               // from the raw signal
 static bool is_initialised = false;
 
-uint8_t *snapshot_buf; // points to the output of the capture
+uint8_t *snapshot_buf;  // points to the output of the capture
+uint8_t *inference_buf; // frame read by the signal of run_classifier
+
+#if defined(CASCADE_IMPULSE)
+// Second stage of the cascade, CASCADE_IMPULSE names the handle of a second
+// (classification) impulse deployed next to the FOMO one
+static const ei_cascade_config_t cascadeConfig = {
+    CASCADE_CONTEXT, CASCADE_MIN_CROP, CASCADE_MAX_CROPS, CASCADE_MIN_VALUE};
+static uint8_t *cascade_frame_buf; // full resolution frame the crops come from
+static uint8_t *cascade_crop_buf;  // one crop, at the second stage input size
+#endif
+
+#if EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_FOMO
+static ei_fomo_fusion_t streamFusion; // FOMO evidence across streamed frames
+#endif
+// Milliseconds spent in each phase of INIT, see handleBootStats()
+typedef struct {
+    uint32_t sd;
+    uint32_t config;
+    uint32_t wifi;
+    uint32_t camera;
+    uint32_t model;
+    uint32_t ready;
+    uint32_t ping;
+} boot_times_t;
+static boot_times_t bootTimes;
+static std::atomic<int> apiPing(0); // Response to the ping, 0 until it is in
+
+static char streamLabel[CapturePipeline::MAX_LABEL_LENGTH]; // last one sent
+static char lookupLabel[CapturePipeline::MAX_LABEL_LENGTH]; // last one looked up
+static float lookupLabelCalories;
 
 // ------- Prototypes ------------------------------------------------------- //
 uint8_t *allocateSnapshotBuffer();
@@ -43,6 +95,17 @@ bool processImage(uint8_t *snapshot_buf, int &detected);
 void handleBoundingBox(const ei_impulse_result_bounding_box_t &bb);
 // void logError(const String &message, int code = 0);
 void handleCapture(const String &command);
+void handleTare(const String &command);
+void handleGateStats(const String &command);
+void handleStream(const String &command);
+void handlePipelineStats(const String &command);
+void stopStream();
+bool lookupCalories(const char *label, float &calories);
+void ei_camera_apply_mode();
+void networkTask(void *arg);
+void handleBootStats(const String &command);
+void handleLogStats(const String &command);
+void handlePreviewStats(const String &command);
 
 static camera_config_t camera_config = {
     .pin_pwdn = PWDN_GPIO_NUM,
@@ -77,8 +140,25 @@ static camera_config_t camera_config = {
         1, // if more than one, i2s runs in continuous mode. Use only with JPEG
     .fb_location = CAMERA_FB_IN_PSRAM,
     .grab_mode = CAMERA_GRAB_WHEN_EMPTY,
+    .sccb_i2c_port = 0, // Only used without the SCCB pins
 };
 
+// Camera frame size of a width and height from the settings, QVGA for one
+// ConfigParser would not have let through
+static framesize_t ei_camera_frame_size(uint16_t width, uint16_t height)
+{
+    static const framesize_t sizes[] = {FRAMESIZE_QQVGA, FRAMESIZE_HQVGA,
+                                        FRAMESIZE_QVGA, FRAMESIZE_CIF,
+                                        FRAMESIZE_VGA};
+    for (framesize_t size : sizes) {
+        if (resolution[size].width == width &&
+            resolution[size].height == height) {
+            return size;
+        }
+    }
+    return FRAMESIZE_QVGA;
+}
+
 bool ei_camera_init(void)
 {
 
@@ -90,12 +170,24 @@ bool ei_camera_init(void)
     pinMode(14, INPUT_PULLUP);
 #endif
 
+    camera_config.frame_size =
+        ei_camera_frame_size(settings.frameWidth, settings.frameHeight);
+    camera_config.jpeg_quality = settings.jpegQuality;
+    if (settings.preview) {
+        // One frame buffer for the preview to send from while CAPTURE takes
+        // the other
+        camera_config.fb_count = 2;
+        camera_config.grab_mode = CAMERA_GRAB_LATEST;
+    }
+
     // initialize the camera
     esp_err_t err = esp_camera_init(&camera_config);
     if (err != ESP_OK) {
         Serial.printf("Camera init failed with error 0x%x\n", err);
         return false;
     }
+    rawFrameCols = maxFrameCols = resolution[camera_config.frame_size].width;
+    rawFrameRows = maxFrameRows = resolution[camera_config.frame_size].height;
 
     sensor_t *s = esp_camera_sensor_get();
     // initial sensors are flipped vertically and colors are a bit saturated
@@ -114,11 +206,64 @@ bool ei_camera_init(void)
     s->set_awb_gain(s, 1);
 #endif
 
+    if (settings.adaptiveCamera) {
+        CameraController::policy_t policy;
+        policy.inputWidth = EI_CLASSIFIER_INPUT_WIDTH;
+        policy.inputHeight = EI_CLASSIFIER_INPUT_HEIGHT;
+        policy.maxWidth = maxFrameCols;
+        policy.maxHeight = maxFrameRows;
+        policy.bestQuality = settings.jpegQuality;
+        policy.qualityFloor = settings.qualityFloor > settings.jpegQuality
+                                  ? settings.qualityFloor
+                                  : settings.jpegQuality;
+        policy.frameBudgetUs = CAMERA_FRAME_BUDGET_US;
+        policy.acceptConfidence = FUSION_ACCEPT_CONFIDENCE;
+        policy.confidentStreak = CAMERA_CONFIDENT_STREAK;
+        cameraController.configure(policy);
+        ei_camera_apply_mode();
+    }
+
     is_initialised = true;
     return true;
 }
 
-void handleHello(const String &command)
+// Mode of the adaptive camera, between CAPTUREs. Set up at the largest frame,
+// the camera's buffers fit any of them.
+void ei_camera_apply_mode()
+{
+    const CameraController::mode_t &mode = cameraController.mode();
+    const framesize_t size = ei_camera_frame_size(mode.width, mode.height);
+    sensor_t *s = esp_camera_sensor_get();
+    s->set_framesize(s, size);
+    s->set_quality(s, mode.quality);
+    s->set_xclk(s, LEDC_TIMER_0, mode.xclkHz / 1000000);
+    rawFrameCols = resolution[size].width;
+    rawFrameRows = resolution[size].height;
+}
+
+// Width and height in the SOF marker of a JPEG
+static bool ei_jpeg_size(const uint8_t *jpeg, size_t length, uint16_t &width,
+                         uint16_t &height)
+{
+    size_t i = 2; // After SOI
+    while (i + 9 < length && jpeg[i] == 0xFF) {
+        const uint8_t marker = jpeg[i + 1];
+        if (marker == 0xFF) {
+            i++; // Fill byte
+            continue;
+        }
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 &&
+            marker != 0xC8 && marker != 0xCC) {
+            height = (jpeg[i + 5] << 8) | jpeg[i + 6];
+            width = (jpeg[i + 7] << 8) | jpeg[i + 8];
+            return true;
+        }
+        i += 2 + ((jpeg[i + 2] << 8) | jpeg[i + 3]);
+    }
+    return false;
+}
+
+void handleHello(const String &)
 {
     commandHandler.sendCommand("READY");
 
@@ -127,7 +272,7 @@ void handleHello(const String &command)
     }
 }
 
-void handleReady(const String &command)
+void handleReady(const String &)
 {
     if (status == STATUS_BOOT) {
         status = STATUS_SYNCED;
@@ -135,13 +280,15 @@ void handleReady(const String &command)
     }
 }
 
-void handleInit(const String &command)
+void handleInit(const String &)
 {
     if (status != STATUS_SYNCED) {
         return;
     }
 
     status = STATUS_INIT;
+    const unsigned long initStart = millis();
+    unsigned long phaseStart = initStart;
 
     SDReader::err_sd_t err = sdReader.init();
 
@@ -155,21 +302,63 @@ void handleInit(const String &command)
         commandHandler.sendCommand("CONFIG_FILE_NOT_CREATED");
         status = STATUS_CONFIG_FILE_NOT_CREATED;
         return;
+    case SDReader::err_sd_t::SD_OK:
+        break;
     }
 
+    // No table yet is fine, the sync builds one
+    sdReader.openNutrition();
+    bootTimes.sd = millis() - phaseStart;
+    phaseStart = millis();
+
     // Read WiFi configuration
     WiFiConfig wifiConfig;
 
-    SDReader::err_read_config_t readConfErr = sdReader.readConfig(wifiConfig);
+    SDReader::err_read_config_t readConfErr =
+        sdReader.readConfig(wifiConfig, settings);
 
     switch (readConfErr) {
     case SDReader::err_read_config_t::RC_BAD_WIFI_CONFIG:
         commandHandler.sendCommand("BAD_WIFI_CONF");
         status = STATUS_BAD_WIFI_CONF;
         return;
+    case SDReader::err_read_config_t::RC_OK:
+        break;
     }
 
-    APIHandler::err_wifi_t api_err = apiHandler.init(wifiConfig);
+    apiHandler.setURL(String(settings.apiUrl.c_str()));
+    resultCache.configure(CACHE_MAX_CELL_DELTA, settings.weightWindow,
+                          settings.cacheTtlMs);
+    if (settings.captureLog && !captureLog.running()) {
+        // CAPTURE works without it, LOG_STATS shows whether it runs
+        captureLog.start(CAPTURE_LOG_DIR, CAPTURE_LOG_FILE_BYTES);
+    }
+
+    wifi_cache_t wifiCache;
+    const bool cached = sdReader.readWiFiCache(wifiCache);
+    bootTimes.config = millis() - phaseStart;
+
+    // WiFi associates in the background while the camera and the model are
+    // set up here
+    const unsigned long wifiStart = millis();
+    APIHandler::err_wifi_t api_err =
+        apiHandler.begin(wifiConfig, cached ? &wifiCache : nullptr);
+
+    phaseStart = millis();
+    bool camInit = ei_camera_init();
+    bootTimes.camera = millis() - phaseStart;
+
+    // The tensor arena and the kernel data stay set up from here on, the
+    // first CAPTURE does not wait for them. Should it fail, every run sets
+    // the model up itself as before.
+    phaseStart = millis();
+    run_classifier_keep_model();
+    bootTimes.model = millis() - phaseStart;
+
+    if (api_err == APIHandler::err_wifi_t::WIFI_OK) {
+        api_err = apiHandler.waitConnected(wifiConfig);
+    }
+    bootTimes.wifi = millis() - wifiStart;
 
     if (api_err == APIHandler::err_wifi_t::WIFI_ERR) {
         commandHandler.sendCommand("NO_WIFI_CONN");
@@ -177,7 +366,6 @@ void handleInit(const String &command)
         return;
     }
 
-    bool camInit = ei_camera_init();
     if (!camInit) {
         esp_camera_deinit();
         // Serial.printf("ERROR: Camera init failed with error 0x%x\n", camErr);
@@ -186,37 +374,105 @@ void handleInit(const String &command)
         return;
     }
 
-    sensor_t *s = esp_camera_sensor_get();
-    // initial sensors are flipped vertically and colors are a bit saturated
-    if (s->id.PID == OV3660_PID) {
-        s->set_vflip(s, 1);      // flip it back
-        s->set_brightness(s, 1); // up the brightness just a bit
-        s->set_saturation(s, 0); // lower the saturation
+    is_initialised = true;
+
+    // Written only when the network moved, not on every boot
+    wifi_cache_t connected;
+    apiHandler.connectionCache(wifiConfig, connected);
+    if (!cached || memcmp(&connected, &wifiCache, sizeof(connected)) != 0) {
+        sdReader.writeWiFiCache(connected);
     }
 
-    is_initialised = true;
+    // The API is pinged by the network task, loop() reports NO_INTERNET if
+    // it does not answer
+    commandHandler.sendCommand("INIT_SUCCESS");
+    status = STATUS_READY;
+    bootTimes.ready = millis() - initStart;
 
-    APIHandler::api_response_code_t response = apiHandler.pingAPI();
+    if (settings.preview && !preview.running()) {
+        preview.begin(PREVIEW_FRAME_INTERVAL_MS);
+    }
 
-    // Serial.println("API response: " + String(response));
+    static TaskHandle_t networkTaskHandle = nullptr;
+    if (networkTaskHandle == nullptr) {
+        xTaskCreatePinnedToCore(networkTask, "network",
+                                NETWORK_TASK_STACK, nullptr,
+                                tskIDLE_PRIORITY, &networkTaskHandle, 0);
+    }
+}
 
-    if (response != 200) {
-        commandHandler.sendCommand("NO_INTERNET");
-        status = STATUS_NO_INTERNET;
-        return;
+// Report how long each INIT phase took, in ms. The camera and the model are
+// set up while WiFi connects, ready is the time to INIT_SUCCESS and ping
+// comes after it.
+void handleBootStats(const String &)
+{
+    commandHandler.sendCommand(
+        "BOOT_STATS", String(bootTimes.sd) + " " + String(bootTimes.config) +
+                          " " + String(bootTimes.wifi) + " " +
+                          String(bootTimes.camera) + " " +
+                          String(bootTimes.model) + " " +
+                          String(bootTimes.ready) + " " +
+                          String(bootTimes.ping));
+}
+
+// Calories of a food, from the SD table when it has the food, so a capture
+// needs no network in the common case
+bool lookupCalories(const char *label, float &calories)
+{
+    if (sdReader.lookupCalories(label, calories)) {
+        return true;
     }
+    return apiHandler.fetchData(label, calories) == 200;
+}
 
-    commandHandler.sendCommand("INIT_SUCCESS");
-    status = STATUS_READY;
+// Network work off the capture path, at idle priority on core 0 next to
+// WiFi: the API ping of INIT, then pulling what changed in the API data into
+// the SD table, page by page, and rebuilding the table once.
+void networkTask(void *)
+{
+    const unsigned long pingStart = millis();
+    const int response = apiHandler.pingAPI();
+    bootTimes.ping = millis() - pingStart;
+    apiPing = response;
+
+    for (;;) {
+        const uint32_t since = sdReader.nutritionRevision();
+        uint32_t revision = since;
+        std::vector<NutritionDB::food_t> delta;
+
+        while (delta.size() < NutritionDB::MAX_RECORDS) {
+            const size_t before = delta.size();
+            uint32_t next = revision;
+            if (apiHandler.fetchNutritionDelta(revision, NUTRITION_SYNC_PAGE,
+                                               next, delta) != 200) {
+                break;
+            }
+            revision = next;
+            if (delta.size() - before < NUTRITION_SYNC_PAGE) {
+                break; // Last page
+            }
+        }
+
+        // Pages fetched before a failure are still applied, the next round
+        // picks up from the revision they got to
+        if (revision != since) {
+            sdReader.updateNutrition(revision, delta);
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(NUTRITION_SYNC_INTERVAL_MS));
+    }
 }
 
-void statusHandler(const String &command)
+void statusHandler(const String &)
 {
     commandHandler.sendCommand("STATUS", String(status));
 }
 
+// full_buf, if given, keeps the decoded frame at full resolution; keep_fb,
+// if given, gets the camera frame (its JPEG) to return to the camera later
 bool ei_camera_capture(uint32_t img_width, uint32_t img_height,
-                       uint8_t *out_buf)
+                       uint8_t *out_buf, uint8_t *full_buf = nullptr,
+                       camera_fb_t **keep_fb = nullptr)
 {
     bool do_resize = false;
 
@@ -225,31 +481,56 @@ bool ei_camera_capture(uint32_t img_width, uint32_t img_height,
         return false;
     }
 
-    camera_fb_t *fb = esp_camera_fb_get();
+    // Frames taken before a frame size change are still of the old size,
+    // they are skipped instead of being decoded past the buffers
+    camera_fb_t *fb = nullptr;
+    for (int attempt = 0; attempt < 3; attempt++) {
+        fb = esp_camera_fb_get();
+        uint16_t width, height;
+        if (fb == nullptr ||
+            (ei_jpeg_size(fb->buf, fb->len, width, height) &&
+             width == rawFrameCols && height == rawFrameRows)) {
+            break;
+        }
+        esp_camera_fb_return(fb);
+        fb = nullptr;
+    }
 
     if (!fb) {
         ei_printf("Camera capture failed\n");
         return false;
     }
 
-    bool converted = fmt2rgb888(fb->buf, fb->len, PIXFORMAT_JPEG, snapshot_buf);
+    uint8_t *decoded = full_buf != nullptr ? full_buf : snapshot_buf;
+    bool converted = fmt2rgb888(fb->buf, fb->len, PIXFORMAT_JPEG, decoded);
 
-    esp_camera_fb_return(fb);
+    if (keep_fb != nullptr && converted) {
+        *keep_fb = fb;
+    } else {
+        esp_camera_fb_return(fb);
+    }
 
     if (!converted) {
         ei_printf("Conversion failed\n");
         return false;
     }
 
-    if ((img_width != EI_CAMERA_RAW_FRAME_BUFFER_COLS) ||
-        (img_height != EI_CAMERA_RAW_FRAME_BUFFER_ROWS)) {
+    if ((img_width != rawFrameCols) || (img_height != rawFrameRows)) {
         do_resize = true;
     }
 
     if (do_resize) {
+        // Into snapshot_buf: the crop is written out before it is scaled
+        // down, only a full size buffer has room for it
         ei::image::processing::crop_and_interpolate_rgb888(
-            out_buf, EI_CAMERA_RAW_FRAME_BUFFER_COLS,
-            EI_CAMERA_RAW_FRAME_BUFFER_ROWS, out_buf, img_width, img_height);
+            decoded, rawFrameCols, rawFrameRows, snapshot_buf, img_width,
+            img_height);
+    } else if (decoded != snapshot_buf) {
+        memcpy(snapshot_buf, decoded, img_width * img_height * 3);
+    }
+
+    if (out_buf != snapshot_buf) {
+        memcpy(out_buf, snapshot_buf, img_width * img_height * 3);
     }
 
     return true;
@@ -265,9 +546,9 @@ static int ei_camera_get_data(size_t offset, size_t length, float *out_ptr)
     while (pixels_left != 0) {
         // Swap BGR to RGB here
         // due to https://github.com/espressif/esp32-camera/issues/379
-        out_ptr[out_ptr_ix] = (snapshot_buf[pixel_ix + 2] << 16) +
-                              (snapshot_buf[pixel_ix + 1] << 8) +
-                              snapshot_buf[pixel_ix];
+        out_ptr[out_ptr_ix] = (inference_buf[pixel_ix + 2] << 16) +
+                              (inference_buf[pixel_ix + 1] << 8) +
+                              inference_buf[pixel_ix];
 
         // go to the next pixel
         out_ptr_ix++;
@@ -278,72 +559,242 @@ static int ei_camera_get_data(size_t offset, size_t length, float *out_ptr)
     return 0;
 }
 
-static const int captureTryCount = 5;
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+// Boxes of a result as the capture log keeps them, the strongest ones when
+// there are more than it has room for
+static uint16_t ei_log_boxes(const ei_impulse_result_t &result,
+                             CaptureLog::box_t *boxes)
+{
+    uint16_t count = 0;
+    for (uint32_t i = 0; i < result.bounding_boxes_count; i++) {
+        const ei_impulse_result_bounding_box_t &bb = result.bounding_boxes[i];
+        if (bb.value == 0) {
+            continue;
+        }
+
+        uint16_t slot = count;
+        if (count == CaptureLog::MAX_BOXES) {
+            slot = 0; // Replace the weakest
+            for (uint16_t j = 1; j < count; j++) {
+                if (boxes[j].value < boxes[slot].value) {
+                    slot = j;
+                }
+            }
+            if (boxes[slot].value >= bb.value) {
+                continue;
+            }
+        } else {
+            count++;
+        }
+
+        CaptureLog::box_t &box = boxes[slot];
+        memset(&box, 0, sizeof(box));
+        strncpy(box.label, bb.label, sizeof(box.label) - 1);
+        box.value = bb.value;
+        box.x = bb.x;
+        box.y = bb.y;
+        box.width = bb.width;
+        box.height = bb.height;
+    }
+    return count;
+}
+#endif
+
+// Boxes of a result to the preview page, weight in grams or negative
+static void ei_publish_boxes(const ei_impulse_result_t &result, float weight)
+{
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+    if (!preview.running()) {
+        return;
+    }
+
+    PreviewServer::box_t boxes[PreviewServer::MAX_BOXES];
+    size_t count = 0;
+    for (uint32_t i = 0;
+         i < result.bounding_boxes_count && count < PreviewServer::MAX_BOXES;
+         i++) {
+        const ei_impulse_result_bounding_box_t &bb = result.bounding_boxes[i];
+        if (bb.value > 0) {
+            boxes[count++] = {bb.label, bb.value, bb.x, bb.y, bb.width,
+                              bb.height};
+        }
+    }
+    preview.publish(boxes, count, EI_CLASSIFIER_INPUT_WIDTH,
+                    EI_CLASSIFIER_INPUT_HEIGHT, weight);
+#endif
+}
 
 void handleCapture(const String &command)
 {
-    const int maxRetries = 5;   // Maximum number of capture retries
-    int retryCount = 0;         // Current retry attempt
-    bool labelDetected = false; // Flag to indicate if a label is detected
+    stopStream(); // The camera is needed here
+    const uint64_t captureStart = ei_read_timer_us();
 
-    while (retryCount < maxRetries && !labelDetected) {
-        retryCount++;
+    if (cameraModeChanged) {
+        ei_camera_apply_mode(); // Before the buffers are sized for the frames
+        cameraModeChanged = false;
+    }
 
-        // Allocate memory for the snapshot buffer
-        snapshot_buf = (uint8_t *)malloc(EI_CAMERA_RAW_FRAME_BUFFER_COLS *
-                                         EI_CAMERA_RAW_FRAME_BUFFER_ROWS *
-                                         EI_CAMERA_FRAME_BYTE_SIZE);
+    // Allocate memory for the snapshot buffer, reused for every frame
+    snapshot_buf = (uint8_t *)malloc(rawFrameCols * rawFrameRows *
+                                     EI_CAMERA_FRAME_BYTE_SIZE);
 
-        if (snapshot_buf == nullptr) {
-            // ei_printf("ERR: Failed to allocate snapshot buffer!\n");
-            commandHandler.sendCommand("CAPTURE_FAIL");
-            return; // Exit if memory allocation fails
-        }
+    if (snapshot_buf == nullptr) {
+        // ei_printf("ERR: Failed to allocate snapshot buffer!\n");
+        commandHandler.sendCommand("CAPTURE_FAIL");
+        return; // Exit if memory allocation fails
+    }
+    inference_buf = snapshot_buf;
 
-        // Set up signal data
-        ei::signal_t signal;
-        signal.total_length =
-            EI_CLASSIFIER_INPUT_WIDTH * EI_CLASSIFIER_INPUT_HEIGHT;
-        signal.get_data = &ei_camera_get_data;
+#if defined(CASCADE_IMPULSE)
+    // Kept from one CAPTURE to the next, like the fusion state
+    if (cascade_frame_buf == nullptr) {
+        cascade_frame_buf = (uint8_t *)malloc(
+            maxFrameCols * maxFrameRows * EI_CAMERA_FRAME_BYTE_SIZE);
+    }
+    if (cascade_crop_buf == nullptr) {
+        cascade_crop_buf = (uint8_t *)malloc(
+            CASCADE_IMPULSE.impulse->input_width *
+            CASCADE_IMPULSE.impulse->input_height * EI_CAMERA_FRAME_BYTE_SIZE);
+    }
+    if (cascade_frame_buf == nullptr || cascade_crop_buf == nullptr) {
+        free(snapshot_buf);
+        commandHandler.sendCommand("CAPTURE_FAIL");
+        return;
+    }
+    const ei_cascade_frame_t cascadeFrame = {
+        cascade_frame_buf, rawFrameCols, rawFrameRows, true};
+    uint8_t *full_buf = cascade_frame_buf;
+#else
+    uint8_t *full_buf = nullptr;
+#endif
+
+    // Set up signal data
+    ei::signal_t signal;
+    signal.total_length =
+        EI_CLASSIFIER_INPUT_WIDTH * EI_CLASSIFIER_INPUT_HEIGHT;
+    signal.get_data = &ei_camera_get_data;
+
+#if EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_FOMO
+    // Evidence from every frame adds up instead of being thrown away with a failed retry
+    static ei_fomo_fusion_t fusion;
+    ei_fomo_fusion_init(&fusion, FUSION_HISTORY_WEIGHT);
+    ei_fomo_fusion_t *captureFusion = &fusion;
+#else
+    ei_fomo_fusion_t *captureFusion = nullptr;
+#endif
+
+    ei_impulse_result_bounding_box_t best = {}; // Strongest box of the fused output
+
+    // The scale may send the weight on the platter along, "CAPTURE <grams>"
+    const float weight = command.isEmpty() ? -1.0f : command.toFloat();
+    const int32_t weightBucket = resultCache.weightBucket(weight);
+    // Without a weight the scene alone cannot tell a new serving from the
+    // last one, so the cache is left out
+    const bool cacheable = weightBucket != ResultCache::NO_WEIGHT;
+    FrameGate::stats_t signature;  // Scene of the first usable frame
+    bool haveSignature = false;
+
+    // The last frame, kept for the capture log while it is classified
+    camera_fb_t *logFrame = nullptr;
+    bool logFrameInferred = false;
+    bool classified = false; // Any frame
+    CaptureLog::box_t logBoxes[CaptureLog::MAX_BOXES];
+    CaptureLog::capture_t logged = {};
+    logged.weight = weight;
+    logged.boxes = logBoxes;
+
+    for (int frame = 0; frame < settings.captureFrames; frame++) {
+        if (logFrame != nullptr) {
+            esp_camera_fb_return(logFrame); // Only one frame buffer
+            logFrame = nullptr;
+        }
+        logFrameInferred = false;
 
         // Capture image
+        const uint64_t frameStart = ei_read_timer_us();
         if (!ei_camera_capture((size_t)EI_CLASSIFIER_INPUT_WIDTH,
                                (size_t)EI_CLASSIFIER_INPUT_HEIGHT,
-                               snapshot_buf)) {
+                               snapshot_buf, full_buf,
+                               captureLog.running() ? &logFrame : nullptr)) {
             commandHandler.sendCommand("CAPTURE_FAIL");
-            free(snapshot_buf);
-            continue; // Retry capture
+            continue; // Try the next frame
+        }
+        logged.captureUs = ei_read_timer_us() - frameStart;
+
+        // Skip the DSP and the network for frames not worth classifying
+        FrameGate::gate_result_t gate = frameGate.check(
+            snapshot_buf, EI_CLASSIFIER_INPUT_WIDTH, EI_CLASSIFIER_INPUT_HEIGHT);
+        if (gate == FrameGate::GATE_EMPTY_PLATE) {
+            break; // Nothing on the plate, more frames will not change that
+        }
+        if (gate != FrameGate::GATE_PASS) {
+            continue; // Exposure may settle by the next frame
+        }
+
+        if (!haveSignature) {
+            signature = frameGate.lastStats();
+            haveSignature = true;
+
+            // Same scene and weight as an earlier CAPTURE, answer from the cache
+            char label[ResultCache::MAX_LABEL_LENGTH];
+            float calories;
+            if (cacheable && resultCache.lookup(signature, weightBucket,
+                                                millis(), label, calories)) {
+                if (logFrame != nullptr) {
+                    esp_camera_fb_return(logFrame); // Logged the first time
+                }
+                free(snapshot_buf);
+                commandHandler.sendCommand("FOOD_INFO", String(label) + " " +
+                                                            String(calories));
+                return;
+            }
         }
 
         // Run the classifier
-        ei_impulse_result_t result = {0};
-        EI_IMPULSE_ERROR err = run_classifier(&signal, &result, debug_nn);
+        ei_impulse_result_t result = {};
+        const uint64_t inferStart = ei_read_timer_us();
+        const uint64_t deadline = inferStart + INFERENCE_BUDGET_US;
+#if defined(CASCADE_IMPULSE)
+        // FOMO finds the food, the second impulse names it from a full
+        // resolution crop of the strongest boxes
+        EI_IMPULSE_ERROR err = run_classifier_cascade(
+            &ei_default_impulse, &CASCADE_IMPULSE, &signal, &result,
+            &cascadeFrame, &cascadeConfig, cascade_crop_buf, nullptr, 0,
+            captureFusion, deadline, debug_nn);
+#else
+        EI_IMPULSE_ERROR err = run_classifier_with_buffers(
+            &signal, &result, nullptr, 0, captureFusion, deadline, debug_nn);
+#endif
+
+        if (err == EI_IMPULSE_CANCELED) {
+            // Over budget, a fresh frame is better than a late answer
+            continue;
+        }
 
         if (err != EI_IMPULSE_OK) {
             commandHandler.sendCommand("AI_FAIL");
-            free(snapshot_buf);
-            continue; // Retry if classification fails
+            continue; // Try the next frame
         }
 
+        logged.inferUs = ei_read_timer_us() - inferStart;
+        ei_publish_boxes(result, weight);
 #if EI_CLASSIFIER_OBJECT_DETECTION == 1
+        logged.boxCount = ei_log_boxes(result, logBoxes);
+#endif
+        logFrameInferred = true;
+        classified = true;
+
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+        // Boxes describe all frames so far, keep the strongest
+        best.value = 0;
         for (uint32_t i = 0; i < result.bounding_boxes_count; i++) {
-            ei_impulse_result_bounding_box_t bb = result.bounding_boxes[i];
-            if (bb.value == 0) {
-                continue; // Skip bounding boxes with zero value
+            if (result.bounding_boxes[i].value > best.value) {
+                best = result.bounding_boxes[i];
             }
+        }
 
-            // Stop retries as a label is detected
-            labelDetected = true;
-
-            // Process the detected label (e.g., fetch additional data)
-            float calories;
-            if (apiHandler.fetchData(bb.label, calories)) {
-                String args = String(bb.label) + " " + String(calories);
-                commandHandler.sendCommand("FOOD_INFO", args);
-            } else {
-                commandHandler.sendCommand("CAPTURE_FAIL");
-            }
-            break; // Stop processing further bounding boxes
+        if (best.value >= FUSION_ACCEPT_CONFIDENCE) {
+            break; // Confident enough, skip the remaining frames
         }
 #else
         // Handle predictions (classification mode)
@@ -372,15 +823,259 @@ void handleCapture(const String &command)
                       bb.label, bb.value, bb.x, bb.y, bb.width, bb.height);
         }
 #endif
+    }
 
-        free(snapshot_buf); // Free memory after each attempt
+    free(snapshot_buf);
+
+    // Logged before the calorie lookup, the camera gets its frame buffer back
+    // without waiting on the network
+    if (logFrame != nullptr) {
+        if (logFrameInferred) {
+            logged.jpeg = logFrame->buf;
+            logged.jpegLength = logFrame->len;
+            logged.totalUs = ei_read_timer_us() - captureStart;
+            captureLog.append(logged, millis());
+        }
+        esp_camera_fb_return(logFrame);
+    }
+
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+    // Larger frames for the next CAPTURE if this one was unsure, smaller
+    // ones after a few sure ones
+    if (settings.adaptiveCamera && classified &&
+        cameraController.update(logged.captureUs + logged.inferUs, best.value)) {
+        cameraModeChanged = true;
     }
+#endif
 
-    if (!labelDetected) {
+    if (best.value == 0 || best.value < settings.detectionThreshold) {
         commandHandler.sendCommand("FOOD_NOT_RECOG");
+        return;
+    }
+
+    // Process the detected label (e.g., fetch additional data)
+    float calories;
+    if (lookupCalories(best.label, calories)) {
+        String args = String(best.label) + " " + String(calories);
+        commandHandler.sendCommand("FOOD_INFO", args);
+        if (cacheable) {
+            resultCache.store(signature, weightBucket, millis(), best.label,
+                              calories);
+        }
+    } else {
+        commandHandler.sendCommand("CAPTURE_FAIL");
     }
 }
 
+// Store the empty platter as the reference of the frame gate, sent when the
+// scale is tared
+void handleTare(const String &)
+{
+    stopStream();
+
+    snapshot_buf = (uint8_t *)malloc(rawFrameCols * rawFrameRows *
+                                     EI_CAMERA_FRAME_BYTE_SIZE);
+
+    if (snapshot_buf == nullptr) {
+        commandHandler.sendCommand("TARE_FAIL");
+        return;
+    }
+
+    bool stored = ei_camera_capture((size_t)EI_CLASSIFIER_INPUT_WIDTH,
+                                    (size_t)EI_CLASSIFIER_INPUT_HEIGHT,
+                                    snapshot_buf) &&
+                  frameGate.setReference(snapshot_buf,
+                                         EI_CLASSIFIER_INPUT_WIDTH,
+                                         EI_CLASSIFIER_INPUT_HEIGHT);
+
+    free(snapshot_buf);
+
+    // Weights are relative to the tare, earlier recognitions no longer apply
+    resultCache.clear();
+
+    commandHandler.sendCommand(stored ? "TARE_DONE" : "TARE_FAIL");
+}
+
+// Report how many frames the gate let through and why it rejected the others
+void handleGateStats(const String &)
+{
+    const FrameGate::counters_t &c = frameGate.counters();
+    commandHandler.sendCommand(
+        "GATE_STATS", String(c.passed) + " " + String(c.tooDark) + " " +
+                          String(c.overexposed) + " " + String(c.noDetail) +
+                          " " + String(c.emptyPlate));
+}
+
+// Capture stage of the stream, on core 0. A frame of the empty platter goes
+// on without inference, so the stream can report that the food is gone.
+bool streamCapture(CapturePipeline::frame_t &frame)
+{
+    if (!ei_camera_capture((size_t)EI_CLASSIFIER_INPUT_WIDTH,
+                           (size_t)EI_CLASSIFIER_INPUT_HEIGHT, frame.pixels)) {
+        return false;
+    }
+
+    FrameGate::gate_result_t gate = frameGate.check(
+        frame.pixels, EI_CLASSIFIER_INPUT_WIDTH, EI_CLASSIFIER_INPUT_HEIGHT);
+    frame.empty = gate == FrameGate::GATE_EMPTY_PLATE;
+    return gate == FrameGate::GATE_PASS || frame.empty;
+}
+
+// Inference stage of the stream, on core 1: the strongest box, fused with the
+// frames before it
+bool streamInfer(const CapturePipeline::frame_t &frame,
+                 CapturePipeline::result_t &result)
+{
+    ei::signal_t signal;
+    signal.total_length =
+        EI_CLASSIFIER_INPUT_WIDTH * EI_CLASSIFIER_INPUT_HEIGHT;
+    signal.get_data = &ei_camera_get_data;
+    inference_buf = frame.pixels;
+
+#if EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_FOMO
+    ei_fomo_fusion_t *fusion = &streamFusion;
+#else
+    ei_fomo_fusion_t *fusion = nullptr;
+#endif
+    ei_impulse_result_t eiResult = {};
+    EI_IMPULSE_ERROR err = run_classifier_with_buffers(
+        &signal, &eiResult, nullptr, 0, fusion,
+        ei_read_timer_us() + INFERENCE_BUDGET_US, debug_nn);
+    if (err != EI_IMPULSE_OK) {
+        return false;
+    }
+    ei_publish_boxes(eiResult, -1.0f);
+
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+    for (uint32_t i = 0; i < eiResult.bounding_boxes_count; i++) {
+        const ei_impulse_result_bounding_box_t &bb = eiResult.bounding_boxes[i];
+        if (bb.value >= settings.detectionThreshold && bb.value > result.value) {
+            strncpy(result.label, bb.label, CapturePipeline::MAX_LABEL_LENGTH - 1);
+            result.value = bb.value;
+        }
+    }
+#else
+    for (uint16_t i = 0; i < EI_CLASSIFIER_LABEL_COUNT; i++) {
+        const ei_impulse_result_classification_t &c = eiResult.classification[i];
+        if (c.value >= FUSION_ACCEPT_CONFIDENCE && c.value > result.value) {
+            strncpy(result.label, c.label, CapturePipeline::MAX_LABEL_LENGTH - 1);
+            result.value = c.value;
+        }
+    }
+#endif
+
+    return true;
+}
+
+// Lookup stage of the stream, on core 0. The same food stays on the scale for
+// many frames, the API is only asked when the label changes.
+bool streamLookup(CapturePipeline::result_t &result)
+{
+    if (strcmp(result.label, lookupLabel) != 0) {
+        float calories;
+        if (!lookupCalories(result.label, calories)) {
+            return false;
+        }
+        strcpy(lookupLabel, result.label);
+        lookupLabelCalories = calories;
+    }
+
+    result.calories = lookupLabelCalories;
+    return true;
+}
+
+// STREAM ON recognises continuously, sending FOOD_INFO (or FOOD_NOT_RECOG)
+// whenever what is on the scale changes, STREAM OFF ends it
+void handleStream(const String &command)
+{
+    if (command == "OFF") {
+        stopStream();
+        commandHandler.sendCommand("STREAM_OFF");
+        return;
+    }
+
+    if (pipeline.running()) {
+        commandHandler.sendCommand("STREAM_ON");
+        return;
+    }
+
+    if (status != STATUS_READY) {
+        commandHandler.sendCommand("STREAM_FAIL");
+        return;
+    }
+
+    // Full size frame the capture stage decodes into
+    snapshot_buf = (uint8_t *)malloc(rawFrameCols * rawFrameRows *
+                                     EI_CAMERA_FRAME_BYTE_SIZE);
+    if (snapshot_buf == nullptr) {
+        commandHandler.sendCommand("STREAM_FAIL");
+        return;
+    }
+
+#if EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_FOMO
+    ei_fomo_fusion_init(&streamFusion, FUSION_HISTORY_WEIGHT);
+#endif
+    streamLabel[0] = '\0';
+    lookupLabel[0] = '\0';
+
+    CapturePipeline::err_pipeline_t err =
+        pipeline.start(EI_CLASSIFIER_INPUT_WIDTH * EI_CLASSIFIER_INPUT_HEIGHT *
+                           EI_CAMERA_FRAME_BYTE_SIZE,
+                       streamCapture, streamInfer, streamLookup);
+    if (err != CapturePipeline::PIPELINE_OK) {
+        free(snapshot_buf);
+        snapshot_buf = nullptr;
+        commandHandler.sendCommand("STREAM_FAIL");
+        return;
+    }
+
+    commandHandler.sendCommand("STREAM_ON");
+}
+
+void stopStream()
+{
+    if (!pipeline.running()) {
+        return;
+    }
+
+    pipeline.stop();
+    free(snapshot_buf);
+    snapshot_buf = nullptr;
+}
+
+// Report how many captures went to the capture log, how many it dropped and
+// how many files it finished
+void handleLogStats(const String &)
+{
+    const CaptureLog::counters_t c = captureLog.counters();
+    commandHandler.sendCommand(
+        "LOG_STATS", String(captureLog.running() ? 1 : 0) + " " +
+                         String(c.logged) + " " + String(c.dropped) + " " +
+                         String(c.written) + " " + String(c.errors) + " " +
+                         String(c.files));
+}
+
+// Report how many frames the preview sent, how many viewers it turned away
+// and how many box messages it sent
+void handlePreviewStats(const String &)
+{
+    const PreviewServer::counters_t c = preview.counters();
+    commandHandler.sendCommand(
+        "PREVIEW_STATS", String(preview.running() ? 1 : 0) + " " +
+                             String(c.frames) + " " + String(c.refused) + " " +
+                             String(c.published));
+}
+
+// Report how many frames went through the stream and how many were lost
+void handlePipelineStats(const String &)
+{
+    const CapturePipeline::counters_t c = pipeline.counters();
+    commandHandler.sendCommand(
+        "PIPELINE_STATS", String(c.captured) + " " + String(c.rejected) + " " +
+                              String(c.failed) + " " + String(c.dropped) +
+                              " " + String(c.completed));
+}
+
 void setup()
 {
     Serial.begin(115200);
@@ -396,6 +1091,38 @@ void setup()
     commandHandler.registerRoute("READY", handleReady);
     commandHandler.registerRoute("STATUS", statusHandler);
     commandHandler.registerRoute("CAPTURE", handleCapture);
+    commandHandler.registerRoute("TARE", handleTare);
+    commandHandler.registerRoute("GATE_STATS", handleGateStats);
+    commandHandler.registerRoute("STREAM", handleStream);
+    commandHandler.registerRoute("PIPELINE_STATS", handlePipelineStats);
+    commandHandler.registerRoute("BOOT_STATS", handleBootStats);
+    commandHandler.registerRoute("LOG_STATS", handleLogStats);
+    commandHandler.registerRoute("PREVIEW_STATS", handlePreviewStats);
+
+    FrameGate::policy_t gatePolicy;
+    gatePolicy.minMean = GATE_MIN_MEAN;
+    gatePolicy.maxMean = GATE_MAX_MEAN;
+    gatePolicy.maxClippedShare = GATE_MAX_CLIPPED_SHARE;
+    gatePolicy.minVariance = GATE_MIN_VARIANCE;
+    gatePolicy.minEdgeEnergy = GATE_MIN_EDGE_ENERGY;
+    gatePolicy.emptyCellDelta = GATE_EMPTY_CELL_DELTA;
+    gatePolicy.emptyEdgeDelta = GATE_EMPTY_EDGE_DELTA;
+    frameGate.setPolicy(gatePolicy);
+
+    settings.apiUrl = API_URL.c_str();
+    settings.detectionThreshold = DETECTION_THRESHOLD;
+    settings.frameWidth = CAMERA_FRAME_WIDTH;
+    settings.frameHeight = CAMERA_FRAME_HEIGHT;
+    settings.jpegQuality = CAMERA_JPEG_QUALITY;
+    settings.adaptiveCamera = CAMERA_ADAPTIVE;
+    settings.qualityFloor = CAMERA_QUALITY_FLOOR;
+    settings.captureFrames = FUSION_MAX_FRAMES;
+    settings.cacheTtlMs = CACHE_TTL_MS;
+    settings.weightWindow = CACHE_WEIGHT_BUCKET_G;
+    settings.captureLog = CAPTURE_LOG;
+    settings.preview = PREVIEW;
+    resultCache.configure(CACHE_MAX_CELL_DELTA, settings.weightWindow,
+                          settings.cacheTtlMs);
 
     commandHandler.sendCommand("HELLO");
 }
@@ -416,4 +1143,39 @@ void loop()
     if (status != STATUS_READY) {
         return; // Skip processing if the system isn't ready
     }
+
+    const int ping = apiPing.exchange(0);
+    if (ping != 0 && ping != 200) {
+        // Serial.println("API response: " + String(ping));
+        stopStream();
+        commandHandler.sendCommand("NO_INTERNET");
+        status = STATUS_NO_INTERNET;
+        return;
+    }
+
+    // Captures come far apart, do not leave them in RAM for long
+    static unsigned long lastLogFlush = 0;
+    if (captureLog.running() && millis() - lastLogFlush > CAPTURE_LOG_FLUSH_MS) {
+        lastLogFlush = millis();
+        captureLog.flush();
+    }
+
+    // Report what the stream recognises, only when it changes
+    CapturePipeline::result_t result;
+    while (pipeline.running() && pipeline.poll(result)) {
+        if (result.label[0] != '\0' && !result.found) {
+            continue; // Lookup failed, a later frame tries again
+        }
+        if (strcmp(result.label, streamLabel) == 0) {
+            continue;
+        }
+
+        strcpy(streamLabel, result.label);
+        if (result.label[0] == '\0') {
+            commandHandler.sendCommand("FOOD_NOT_RECOG");
+        } else {
+            commandHandler.sendCommand("FOOD_INFO", String(result.label) + " " +
+                                                        String(result.calories));
+        }
+    }
 }
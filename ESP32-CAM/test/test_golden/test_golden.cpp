@@ -0,0 +1,126 @@
+// Golden image regression check of tools/golden_check.cpp on the small corpus of corpus/:
+// synthetic plates, a 96x96 one that goes to the impulse as it is, and QQVGA and QVGA ones
+// that are cropped and scaled first (one of them empty). The input tensor, every layer and
+// the boxes must match corpus/golden.bin within the default tolerances.
+// The timings recorded in golden.bin only compare on the machine they were recorded on,
+// golden_check does that. Here the p50 and p95 of a run only have to stay under limits
+// generous enough for any machine the test runs on, which still catch the impulse falling
+// back to the reference kernels or setting the model up on every run.
+//
+// After a change that is meant to change the output (a new model, a DSP fix), record it again
+// from ESP32-CAM/ and commit golden.bin with it:
+//   ./golden_check --record --no-timing test/test_golden/corpus
+//
+// Run from ESP32-CAM/:
+//   pio test -e native_golden
+#include "../../tools/golden.h"
+
+#include <unity.h>
+
+namespace
+{
+
+// DSP, classification and anomaly together, a desktop takes about 60 ms
+const int64_t kMaxP50Us = 500000;
+const int64_t kMaxP95Us = 1000000;
+const int kTimedRuns = 5;
+
+// Next to this file, wherever the test is built from
+std::string fixture(const char *name)
+{
+    std::string path = __FILE__;
+    path.erase(path.rfind('/') + 1);
+    return path + name;
+}
+
+void loadRecorded(golden::Golden &recorded)
+{
+    TEST_ASSERT_TRUE_MESSAGE(golden::ReadGolden(fixture("corpus/golden.bin"), recorded),
+                             "corpus/golden.bin does not load, see stderr");
+    TEST_ASSERT_FALSE_MESSAGE(recorded.images.empty(), "corpus/golden.bin has no images");
+}
+
+} // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_corpus_is_recorded()
+{
+    golden::Golden recorded;
+    loadRecorded(recorded);
+    const std::vector<std::string> names = golden::ListJpegs(fixture("corpus"));
+    TEST_ASSERT_EQUAL_INT_MESSAGE((int)recorded.images.size(), (int)names.size(),
+                                  "corpus and golden.bin do not have the same images");
+    for (const std::string &name : names) {
+        TEST_ASSERT_TRUE_MESSAGE(golden::FindImage(recorded, name) != nullptr, name.c_str());
+    }
+}
+
+void test_corpus_matches_golden()
+{
+    golden::Golden recorded;
+    loadRecorded(recorded);
+
+    const golden::Options options;
+    ei_impulse_handle_t handle(ei_default_impulse.impulse);
+    int failures = 0, boxes = 0;
+    for (const golden::Image &expected : recorded.images) {
+        golden::Image image;
+        image.name = expected.name;
+        TEST_ASSERT_TRUE_MESSAGE(golden::LoadFrame(fixture("corpus/") + image.name),
+                                 image.name.c_str());
+        int64_t timing_us[golden::kStages];
+        TEST_ASSERT_TRUE_MESSAGE(golden::Classify(handle, image, true, timing_us),
+                                 image.name.c_str());
+
+        std::vector<std::string> report;
+        if (!golden::CompareImage(expected, image, options, report)) {
+            failures++;
+        }
+        for (const std::string &line : report) {
+            TEST_MESSAGE((image.name + ": " + line).c_str());
+        }
+        boxes += (int)expected.boxes.size();
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, failures, "images off their golden data");
+    TEST_ASSERT_TRUE_MESSAGE(boxes > 0, "no golden boxes to compare");
+}
+
+void test_corpus_timing()
+{
+    const std::vector<std::string> names = golden::ListJpegs(fixture("corpus"));
+    TEST_ASSERT_FALSE_MESSAGE(names.empty(), "no JPEGs in corpus/");
+
+    ei_impulse_handle_t handle(ei_default_impulse.impulse);
+    std::vector<int64_t> totals;
+    for (const std::string &name : names) {
+        golden::Image image;
+        image.name = name;
+        TEST_ASSERT_TRUE_MESSAGE(golden::LoadFrame(fixture("corpus/") + name), name.c_str());
+        int64_t timing_us[golden::kStages];
+        // the first run sets up the model, like the warmup at boot
+        TEST_ASSERT_TRUE_MESSAGE(golden::Classify(handle, image, false, timing_us), name.c_str());
+        for (int run = 0; run < kTimedRuns; run++) {
+            TEST_ASSERT_TRUE_MESSAGE(golden::Classify(handle, image, false, timing_us), name.c_str());
+            totals.push_back(timing_us[0] + timing_us[1] + timing_us[2]);
+        }
+    }
+
+    const int64_t p50 = golden::Percentile(totals, 50), p95 = golden::Percentile(totals, 95);
+    char line[96];
+    snprintf(line, sizeof(line), "p50 %lld us, p95 %lld us", (long long)p50, (long long)p95);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE_MESSAGE(p50 <= kMaxP50Us, line);
+    TEST_ASSERT_TRUE_MESSAGE(p95 <= kMaxP95Us, line);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_corpus_is_recorded);
+    RUN_TEST(test_corpus_matches_golden);
+    RUN_TEST(test_corpus_timing);
+    return UNITY_END();
+}
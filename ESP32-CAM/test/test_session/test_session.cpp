@@ -0,0 +1,269 @@
+// A session of the whole application on the host stand-ins of tools/host, as
+// the scale drives it: HELLO, INIT, TARE, then CAPTUREs with and without the
+// weight. Each command must get its exact reply within a time budget, and the
+// heap in use while it runs must stay under a budget. The SD card is a fresh
+// directory under /tmp with a nutrition table, WiFi takes WIFI_SCAN_MS to
+// associate.
+//
+// The camera hands out the QQVGA frames of frames/ in turn: plate_0, the empty
+// platter, then plate_1, an apple. TARE takes the platter, so CAPTUREs get the
+// apple and the platter by turns.
+//
+// No API runs: the ping of INIT fails and NO_INTERNET may come in between,
+// calories come from the nutrition table.
+//
+// Run from ESP32-CAM/:
+//   pio test -e native -f test_session
+#include "Arduino.h"
+#include "NutritionDB.hpp"
+#include "ResultCache.hpp"
+#include "SD_MMC.h"
+#include "WiFi.h"
+#include "esp_camera.h"
+#include "host_stats.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <unity.h>
+
+void setup();
+void loop();
+
+extern ResultCache resultCache;
+
+namespace
+{
+
+// Far above what a command takes on a build machine (a CAPTURE that gets to
+// the classifier: around 100 ms), for slow or busy CI runners
+const uint64_t COMMAND_BUDGET_US = 2000 * 1000;
+// A CAPTURE of a QQVGA frame peaks around 320 KB of heap on the host
+const size_t HEAP_BUDGET = 512 * 1024;
+// Association of the first INIT, without a WiFi cache yet
+const uint32_t WIFI_SCAN_MS = 150;
+
+const char CONFIG[] = "SSID=testnet\n"
+                      "Password=secret\n"
+                      "API_URL=http://127.0.0.1:9\n"
+                      "FRAME_SIZE=QQVGA\n"
+                      "ADAPTIVE_CAMERA=0\n"
+                      "CAPTURE_LOG=0\n"
+                      "PREVIEW=0\n";
+
+const NutritionDB::food_t FOODS[] = {{"apple", 52.0f}, {"banana", 89.0f}};
+
+typedef struct {
+    std::string output;
+    uint64_t us;
+    size_t heapPeak;
+} reply_t;
+
+// Next to this file, wherever the test is built from
+std::string fixture(const char *name)
+{
+    std::string path = __FILE__;
+    path.erase(path.rfind('/') + 1);
+    return path + name;
+}
+
+// Feeds one line to Serial and runs loop() once, as host_main.cpp does
+reply_t send(const char *line)
+{
+    Serial.takeOutput();
+    host_heap_reset_peak();
+
+    reply_t reply;
+    const uint64_t start = host_now_us();
+    Serial.feed(line, strlen(line));
+    Serial.feed("\n", 1);
+    loop();
+    reply.us = host_now_us() - start;
+    reply.heapPeak = host_heap_peak();
+    reply.output = Serial.takeOutput();
+
+    char message[128];
+    snprintf(message, sizeof(message), "%s: %.2f ms, heap peak %zu KB", line,
+             reply.us / 1000.0, reply.heapPeak / 1024);
+    TEST_MESSAGE(message);
+    return reply;
+}
+
+// Whether one of the lines written starts with the command
+bool replied(const reply_t &reply, const char *command)
+{
+    const size_t length = strlen(command);
+    size_t line = 0;
+    while (line < reply.output.size()) {
+        size_t end = reply.output.find('\n', line);
+        if (end == std::string::npos) {
+            end = reply.output.size();
+        }
+        if (reply.output.compare(line, length, command) == 0 &&
+            (line + length == end || reply.output[line + length] == ' ' ||
+             reply.output[line + length] == '\r')) {
+            return true;
+        }
+        line = end + 1;
+    }
+    return false;
+}
+
+void assertBudgets(const reply_t &reply)
+{
+    TEST_ASSERT_LESS_THAN_UINT64(COMMAND_BUDGET_US, reply.us);
+    TEST_ASSERT_LESS_THAN_size_t(HEAP_BUDGET, reply.heapPeak);
+}
+
+// The one reply of a CAPTURE, NO_INTERNET from the network task aside
+void assertCaptureReply(const reply_t &reply, const char *expected)
+{
+    std::string captureReply;
+    int replies = 0;
+    size_t line = 0;
+    while (line < reply.output.size()) {
+        size_t end = reply.output.find('\n', line);
+        if (end == std::string::npos) {
+            end = reply.output.size();
+        }
+        std::string text = reply.output.substr(line, end - line);
+        if (!text.empty() && text.back() == '\r') {
+            text.pop_back();
+        }
+        if (text.compare(0, 11, "NO_INTERNET") != 0 && !text.empty()) {
+            captureReply = text;
+            replies++;
+        }
+        line = end + 1;
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(1, replies, reply.output.c_str());
+    TEST_ASSERT_TRUE_MESSAGE(captureReply == expected, reply.output.c_str());
+    assertBudgets(reply);
+}
+
+bool writeNutrition(void *file, const void *data, size_t length)
+{
+    return fwrite(data, 1, length, (FILE *)file) == length;
+}
+
+} // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_hello()
+{
+    const reply_t reply = send("HELLO");
+    TEST_ASSERT_TRUE_MESSAGE(replied(reply, "READY"), reply.output.c_str());
+    assertBudgets(reply);
+}
+
+void test_init()
+{
+    const reply_t reply = send("INIT");
+    TEST_ASSERT_TRUE_MESSAGE(replied(reply, "INIT_SUCCESS"), reply.output.c_str());
+    assertBudgets(reply);
+}
+
+void test_tare()
+{
+    const reply_t reply = send("TARE");
+    TEST_ASSERT_TRUE_MESSAGE(replied(reply, "TARE_DONE"), reply.output.c_str());
+    assertBudgets(reply);
+}
+
+void test_capture_food()
+{
+    const uint32_t hits = resultCache.hits();
+    assertCaptureReply(send("CAPTURE 120.0"), "FOOD_INFO apple 52.00");
+    TEST_ASSERT_EQUAL_INT(hits, resultCache.hits());
+}
+
+void test_capture_empty_plate()
+{
+    assertCaptureReply(send("CAPTURE 0.0"), "FOOD_NOT_RECOG");
+}
+
+// The apple again at the same weight, answered from the result cache
+void test_capture_cached()
+{
+    const uint32_t hits = resultCache.hits();
+    assertCaptureReply(send("CAPTURE 120.0"), "FOOD_INFO apple 52.00");
+    TEST_ASSERT_EQUAL_INT(hits + 1, resultCache.hits());
+    assertCaptureReply(send("CAPTURE 0.0"), "FOOD_NOT_RECOG");
+}
+
+// Without the weight the cache is left out, the apple is classified again
+void test_capture_without_weight()
+{
+    const uint32_t hits = resultCache.hits();
+    assertCaptureReply(send("CAPTURE"), "FOOD_INFO apple 52.00");
+    TEST_ASSERT_EQUAL_INT(hits, resultCache.hits());
+}
+
+void test_boot_stats()
+{
+    const reply_t reply = send("BOOT_STATS");
+    unsigned long sd, config, wifi, camera, model, ready, ping;
+    const size_t at = reply.output.find("BOOT_STATS ");
+    TEST_ASSERT_TRUE_MESSAGE(at != std::string::npos, reply.output.c_str());
+    TEST_ASSERT_EQUAL_INT_MESSAGE(
+        7,
+        sscanf(reply.output.c_str() + at, "BOOT_STATS %lu %lu %lu %lu %lu %lu %lu",
+               &sd, &config, &wifi, &camera, &model, &ready, &ping),
+        reply.output.c_str());
+    // The camera and the model are set up while WiFi associates
+    TEST_ASSERT_TRUE_MESSAGE(wifi >= WIFI_SCAN_MS, reply.output.c_str());
+    TEST_ASSERT_TRUE_MESSAGE(ready >= sd + config + wifi, reply.output.c_str());
+    TEST_ASSERT_TRUE_MESSAGE(wifi >= camera + model, reply.output.c_str());
+}
+
+int main()
+{
+    char sd[] = "/tmp/test_session_XXXXXX";
+    if (mkdtemp(sd) == nullptr) {
+        return 1;
+    }
+    FILE *config = fopen((std::string(sd) + "/config.txt").c_str(), "w");
+    if (config == nullptr) {
+        return 1;
+    }
+    fputs(CONFIG, config);
+    fclose(config);
+    FILE *nutrition = fopen((std::string(sd) + "/nutrition.db").c_str(), "wb");
+    if (nutrition == nullptr) {
+        return 1;
+    }
+    std::vector<NutritionDB::food_t> foods(FOODS, FOODS + sizeof(FOODS) / sizeof(FOODS[0]));
+    const bool written = NutritionDB::write(writeNutrition, nutrition, 1, foods) ==
+                         NutritionDB::NDB_OK;
+    fclose(nutrition);
+    if (!written) {
+        return 1;
+    }
+
+    esp_camera_host_frames(fixture("frames").c_str());
+    sd_mmc_host_root(sd);
+    wifi_host_connect_ms(WIFI_SCAN_MS, WIFI_SCAN_MS / 5);
+    hostForeground = true;
+    setup();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_hello);
+    RUN_TEST(test_init);
+    RUN_TEST(test_tare);
+    RUN_TEST(test_capture_food);
+    RUN_TEST(test_capture_empty_plate);
+    RUN_TEST(test_capture_cached);
+    RUN_TEST(test_capture_without_weight);
+    RUN_TEST(test_boot_stats);
+    const int failures = UNITY_END();
+
+    // The network task is still running, do not wait for it
+    fflush(stdout);
+    _exit(failures);
+}
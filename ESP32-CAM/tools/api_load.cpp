@@ -0,0 +1,296 @@
+// Load test of the nutrition lookups of a fleet of scales, through the
+// firmware's own APIHandler on the host stand-ins of HTTPClient and WiFi
+// (tools/host/), against tools/api_server.cpp or the real API.
+//
+// The foods are first synced the way networkTask does it, a page at a time
+// through fetchNutritionDelta, and a share of them (--synced) is kept in a
+// NutritionDB table in memory: the SD table of a scale that last synced a
+// while ago. Then --scales threads do --lookups lookups each, of labels drawn
+// Zipf-like from the foods plus a share (--unknown) of names the API does not
+// know; the table first, the API on a miss, as lookupCalories() does. This
+// runs twice: with one APIHandler per scale, whose fetchData() keeps its
+// connection between lookups, and with a new APIHandler for every lookup.
+// Each run reports lookup latency percentiles, of every lookup and of the
+// ones that went to the API, the table hit rate, errors, connections opened
+// and lookups per second.
+//
+// Build and run on Linux, from ESP32-CAM/, with ArduinoJson where PlatformIO
+// puts it (pio pkg install -e esp32cam):
+//   JSON="-isystem .pio/libdeps/esp32cam/ArduinoJson/src -DARDUINOJSON_ENABLE_ARDUINO_STRING=1 -DARDUINOJSON_ENABLE_ARDUINO_STREAM=1 -DARDUINOJSON_ENABLE_ARDUINO_PRINT=1 -DARDUINOJSON_ENABLE_PROGMEM=0"
+//   g++ -std=c++17 -O2 -Wall -Wextra -pthread -Iinclude -Itools/host $JSON tools/api_load.cpp src/APIHandler.cpp src/NutritionDB.cpp tools/host/HTTPClient.cpp -o api_load
+//   ./api_server --latency 20:10 --error-rate 0.01 &
+//   ./api_load --url http://127.0.0.1:8000 --scales 16 --lookups 200
+
+#include "APIHandler.hpp"
+#include "NutritionDB.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct Options {
+    String url = "http://127.0.0.1:8000";
+    int scales = 8;
+    int lookups = 200;
+    double synced = 0.8;
+    double unknown = 0.05;
+    double zipf = 1.0;
+    int thinkMs = 0;
+};
+
+struct MemoryFile {
+    std::vector<uint8_t> bytes;
+};
+
+bool Read(void *file, uint32_t offset, void *data, size_t length)
+{
+    const MemoryFile *f = (const MemoryFile *)file;
+    if (offset + length > f->bytes.size()) {
+        return false;
+    }
+    memcpy(data, f->bytes.data() + offset, length);
+    return true;
+}
+
+bool Write(void *file, const void *data, size_t length)
+{
+    MemoryFile *f = (MemoryFile *)file;
+    f->bytes.insert(f->bytes.end(), (const uint8_t *)data,
+                    (const uint8_t *)data + length);
+    return true;
+}
+
+// What one scale saw
+struct Result {
+    std::vector<uint32_t> lookupUs;
+    std::vector<uint32_t> apiUs;
+    int hits = 0;
+    int found = 0;
+    int notFound = 0;
+    int errors = 0;
+};
+
+Options options;
+std::vector<std::string> labels; // most popular first
+std::vector<double> popularity;  // cumulative
+NutritionDB table;
+
+uint32_t ElapsedUs(std::chrono::steady_clock::time_point since)
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - since)
+        .count();
+}
+
+// Up to since + pages of NUTRITION_SYNC_PAGE, as networkTask pulls them
+bool Sync(std::vector<NutritionDB::food_t> &foods, uint32_t &revision)
+{
+    APIHandler api;
+    api.setURL(options.url);
+    revision = 0;
+    while (foods.size() < NutritionDB::MAX_RECORDS) {
+        const size_t before = foods.size();
+        uint32_t next = revision;
+        const int code = api.fetchNutritionDelta(revision, NUTRITION_SYNC_PAGE, next, foods);
+        if (code != 200) {
+            printf("sync stopped at revision %u: %d\n", (unsigned)revision, code);
+            return false;
+        }
+        revision = next;
+        if (foods.size() - before < NUTRITION_SYNC_PAGE) {
+            return true;
+        }
+    }
+    return true;
+}
+
+void BuildLabels(const std::vector<NutritionDB::food_t> &foods)
+{
+    for (const NutritionDB::food_t &food : foods) {
+        labels.push_back(food.name);
+    }
+    // Popularity has nothing to do with the order foods were added in
+    std::mt19937 random(7);
+    std::shuffle(labels.begin(), labels.end(), random);
+
+    double total = 0;
+    for (size_t rank = 0; rank < labels.size(); rank++) {
+        total += 1.0 / pow(rank + 1, options.zipf);
+        popularity.push_back(total);
+    }
+    for (double &p : popularity) {
+        p /= total;
+    }
+}
+
+void Scale(int index, bool reuse, Result &result)
+{
+    std::mt19937 random(1000 + index);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+    APIHandler shared;
+    shared.setURL(options.url);
+
+    for (int i = 0; i < options.lookups; i++) {
+        std::string label;
+        if (chance(random) < options.unknown) {
+            label = "unknown_" + std::to_string(random() % 1000);
+        } else {
+            const size_t rank =
+                std::lower_bound(popularity.begin(), popularity.end(), chance(random)) -
+                popularity.begin();
+            label = labels[std::min(rank, labels.size() - 1)];
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        float calories = 0;
+        if (table.lookup(label.c_str(), calories)) {
+            result.hits++;
+        } else {
+            int code;
+            if (reuse) {
+                code = shared.fetchData(label.c_str(), calories);
+            } else {
+                APIHandler api;
+                api.setURL(options.url);
+                code = api.fetchData(label.c_str(), calories);
+            }
+            result.apiUs.push_back(ElapsedUs(start));
+            if (code == 200) {
+                result.found++;
+            } else if (code == 404) {
+                result.notFound++;
+            } else {
+                result.errors++;
+            }
+        }
+        result.lookupUs.push_back(ElapsedUs(start));
+
+        if (options.thinkMs > 0) {
+            delay(options.thinkMs);
+        }
+    }
+}
+
+uint32_t Percentile(const std::vector<uint32_t> &sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+void PrintLatency(const char *what, std::vector<uint32_t> &us)
+{
+    std::sort(us.begin(), us.end());
+    printf("  %-7s %6zu  p50 %7.2f  p90 %7.2f  p99 %7.2f  max %7.2f ms\n", what,
+           us.size(), Percentile(us, 0.5) / 1000.0, Percentile(us, 0.9) / 1000.0,
+           Percentile(us, 0.99) / 1000.0, (us.empty() ? 0 : us.back()) / 1000.0);
+}
+
+void Run(bool reuse)
+{
+    std::vector<Result> results(options.scales);
+    std::vector<std::thread> threads;
+    const unsigned long connectionsBefore = HTTPClient::connections();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.scales; i++) {
+        threads.emplace_back(Scale, i, reuse, std::ref(results[i]));
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    const double seconds = ElapsedUs(start) / 1e6;
+
+    Result all;
+    for (Result &r : results) {
+        all.lookupUs.insert(all.lookupUs.end(), r.lookupUs.begin(), r.lookupUs.end());
+        all.apiUs.insert(all.apiUs.end(), r.apiUs.begin(), r.apiUs.end());
+        all.hits += r.hits;
+        all.found += r.found;
+        all.notFound += r.notFound;
+        all.errors += r.errors;
+    }
+    const size_t lookups = all.lookupUs.size();
+
+    printf("%s:\n", reuse ? "one APIHandler per scale" : "a new APIHandler per lookup");
+    PrintLatency("lookup", all.lookupUs);
+    PrintLatency("api", all.apiUs);
+    printf("  table hits %.1f%%, api found %d, not found %d, errors %d\n",
+           lookups ? 100.0 * all.hits / lookups : 0.0, all.found, all.notFound,
+           all.errors);
+    printf("  connections %lu, %.0f lookups/s\n",
+           HTTPClient::connections() - connectionsBefore, lookups / seconds);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const char *mode = "both";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char *name = argv[i], *value = argv[i + 1];
+        if (!strcmp(name, "--url")) {
+            options.url = value;
+        } else if (!strcmp(name, "--scales")) {
+            options.scales = atoi(value);
+        } else if (!strcmp(name, "--lookups")) {
+            options.lookups = atoi(value);
+        } else if (!strcmp(name, "--synced")) {
+            options.synced = atof(value);
+        } else if (!strcmp(name, "--unknown")) {
+            options.unknown = atof(value);
+        } else if (!strcmp(name, "--zipf")) {
+            options.zipf = atof(value);
+        } else if (!strcmp(name, "--think")) {
+            options.thinkMs = atoi(value);
+        } else if (!strcmp(name, "--mode")) {
+            mode = value; // both, reuse or fresh
+        } else {
+            fprintf(stderr, "unknown option %s\n", name);
+            return 2;
+        }
+    }
+
+    const auto syncStart = std::chrono::steady_clock::now();
+    std::vector<NutritionDB::food_t> foods;
+    uint32_t revision = 0;
+    if (!Sync(foods, revision) || foods.empty()) {
+        printf("no foods from %s\n", options.url.c_str());
+        return 1;
+    }
+    printf("synced %zu foods, revision %u, in %.1f ms\n", foods.size(),
+           (unsigned)revision, ElapsedUs(syncStart) / 1000.0);
+    BuildLabels(foods);
+
+    // The table of a scale that has not seen the newest foods yet
+    std::vector<NutritionDB::food_t> kept(
+        foods.begin(), foods.begin() + (size_t)(foods.size() * options.synced));
+    MemoryFile file;
+    if (NutritionDB::write(Write, &file, revision, kept) != NutritionDB::NDB_OK ||
+        table.open(Read, &file) != NutritionDB::NDB_OK) {
+        printf("could not build the table\n");
+        return 1;
+    }
+    printf("table of %u foods, %d scales x %d lookups\n", (unsigned)table.count(),
+           options.scales, options.lookups);
+
+    if (strcmp(mode, "fresh") != 0) {
+        Run(true);
+    }
+    if (strcmp(mode, "reuse") != 0) {
+        Run(false);
+    }
+    return 0;
+}
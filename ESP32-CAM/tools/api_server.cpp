@@ -0,0 +1,420 @@
+// Stand-in for the nutrition API the scale talks to at API_URL, for Linux.
+//
+// Serves what APIHandler asks for:
+//   GET /                       200, the ping
+//   GET /search/<name>          the food as JSON with "calories" (per 100 g)
+//                               among other fields, 404 for an unknown one
+//   GET /foods?since=&limit=    foods changed after revision since, the sync
+// HTTP/1.0 and 1.1, with keep-alive unless the client asks to close.
+//
+// Faults for load tests, on every request but the ping:
+//   --latency MS[:JITTER]   wait MS, plus up to JITTER more, before answering
+//   --error-rate P          answer 500 with probability P
+//   --drop-rate P           close the connection without an answer
+//   --slow-rate P           send the body in small pieces over --slow-body MS
+//   --foods N               foods in the table, the named ones then food_<i>
+//
+// Build and run on Linux, from ESP32-CAM/:
+//   g++ -std=c++17 -O2 -Wall -Wextra -pthread tools/api_server.cpp -o api_server
+//   ./api_server --port 8000 --latency 40:20 --error-rate 0.01
+// and point API_URL (or a load test, tools/api_load.cpp) at it. Ctrl-C prints
+// what was served.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct Options {
+    int port = 8000;
+    int latencyMs = 0;
+    int jitterMs = 0;
+    double errorRate = 0;
+    double dropRate = 0;
+    double slowRate = 0;
+    int slowBodyMs = 500;
+    int foods = 200;
+};
+
+struct Food {
+    std::string name;
+    float calories; // per 100 g
+};
+
+struct Counters {
+    std::atomic<uint64_t> connections{0};
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> searches{0};
+    std::atomic<uint64_t> notFound{0};
+    std::atomic<uint64_t> syncs{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> drops{0};
+    std::atomic<uint64_t> slow{0};
+};
+
+Options options;
+std::vector<Food> foods;
+Counters counters;
+std::atomic<bool> stopping(false);
+
+const Food NAMED_FOODS[] = {
+    {"apple", 52},        {"banana", 89},      {"orange", 47},
+    {"pear", 57},         {"grapes", 69},      {"strawberry", 32},
+    {"tomato", 18},       {"cucumber", 15},    {"carrot", 41},
+    {"broccoli", 34},     {"potato", 77},      {"rice", 130},
+    {"pasta", 131},       {"bread", 265},      {"egg", 155},
+    {"cheese", 402},      {"chicken", 239},    {"beef", 250},
+    {"salmon", 208},      {"tofu", 76},        {"avocado", 160},
+    {"lemon", 29},        {"kiwi", 61},        {"mango", 60},
+    {"pineapple", 50},    {"watermelon", 30},  {"onion", 40},
+    {"pepper", 20},       {"lettuce", 15},     {"spinach", 23},
+    {"mushroom", 22},     {"corn", 86},        {"peas", 81},
+    {"beans", 347},       {"lentils", 116},    {"oats", 389},
+    {"yogurt", 59},       {"milk", 42},        {"butter", 717},
+    {"chocolate", 546},   {"cookie", 502},     {"cake", 257},
+    {"pizza", 266},       {"burger", 295},     {"fries", 312},
+    {"sausage", 301},     {"ham", 145},        {"almonds", 579},
+};
+
+void BuildFoods()
+{
+    for (const Food &food : NAMED_FOODS) {
+        if ((int)foods.size() == options.foods) {
+            return;
+        }
+        foods.push_back(food);
+    }
+    for (int i = (int)foods.size(); i < options.foods; i++) {
+        foods.push_back({"food_" + std::to_string(i), (float)(50 + (i * 37) % 450)});
+    }
+}
+
+bool SameName(const std::string &a, const std::string &b)
+{
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+std::string UrlDecode(const std::string &text)
+{
+    std::string out;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '%' && i + 2 < text.size()) {
+            out += (char)strtol(text.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        } else {
+            out += text[i] == '+' ? ' ' : text[i];
+        }
+    }
+    return out;
+}
+
+uint32_t QueryValue(const std::string &query, const char *key, uint32_t fallback)
+{
+    const std::string prefix = std::string(key) + "=";
+    size_t at = 0;
+    while (at < query.size()) {
+        size_t end = query.find('&', at);
+        if (end == std::string::npos) {
+            end = query.size();
+        }
+        if (query.compare(at, prefix.size(), prefix) == 0) {
+            return strtoul(query.c_str() + at + prefix.size(), nullptr, 10);
+        }
+        at = end + 1;
+    }
+    return fallback;
+}
+
+bool SendAll(int fd, const char *data, size_t length)
+{
+    while (length > 0) {
+        const ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        length -= sent;
+    }
+    return true;
+}
+
+struct Response {
+    int status = 200;
+    std::string body;
+};
+
+Response Search(const std::string &name)
+{
+    counters.searches++;
+    Response response;
+    for (size_t i = 0; i < foods.size(); i++) {
+        if (SameName(foods[i].name, name)) {
+            const Food &f = foods[i];
+            // More than the scale reads, as the real service sends
+            char body[512];
+            snprintf(body, sizeof(body),
+                     "{\"id\":%zu,\"name\":\"%s\",\"serving_size_g\":100,"
+                     "\"calories\":%.1f,\"protein_g\":%.1f,\"fat_total_g\":%.1f,"
+                     "\"fat_saturated_g\":%.1f,\"carbohydrates_total_g\":%.1f,"
+                     "\"fiber_g\":%.1f,\"sugar_g\":%.1f,\"sodium_mg\":%d,"
+                     "\"potassium_mg\":%d,\"cholesterol_mg\":%d,"
+                     "\"source\":\"stand-in\"}\n",
+                     i + 1, f.name.c_str(), f.calories, f.calories * 0.05f,
+                     f.calories * 0.03f, f.calories * 0.01f, f.calories * 0.12f,
+                     f.calories * 0.02f, f.calories * 0.06f, (int)(i % 400),
+                     (int)(i * 7 % 600), (int)(i % 90));
+            response.body = body;
+            return response;
+        }
+    }
+    counters.notFound++;
+    response.status = 404;
+    response.body = "{\"detail\":\"Not Found\"}\n";
+    return response;
+}
+
+// Food i carries revision i + 1, a page holds the foods after since
+Response Foods(const std::string &query)
+{
+    counters.syncs++;
+    const uint32_t since = QueryValue(query, "since", 0);
+    const uint32_t limit = QueryValue(query, "limit", 64);
+    uint32_t revision = since;
+    std::string list;
+    for (uint32_t i = since; i < foods.size() && i < since + limit; i++) {
+        char item[96];
+        snprintf(item, sizeof(item), "%s{\"name\":\"%s\",\"calories\":%.1f}",
+                 list.empty() ? "" : ",", foods[i].name.c_str(), foods[i].calories);
+        list += item;
+        revision = i + 1;
+    }
+    Response response;
+    response.body = "{\"revision\":" + std::to_string(revision) + ",\"foods\":[" + list + "]}\n";
+    return response;
+}
+
+const char *Reason(int status)
+{
+    switch (status) {
+    case 200:
+        return "OK";
+    case 404:
+        return "Not Found";
+    case 500:
+        return "Internal Server Error";
+    default:
+        return "Bad Request";
+    }
+}
+
+void Serve(int fd)
+{
+    counters.connections++;
+    std::mt19937 random(std::random_device{}());
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+    std::string buffer;
+    char chunk[2048];
+    bool open = true;
+    while (open && !stopping.load()) {
+        // One request, headers only, GET has no body
+        size_t end;
+        while ((end = buffer.find("\r\n\r\n")) == std::string::npos) {
+            const ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+            if (received <= 0) {
+                close(fd);
+                return;
+            }
+            buffer.append(chunk, received);
+        }
+        std::string head = buffer.substr(0, end);
+        buffer.erase(0, end + 4);
+        counters.requests++;
+
+        char method[8] = {0}, target[512] = {0}, version[16] = {0};
+        sscanf(head.c_str(), "%7s %511s %15s", method, target, version);
+        for (char &c : head) {
+            c = tolower(c);
+        }
+        const bool http10 = strcmp(version, "HTTP/1.0") == 0;
+        const bool keepAlive = http10 ? head.find("connection: keep-alive") != std::string::npos
+                                      : head.find("connection: close") == std::string::npos;
+
+        std::string path = target, query;
+        const size_t question = path.find('?');
+        if (question != std::string::npos) {
+            query = path.substr(question + 1);
+            path.erase(question);
+        }
+
+        Response response;
+        const bool ping = path == "/";
+        if (strcmp(method, "GET") != 0) {
+            response.status = 400;
+        } else if (ping) {
+            response.body = "{\"status\":\"ok\"}\n";
+        } else if (path.compare(0, 8, "/search/") == 0) {
+            response = Search(UrlDecode(path.substr(8)));
+        } else if (path == "/foods") {
+            response = Foods(query);
+        } else {
+            response.status = 404;
+            response.body = "{\"detail\":\"Not Found\"}\n";
+        }
+
+        bool slow = false;
+        if (!ping) {
+            int wait = options.latencyMs;
+            if (options.jitterMs > 0) {
+                wait += random() % (options.jitterMs + 1);
+            }
+            if (wait > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(wait));
+            }
+            if (chance(random) < options.dropRate) {
+                counters.drops++;
+                close(fd);
+                return;
+            }
+            if (chance(random) < options.errorRate) {
+                counters.errors++;
+                response.status = 500;
+                response.body = "{\"detail\":\"Internal Server Error\"}\n";
+            }
+            slow = chance(random) < options.slowRate;
+        }
+
+        char header[256];
+        const int headerLength = snprintf(
+            header, sizeof(header),
+            "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\n"
+            "Content-Length: %zu\r\nConnection: %s\r\n\r\n",
+            response.status, Reason(response.status), response.body.size(),
+            keepAlive ? "keep-alive" : "close");
+        open = SendAll(fd, header, headerLength);
+
+        if (open && slow) {
+            // The body trickles in, as over a congested link
+            counters.slow++;
+            const size_t piece = 8;
+            const size_t pieces = (response.body.size() + piece - 1) / piece;
+            for (size_t at = 0; open && at < response.body.size(); at += piece) {
+                open = SendAll(fd, response.body.data() + at,
+                               std::min(piece, response.body.size() - at));
+                std::this_thread::sleep_for(
+                    std::chrono::microseconds(options.slowBodyMs * 1000 / pieces));
+            }
+        } else if (open) {
+            open = SendAll(fd, response.body.data(), response.body.size());
+        }
+
+        open = open && keepAlive;
+    }
+    close(fd);
+}
+
+double Rate(const char *text)
+{
+    const double rate = atof(text);
+    return rate < 0 ? 0 : rate > 1 ? 1 : rate;
+}
+
+void Stop(int)
+{
+    stopping = true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char *name = argv[i], *value = argv[i + 1];
+        if (!strcmp(name, "--port")) {
+            options.port = atoi(value);
+        } else if (!strcmp(name, "--latency")) {
+            options.latencyMs = atoi(value);
+            const char *colon = strchr(value, ':');
+            options.jitterMs = colon != nullptr ? atoi(colon + 1) : 0;
+        } else if (!strcmp(name, "--error-rate")) {
+            options.errorRate = Rate(value);
+        } else if (!strcmp(name, "--drop-rate")) {
+            options.dropRate = Rate(value);
+        } else if (!strcmp(name, "--slow-rate")) {
+            options.slowRate = Rate(value);
+        } else if (!strcmp(name, "--slow-body")) {
+            options.slowBodyMs = atoi(value);
+        } else if (!strcmp(name, "--foods")) {
+            options.foods = atoi(value);
+        } else {
+            fprintf(stderr, "unknown option %s\n", name);
+            return 2;
+        }
+    }
+    BuildFoods();
+
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    const int on = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(options.port);
+    if (bind(listener, (sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(listener, 128) != 0) {
+        perror("listen");
+        return 1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = Stop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    printf("serving %zu foods on port %d\n", foods.size(), options.port);
+    fflush(stdout);
+
+    while (!stopping.load()) {
+        pollfd p = {listener, POLLIN, 0};
+        if (poll(&p, 1, 200) <= 0) {
+            continue;
+        }
+        const int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        std::thread(Serve, fd).detach();
+    }
+    close(listener);
+
+    printf("connections %llu, requests %llu, searches %llu (%llu not found), "
+           "syncs %llu, errors %llu, drops %llu, slow %llu\n",
+           (unsigned long long)counters.connections.load(),
+           (unsigned long long)counters.requests.load(),
+           (unsigned long long)counters.searches.load(),
+           (unsigned long long)counters.notFound.load(),
+           (unsigned long long)counters.syncs.load(),
+           (unsigned long long)counters.errors.load(),
+           (unsigned long long)counters.drops.load(),
+           (unsigned long long)counters.slow.load());
+    return 0;
+}
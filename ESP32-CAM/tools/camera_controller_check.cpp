@@ -0,0 +1,107 @@
+// Check of the camera mode ladder (src/CameraController.cpp).
+//
+// The ladder a 96x96 impulse gets under a QVGA and a VGA ceiling, and the one
+// of an input as large as the ceiling, are compared with what they should be.
+// Then a run of CAPTUREs with a frame time that grows with the frame's pixels
+// goes through it: unsure captures climb, a frame over budget steps back and
+// caps the ladder, and confident ones step down again.
+//
+// Build and run on the host, from ESP32-CAM/:
+//   g++ -std=c++17 -O2 -Wall -Wextra -Iinclude tools/camera_controller_check.cpp src/CameraController.cpp -o camera_controller_check
+//   ./camera_controller_check
+
+#include "CameraController.hpp"
+
+#include <cstdio>
+
+namespace
+{
+
+int failures = 0;
+
+void Expect(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+CameraController::policy_t Policy(uint16_t input, uint16_t maxWidth, uint16_t maxHeight)
+{
+    CameraController::policy_t policy;
+    policy.inputWidth = input;
+    policy.inputHeight = input;
+    policy.maxWidth = maxWidth;
+    policy.maxHeight = maxHeight;
+    policy.bestQuality = 12;
+    policy.qualityFloor = 20;
+    policy.frameBudgetUs = 300000;
+    policy.acceptConfidence = 0.8f;
+    policy.confidentStreak = 3;
+    return policy;
+}
+
+// Inference of 120 ms, then decode and resize at 0.8 us a pixel
+uint32_t FrameUs(const CameraController::mode_t &mode)
+{
+    return 120000 + mode.width * mode.height * 8 / 10;
+}
+
+void Print(const CameraController &controller)
+{
+    const CameraController::mode_t &m = controller.mode();
+    printf("  level %d: %ux%u q%d %u MHz, %u us\n", controller.level(), m.width,
+           m.height, m.quality, (unsigned)(m.xclkHz / 1000000), (unsigned)FrameUs(m));
+}
+
+} // namespace
+
+int main()
+{
+    CameraController controller;
+
+    controller.configure(Policy(96, 320, 240));
+    Expect(controller.levels() == 3, "QQVGA to QVGA for 96x96 under QVGA");
+    Expect(controller.mode().width == 160 && controller.mode().quality == 20 &&
+               controller.mode().xclkHz == 10000000,
+           "starts at QQVGA, quality floor, low clock");
+
+    controller.configure(Policy(240, 320, 240));
+    Expect(controller.levels() == 1 && controller.mode().width == 320 &&
+               controller.mode().quality == 12 && controller.mode().xclkHz == 20000000,
+           "an input that needs the ceiling stays there at the best quality");
+
+    controller.configure(Policy(96, 640, 480));
+    Expect(controller.levels() == 5, "QQVGA to VGA under VGA");
+    printf("96x96 under VGA, unsure captures:\n");
+    Print(controller);
+
+    // Unsure: climbs until a frame takes too long, then stays below that
+    int changes = 0;
+    for (int i = 0; i < 8; i++) {
+        if (controller.update(FrameUs(controller.mode()), 0.5f)) {
+            changes++;
+            Print(controller);
+        }
+    }
+    Expect(controller.mode().width == 400, "VGA over budget, capped at CIF");
+    Expect(FrameUs(controller.mode()) <= 300000, "within the budget");
+    Expect(changes == 5, "up to VGA, back to CIF, no further");
+
+    // Confident: steps down a level every third capture
+    printf("confident captures:\n");
+    for (int i = 0; i < 6; i++) {
+        if (controller.update(FrameUs(controller.mode()), 0.95f)) {
+            Print(controller);
+        }
+    }
+    Expect(controller.level() == 1, "two levels down after two streaks");
+
+    // Nothing found: also climbs
+    Expect(controller.update(FrameUs(controller.mode()), 0.0f) && controller.level() == 2,
+           "no box climbs");
+
+    printf("%s\n", failures ? "FAIL" : "OK");
+    return failures ? 1 : 0;
+}
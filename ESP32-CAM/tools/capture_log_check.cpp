@@ -0,0 +1,262 @@
+// Check of the capture log (src/CaptureLog.cpp).
+//
+// Captures of random sizes are appended as fast as the host can, far faster
+// than the writer can take them, then more at a kitchen pace with a flush in
+// between. The files are read back twice, through their index and by walking
+// the records, and must hold every capture that was not counted as dropped,
+// byte for byte and in order, in files cut at the size limit and written in
+// whole blocks.
+//
+// Build and run on the host, from ESP32-CAM/:
+//   g++ -std=c++17 -O2 -Wall -Wextra -pthread -Iinclude tools/capture_log_check.cpp src/CaptureLog.cpp src/Signal.cpp -o capture_log_check
+//   ./capture_log_check
+// Add -fsanitize=address,undefined to check the buffer handling.
+
+#include "CaptureLog.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+
+namespace
+{
+
+const char *DIRECTORY = "/tmp/capture_log_check";
+const uint32_t MAX_FILE_BYTES = 512 * 1024;
+
+int failures = 0;
+
+void Expect(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// The bytes of every capture, by sequence
+struct Sent {
+    float weight;
+    std::vector<CaptureLog::box_t> boxes;
+    std::vector<uint8_t> jpeg;
+};
+
+Sent MakeCapture(std::mt19937 &random, uint32_t sequence, uint32_t maxJpeg)
+{
+    Sent sent;
+    sent.weight = (float)(random() % 5000) / 10.0f;
+    const int boxes = random() % (CaptureLog::MAX_BOXES + 1);
+    for (int i = 0; i < boxes; i++) {
+        CaptureLog::box_t box;
+        memset(&box, 0, sizeof(box));
+        snprintf(box.label, sizeof(box.label), "food_%u_%d", sequence, i);
+        box.value = (float)(random() % 1000) / 1000.0f;
+        box.x = random() % 96;
+        box.y = random() % 96;
+        box.width = box.height = 8;
+        sent.boxes.push_back(box);
+    }
+    sent.jpeg.resize(random() % maxJpeg);
+    for (uint8_t &byte : sent.jpeg) {
+        byte = (uint8_t)random();
+    }
+    return sent;
+}
+
+bool Append(CaptureLog &log, const Sent &sent, uint32_t sequence)
+{
+    CaptureLog::capture_t capture;
+    capture.weight = sent.weight;
+    capture.captureUs = sequence;
+    capture.inferUs = sequence * 2;
+    capture.totalUs = sequence * 3;
+    capture.boxes = sent.boxes.data();
+    capture.boxCount = (uint16_t)sent.boxes.size();
+    capture.jpeg = sent.jpeg.data();
+    capture.jpegLength = (uint32_t)sent.jpeg.size();
+    return log.append(capture, sequence * 10);
+}
+
+bool Matches(const uint8_t *record, const Sent &sent, uint32_t sequence)
+{
+    CaptureLog::record_header_t header;
+    memcpy(&header, record, sizeof(header));
+    const size_t boxesLength = sent.boxes.size() * sizeof(CaptureLog::box_t);
+    return header.magic == CaptureLog::RECORD_MAGIC &&
+           header.sequence == sequence && header.timeMs == sequence * 10 &&
+           header.weight == sent.weight && header.captureUs == sequence &&
+           header.inferUs == sequence * 2 && header.totalUs == sequence * 3 &&
+           header.boxCount == sent.boxes.size() &&
+           header.jpegLength == sent.jpeg.size() &&
+           (boxesLength == 0 ||
+            memcmp(record + sizeof(header), sent.boxes.data(), boxesLength) == 0) &&
+           (sent.jpeg.empty() ||
+            memcmp(record + sizeof(header) + boxesLength, sent.jpeg.data(),
+                   sent.jpeg.size()) == 0);
+}
+
+std::vector<uint8_t> ReadFile(const std::string &path)
+{
+    std::vector<uint8_t> bytes;
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return bytes;
+    }
+    fseek(file, 0, SEEK_END);
+    bytes.resize(ftell(file));
+    fseek(file, 0, SEEK_SET);
+    if (fread(bytes.data(), 1, bytes.size(), file) != bytes.size()) {
+        bytes.clear();
+    }
+    fclose(file);
+    return bytes;
+}
+
+// Sequences found in one file, through the index and by walking the records
+void ReadBack(const std::vector<uint8_t> &file, const std::map<uint32_t, Sent> &sent,
+              std::vector<uint32_t> &indexed, std::vector<uint32_t> &walked)
+{
+    CaptureLog::file_header_t header;
+    memcpy(&header, file.data(), sizeof(header));
+    Expect(header.magic == CaptureLog::FILE_MAGIC &&
+               header.blockBytes == CaptureLog::BLOCK_BYTES,
+           "file header");
+
+    CaptureLog::index_trailer_t trailer;
+    memcpy(&trailer, file.data() + file.size() - sizeof(trailer), sizeof(trailer));
+    Expect(trailer.magic == CaptureLog::INDEX_MAGIC, "index trailer");
+    Expect(trailer.indexOffset % CaptureLog::BLOCK_BYTES == 0,
+           "records written in whole blocks");
+    Expect(trailer.indexOffset + trailer.count * sizeof(CaptureLog::index_entry_t) +
+                   sizeof(trailer) == file.size(),
+           "index at the end of the file");
+
+    for (uint32_t i = 0; i < trailer.count; i++) {
+        CaptureLog::index_entry_t entry;
+        memcpy(&entry, file.data() + trailer.indexOffset + i * sizeof(entry),
+               sizeof(entry));
+        auto it = sent.find(entry.sequence);
+        const bool ok = it != sent.end() && entry.offset + entry.length <= trailer.indexOffset &&
+                        Matches(file.data() + entry.offset, it->second, entry.sequence);
+        Expect(ok, "indexed record as it was appended");
+        indexed.push_back(entry.sequence);
+    }
+
+    // As a reader of a file cut short would, without the index
+    for (uint32_t offset = CaptureLog::BLOCK_BYTES; offset < trailer.indexOffset;) {
+        CaptureLog::record_header_t record;
+        memcpy(&record, file.data() + offset, sizeof(record));
+        if (record.magic != CaptureLog::RECORD_MAGIC) {
+            offset = (offset / CaptureLog::BLOCK_BYTES + 1) * CaptureLog::BLOCK_BYTES;
+            continue;
+        }
+        walked.push_back(record.sequence);
+        offset += record.length;
+    }
+}
+
+} // namespace
+
+int main()
+{
+    std::string clean = std::string("rm -rf ") + DIRECTORY;
+    if (system(clean.c_str()) != 0) {
+        return 1;
+    }
+
+    std::mt19937 random(7);
+    std::map<uint32_t, Sent> sent;
+    uint32_t sequence = 0, appended = 0;
+
+    CaptureLog log;
+    Expect(log.start(DIRECTORY, MAX_FILE_BYTES) == CaptureLog::LOG_OK, "start");
+
+    // Flood, records up to 40 KB
+    for (uint32_t i = 0; i < 2000; i++) {
+        sent[i] = MakeCapture(random, i, 40 * 1024);
+    }
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < 2000; i++, sequence++) {
+        appended += Append(log, sent[sequence], sequence);
+    }
+    const double floodUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    const uint32_t flooded = appended;
+
+    // One too big for a buffer, always dropped
+    Sent big;
+    big.weight = 1;
+    big.jpeg.resize(CaptureLog::BUFFER_BYTES);
+    Expect(!Append(log, big, sequence++), "capture larger than a buffer dropped");
+
+    // Kitchen pace, one capture every few ms with a flush now and then
+    for (int i = 0; i < 200; i++, sequence++) {
+        sent[sequence] = MakeCapture(random, sequence, 12 * 1024);
+        appended += Append(log, sent[sequence], sequence);
+        if (i % 50 == 49) {
+            log.flush();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const uint32_t paced = appended - flooded;
+
+    log.stop();
+    const CaptureLog::counters_t c = log.counters();
+
+    Expect(c.logged == appended, "logged counts the appended captures");
+    Expect(c.logged + c.dropped == sequence, "every capture logged or dropped");
+    Expect(c.written == c.logged, "every logged capture written at stop");
+    Expect(c.errors == 0, "no write errors");
+    Expect(paced > 190, "captures at a kitchen pace are not dropped");
+
+    // Read every file back, in the order they were written
+    std::vector<std::string> names;
+    DIR *dir = opendir(DIRECTORY);
+    for (dirent *entry; dir != nullptr && (entry = readdir(dir)) != nullptr;) {
+        const std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".cap") == 0) {
+            names.push_back(name);
+        }
+    }
+    if (dir != nullptr) {
+        closedir(dir);
+    }
+    std::sort(names.begin(), names.end());
+    Expect(names.size() == c.files && c.files > 1, "rotated into several files");
+
+    std::vector<uint32_t> indexed, walked;
+    for (const std::string &name : names) {
+        const std::vector<uint8_t> file = ReadFile(std::string(DIRECTORY) + "/" + name);
+        Expect(file.size() <= MAX_FILE_BYTES + 16 * 1024, "file cut at the size limit");
+        ReadBack(file, sent, indexed, walked);
+    }
+    Expect(indexed.size() == c.logged, "every logged capture in an index");
+    Expect(indexed == walked, "index and record walk agree");
+    bool ordered = true;
+    for (size_t i = 1; i < indexed.size(); i++) {
+        ordered = ordered && indexed[i] > indexed[i - 1];
+    }
+    Expect(ordered, "records in append order");
+
+    // A second start numbers its files after these
+    Expect(log.start(DIRECTORY, MAX_FILE_BYTES) == CaptureLog::LOG_OK, "restart");
+    Append(log, sent[0], 0);
+    log.stop();
+    char last[32];
+    snprintf(last, sizeof(last), "/%05zu.cap", names.size());
+    Expect(!ReadFile(std::string(DIRECTORY) + last).empty(), "restart appends a new file");
+
+    printf("flood: %u of 2000 logged, %.2f us per append\n", flooded, floodUs / 2000);
+    printf("paced: %u of 200 logged\n", paced);
+    printf("%u logged, %u dropped, %u files\n", c.logged, c.dropped, c.files);
+    printf("%s\n", failures ? "FAIL" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,194 @@
+// Check of the two stage cascade in classifier/ei_run_cascade.h.
+//
+// The crop geometry and the resampling are checked against hand computed values.
+// The cascade then runs end to end on synthetic 320x240 frames, reduced to the
+// model input the way the firmware does it (crop_and_interpolate_rgb888). There
+// is only one impulse in this tree, so it also serves as the second stage,
+// through a handle of its own, on the crops. Checked:
+//   - with an unreachable min_value the boxes are exactly those of run_classifier
+//   - with min_value 0 every refined box carries a label of the second stage
+//   - with the FOMO fusion state, as handleCapture runs it, the first stage boxes are
+//     those of run_classifier_with_buffers with a fusion state fed the same frames
+//
+// Build and run on the host, from ESP32-CAM/, with SRC, FLAGS, SDK and common.o as in
+// tools/eon_session_stress.cpp:
+//   g++ -std=c++17 $FLAGS -Wall -Wextra -c tools/cascade_check.cpp
+//   g++ -std=c++17 $FLAGS -w cascade_check.o common.o $SDK $SRC/edge-impulse-sdk/porting/clib/*.cpp -o cascade_check -lm
+//   ./cascade_check
+
+#include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+const uint32_t kFrameWidth = 320;
+const uint32_t kFrameHeight = 240;
+
+int failures = 0;
+
+void Expect(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// grey background with a red blob, in BGR like the camera driver
+std::vector<uint8_t> DrawFrame(int cx, int cy)
+{
+    std::vector<uint8_t> bgr(kFrameWidth * kFrameHeight * 3);
+    for (uint32_t y = 0; y < kFrameHeight; y++) {
+        for (uint32_t x = 0; x < kFrameWidth; x++) {
+            uint8_t *p = &bgr[(y * kFrameWidth + x) * 3];
+            const int dx = (int)x - cx, dy = (int)y - cy;
+            if (dx * dx + dy * dy < 900) {
+                p[0] = 30; p[1] = 40; p[2] = 200;
+            }
+            else {
+                p[0] = 210; p[1] = 220; p[2] = 220;
+            }
+        }
+    }
+    return bgr;
+}
+
+void CheckGeometry()
+{
+    const ei_impulse_t *impulse = ei_default_impulse.impulse;
+    std::vector<uint8_t> pixels(kFrameWidth * kFrameHeight * 3, 0);
+    ei_cascade_frame_t frame = { pixels.data(), kFrameWidth, kFrameHeight, true };
+    ei_cascade_config_t config = { 0.5f, 64, 2, 0.5f };
+    ei_cascade_region_t region;
+
+    // 96x96 input from the center 240x240 of the frame, 2.5 frame pixels per input pixel
+    ei_impulse_result_bounding_box_t box = { "x", 40, 40, 8, 8, 1.0f };
+    ei_cascade_crop_region(impulse, impulse, &frame, &box, &config, &region);
+    Expect(region.x == 118 && region.y == 78 && region.width == 64 && region.height == 64,
+        "small box grows to min_crop around its center");
+
+    ei_impulse_result_bounding_box_t big = { "x", 0, 0, 40, 40, 1.0f };
+    ei_cascade_crop_region(impulse, impulse, &frame, &big, &config, &region);
+    Expect(region.x == 0 && region.y == 0 && region.width == 200 && region.height == 200,
+        "box in the corner is shifted into the frame");
+
+    ei_impulse_result_bounding_box_t all = { "x", 0, 0, 96, 96, 1.0f };
+    ei_cascade_crop_region(impulse, impulse, &frame, &all, &config, &region);
+    Expect(region.width == kFrameHeight && region.height == kFrameHeight && region.x == 40,
+        "crop larger than the frame is clipped to it");
+
+    // resampling a region of the output size is a copy
+    for (size_t i = 0; i < pixels.size(); i++) {
+        pixels[i] = (uint8_t)(i * 7);
+    }
+    ei_cascade_region_t same = { 10, 20, 16, 8 };
+    uint8_t out[16 * 8 * 3];
+    ei_cascade_sample_region(&frame, &same, out, 16, 8);
+    bool copy = true;
+    for (uint32_t y = 0; y < 8; y++) {
+        copy = copy && memcmp(out + y * 16 * 3, &pixels[((20 + y) * kFrameWidth + 10) * 3], 16 * 3) == 0;
+    }
+    Expect(copy, "resample at scale 1 copies the region");
+}
+
+bool SameBoxes(const ei_impulse_result_t &a, const ei_impulse_result_t &b)
+{
+    if (a.bounding_boxes_count != b.bounding_boxes_count) {
+        return false;
+    }
+    for (uint32_t i = 0; i < a.bounding_boxes_count; i++) {
+        const ei_impulse_result_bounding_box_t &x = a.bounding_boxes[i], &y = b.bounding_boxes[i];
+        if (strcmp(x.label, y.label) != 0 || x.value != y.value || x.x != y.x || x.y != y.y ||
+            x.width != y.width || x.height != y.height) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IsCategory(const char *label)
+{
+    for (size_t i = 0; i < EI_CLASSIFIER_LABEL_COUNT; i++) {
+        if (strcmp(label, ei_classifier_inferencing_categories[i]) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+int main()
+{
+    CheckGeometry();
+
+    ei_impulse_handle_t second(ei_default_impulse.impulse);
+    std::vector<uint8_t> crop(second.impulse->input_width * second.impulse->input_height * 3);
+    std::vector<uint8_t> input(EI_CLASSIFIER_INPUT_WIDTH * EI_CLASSIFIER_INPUT_HEIGHT * 3);
+    int frames_with_boxes = 0, refined = 0;
+    ei_fomo_fusion_t plain_fusion, cascade_fusion;
+    ei_fomo_fusion_init(&plain_fusion, 0.5f);
+    ei_fomo_fusion_init(&cascade_fusion, 0.5f);
+
+    for (int f = 0; f < 8; f++) {
+        std::vector<uint8_t> bgr = DrawFrame(70 + f * 25, 60 + (f * 37) % 120);
+        // crop_and_interpolate_rgb888 needs room for the whole crop in its output
+        std::vector<uint8_t> scratch(bgr);
+        ei::image::processing::crop_and_interpolate_rgb888(scratch.data(), kFrameWidth, kFrameHeight,
+            scratch.data(), EI_CLASSIFIER_INPUT_WIDTH, EI_CLASSIFIER_INPUT_HEIGHT);
+        memcpy(input.data(), scratch.data(), input.size());
+
+        signal_t signal;
+        signal.total_length = EI_CLASSIFIER_INPUT_WIDTH * EI_CLASSIFIER_INPUT_HEIGHT;
+        signal.get_data = [&input](size_t offset, size_t length, float *out) {
+            for (size_t i = 0; i < length; i++) {
+                const uint8_t *p = &input[(offset + i) * 3];
+                out[i] = (float)((p[2] << 16) + (p[1] << 8) + p[0]);
+            }
+            return 0;
+        };
+        const ei_cascade_frame_t frame = { bgr.data(), kFrameWidth, kFrameHeight, true };
+
+        ei_impulse_result_bounding_box_t plain_boxes[EI_CLASSIFIER_OBJECT_DETECTION_COUNT];
+        ei_impulse_result_bounding_box_t kept_boxes[EI_CLASSIFIER_OBJECT_DETECTION_COUNT];
+        ei_impulse_result_t plain = {}, kept = {}, relabeled = {};
+        Expect(run_classifier_with_buffers(&signal, &plain, plain_boxes, EI_CLASSIFIER_OBJECT_DETECTION_COUNT) == EI_IMPULSE_OK,
+            "first stage runs");
+        frames_with_boxes += plain.bounding_boxes_count > 0;
+
+        ei_cascade_config_t never = { 0.5f, 64, 2, 2.0f };
+        Expect(run_classifier_cascade(&ei_default_impulse, &second, &signal, &kept, &frame, &never, crop.data(),
+            kept_boxes, EI_CLASSIFIER_OBJECT_DETECTION_COUNT) == EI_IMPULSE_OK,
+            "cascade runs");
+        Expect(SameBoxes(plain, kept), "boxes unchanged below min_value");
+
+        // the stand-in second stage is a detector too, it needs the food with some plate around it
+        ei_cascade_config_t always = { 0.5f, 160, 2, 0.0f };
+        Expect(run_classifier_cascade(&ei_default_impulse, &second, &signal, &relabeled, &frame, &always, crop.data()) == EI_IMPULSE_OK,
+            "cascade runs");
+        for (uint32_t i = 0; i < relabeled.bounding_boxes_count; i++) {
+            const ei_impulse_result_bounding_box_t &b = relabeled.bounding_boxes[i];
+            Expect(IsCategory(b.label), "refined label is a category");
+            refined += b.value != plain_boxes[i].value;
+        }
+
+        ei_impulse_result_bounding_box_t fused_boxes[EI_CLASSIFIER_OBJECT_DETECTION_COUNT];
+        ei_impulse_result_bounding_box_t fused_kept_boxes[EI_CLASSIFIER_OBJECT_DETECTION_COUNT];
+        ei_impulse_result_t fused = {}, fused_kept = {};
+        Expect(run_classifier_with_buffers(&signal, &fused, fused_boxes, EI_CLASSIFIER_OBJECT_DETECTION_COUNT,
+            &plain_fusion) == EI_IMPULSE_OK, "fused first stage runs");
+        Expect(run_classifier_cascade(&ei_default_impulse, &second, &signal, &fused_kept, &frame, &never, crop.data(),
+            fused_kept_boxes, EI_CLASSIFIER_OBJECT_DETECTION_COUNT, &cascade_fusion) == EI_IMPULSE_OK,
+            "fused cascade runs");
+        Expect(SameBoxes(fused, fused_kept), "fused boxes unchanged below min_value");
+    }
+
+    printf("%d/8 frames with detections, %d boxes rescored by the second stage\n", frames_with_boxes, refined);
+    Expect(refined > 0, "second stage rescored boxes");
+    printf("%s\n", failures ? "FAIL" : "OK");
+    return failures ? 1 : 0;
+}
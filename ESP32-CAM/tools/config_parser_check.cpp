@@ -0,0 +1,137 @@
+// Check of the config.txt parser (src/ConfigParser.cpp).
+//
+// A config with CRLF line ends, spaces, comments, keys in other cases, more
+// keys than the old five line parser kept, values it must refuse and a last
+// line without a newline is parsed the way SDReader::readConfig does it.
+// Every value must land where it belongs, and refused ones must leave their
+// default. The parse is timed over a config of a few hundred entries.
+//
+// Build and run on the host, from ESP32-CAM/:
+//   g++ -std=c++17 -O2 -Wall -Wextra -Iinclude tools/config_parser_check.cpp src/ConfigParser.cpp src/WiFiConfig.cpp -o config_parser_check
+//   ./config_parser_check
+
+#include "ConfigParser.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace
+{
+
+int failures = 0;
+int unknown = 0;
+
+void Expect(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+struct Target {
+    WiFiConfig wifi;
+    settings_t settings;
+};
+
+bool Set(void *context, ConfigParser::token_t key, ConfigParser::token_t value)
+{
+    Target *target = (Target *)context;
+    if (ConfigParser::setWiFi(target->wifi, key, value) ||
+        ConfigParser::setSetting(target->settings, key, value)) {
+        return true;
+    }
+    unknown++;
+    return false;
+}
+
+settings_t Defaults()
+{
+    settings_t settings;
+    settings.apiUrl = "http://192.168.1.158:8000";
+    settings.detectionThreshold = 0.5f;
+    settings.frameWidth = 320;
+    settings.frameHeight = 240;
+    settings.jpegQuality = 12;
+    settings.adaptiveCamera = true;
+    settings.qualityFloor = 20;
+    settings.captureFrames = 3;
+    settings.cacheTtlMs = 0;
+    settings.weightWindow = 5.0f;
+    settings.captureLog = false;
+    settings.preview = false;
+    return settings;
+}
+
+} // namespace
+
+int main()
+{
+    const char *text =
+        "# kitchen 3\r\n"
+        "SSID=Kitchen WiFi\r\n"
+        "password = s3cret=value \r\n"
+        "IP=\r\n"
+        "Gateway=192.168.1.1\r\n"
+        "\r\n"
+        "MASK=255.255.255.0\r\n"
+        "api_url = http://10.0.0.2:8000/ \r\n"
+        "DETECTION_THRESHOLD=0.65\r\n"
+        "FRAME_SIZE=hqvga\r\n"
+        "JPEG_QUALITY=99\r\n"          // out of range, refused
+        "CAPTURE_FRAMES=2x\r\n"        // not a number, refused
+        "ADAPTIVE_CAMERA=0\r\n"
+        "JPEG_QUALITY_FLOOR=30\r\n"
+        "CACHE_TTL_S=30\r\n"
+        "capture_log=1\r\n"
+        "PREVIEW=yes\r\n"            // not 0 or 1, refused
+        "no equals sign here\r\n"
+        "UNKNOWN_KEY=1\r\n"
+        "WEIGHT_WINDOW_G=2.5";         // no newline at the end
+
+    Target target;
+    target.settings = Defaults();
+    const size_t entries = ConfigParser::parse(text, strlen(text), Set, &target);
+
+    Expect(entries == 17, "every key=value line is an entry");
+    Expect(unknown == 4, "unknown key and refused values reported");
+    Expect(target.wifi.ssid == "Kitchen WiFi", "SSID with a space");
+    Expect(target.wifi.password == "s3cret=value", "password keeps '=', loses spaces and CR");
+    Expect(target.wifi.ip.empty(), "empty IP");
+    Expect(target.wifi.gateway == "192.168.1.1" && target.wifi.mask == "255.255.255.0", "gateway and mask");
+
+    const settings_t &s = target.settings;
+    Expect(s.apiUrl == "http://10.0.0.2:8000", "API URL without the trailing slash");
+    Expect(s.detectionThreshold == 0.65f, "detection threshold");
+    Expect(s.frameWidth == 240 && s.frameHeight == 176, "frame size by name, any case");
+    Expect(s.jpegQuality == 12, "JPEG quality out of range keeps the default");
+    Expect(s.captureFrames == 3, "capture frames not a number keeps the default");
+    Expect(!s.adaptiveCamera && s.qualityFloor == 30, "adaptive camera off, quality floor");
+    Expect(s.cacheTtlMs == 30000, "cache TTL in ms");
+    Expect(s.captureLog, "capture log switched on");
+    Expect(!s.preview, "preview not switched on by a word");
+    Expect(s.weightWindow == 2.5f, "weight window on the last line");
+
+    // A few hundred entries, as a site with many notes in its config might have
+    std::string big;
+    for (int i = 0; i < 300; i++) {
+        big += "NOTE_" + std::to_string(i) + " = something to skip\n";
+    }
+    big += "CAPTURE_FRAMES=5\n";
+    Target bigTarget;
+    bigTarget.settings = Defaults();
+    unknown = 0;
+    const int rounds = 1000;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        ConfigParser::parse(big.data(), big.size(), Set, &bigTarget);
+    }
+    const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / rounds;
+    Expect(bigTarget.settings.captureFrames == 5, "key after hundreds of others");
+    printf("%zu bytes, 301 entries: %.1f us per parse\n", big.size(), us);
+
+    printf("%s\n", failures ? "FAIL" : "OK");
+    return failures ? 1 : 0;
+}
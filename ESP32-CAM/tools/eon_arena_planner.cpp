@@ -0,0 +1,529 @@
+// Offline memory planner for Edge Impulse EON compiled models.
+//
+// Reads a generated `tflite-model/<name>_compiled.cpp`, recomputes the arena
+// offsets of every kTfLiteArenaRw tensor and prints (or writes back) a smaller
+// layout. Compared to the offsets emitted by the EON compiler it:
+//
+//  - lets element-wise ADD write its output over an input that dies at the
+//    same node (same offset, same size),
+//  - lets PAD write its output over its input when the input dies at the PAD
+//    node: the output is placed so that both buffers end at the same address,
+//    which is safe because the reference PAD kernel copies strictly forward
+//    and never writes past the next input element it still has to read,
+//  - tries alternative topological orders of the graph and reports a better
+//    one if it exists (offsets are only written for the generated order, as
+//    that's the order the runtime executes nodes in),
+//  - places buffers greedily by size (largest first, lowest free offset) with
+//    16-byte alignment.
+//
+// The persistent/scratch headroom that the EON compiler reserved on top of the
+// tensors is kept as-is; scratch buffers are packed into gaps of this layout
+// at runtime by the compiled model itself.
+//
+// Build and run on the host:
+//   g++ -std=c++17 -O2 -Wall -Wextra tools/eon_arena_planner.cpp -o eon_arena_planner
+//   ./eon_arena_planner lib/smart_scale_inferencing/src/tflite-model/tflite_learn_4_compiled.cpp [--write]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const size_t kAlignment = 16;
+const size_t kMaxOrders = 4096;
+
+struct Tensor {
+    bool arena = false;
+    size_t offset = 0;
+    size_t bytes = 0;
+    size_t line = 0; // line of the tensorData row in the source file
+};
+
+struct Node {
+    std::string op;
+    std::vector<int> inputs;
+    std::vector<int> outputs;
+};
+
+struct Model {
+    std::vector<std::string> lines;
+    std::vector<Tensor> tensors;
+    std::vector<Node> nodes;
+    std::vector<int> graphInputs;
+    std::vector<int> graphOutputs;
+    size_t arenaSize = 0;
+};
+
+// A buffer is a set of tensors sharing one memory block, each at a fixed delta
+// from the start of the block.
+struct Buffer {
+    size_t bytes = 0;
+    int first = 0;
+    int last = 0;
+    std::vector<std::pair<int, size_t>> members; // tensor index, delta
+    size_t offset = 0;
+};
+
+struct Plan {
+    std::vector<int> order;
+    std::vector<Buffer> buffers;
+    std::vector<size_t> offsets; // per tensor
+    size_t size = 0;
+    int inPlaceOps = 0;
+};
+
+size_t alignUp(size_t v)
+{
+    return (v + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+std::vector<int> parseIntList(const std::string &s)
+{
+    std::vector<int> out;
+    std::stringstream ss(s);
+    std::string item;
+
+    while (std::getline(ss, item, ',')) {
+        item.erase(std::remove_if(item.begin(), item.end(), ::isspace),
+                   item.end());
+        if (!item.empty()) {
+            out.push_back(std::atoi(item.c_str()));
+        }
+    }
+    return out;
+}
+
+bool loadModel(const char *path, Model &model)
+{
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "ERR: cannot open %s\n", path);
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(in, line)) {
+        model.lines.push_back(line);
+    }
+
+    const std::regex ioRe(
+        R"(TfArray<\d+, int> (inputs|outputs)(\d+) = \{ \d+, \{ ([^}]*) \} \};)");
+    const std::regex rowRe(
+        R"(^\{ (kTfLite\w+), kTfLite\w+, \(int32_t\*\)(.*?), \(TfLiteIntArray\*\)&g0::tensor_dimension\d+, (\d+),)");
+    const std::regex arenaRe(R"(\(tensor_arena \+ (\d+)\))");
+    const std::regex opsRe(R"(^\{(OP_[A-Z0-9_, ]*)\};)");
+    const std::regex arenaSizeRe(R"(constexpr int kTensorArenaSize = (\d+);)");
+
+    std::map<int, Node> nodes;
+    bool inTensorData = false;
+    bool inIn = false, inOut = false;
+    std::vector<std::string> ops;
+
+    for (size_t i = 0; i < model.lines.size(); i++) {
+        const std::string &l = model.lines[i];
+        std::smatch m;
+
+        if (std::regex_search(l, m, ioRe)) {
+            int ix = std::atoi(m[2].str().c_str());
+            (m[1] == "inputs" ? nodes[ix].inputs : nodes[ix].outputs) =
+                parseIntList(m[3]);
+        } else if (l.rfind("TensorInfo_t tensorData[]", 0) == 0) {
+            inTensorData = true;
+        } else if (inTensorData && l.rfind("};", 0) == 0) {
+            inTensorData = false;
+        } else if (inTensorData && std::regex_search(l, m, rowRe)) {
+            Tensor t;
+            t.arena = m[1] == "kTfLiteArenaRw";
+            t.bytes = std::strtoul(m[3].str().c_str(), nullptr, 10);
+            t.line = i;
+            std::smatch a;
+            std::string data = m[2];
+            if (t.arena && std::regex_search(data, a, arenaRe)) {
+                t.offset = std::strtoul(a[1].str().c_str(), nullptr, 10);
+            }
+            model.tensors.push_back(t);
+        } else if (std::regex_search(l, m, opsRe)) {
+            std::string list = m[1];
+            std::stringstream ss(list);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                item.erase(std::remove_if(item.begin(), item.end(), ::isspace),
+                           item.end());
+                if (!item.empty()) {
+                    ops.push_back(item);
+                }
+            }
+        } else if (std::regex_search(l, m, arenaSizeRe)) {
+            size_t v = std::strtoul(m[1].str().c_str(), nullptr, 10);
+            if (model.arenaSize == 0 || v < model.arenaSize) {
+                model.arenaSize = v;
+            }
+        } else if (l.rfind("static const int in_tensor_indices[]", 0) == 0) {
+            inIn = true;
+        } else if (l.rfind("static const int out_tensor_indices[]", 0) == 0) {
+            inOut = true;
+        } else if ((inIn || inOut) && l.rfind("};", 0) == 0) {
+            inIn = inOut = false;
+        } else if (inIn || inOut) {
+            auto v = parseIntList(l);
+            auto &dst = inIn ? model.graphInputs : model.graphOutputs;
+            dst.insert(dst.end(), v.begin(), v.end());
+        }
+    }
+
+    if (ops.size() != nodes.size() || model.tensors.empty()) {
+        fprintf(stderr, "ERR: unexpected file layout (%zu ops, %zu nodes, %zu "
+                        "tensors)\n",
+                ops.size(), nodes.size(), model.tensors.size());
+        return false;
+    }
+
+    for (size_t i = 0; i < ops.size(); i++) {
+        nodes[i].op = ops[i];
+        model.nodes.push_back(nodes[i]);
+    }
+    return true;
+}
+
+bool isArena(const Model &model, int t)
+{
+    return t >= 0 && t < (int)model.tensors.size() && model.tensors[t].arena;
+}
+
+bool contains(const std::vector<int> &v, int x)
+{
+    return std::find(v.begin(), v.end(), x) != v.end();
+}
+
+// Enumerates topological orders (bounded by kMaxOrders).
+void enumerateOrders(const Model &model, std::vector<int> &current,
+                     std::vector<bool> &done, std::vector<std::vector<int>> &out)
+{
+    if (out.size() >= kMaxOrders) {
+        return;
+    }
+    if (current.size() == model.nodes.size()) {
+        out.push_back(current);
+        return;
+    }
+
+    for (size_t n = 0; n < model.nodes.size(); n++) {
+        if (done[n]) {
+            continue;
+        }
+        bool ready = true;
+        for (int in : model.nodes[n].inputs) {
+            for (size_t p = 0; p < model.nodes.size() && ready; p++) {
+                if (!done[p] && contains(model.nodes[p].outputs, in)) {
+                    ready = false;
+                }
+            }
+        }
+        if (!ready) {
+            continue;
+        }
+        done[n] = true;
+        current.push_back((int)n);
+        enumerateOrders(model, current, done, out);
+        current.pop_back();
+        done[n] = false;
+    }
+}
+
+Plan planOrder(const Model &model, const std::vector<int> &order)
+{
+    Plan plan;
+    plan.order = order;
+
+    const int count = (int)model.tensors.size();
+    const int end = (int)order.size();
+    std::vector<int> first(count, -1), last(count, -1);
+
+    for (int t : model.graphInputs) {
+        first[t] = 0;
+        last[t] = 0;
+    }
+    for (int step = 0; step < end; step++) {
+        const Node &node = model.nodes[order[step]];
+        for (int t : node.inputs) {
+            if (isArena(model, t)) {
+                last[t] = std::max(last[t], step);
+            }
+        }
+        for (int t : node.outputs) {
+            if (isArena(model, t)) {
+                if (first[t] < 0) {
+                    first[t] = step;
+                }
+                last[t] = std::max(last[t], step);
+            }
+        }
+    }
+    for (int t : model.graphOutputs) {
+        last[t] = end;
+    }
+
+    std::vector<int> owner(count, -1);
+    std::vector<size_t> delta(count, 0);
+
+    auto newBuffer = [&](int t) {
+        Buffer b;
+        b.bytes = model.tensors[t].bytes;
+        b.first = first[t];
+        b.last = last[t];
+        b.members.push_back({t, 0});
+        owner[t] = (int)plan.buffers.size();
+        plan.buffers.push_back(b);
+    };
+
+    for (int t : model.graphInputs) {
+        if (isArena(model, t) && owner[t] < 0) {
+            newBuffer(t);
+        }
+    }
+
+    for (int step = 0; step < end; step++) {
+        const Node &node = model.nodes[order[step]];
+
+        for (int out : node.outputs) {
+            if (!isArena(model, out) || owner[out] >= 0) {
+                continue;
+            }
+
+            int alias = -1;
+            if (node.op == "OP_ADD" || node.op == "OP_PAD") {
+                for (int in : node.inputs) {
+                    if (!isArena(model, in) || last[in] != step ||
+                        contains(model.graphInputs, in) ||
+                        contains(model.graphOutputs, in) || owner[in] < 0) {
+                        continue;
+                    }
+                    // another input of this node must not live in the same
+                    // buffer, or we'd overwrite it while reading
+                    bool shared = false;
+                    for (int other : node.inputs) {
+                        if (other != in && isArena(model, other) &&
+                            owner[other] == owner[in]) {
+                            shared = true;
+                        }
+                    }
+                    if (shared) {
+                        continue;
+                    }
+                    const size_t inBytes = model.tensors[in].bytes;
+                    const size_t outBytes = model.tensors[out].bytes;
+                    if ((node.op == "OP_ADD" && inBytes == outBytes) ||
+                        (node.op == "OP_PAD" && outBytes >= inBytes)) {
+                        alias = in;
+                        break;
+                    }
+                }
+            }
+
+            if (alias < 0) {
+                newBuffer(out);
+                continue;
+            }
+
+            Buffer &b = plan.buffers[owner[alias]];
+            const size_t shift =
+                model.tensors[out].bytes - model.tensors[alias].bytes;
+            size_t d = delta[alias];
+            if (d < shift) {
+                // grow the buffer at the front so the output can end where
+                // the input ends
+                const size_t grow = alignUp(shift - d);
+                for (auto &m : b.members) {
+                    m.second += grow;
+                    delta[m.first] = m.second;
+                }
+                d = delta[alias];
+            }
+            delta[out] = d - shift;
+            owner[out] = owner[alias];
+            b.members.push_back({out, delta[out]});
+            b.last = std::max(b.last, last[out]);
+            for (auto &m : b.members) {
+                b.bytes = std::max(b.bytes,
+                                   m.second + model.tensors[m.first].bytes);
+            }
+            plan.inPlaceOps++;
+        }
+    }
+
+    // greedy by size: biggest first, lowest offset that doesn't collide with
+    // an already placed buffer whose lifetime overlaps
+    std::vector<int> bySize(plan.buffers.size());
+    for (size_t i = 0; i < bySize.size(); i++) {
+        bySize[i] = (int)i;
+    }
+    std::stable_sort(bySize.begin(), bySize.end(), [&](int a, int b) {
+        return plan.buffers[a].bytes > plan.buffers[b].bytes;
+    });
+
+    std::vector<int> placed;
+    for (int bi : bySize) {
+        Buffer &b = plan.buffers[bi];
+        std::vector<std::pair<size_t, size_t>> busy;
+        for (int pi : placed) {
+            const Buffer &p = plan.buffers[pi];
+            if (p.first <= b.last && b.first <= p.last) {
+                busy.push_back({p.offset, p.offset + p.bytes});
+            }
+        }
+        std::sort(busy.begin(), busy.end());
+
+        size_t candidate = 0;
+        for (auto &r : busy) {
+            if (candidate + b.bytes <= r.first) {
+                break;
+            }
+            candidate = std::max(candidate, alignUp(r.second));
+        }
+        b.offset = candidate;
+        placed.push_back(bi);
+        plan.size = std::max(plan.size, alignUp(b.offset + b.bytes));
+    }
+
+    plan.offsets.assign(count, 0);
+    for (auto &b : plan.buffers) {
+        for (auto &m : b.members) {
+            plan.offsets[m.first] = b.offset + m.second;
+        }
+    }
+    return plan;
+}
+
+size_t currentTensorSize(const Model &model)
+{
+    size_t size = 0;
+    for (auto &t : model.tensors) {
+        if (t.arena) {
+            size = std::max(size, t.offset + t.bytes);
+        }
+    }
+    return size;
+}
+
+bool writeModel(const char *path, Model &model, const Plan &plan,
+                size_t newArena)
+{
+    const std::regex arenaRe(R"(\(tensor_arena \+ \d+\))");
+    const std::regex arenaSizeRe(R"(constexpr int kTensorArenaSize = (\d+);)");
+
+    for (size_t t = 0; t < model.tensors.size(); t++) {
+        if (!model.tensors[t].arena) {
+            continue;
+        }
+        std::string &l = model.lines[model.tensors[t].line];
+        l = std::regex_replace(
+            l, arenaRe, "(tensor_arena + " + std::to_string(plan.offsets[t]) + ")",
+            std::regex_constants::format_first_only);
+    }
+
+    for (auto &l : model.lines) {
+        std::smatch m;
+        if (std::regex_search(l, m, arenaSizeRe)) {
+            // keep the extra headroom some targets reserve on top
+            size_t old = std::strtoul(m[1].str().c_str(), nullptr, 10);
+            size_t v = newArena + (old - model.arenaSize);
+            l = std::regex_replace(l, arenaSizeRe,
+                                   "constexpr int kTensorArenaSize = " +
+                                       std::to_string(v) + ";");
+        }
+    }
+
+    std::ofstream out(path);
+    if (!out) {
+        fprintf(stderr, "ERR: cannot write %s\n", path);
+        return false;
+    }
+    for (auto &l : model.lines) {
+        out << l << "\n";
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <model>_compiled.cpp [--write]\n", argv[0]);
+        return 1;
+    }
+    const bool write = argc > 2 && std::string(argv[2]) == "--write";
+
+    Model model;
+    if (!loadModel(argv[1], model)) {
+        return 1;
+    }
+
+    std::vector<std::vector<int>> orders;
+    std::vector<int> current;
+    std::vector<bool> done(model.nodes.size(), false);
+    enumerateOrders(model, current, done, orders);
+
+    // the runtime executes nodes in the generated order, so that's the plan
+    // we can write back; other orders are only reported
+    std::vector<int> generated(model.nodes.size());
+    for (size_t i = 0; i < generated.size(); i++) {
+        generated[i] = (int)i;
+    }
+    Plan plan = planOrder(model, generated);
+    Plan best = plan;
+    for (auto &order : orders) {
+        Plan p = planOrder(model, order);
+        if (p.size < best.size) {
+            best = p;
+        }
+    }
+
+    const size_t oldTensors = currentTensorSize(model);
+    const size_t headroom = model.arenaSize - oldTensors;
+    const size_t newArena = alignUp(plan.size + headroom);
+
+    printf("nodes: %zu, arena tensors: %zu, orders tried: %zu%s\n",
+           model.nodes.size(),
+           (size_t)std::count_if(model.tensors.begin(), model.tensors.end(),
+                                 [](const Tensor &t) { return t.arena; }),
+           orders.size(), orders.size() >= kMaxOrders ? " (capped)" : "");
+    printf("in-place ops: %d\n", plan.inPlaceOps);
+    printf("tensor area: %zu -> %zu bytes\n", oldTensors, plan.size);
+    printf("kTensorArenaSize: %zu -> %zu bytes (persistent headroom %zu)\n",
+           model.arenaSize, newArena, headroom);
+
+    if (best.size < plan.size) {
+        printf("node order");
+        for (int n : best.order) {
+            printf(" %d", n);
+        }
+        printf(" would need %zu bytes, reorder the graph to use it\n",
+               best.size);
+    }
+
+    for (size_t t = 0; t < model.tensors.size(); t++) {
+        if (model.tensors[t].arena) {
+            printf("  tensor %3zu: %7zu bytes @ %7zu (was %7zu)\n", t,
+                   model.tensors[t].bytes, plan.offsets[t],
+                   model.tensors[t].offset);
+        }
+    }
+
+    if (!write) {
+        return 0;
+    }
+    if (plan.size >= oldTensors) {
+        printf("no improvement, file left untouched\n");
+        return 0;
+    }
+    return writeModel(argv[1], model, plan, newArena) ? 0 : 1;
+}
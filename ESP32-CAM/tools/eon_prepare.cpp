@@ -0,0 +1,316 @@
+// Ahead-of-time kernel preparation for the EON compiled model.
+//
+// tflite_learn_4_init() normally calls init and prepare on every node each time
+// the graph is set up (which the EON runtime does before every inference). For
+// our int8 graph that means recomputing per-channel output multipliers/shifts,
+// activation ranges and padding, and planning scratch buffers - all of which is
+// fixed for a given model. This tool runs that pass once on the host, with the
+// same ESP-NN kernel variant as the ESP32, and writes the result to
+// `tflite-model/tflite_learn_4_prepared.h` as const data:
+//
+//  - the kernel data (OpData / NodeData) of every node, with the per-channel
+//    arrays emitted next to it,
+//  - the arena offset, size and node of every scratch buffer,
+//  - the arena size and a hash of the tensor layout, which the device checks
+//    before using the data.
+//
+// When that header is present and the build uses the plain ESP32 ESP-NN
+// kernels, tflite_learn_4_init() only points the nodes at the prepared data.
+// Define EI_CLASSIFIER_EON_RUNTIME_PREPARE to always prepare at runtime.
+// Re-run the tool whenever the model or tools/eon_arena_planner.cpp changes the
+// compiled model.
+//
+// Build and run on the host, from ESP32-CAM/. The SDK is built without warnings, the
+// tool with -Wall -Wextra:
+//   SRC=lib/smart_scale_inferencing/src
+//   FLAGS="-O2 -DEI_CLASSIFIER_TFLITE_ENABLE_ESP_NN=1 -DEI_PORTING_CLIB=1 -DTF_LITE_DISABLE_X86_NEON -Itools/host -isystem $SRC -isystem $SRC/edge-impulse-sdk"
+//   ESP_NN=$(find $SRC/edge-impulse-sdk/porting/espressif/ESP-NN/src -name '*_ansi.c' -o -name '*_opt.c')
+//   SDK=$(find $SRC/edge-impulse-sdk/tensorflow $SRC/edge-impulse-sdk/dsp/kissfft -name '*.cc' -o -name '*.cpp')
+//   gcc $FLAGS -w -c $SRC/edge-impulse-sdk/tensorflow/lite/c/common.c $ESP_NN
+//   g++ -std=c++17 $FLAGS -Wall -Wextra -c tools/eon_prepare.cpp
+//   g++ -std=c++17 $FLAGS -w eon_prepare.o common.o *_ansi.o *_opt.o $SDK $SRC/edge-impulse-sdk/porting/clib/*.cpp -o eon_prepare -lm
+//   ./eon_prepare $SRC/tflite-model/tflite_learn_4_prepared.h
+
+#define EI_CLASSIFIER_EON_RUNTIME_PREPARE 1
+#include "tflite-model/tflite_learn_4_compiled.cpp"
+#include "edge-impulse-sdk/tensorflow/lite/micro/kernels/esp_nn_node_data.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if !defined(EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN) || EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN != 1
+#error "Build with -DEI_CLASSIFIER_TFLITE_ENABLE_ESP_NN=1, the prepared data has to match the ESP32 kernels"
+#endif
+
+namespace
+{
+
+// The user_data of the ESP-NN conv, depthwise, pad and softmax nodes, which the
+// header below mirrors and checks its mirrors against. ADD uses the public
+// tflite::OpDataAdd as-is.
+typedef tflite::EspNnConvNodeData ConvData;
+typedef tflite::PadOpData PadData;
+typedef tflite::EspNnSoftmaxNodeData SoftmaxData;
+
+std::string Float(float v)
+{
+    if (std::isinf(v)) {
+        return v < 0 ? "-std::numeric_limits<float>::infinity()" : "std::numeric_limits<float>::infinity()";
+    }
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.9g", v);
+    std::string literal = buf;
+    if (literal.find_first_of(".e") == std::string::npos) {
+        literal += ".0";
+    }
+    return literal + "f";
+}
+
+std::string Double(double v)
+{
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%.17g", v);
+    return buf;
+}
+
+void EmitArray(FILE *out, const char *name, size_t node, const int32_t *data, int count)
+{
+    fprintf(out, "const int32_t node%zu_%s[%d] = {", node, name, count);
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "%s%ld", i == 0 ? "\n    " : i % 8 ? ", " : ",\n    ", (long)data[i]);
+    }
+    fprintf(out, "\n};\n");
+}
+
+bool EmitConv(FILE *out, size_t node, const TfLiteNode &n, int quantizedDimension)
+{
+    const ConvData &d = *static_cast<const ConvData *>(n.user_data);
+    const tflite::OpDataConv &o = d.op_data;
+    const int channels = tensorData[n.inputs->data[1]].dims->data[quantizedDimension];
+
+    EmitArray(out, "multiplier", node, o.per_channel_output_multiplier, channels);
+    EmitArray(out, "shift", node, o.per_channel_output_shift, channels);
+    fprintf(out, "const ConvData node%zu = { { { %d, %d, %d, %d }, %ld, %ld, %ld, %ld, %d,\n"
+                 "    const_cast<int32_t*>(node%zu_multiplier), const_cast<int32_t*>(node%zu_shift),\n"
+                 "    %ld, %ld, %d }, %d };\n\n",
+        node, o.padding.width, o.padding.height, o.padding.width_offset, o.padding.height_offset,
+        (long)o.input_zero_point, (long)o.filter_zero_point, (long)o.output_zero_point,
+        (long)o.output_multiplier, o.output_shift, node, node,
+        (long)o.output_activation_min, (long)o.output_activation_max, o.filter_buffer_index,
+        d.buffer_idx);
+    return true;
+}
+
+bool EmitPad(FILE *out, size_t node, const TfLiteNode &n)
+{
+    const PadData &d = *static_cast<const PadData *>(n.user_data);
+    const tflite::PadParams &p = d.params;
+
+    fprintf(out, "const PadData node%zu = { { %d, { %ld, %ld, %ld, %ld, %ld }, %d, { %ld, %ld, %ld, %ld, %ld },\n"
+                 "    static_cast<tflite::ResizingCategory>(%d) }, %ld };\n\n",
+        node, p.left_padding_count,
+        (long)p.left_padding[0], (long)p.left_padding[1], (long)p.left_padding[2], (long)p.left_padding[3], (long)p.left_padding[4],
+        p.right_padding_count,
+        (long)p.right_padding[0], (long)p.right_padding[1], (long)p.right_padding[2], (long)p.right_padding[3], (long)p.right_padding[4],
+        (int)p.resizing_category, (long)d.output_zero_point);
+    return true;
+}
+
+bool EmitAdd(FILE *out, size_t node, const TfLiteNode &n)
+{
+    const tflite::OpDataAdd &d = *static_cast<const tflite::OpDataAdd *>(n.user_data);
+
+    fprintf(out, "const tflite::OpDataAdd node%zu = { %s, %d, %d, %ld, %ld,\n"
+                 "    %ld, %ld, %ld, %d, %d, %ld, %ld, %ld,\n"
+                 "    %s, %s };\n\n",
+        node, d.requires_broadcast ? "true" : "false", d.input1_shift, d.input2_shift,
+        (long)d.output_activation_min, (long)d.output_activation_max,
+        (long)d.input1_multiplier, (long)d.input2_multiplier, (long)d.output_multiplier, d.output_shift,
+        d.left_shift, (long)d.input1_offset, (long)d.input2_offset, (long)d.output_offset,
+        Float(d.output_activation_min_f32).c_str(), Float(d.output_activation_max_f32).c_str());
+    return true;
+}
+
+bool EmitSoftmax(FILE *out, size_t node, const TfLiteNode &n)
+{
+    const SoftmaxData &d = *static_cast<const SoftmaxData *>(n.user_data);
+    const tflite::SoftmaxParams &p = d.op_data;
+
+    // lookup tables are only allocated for int16 softmax, which this tool doesn't handle
+    if (p.table || p.exp_lut || p.one_over_one_plus_x_lut || p.uint8_table1 || p.uint8_table2) {
+        fprintf(stderr, "node %zu: softmax with lookup tables is not supported\n", node);
+        return false;
+    }
+
+    fprintf(out, "const SoftmaxData node%zu = { { %s, %ld, %ld, %ld, %ld, %d, %ld, %s,\n"
+                 "    nullptr, nullptr, nullptr, nullptr, nullptr }, %d };\n\n",
+        node, Double(p.beta).c_str(), (long)p.input_multiplier, (long)p.input_left_shift,
+        (long)p.reverse_scaling_divisor, (long)p.reverse_scaling_right_shift, p.diff_min,
+        (long)p.zero_point, Float(p.scale).c_str(), d.buffer_idx);
+    return true;
+}
+
+void *AlignedCalloc(size_t align, size_t size)
+{
+    void *ptr = aligned_alloc(align, (size + align - 1) / align * align);
+    if (ptr) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc > 2) {
+        fprintf(stderr, "usage: %s [output header]\n", argv[0]);
+        return 1;
+    }
+
+    static EonSession session;
+    if (tflite_learn_4_init_session(&session, AlignedCalloc) != kTfLiteOk) {
+        fprintf(stderr, "tflite_learn_4_init_session failed\n");
+        return 1;
+    }
+
+    // the device only gets arena offsets, so nothing may live on the heap
+    for (size_t ix = 0; ix < session.scratch_buffers_ix; ix++) {
+        uint8_t *ptr = (uint8_t *)session.scratch_buffers[ix].ptr;
+        if (ptr < session.arena || ptr + session.scratch_buffers[ix].bytes > session.arena + kTensorArenaSize) {
+            fprintf(stderr, "scratch buffer %zu does not fit in the tensor arena\n", ix);
+            return 1;
+        }
+    }
+
+    FILE *out = argc > 1 ? fopen(argv[1], "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "failed to open %s\n", argv[1]);
+        return 1;
+    }
+
+    fprintf(out,
+        "// Generated by tools/eon_prepare.cpp from tflite_learn_4_compiled.cpp, do not edit.\n"
+        "//\n"
+        "// Kernel data of every node and the scratch buffer plan, as computed by the init/prepare\n"
+        "// pass of the ESP-NN kernels (ESP32 variant). tflite_learn_4_init() uses this instead of\n"
+        "// running that pass on the device.\n"
+        "\n"
+        "#ifndef TFLITE_LEARN_4_PREPARED_H\n"
+        "#define TFLITE_LEARN_4_PREPARED_H\n"
+        "\n"
+        "#include \"edge-impulse-sdk/classifier/ei_classifier_config.h\"\n"
+        "\n"
+        "#if EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN == 1 && !defined(EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN_S3) && \\\n"
+        "    !defined(EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN_P4) && !defined(EI_CLASSIFIER_EON_RUNTIME_PREPARE)\n"
+        "#define TFLITE_LEARN_4_PREPARED 1\n"
+        "\n"
+        "#include <cstddef>\n"
+        "#include <limits>\n"
+        "#include \"edge-impulse-sdk/tensorflow/lite/kernels/internal/types.h\"\n"
+        "#include \"edge-impulse-sdk/tensorflow/lite/micro/kernels/add.h\"\n"
+        "#include \"edge-impulse-sdk/tensorflow/lite/micro/kernels/conv.h\"\n"
+        "#include \"edge-impulse-sdk/tensorflow/lite/micro/kernels/esp_nn_node_data.h\"\n"
+        "\n"
+        "namespace tflite_learn_4_prepared {\n"
+        "\n"
+        "// Same layout as the node data of the ESP-NN conv, depthwise, pad and softmax kernels\n"
+        "// (kernels/esp_nn_node_data.h), checked below: the data is written for that layout\n"
+        "struct ConvData {\n"
+        "  tflite::OpDataConv op_data;\n"
+        "  int buffer_idx;\n"
+        "};\n"
+        "\n"
+        "struct PadData {\n"
+        "  tflite::PadParams params;\n"
+        "  int32_t output_zero_point;\n"
+        "};\n"
+        "\n"
+        "struct SoftmaxData {\n"
+        "  tflite::SoftmaxParams op_data;\n"
+        "  int buffer_idx;\n"
+        "};\n"
+        "\n"
+        "static_assert(sizeof(ConvData) == sizeof(tflite::EspNnConvNodeData) &&\n"
+        "              offsetof(ConvData, op_data) == offsetof(tflite::EspNnConvNodeData, op_data) &&\n"
+        "              offsetof(ConvData, buffer_idx) == offsetof(tflite::EspNnConvNodeData, buffer_idx),\n"
+        "              \"conv node data changed, run tools/eon_prepare.cpp again\");\n"
+        "static_assert(sizeof(PadData) == sizeof(tflite::PadOpData) &&\n"
+        "              offsetof(PadData, params) == offsetof(tflite::PadOpData, params) &&\n"
+        "              offsetof(PadData, output_zero_point) == offsetof(tflite::PadOpData, output_zero_point),\n"
+        "              \"pad node data changed, run tools/eon_prepare.cpp again\");\n"
+        "static_assert(sizeof(SoftmaxData) == sizeof(tflite::EspNnSoftmaxNodeData) &&\n"
+        "              offsetof(SoftmaxData, op_data) == offsetof(tflite::EspNnSoftmaxNodeData, op_data) &&\n"
+        "              offsetof(SoftmaxData, buffer_idx) == offsetof(tflite::EspNnSoftmaxNodeData, buffer_idx),\n"
+        "              \"softmax node data changed, run tools/eon_prepare.cpp again\");\n"
+        "\n"
+        "struct ScratchBuffer {\n"
+        "  uint32_t offset;\n"
+        "  uint32_t bytes;\n"
+        "  int16_t node;\n"
+        "};\n"
+        "\n"
+        "const int kArenaSize = %d;\n"
+        "const uint32_t kTensorLayoutHash = 0x%08lx;\n"
+        "\n",
+        kTensorArenaSize, (unsigned long)TensorLayoutHash());
+
+    for (size_t i = 0; i < 27; i++) {
+        bool ok = false;
+        switch (used_ops[i]) {
+            case OP_CONV_2D:
+                ok = EmitConv(out, i, session.nodes[i], 0);
+                break;
+            case OP_DEPTHWISE_CONV_2D:
+                ok = EmitConv(out, i, session.nodes[i], 3);
+                break;
+            case OP_PAD:
+                ok = EmitPad(out, i, session.nodes[i]);
+                break;
+            case OP_ADD:
+                ok = EmitAdd(out, i, session.nodes[i]);
+                break;
+            case OP_SOFTMAX:
+                ok = EmitSoftmax(out, i, session.nodes[i]);
+                break;
+            default:
+                fprintf(stderr, "node %zu: unsupported op %d\n", i, (int)used_ops[i]);
+                break;
+        }
+        if (!ok) {
+            return 1;
+        }
+    }
+
+    fprintf(out, "const void* const node_data[27] = {");
+    for (size_t i = 0; i < 27; i++) {
+        fprintf(out, "%s&node%zu", i == 0 ? "\n  " : i % 8 ? ", " : ",\n  ", i);
+    }
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out, "const size_t scratch_buffer_count = %zu;\n", session.scratch_buffers_ix);
+    fprintf(out, "const ScratchBuffer scratch_buffers[%zu] = {\n", session.scratch_buffers_ix ? session.scratch_buffers_ix : 1);
+    for (size_t ix = 0; ix < session.scratch_buffers_ix; ix++) {
+        const scratch_buffer_t &b = session.scratch_buffers[ix];
+        fprintf(out, "  { %lu, %lu, %d },\n",
+            (unsigned long)((uint8_t *)b.ptr - session.arena), (unsigned long)b.bytes, (int)b.node);
+    }
+    if (!session.scratch_buffers_ix) {
+        fprintf(out, "  { 0, 0, -1 },\n");
+    }
+    fprintf(out, "};\n"
+                 "\n"
+                 "} // namespace tflite_learn_4_prepared\n"
+                 "\n"
+                 "#endif // EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN\n"
+                 "#endif // TFLITE_LEARN_4_PREPARED_H\n");
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    tflite_learn_4_reset_session(&session, free);
+    return 0;
+}
@@ -0,0 +1,144 @@
+// Concurrency stress test for the EON runtime sessions.
+//
+// Every ei_impulse_handle_t gets its own EON session (arena, tensors, kernel
+// data, scratch buffers), so handles on different threads can run the impulse
+// at the same time. This runs the full impulse on a few synthetic frames,
+// first one after the other for reference results, then on one thread per
+// frame with a handle each, and checks that every concurrent run reproduces
+// the reference bounding boxes exactly. Any state that is still shared between
+// sessions shows up as mismatching boxes (or a crash).
+//
+// Build and run on the host, from ESP32-CAM/ (add -DEI_CLASSIFIER_TFLITE_ENABLE_ESP_NN=1
+// and the ESP-NN sources as in tools/eon_prepare.cpp to test the ESP32 kernels):
+//   SRC=lib/smart_scale_inferencing/src
+//   FLAGS="-O2 -DEI_PORTING_CLIB=1 -DTF_LITE_DISABLE_X86_NEON -Itools/host -isystem $SRC -isystem $SRC/edge-impulse-sdk"
+//   SDK=$(find $SRC/edge-impulse-sdk/tensorflow $SRC/edge-impulse-sdk/dsp $SRC/tflite-model -name '*.cc' -o -name '*.cpp')
+//   gcc $FLAGS -w -c $SRC/edge-impulse-sdk/tensorflow/lite/c/common.c
+//   g++ -std=c++17 $FLAGS -Wall -Wextra -c tools/eon_session_stress.cpp
+//   g++ -std=c++17 $FLAGS -w eon_session_stress.o common.o $SDK $SRC/edge-impulse-sdk/porting/clib/*.cpp -o eon_session_stress -lm -lpthread
+//   ./eon_session_stress [threads] [iterations]
+
+#include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct Frame {
+    std::vector<uint8_t> rgb;
+    ei_impulse_result_bounding_box_t boxes[EI_CLASSIFIER_OBJECT_DETECTION_COUNT];
+    uint32_t box_count;
+};
+
+// plain background with a red blob, placed differently for every frame
+void DrawFrame(Frame &frame, size_t ix)
+{
+    const int w = EI_CLASSIFIER_INPUT_WIDTH, h = EI_CLASSIFIER_INPUT_HEIGHT;
+    const int cx = 16 + (int)(ix * 23) % (w - 32), cy = 16 + (int)(ix * 37) % (h - 32);
+    frame.rgb.resize(w * h * 3);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            uint8_t *p = &frame.rgb[(y * w + x) * 3];
+            if ((x - cx) * (x - cx) + (y - cy) * (y - cy) < 150) {
+                p[0] = 200; p[1] = (uint8_t)(40 + ix); p[2] = 30;
+            }
+            else {
+                p[0] = 220; p[1] = 220; p[2] = 210;
+            }
+        }
+    }
+}
+
+EI_IMPULSE_ERROR RunFrame(ei_impulse_handle_t *handle, const Frame &frame, ei_impulse_result_t *result,
+    ei_impulse_result_bounding_box_t *boxes = nullptr)
+{
+    signal_t signal;
+    signal.total_length = EI_CLASSIFIER_INPUT_WIDTH * EI_CLASSIFIER_INPUT_HEIGHT;
+    signal.get_data = [&frame](size_t offset, size_t length, float *out) {
+        for (size_t i = 0; i < length; i++) {
+            const uint8_t *p = &frame.rgb[(offset + i) * 3];
+            out[i] = (float)((p[0] << 16) + (p[1] << 8) + p[2]);
+        }
+        return 0;
+    };
+    if (boxes) {
+        // Nothing is read from the result, stale pointers in it must not matter
+        memset(result, 0xa5, sizeof(*result));
+        return run_classifier_with_buffers(handle, &signal, result, boxes, EI_CLASSIFIER_OBJECT_DETECTION_COUNT);
+    }
+    return run_classifier(handle, &signal, result, false);
+}
+
+bool SameBoxes(const Frame &frame, const ei_impulse_result_t &result)
+{
+    if (result.bounding_boxes_count != frame.box_count) {
+        return false;
+    }
+    for (uint32_t i = 0; i < frame.box_count; i++) {
+        const ei_impulse_result_bounding_box_t &a = frame.boxes[i], &b = result.bounding_boxes[i];
+        if (strcmp(a.label, b.label) != 0 || a.value != b.value || a.x != b.x || a.y != b.y ||
+            a.width != b.width || a.height != b.height) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const size_t threads = argc > 1 ? (size_t)atoi(argv[1]) : 4;
+    const size_t iterations = argc > 2 ? (size_t)atoi(argv[2]) : 20;
+
+    std::vector<Frame> frames(threads);
+    size_t frames_with_boxes = 0;
+    for (size_t ix = 0; ix < threads; ix++) {
+        DrawFrame(frames[ix], ix);
+
+        ei_impulse_result_t result = {};
+        if (RunFrame(&ei_default_impulse, frames[ix], &result) != EI_IMPULSE_OK) {
+            fprintf(stderr, "reference run %zu failed\n", ix);
+            return 1;
+        }
+        frames[ix].box_count = result.bounding_boxes_count;
+        memcpy(frames[ix].boxes, result.bounding_boxes, result.bounding_boxes_count * sizeof(result.bounding_boxes[0]));
+        frames_with_boxes += frames[ix].box_count > 0;
+    }
+
+    std::vector<size_t> failures(threads, 0);
+    std::vector<std::thread> workers;
+    for (size_t ix = 0; ix < threads; ix++) {
+        workers.emplace_back([&, ix]() {
+            ei_impulse_handle_t handle(ei_default_impulse.impulse);
+            ei_impulse_result_bounding_box_t boxes[EI_CLASSIFIER_OBJECT_DETECTION_COUNT];
+            for (size_t it = 0; it < iterations; it++) {
+                // odd iterations write the boxes into this thread's own array
+                ei_impulse_result_t result = {};
+                ei_impulse_result_bounding_box_t *own = it % 2 ? boxes : nullptr;
+                if (RunFrame(&handle, frames[ix], &result, own) != EI_IMPULSE_OK ||
+                    !SameBoxes(frames[ix], result) || (own && result.bounding_boxes != own)) {
+                    failures[ix]++;
+                }
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    size_t total_failures = 0;
+    for (size_t ix = 0; ix < threads; ix++) {
+        printf("thread %zu: %zu box(es), %zu/%zu runs differ from the reference\n",
+            ix, (size_t)frames[ix].box_count, failures[ix], iterations);
+        total_failures += failures[ix];
+    }
+    printf("%zu threads x %zu runs, %zu/%zu frames with detections: %s\n",
+        threads, iterations, frames_with_boxes, threads, total_failures ? "FAIL" : "OK");
+    return total_failures ? 1 : 0;
+}
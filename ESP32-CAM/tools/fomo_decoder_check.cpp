@@ -0,0 +1,230 @@
+// Compares the allocation free FOMO decoder (union-find over the output grid, raw
+// int8 compares) with the cube based decoder it replaces.
+//
+// The model is run on synthetic frames (one to three coloured blobs on a plain
+// background) and both decoders get every output tensor at a range of thresholds.
+// From the impulse's own threshold up the boxes must be identical. Below it the
+// heatmaps get noisy and the cube decoder's results depend on the order it visits
+// cells in: it reports a box before later cubes of the same object are merged into
+// it, and joins cells that only touch a box's bounding rectangle. Those differences,
+// and the ones on random heatmaps, are reported but do not fail the check.
+//
+// Build and run on the host, from ESP32-CAM/:
+//   SRC=lib/smart_scale_inferencing/src
+//   FLAGS="-O2 -DEI_PORTING_CLIB=1 -DTF_LITE_DISABLE_X86_NEON -Itools/host -isystem $SRC -isystem $SRC/edge-impulse-sdk"
+//   SDK=$(find $SRC/edge-impulse-sdk/tensorflow $SRC/edge-impulse-sdk/dsp $SRC/tflite-model -name '*.cc' -o -name '*.cpp')
+//   gcc $FLAGS -w -c $SRC/edge-impulse-sdk/tensorflow/lite/c/common.c
+//   g++ -std=c++17 $FLAGS -Wall -Wextra -c tools/fomo_decoder_check.cpp
+//   g++ -std=c++17 $FLAGS -w fomo_decoder_check.o common.o $SDK $SRC/edge-impulse-sdk/porting/clib/*.cpp -o fomo_decoder_check -lm
+//   ./fomo_decoder_check [frames]
+
+#include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+const int kGrid = EI_CLASSIFIER_INPUT_WIDTH / 8;
+const int kStride = EI_CLASSIFIER_LABEL_COUNT + 1;
+
+struct Boxes {
+    std::vector<ei_impulse_result_bounding_box_t> boxes;
+};
+
+// blobs of random colour and size on a light background, quantized like the image DSP block does
+void DrawFrame(std::mt19937 &rng, TfLiteTensor *input)
+{
+    const int w = EI_CLASSIFIER_INPUT_WIDTH, h = EI_CLASSIFIER_INPUT_HEIGHT;
+    std::vector<uint8_t> rgb(w * h * 3);
+    const uint8_t bg = 180 + rng() % 60;
+    for (size_t i = 0; i < rgb.size(); i++) {
+        rgb[i] = bg;
+    }
+    const int blobs = 1 + rng() % 3;
+    for (int b = 0; b < blobs; b++) {
+        const int cx = rng() % w, cy = rng() % h, r2 = 30 + rng() % 300;
+        const uint8_t c[3] = { (uint8_t)(rng() % 256), (uint8_t)(rng() % 256), (uint8_t)(rng() % 256) };
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                if ((x - cx) * (x - cx) + (y - cy) * (y - cy) < r2) {
+                    memcpy(&rgb[(y * w + x) * 3], c, 3);
+                }
+            }
+        }
+    }
+    const float scale = input->params.scale;
+    const int zero_point = input->params.zero_point;
+    for (size_t i = 0; i < rgb.size(); i++) {
+        int q = (int)roundf((rgb[i] / 255.0f) / scale) + zero_point;
+        input->data.int8[i] = (int8_t)(q < -128 ? -128 : q > 127 ? 127 : q);
+    }
+}
+
+// sparse random blobs per class, with scattered single cells
+void RandomHeatmap(std::mt19937 &rng, int8_t *data)
+{
+    for (int i = 0; i < kGrid * kGrid * kStride; i++) {
+        data[i] = -128 + rng() % 40;
+    }
+    const int blobs = rng() % 6;
+    for (int b = 0; b < blobs; b++) {
+        const int ix = 1 + rng() % EI_CLASSIFIER_LABEL_COUNT;
+        const int x0 = rng() % kGrid, y0 = rng() % kGrid, bw = 1 + rng() % 4, bh = 1 + rng() % 4;
+        for (int y = y0; y < y0 + bh && y < kGrid; y++) {
+            for (int x = x0; x < x0 + bw && x < kGrid; x++) {
+                if (rng() % 5) {
+                    data[(y * kGrid + x) * kStride + ix] = rng() % 256 - 128;
+                }
+            }
+        }
+    }
+}
+
+Boxes Collect(const ei_impulse_result_t &result)
+{
+    Boxes out;
+    out.boxes.assign(result.bounding_boxes, result.bounding_boxes + result.bounding_boxes_count);
+    return out;
+}
+
+// same boxes, except that the cube decoder left out part of an object (a smaller box,
+// possibly a lower confidence)
+bool LegacyMissesFragment(const Boxes &cubes, const Boxes &ccl)
+{
+    if (cubes.boxes.size() != ccl.boxes.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < cubes.boxes.size(); i++) {
+        const ei_impulse_result_bounding_box_t &x = cubes.boxes[i], &y = ccl.boxes[i];
+        if (strcmp(x.label, y.label) != 0 || y.value < x.value || y.x > x.x || y.y > x.y ||
+            y.x + y.width < x.x + x.width || y.y + y.height < x.y + x.height) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Same(const Boxes &a, const Boxes &b)
+{
+    if (a.boxes.size() != b.boxes.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.boxes.size(); i++) {
+        const ei_impulse_result_bounding_box_t &x = a.boxes[i], &y = b.boxes[i];
+        if (strcmp(x.label, y.label) != 0 || x.value != y.value || x.x != y.x || x.y != y.y ||
+            x.width != y.width || x.height != y.height) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Print(const char *name, const Boxes &b)
+{
+    printf("  %s:", name);
+    for (auto &box : b.boxes) {
+        printf(" [%s %.4f %u %u %u %u]", box.label, box.value, box.x, box.y, box.width, box.height);
+    }
+    printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const int frames = argc > 1 ? atoi(argv[1]) : 500;
+    const float thresholds[] = { 0.05f, 0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f, 0.7f, 0.8f, 0.9f };
+
+    const ei_impulse_t *impulse = ei_default_impulse.impulse;
+    ei_learning_block_config_tflite_graph_t block_config =
+        *(const ei_learning_block_config_tflite_graph_t *)impulse->learning_blocks[0].config;
+
+    if (tflite_learn_4_init(ei_aligned_calloc) != kTfLiteOk) {
+        fprintf(stderr, "model init failed\n");
+        return 1;
+    }
+    TfLiteTensor input, output;
+    tflite_learn_4_input(0, &input);
+    tflite_learn_4_output(0, &output);
+
+    std::mt19937 rng(1234);
+    const float configured_threshold = block_config.threshold;
+    size_t model_cases = 0, model_boxes = 0, model_mismatches = 0, low_fragments = 0, low_regrouped = 0;
+    double cube_us = 0, ccl_us = 0;
+
+    for (int f = 0; f < frames; f++) {
+        DrawFrame(rng, &input);
+        if (tflite_learn_4_invoke() != kTfLiteOk) {
+            fprintf(stderr, "invoke failed\n");
+            return 1;
+        }
+        for (float threshold : thresholds) {
+            block_config.threshold = threshold;
+            ei_impulse_result_t result = {};
+
+            auto t0 = std::chrono::steady_clock::now();
+            fill_result_struct_i8_fomo_cubes(impulse, &block_config, &result, output.data.int8,
+                output.params.zero_point, output.params.scale, kGrid, kGrid);
+            auto t1 = std::chrono::steady_clock::now();
+            Boxes cubes = Collect(result);
+
+            fill_result_struct_i8_fomo(impulse, &block_config, &result, output.data.int8,
+                output.params.zero_point, output.params.scale, kGrid, kGrid);
+            auto t2 = std::chrono::steady_clock::now();
+            Boxes ccl = Collect(result);
+
+            cube_us += std::chrono::duration<double, std::micro>(t1 - t0).count();
+            ccl_us += std::chrono::duration<double, std::micro>(t2 - t1).count();
+            model_cases++;
+            model_boxes += ccl.boxes.size();
+            if (Same(cubes, ccl)) {
+                continue;
+            }
+            if (threshold < configured_threshold) {
+                if (LegacyMissesFragment(cubes, ccl)) {
+                    low_fragments++;
+                }
+                else {
+                    low_regrouped++;
+                }
+            }
+            else if (model_mismatches++ < 5) {
+                printf("frame %d, threshold %.2f differs\n", f, threshold);
+                Print("cubes", cubes);
+                Print("ccl  ", ccl);
+            }
+        }
+    }
+    tflite_learn_4_reset(ei_aligned_free);
+
+    std::vector<int8_t> heatmap(kGrid * kGrid * kStride);
+    size_t random_cases = 10000, random_mismatches = 0;
+    block_config.threshold = configured_threshold;
+    for (size_t i = 0; i < random_cases; i++) {
+        RandomHeatmap(rng, heatmap.data());
+        ei_impulse_result_t result = {};
+        fill_result_struct_i8_fomo_cubes(impulse, &block_config, &result, heatmap.data(),
+            output.params.zero_point, output.params.scale, kGrid, kGrid);
+        Boxes cubes = Collect(result);
+        fill_result_struct_i8_fomo(impulse, &block_config, &result, heatmap.data(),
+            output.params.zero_point, output.params.scale, kGrid, kGrid);
+        random_mismatches += !Same(cubes, Collect(result));
+    }
+
+    printf("model outputs: %zu decodes, %zu boxes, %zu mismatches at threshold >= %.2f\n",
+        model_cases, model_boxes, model_mismatches, configured_threshold);
+    printf("below %.2f: %zu decodes where the cube decoder leaves out part of an object, %zu grouped differently\n",
+        configured_threshold, low_fragments, low_regrouped);
+    printf("per decode: cubes %.2f us, union-find %.2f us\n", cube_us / model_cases, ccl_us / model_cases);
+    printf("random heatmaps: %zu/%zu differ from the cube decoder (informational)\n",
+        random_mismatches, random_cases);
+    printf("%s\n", model_mismatches ? "FAIL" : "OK");
+    return model_mismatches ? 1 : 0;
+}
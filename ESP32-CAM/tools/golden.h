@@ -0,0 +1,462 @@
+// Golden image regression data of the impulse, shared by tools/golden_check.cpp and the
+// test/test_golden suite: what a corpus of plate photos looks like to the model (input tensor,
+// every layer, FOMO boxes, timings), golden.bin that keeps it, and the comparison against it.
+// See golden_check.cpp for the tolerances and how to record a corpus.
+//
+// Include it in the one translation unit that holds the impulse (ei_run_classifier.h defines
+// the model's globals).
+#pragma once
+
+#include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+#include "edge-impulse-sdk/dsp/image/image.hpp"
+#include "img_converters.h"
+
+#include <dirent.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace golden
+{
+
+const char kMagic[8] = { 'E', 'I', 'G', 'O', 'L', 'D', '1', 0 };
+const char *const kStageNames[] = { "dsp", "classification", "anomaly" };
+const int kStages = 3;
+
+struct Tensor {
+    int32_t layer;
+    int32_t type;
+    float scale;
+    int32_t zero_point;
+    std::vector<uint8_t> data;
+};
+
+struct Box {
+    std::string label;
+    float value;
+    uint32_t x, y, width, height;
+};
+
+struct Image {
+    std::string name;
+    std::vector<Tensor> tensors; // input (layer -1), then every layer
+    std::vector<Box> boxes;
+};
+
+struct Golden {
+    std::vector<Image> images;
+    int64_t p50_us[kStages]; // over the corpus, -1 if no timings were recorded
+};
+
+struct Options {
+    bool record = false;
+    bool timing = true;
+    int runs = 5;
+    int input_tolerance = 1;
+    int layer_tolerance = 1;
+    float changed_share = 0.02f;
+    uint32_t box_tolerance = 8; // one FOMO cell
+    float score_tolerance = 0.05f;
+    float threshold = 0.10f;
+    int64_t slack_us = 200;
+};
+
+inline std::vector<uint8_t> rgb; // BGR out of the decoder, like the firmware's snapshot buffer
+
+inline int GetData(size_t offset, size_t length, float *out_ptr)
+{
+    for (size_t i = 0; i < length; i++) {
+        const uint8_t *p = &rgb[(offset + i) * 3];
+        out_ptr[i] = (p[2] << 16) + (p[1] << 8) + p[0];
+    }
+    return 0;
+}
+
+inline void Observe(int layer, const TfLiteTensor *tensor, void *user)
+{
+    Tensor t;
+    t.layer = layer;
+    t.type = tensor->type;
+    t.scale = tensor->params.scale;
+    t.zero_point = tensor->params.zero_point;
+    t.data.assign(tensor->data.uint8, tensor->data.uint8 + tensor->bytes);
+    static_cast<std::vector<Tensor> *>(user)->push_back(std::move(t));
+}
+
+inline bool ReadFile(const std::string &path, std::vector<uint8_t> &data)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    uint8_t chunk[4096];
+    size_t n;
+    data.clear();
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(file);
+    return true;
+}
+
+inline std::vector<std::string> ListJpegs(const std::string &dir)
+{
+    std::vector<std::string> names;
+    DIR *d = opendir(dir.c_str());
+    if (!d) {
+        return names;
+    }
+    while (dirent *entry = readdir(d)) {
+        const char *dot = strrchr(entry->d_name, '.');
+        if (dot && (strcasecmp(dot, ".jpg") == 0 || strcasecmp(dot, ".jpeg") == 0)) {
+            names.push_back(entry->d_name);
+        }
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+// Width and height in the SOF marker, false if there is none
+inline bool JpegSize(const std::vector<uint8_t> &jpeg, int &width, int &height)
+{
+    size_t i = 2;
+    while (i + 9 < jpeg.size() && jpeg[i] == 0xFF) {
+        const uint8_t marker = jpeg[i + 1];
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            height = jpeg[i + 5] << 8 | jpeg[i + 6];
+            width = jpeg[i + 7] << 8 | jpeg[i + 8];
+            return true;
+        }
+        i += 2 + (jpeg[i + 2] << 8 | jpeg[i + 3]);
+    }
+    return false;
+}
+
+// Decodes and scales a frame into rgb as ei_camera_capture() does
+inline bool LoadFrame(const std::string &path)
+{
+    std::vector<uint8_t> jpeg;
+    int width, height;
+    if (!ReadFile(path, jpeg) || !JpegSize(jpeg, width, height)) {
+        return false;
+    }
+    std::vector<uint8_t> decoded(width * height * 3);
+    if (!fmt2rgb888(jpeg.data(), jpeg.size(), PIXFORMAT_JPEG, decoded.data())) {
+        return false;
+    }
+    rgb.resize(EI_CLASSIFIER_INPUT_WIDTH * EI_CLASSIFIER_INPUT_HEIGHT * 3);
+    if (width == EI_CLASSIFIER_INPUT_WIDTH && height == EI_CLASSIFIER_INPUT_HEIGHT) {
+        rgb = decoded;
+    }
+    else {
+        // the crop is written out before it is scaled down, like into the firmware's full buffer
+        ei::image::processing::crop_and_interpolate_rgb888(decoded.data(), width, height,
+            decoded.data(), EI_CLASSIFIER_INPUT_WIDTH, EI_CLASSIFIER_INPUT_HEIGHT);
+        memcpy(rgb.data(), decoded.data(), rgb.size());
+    }
+    return true;
+}
+
+// The EON session the handle runs the model in, where the layer observer goes
+inline void *EonSession(ei_impulse_handle_t &handle)
+{
+    const ei_learning_block_config_tflite_graph_t *block =
+        (const ei_learning_block_config_tflite_graph_t *)handle.impulse->learning_blocks[0].config;
+    void *session = nullptr;
+    if (eon_get_session(&handle, (const ei_config_tflite_eon_graph_t *)block->graph_config, 0, &session) !=
+        EI_IMPULSE_OK) {
+        return nullptr;
+    }
+    return session;
+}
+
+// Runs the impulse on rgb, with the layers copied out when observing (which the timings of
+// that run then include)
+inline bool Classify(ei_impulse_handle_t &handle, Image &image, bool observe, int64_t timing_us[kStages])
+{
+    signal_t signal;
+    signal.total_length = EI_CLASSIFIER_INPUT_WIDTH * EI_CLASSIFIER_INPUT_HEIGHT;
+    signal.get_data = &GetData;
+
+    void *session = nullptr;
+    if (observe) {
+        session = EonSession(handle);
+        if (!session) {
+            fprintf(stderr, "%s: no EON session to observe\n", image.name.c_str());
+            return false;
+        }
+        image.tensors.clear();
+        tflite_learn_4_set_layer_observer_session(session, Observe, &image.tensors);
+    }
+    ei_impulse_result_t result = {};
+    const EI_IMPULSE_ERROR err = run_classifier(&handle, &signal, &result, false);
+    if (session) {
+        tflite_learn_4_set_layer_observer_session(session, nullptr, nullptr);
+    }
+    if (err != EI_IMPULSE_OK) {
+        fprintf(stderr, "%s: run_classifier failed (%d)\n", image.name.c_str(), err);
+        return false;
+    }
+
+    image.boxes.clear();
+    for (uint32_t i = 0; i < result.bounding_boxes_count; i++) {
+        const ei_impulse_result_bounding_box_t &bb = result.bounding_boxes[i];
+        if (bb.value > 0) {
+            image.boxes.push_back({ bb.label, bb.value, bb.x, bb.y, bb.width, bb.height });
+        }
+    }
+    timing_us[0] = result.timing.dsp_us;
+    timing_us[1] = result.timing.classification_us;
+    timing_us[2] = result.timing.anomaly_us;
+    return true;
+}
+
+template <typename T> inline void Put(FILE *file, const T &value)
+{
+    fwrite(&value, sizeof(value), 1, file);
+}
+
+template <typename T> inline bool Get(FILE *file, T &value)
+{
+    return fread(&value, sizeof(value), 1, file) == 1;
+}
+
+inline void PutBytes(FILE *file, const void *data, uint32_t size)
+{
+    Put(file, size);
+    fwrite(data, 1, size, file);
+}
+
+inline bool GetBytes(FILE *file, std::string &out)
+{
+    uint32_t size;
+    if (!Get(file, size) || size > (64u << 20)) {
+        return false;
+    }
+    out.resize(size);
+    return fread(&out[0], 1, size, file) == size;
+}
+
+inline bool WriteGolden(const std::string &path, const Golden &golden)
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    fwrite(kMagic, 1, sizeof(kMagic), file);
+    Put(file, (uint32_t)EI_CLASSIFIER_PROJECT_ID);
+    Put(file, (uint32_t)EI_CLASSIFIER_PROJECT_DEPLOY_VERSION);
+    for (int s = 0; s < kStages; s++) {
+        Put(file, golden.p50_us[s]);
+    }
+    Put(file, (uint32_t)golden.images.size());
+    for (const Image &image : golden.images) {
+        PutBytes(file, image.name.data(), image.name.size());
+        Put(file, (uint32_t)image.tensors.size());
+        for (const Tensor &t : image.tensors) {
+            Put(file, t.layer);
+            Put(file, t.type);
+            Put(file, t.scale);
+            Put(file, t.zero_point);
+            PutBytes(file, t.data.data(), t.data.size());
+        }
+        Put(file, (uint32_t)image.boxes.size());
+        for (const Box &b : image.boxes) {
+            PutBytes(file, b.label.data(), b.label.size());
+            Put(file, b.value);
+            Put(file, b.x);
+            Put(file, b.y);
+            Put(file, b.width);
+            Put(file, b.height);
+        }
+    }
+    return fclose(file) == 0;
+}
+
+inline bool ReadGolden(const std::string &path, Golden &golden)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        fprintf(stderr, "cannot open %s, record it first with --record\n", path.c_str());
+        return false;
+    }
+    char magic[sizeof(kMagic)];
+    uint32_t project, version, images;
+    bool ok = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+        memcmp(magic, kMagic, sizeof(kMagic)) == 0 && Get(file, project) && Get(file, version);
+    if (ok && (project != EI_CLASSIFIER_PROJECT_ID || version != EI_CLASSIFIER_PROJECT_DEPLOY_VERSION)) {
+        fprintf(stderr, "%s is of project %u version %u, the impulse is %u version %u: record it again\n",
+            path.c_str(), project, version, EI_CLASSIFIER_PROJECT_ID, EI_CLASSIFIER_PROJECT_DEPLOY_VERSION);
+        fclose(file);
+        return false;
+    }
+    for (int s = 0; ok && s < kStages; s++) {
+        ok = Get(file, golden.p50_us[s]);
+    }
+    ok = ok && Get(file, images);
+    for (uint32_t i = 0; ok && i < images; i++) {
+        Image image;
+        uint32_t tensors, boxes;
+        ok = GetBytes(file, image.name) && Get(file, tensors);
+        for (uint32_t j = 0; ok && j < tensors; j++) {
+            Tensor t;
+            std::string data;
+            ok = Get(file, t.layer) && Get(file, t.type) && Get(file, t.scale) &&
+                Get(file, t.zero_point) && GetBytes(file, data);
+            t.data.assign(data.begin(), data.end());
+            image.tensors.push_back(std::move(t));
+        }
+        ok = ok && Get(file, boxes);
+        for (uint32_t j = 0; ok && j < boxes; j++) {
+            Box b;
+            ok = GetBytes(file, b.label) && Get(file, b.value) && Get(file, b.x) && Get(file, b.y) &&
+                Get(file, b.width) && Get(file, b.height);
+            image.boxes.push_back(b);
+        }
+        golden.images.push_back(std::move(image));
+    }
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "%s is truncated or not a golden file\n", path.c_str());
+    }
+    return ok;
+}
+
+inline const char *LayerName(int layer, char *buf, size_t size)
+{
+    if (layer < 0) {
+        return "input";
+    }
+    snprintf(buf, size, "layer %d", layer);
+    return buf;
+}
+
+// Differences of a tensor against its golden, within the tolerance or not
+inline bool CompareTensor(const Tensor &golden, const Tensor &now, int tolerance, float changed_share,
+    int &max_diff, char *why, size_t why_size)
+{
+    max_diff = 0;
+    if (golden.type != now.type || golden.data.size() != now.data.size() ||
+        golden.scale != now.scale || golden.zero_point != now.zero_point) {
+        snprintf(why, why_size, "type, size or quantization changed");
+        return false;
+    }
+    if (now.type != kTfLiteInt8 && now.type != kTfLiteUInt8) {
+        // no steps to count in, these have to be the same
+        const bool same = golden.data == now.data;
+        snprintf(why, why_size, "%s", same ? "same" : "not quantized, and changed");
+        return same;
+    }
+    size_t changed = 0;
+    for (size_t i = 0; i < now.data.size(); i++) {
+        const int a = now.type == kTfLiteInt8 ? (int8_t)golden.data[i] : golden.data[i];
+        const int b = now.type == kTfLiteInt8 ? (int8_t)now.data[i] : now.data[i];
+        if (a != b) {
+            changed++;
+            max_diff = std::max(max_diff, abs(a - b));
+        }
+    }
+    const float share = now.data.empty() ? 0.0f : (float)changed / now.data.size();
+    snprintf(why, why_size, "max diff %d steps, %.2f%% changed", max_diff, share * 100.0f);
+    return max_diff <= tolerance && share <= changed_share;
+}
+
+inline bool CompareBoxes(const std::vector<Box> &golden, const std::vector<Box> &now, const Options &options,
+    char *why, size_t why_size)
+{
+    if (golden.size() != now.size()) {
+        snprintf(why, why_size, "%zu boxes, golden %zu", now.size(), golden.size());
+        return false;
+    }
+    std::vector<bool> used(now.size(), false);
+    for (const Box &g : golden) {
+        bool matched = false;
+        for (size_t i = 0; i < now.size() && !matched; i++) {
+            const Box &b = now[i];
+            auto near = [&](uint32_t x, uint32_t y) {
+                return (x > y ? x - y : y - x) <= options.box_tolerance;
+            };
+            if (!used[i] && b.label == g.label && near(b.x, g.x) && near(b.y, g.y) &&
+                near(b.x + b.width, g.x + g.width) && near(b.y + b.height, g.y + g.height) &&
+                fabsf(b.value - g.value) <= options.score_tolerance) {
+                used[i] = matched = true;
+            }
+        }
+        if (!matched) {
+            snprintf(why, why_size, "no match for golden [%s %.3f %u %u %u %u]", g.label.c_str(), g.value,
+                g.x, g.y, g.width, g.height);
+            return false;
+        }
+    }
+    snprintf(why, why_size, "%zu boxes", now.size());
+    return true;
+}
+
+inline const Image *FindImage(const Golden &golden, const std::string &name)
+{
+    for (const Image &image : golden.images) {
+        if (image.name == name) {
+            return &image;
+        }
+    }
+    return nullptr;
+}
+
+// Compares the tensors and boxes of an image against its golden. report gets a line for
+// the first tensor off and one for the boxes, or a single one on how close it came.
+inline bool CompareImage(const Image &golden, const Image &now, const Options &options,
+    std::vector<std::string> &report)
+{
+    char why[160], layer[32], line[256];
+    report.clear();
+    bool ok = golden.tensors.size() == now.tensors.size();
+    if (!ok) {
+        snprintf(line, sizeof(line), "%zu tensors, golden %zu", now.tensors.size(), golden.tensors.size());
+        report.push_back(line);
+    }
+    int worst_layer = -2, worst_diff = 0;
+    for (size_t t = 0; ok && t < now.tensors.size(); t++) {
+        const Tensor &a = golden.tensors[t], &b = now.tensors[t];
+        const int tolerance = b.layer < 0 ? options.input_tolerance : options.layer_tolerance;
+        int diff;
+        if (!CompareTensor(a, b, tolerance, options.changed_share, diff, why, sizeof(why))) {
+            // the first one off, the later layers follow from it
+            snprintf(line, sizeof(line), "%s off, %s", LayerName(b.layer, layer, sizeof(layer)), why);
+            report.push_back(line);
+            ok = false;
+        }
+        if (diff > worst_diff) {
+            worst_diff = diff;
+            worst_layer = b.layer;
+        }
+    }
+    const bool boxes_ok = CompareBoxes(golden.boxes, now.boxes, options, why, sizeof(why));
+    if (!boxes_ok) {
+        snprintf(line, sizeof(line), "boxes off, %s", why);
+        report.push_back(line);
+    }
+    if (ok && boxes_ok) {
+        snprintf(line, sizeof(line), "ok, %s, largest tensor diff %d steps%s%s", why, worst_diff,
+            worst_layer > -2 ? " in " : "", worst_layer > -2 ? LayerName(worst_layer, layer, sizeof(layer)) : "");
+        report.push_back(line);
+    }
+    return ok && boxes_ok;
+}
+
+inline int64_t Percentile(std::vector<int64_t> values, int p)
+{
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[(values.size() - 1) * p / 100];
+}
+
+} // namespace golden
@@ -0,0 +1,204 @@
+// Golden image regression check for the impulse: DSP or kernel changes must not change what
+// the model sees or predicts, nor make it slower.
+//
+// Every JPEG of a corpus directory (plate photos, as the camera takes them) goes through the
+// firmware's path: decoded with fmt2rgb888 (the host stand-in in tools/host), cropped and scaled
+// to the impulse input, then run_classifier(). With --record the quantized input tensor, the
+// output of every layer (tflite_learn_4_set_layer_observer_session on the handle's EON
+// session), the FOMO boxes and the timings of result.timing are written to golden.bin in the
+// corpus directory (about 600 KB an image, most of it the layers). Without it, a run is
+// compared against that file:
+//   - input and layer tensors: int8 values within --input-tolerance / --layer-tolerance
+//     quantization steps, and at most --changed-share of the values different at all
+//   - boxes: the same number, each golden box matched by one of the same label within
+//     --box-tolerance pixels on every side and --score-tolerance in confidence
+//   - timing: the p50 over the corpus of DSP, classification and anomaly no more than
+//     --threshold above the golden one (plus --slack-us, for the stages that take next to
+//     nothing). Timings only compare on the machine they were recorded on; --no-timing leaves
+//     them out, e.g. when checking a kernel change for accuracy on another machine.
+// The first layer that is off is the one to look at, the ones after it follow from it.
+// Exits 1 on any regression. The data, golden.bin and the comparisons are in golden.h, which
+// the native test test/test_golden runs on a small corpus of its own.
+//
+// Build and run on the host, from ESP32-CAM/:
+//   SRC=lib/smart_scale_inferencing/src
+//   FLAGS="-O2 -DEI_PORTING_CLIB=1 -DTF_LITE_DISABLE_X86_NEON -Itools/host -isystem $SRC -isystem $SRC/edge-impulse-sdk"
+//   SDK=$(find $SRC/edge-impulse-sdk/tensorflow $SRC/edge-impulse-sdk/dsp $SRC/tflite-model -name '*.cc' -o -name '*.cpp')
+//   gcc $FLAGS -w -c $SRC/edge-impulse-sdk/tensorflow/lite/c/common.c
+//   g++ -std=c++17 $FLAGS -Wall -Wextra -c tools/golden_check.cpp tools/host/img_converters.cpp
+//   g++ -std=c++17 $FLAGS -w golden_check.o img_converters.o common.o $SDK $SRC/edge-impulse-sdk/porting/clib/*.cpp -o golden_check -lm
+//   ./golden_check --record corpus/     # before the change
+//   ./golden_check corpus/              # after it
+
+#include "golden.h"
+
+#include <string>
+#include <vector>
+
+using namespace golden;
+
+namespace
+{
+
+void Usage(const char *program)
+{
+    fprintf(stderr,
+        "usage: %s [--record] [--runs N] [--no-timing] [--threshold F] [--slack-us N]\n"
+        "       [--input-tolerance N] [--layer-tolerance N] [--changed-share F]\n"
+        "       [--box-tolerance PX] [--score-tolerance F] corpus-dir\n", program);
+    exit(2);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    std::string dir;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--record") {
+            options.record = true;
+        }
+        else if (arg == "--no-timing") {
+            options.timing = false;
+        }
+        else if (arg == "--runs" && has_value) {
+            options.runs = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--threshold" && has_value) {
+            options.threshold = atof(argv[++i]);
+        }
+        else if (arg == "--slack-us" && has_value) {
+            options.slack_us = atoll(argv[++i]);
+        }
+        else if (arg == "--input-tolerance" && has_value) {
+            options.input_tolerance = atoi(argv[++i]);
+        }
+        else if (arg == "--layer-tolerance" && has_value) {
+            options.layer_tolerance = atoi(argv[++i]);
+        }
+        else if (arg == "--changed-share" && has_value) {
+            options.changed_share = atof(argv[++i]);
+        }
+        else if (arg == "--box-tolerance" && has_value) {
+            options.box_tolerance = atoi(argv[++i]);
+        }
+        else if (arg == "--score-tolerance" && has_value) {
+            options.score_tolerance = atof(argv[++i]);
+        }
+        else if (arg[0] != '-' && dir.empty()) {
+            dir = arg;
+        }
+        else {
+            Usage(argv[0]);
+        }
+    }
+    if (dir.empty()) {
+        Usage(argv[0]);
+    }
+    const std::string golden_path = dir + "/golden.bin";
+
+    const std::vector<std::string> names = ListJpegs(dir);
+    if (names.empty()) {
+        fprintf(stderr, "no JPEGs in %s\n", dir.c_str());
+        return 2;
+    }
+
+    Golden golden;
+    if (!options.record && !ReadGolden(golden_path, golden)) {
+        return 2;
+    }
+
+    ei_impulse_handle_t handle(ei_default_impulse.impulse);
+    Golden now;
+    std::vector<int64_t> samples[kStages], totals;
+    int failures = 0;
+    for (const std::string &name : names) {
+        Image image;
+        image.name = name;
+        if (!LoadFrame(dir + "/" + name)) {
+            fprintf(stderr, "%s: cannot decode\n", name.c_str());
+            return 2;
+        }
+        int64_t timing_us[kStages];
+        if (!Classify(handle, image, true, timing_us)) {
+            return 2;
+        }
+        for (int run = 0; run < options.runs; run++) {
+            if (!Classify(handle, image, false, timing_us)) {
+                return 2;
+            }
+            for (int s = 0; s < kStages; s++) {
+                samples[s].push_back(timing_us[s]);
+            }
+            totals.push_back(timing_us[0] + timing_us[1] + timing_us[2]);
+        }
+
+        if (!options.record) {
+            const Image *g = FindImage(golden, name);
+            if (!g) {
+                printf("%s: not in the golden data, record it again\n", name.c_str());
+                failures++;
+                continue;
+            }
+            std::vector<std::string> report;
+            if (!CompareImage(*g, image, options, report)) {
+                failures++;
+            }
+            for (const std::string &line : report) {
+                printf("%s: %s\n", name.c_str(), line.c_str());
+            }
+        }
+        now.images.push_back(std::move(image));
+    }
+
+    printf("\n%zu images x %d runs      p50 us   p90 us   p99 us   max us\n", names.size(), options.runs);
+    for (int s = 0; s < kStages; s++) {
+        now.p50_us[s] = Percentile(samples[s], 50);
+        printf("%-22s %8lld %8lld %8lld %8lld\n", kStageNames[s], (long long)now.p50_us[s],
+            (long long)Percentile(samples[s], 90), (long long)Percentile(samples[s], 99),
+            (long long)Percentile(samples[s], 100));
+    }
+    printf("%-22s %8lld %8lld %8lld %8lld\n", "total", (long long)Percentile(totals, 50),
+        (long long)Percentile(totals, 90), (long long)Percentile(totals, 99), (long long)Percentile(totals, 100));
+
+    if (options.record) {
+        if (!options.timing) {
+            for (int s = 0; s < kStages; s++) {
+                now.p50_us[s] = -1;
+            }
+        }
+        if (!WriteGolden(golden_path, now)) {
+            fprintf(stderr, "cannot write %s\n", golden_path.c_str());
+            return 2;
+        }
+        printf("\nrecorded %s\n", golden_path.c_str());
+        return 0;
+    }
+
+    if (options.timing) {
+        for (int s = 0; s < kStages; s++) {
+            if (golden.p50_us[s] < 0) {
+                continue;
+            }
+            const int64_t limit = (int64_t)(golden.p50_us[s] * (1.0f + options.threshold)) + options.slack_us;
+            const bool ok = now.p50_us[s] <= limit;
+            printf("%s p50 %lld us, golden %lld us, limit %lld us%s\n", kStageNames[s],
+                (long long)now.p50_us[s], (long long)golden.p50_us[s], (long long)limit, ok ? "" : ": SLOWER");
+            if (!ok) {
+                failures++;
+            }
+        }
+    }
+    for (const Image &g : golden.images) {
+        if (std::find(names.begin(), names.end(), g.name) == names.end()) {
+            printf("%s: in the golden data but not in the corpus\n", g.name.c_str());
+            failures++;
+        }
+    }
+
+    printf("\n%s, %d regression%s\n", failures ? "FAIL" : "PASS", failures, failures == 1 ? "" : "s");
+    return failures ? 1 : 0;
+}
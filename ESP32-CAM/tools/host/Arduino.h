@@ -0,0 +1,378 @@
+// Host stand-in for the parts of the Arduino core the firmware modules use:
+// String, Print and Stream, Serial, millis() and delay(). Enough to build
+// them on Linux against the tools in tools/, not a port of the core.
+#pragma once
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// As in the core, the tasks come with it
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+inline unsigned long millis()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+inline void delay(uint32_t ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+// newlib has it, glibc only from 2.38
+inline size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    const size_t length = strlen(src);
+    if (size > 0) {
+        const size_t n = length < size - 1 ? length : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return length;
+}
+#endif
+
+class String
+{
+  public:
+    String() = default;
+    String(const char *text) : _s(text != nullptr ? text : "") {}
+    String(const std::string &text) : _s(text) {}
+    String(char c) : _s(1, c) {}
+    String(int value) : _s(std::to_string(value)) {}
+    String(unsigned int value) : _s(std::to_string(value)) {}
+    String(long value) : _s(std::to_string(value)) {}
+    String(unsigned long value) : _s(std::to_string(value)) {}
+    String(float value, unsigned int decimals = 2) : _s(_fixed(value, decimals)) {}
+    String(double value, unsigned int decimals = 2) : _s(_fixed(value, decimals)) {}
+
+    const char *c_str() const { return _s.c_str(); }
+    unsigned int length() const { return (unsigned int)_s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    bool reserve(unsigned int size)
+    {
+        _s.reserve(size);
+        return true;
+    }
+
+    bool concat(const String &other)
+    {
+        _s += other._s;
+        return true;
+    }
+    bool concat(const char *text)
+    {
+        _s += text != nullptr ? text : "";
+        return true;
+    }
+    bool concat(const char *text, unsigned int length)
+    {
+        _s.append(text, length);
+        return true;
+    }
+    bool concat(char c)
+    {
+        _s += c;
+        return true;
+    }
+    String &operator+=(const String &other)
+    {
+        concat(other);
+        return *this;
+    }
+    String &operator+=(const char *text)
+    {
+        concat(text);
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        concat(c);
+        return *this;
+    }
+
+    bool operator==(const String &other) const { return _s == other._s; }
+    bool operator==(const char *text) const { return _s == (text != nullptr ? text : ""); }
+    bool operator!=(const String &other) const { return !(*this == other); }
+    bool operator!=(const char *text) const { return !(*this == text); }
+    bool operator<(const String &other) const { return _s < other._s; }
+
+    char charAt(unsigned int index) const { return index < _s.size() ? _s[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+
+    bool equalsIgnoreCase(const String &other) const
+    {
+        return _s.size() == other._s.size() &&
+               strncasecmp(_s.c_str(), other._s.c_str(), _s.size()) == 0;
+    }
+    bool startsWith(const String &prefix) const { return _s.compare(0, prefix._s.size(), prefix._s) == 0; }
+    bool endsWith(const String &suffix) const
+    {
+        return _s.size() >= suffix._s.size() &&
+               _s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s) == 0;
+    }
+
+    int indexOf(char c, unsigned int from = 0) const { return _position(_s.find(c, from)); }
+    int indexOf(const String &text, unsigned int from = 0) const
+    {
+        return _position(_s.find(text._s, from));
+    }
+    int lastIndexOf(char c) const { return _position(_s.rfind(c)); }
+
+    String substring(unsigned int from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        if (from > to) {
+            std::swap(from, to);
+        }
+        return from < _s.size() ? String(_s.substr(from, to - from)) : String();
+    }
+
+    void trim()
+    {
+        const size_t first = _s.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos) {
+            _s.clear();
+            return;
+        }
+        _s = _s.substr(first, _s.find_last_not_of(" \t\r\n") - first + 1);
+    }
+    void toUpperCase()
+    {
+        for (char &c : _s) {
+            c = (char)toupper((unsigned char)c);
+        }
+    }
+    void toLowerCase()
+    {
+        for (char &c : _s) {
+            c = (char)tolower((unsigned char)c);
+        }
+    }
+
+    long toInt() const { return atol(_s.c_str()); }
+    float toFloat() const { return (float)atof(_s.c_str()); }
+
+  private:
+    static std::string _fixed(double value, unsigned int decimals)
+    {
+        char text[64];
+        snprintf(text, sizeof(text), "%.*f", (int)decimals, value);
+        return text;
+    }
+    static int _position(size_t at) { return at == std::string::npos ? -1 : (int)at; }
+
+    std::string _s;
+};
+
+inline String operator+(const String &a, const String &b)
+{
+    String sum(a);
+    sum.concat(b);
+    return sum;
+}
+inline String operator+(const String &a, const char *b)
+{
+    String sum(a);
+    sum.concat(b);
+    return sum;
+}
+inline String operator+(const char *a, const String &b)
+{
+    String sum(a);
+    sum.concat(b);
+    return sum;
+}
+inline String operator+(const String &a, char b)
+{
+    String sum(a);
+    sum.concat(b);
+    return sum;
+}
+
+class Print
+{
+  public:
+    virtual ~Print() = default;
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (n < size && write(buffer[n])) {
+            n++;
+        }
+        return n;
+    }
+    size_t write(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+
+    size_t print(const String &text) { return write((const uint8_t *)text.c_str(), text.length()); }
+    size_t print(const char *text) { return write(text); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value) { return print(String(value)); }
+    size_t print(unsigned int value) { return print(String(value)); }
+    size_t print(long value) { return print(String(value)); }
+    size_t print(unsigned long value) { return print(String(value)); }
+    size_t print(double value, int decimals = 2) { return print(String(value, decimals)); }
+
+    template <typename T>
+    size_t println(const T &value)
+    {
+        return print(value) + println();
+    }
+    size_t println() { return write("\r\n"); }
+};
+
+class Stream : public Print
+{
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeoutMs) { _timeout = timeoutMs; }
+    unsigned long getTimeout() const { return _timeout; }
+
+    virtual size_t readBytes(char *buffer, size_t length)
+    {
+        size_t count = 0;
+        while (count < length) {
+            const int c = timedRead();
+            if (c < 0) {
+                break;
+            }
+            buffer[count++] = (char)c;
+        }
+        return count;
+    }
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+
+    String readString()
+    {
+        String text;
+        int c;
+        while ((c = timedRead()) >= 0) {
+            text += (char)c;
+        }
+        return text;
+    }
+
+    String readStringUntil(char terminator)
+    {
+        String text;
+        int c;
+        while ((c = timedRead()) >= 0 && c != terminator) {
+            text += (char)c;
+        }
+        return text;
+    }
+
+  protected:
+    // A byte, or -1 once nothing came for the timeout
+    int timedRead()
+    {
+        const unsigned long start = millis();
+        do {
+            const int c = read();
+            if (c >= 0) {
+                return c;
+            }
+            std::this_thread::yield();
+        } while (millis() - start < _timeout);
+        return -1;
+    }
+
+    unsigned long _timeout = 1000;
+};
+
+// Serial: what the firmware writes goes to stdout, and is kept for the native
+// tests; what it reads is what the host program feeds it
+class HardwareSerial : public Stream
+{
+  public:
+    void begin(unsigned long) {}
+    void end() {}
+    explicit operator bool() const { return true; }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        const size_t written = fwrite(buffer, 1, size, stdout);
+        fflush(stdout);
+        std::lock_guard<std::mutex> lock(_outputLock);
+        _output.append((const char *)buffer, size);
+        return written;
+    }
+    using Print::write;
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        char text[256];
+        va_list args;
+        va_start(args, format);
+        const int length = vsnprintf(text, sizeof(text), format, args);
+        va_end(args);
+        return length > 0 ? write((const uint8_t *)text, strlen(text)) : 0;
+    }
+
+    int available() override
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        return (int)_input.size();
+    }
+    int read() override
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        if (_input.empty()) {
+            return -1;
+        }
+        const int c = (uint8_t)_input.front();
+        _input.pop_front();
+        return c;
+    }
+    int peek() override
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        return _input.empty() ? -1 : (uint8_t)_input.front();
+    }
+
+    // Bytes for the firmware to read, as if they came over the wire
+    void feed(const char *data, size_t length)
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _input.insert(_input.end(), data, data + length);
+    }
+
+    // What the firmware wrote since the last call
+    std::string takeOutput()
+    {
+        std::lock_guard<std::mutex> lock(_outputLock);
+        std::string output;
+        output.swap(_output);
+        return output;
+    }
+
+  private:
+    std::mutex _lock;
+    std::deque<char> _input;
+    std::mutex _outputLock;
+    std::string _output;
+};
+
+inline HardwareSerial Serial;
@@ -0,0 +1,146 @@
+#include "FS.h"
+#include "SD_MMC.h"
+
+#include "host_stats.h"
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SDMMCFS SD_MMC;
+
+namespace fs
+{
+
+File::File(FILE *file, const std::string &name) : _file(file, fclose), _name(name)
+{
+    setTimeout(0); // A file has all its bytes, none come later
+}
+
+size_t File::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buffer, size_t size)
+{
+    HostStageTimer timer(HOST_STAGE_SD);
+    return _file ? fwrite(buffer, 1, size, _file.get()) : 0;
+}
+
+int File::available()
+{
+    if (!_file) {
+        return 0;
+    }
+    const size_t at = position();
+    return at < size() ? (int)(size() - at) : 0;
+}
+
+int File::read()
+{
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek()
+{
+    if (!_file) {
+        return -1;
+    }
+    const int c = fgetc(_file.get());
+    if (c != EOF) {
+        ungetc(c, _file.get());
+    }
+    return c == EOF ? -1 : c;
+}
+
+size_t File::read(uint8_t *buffer, size_t size)
+{
+    HostStageTimer timer(HOST_STAGE_SD);
+    return _file ? fread(buffer, 1, size, _file.get()) : 0;
+}
+
+void File::flush()
+{
+    if (_file) {
+        fflush(_file.get());
+    }
+}
+
+bool File::seek(uint32_t position, SeekMode mode)
+{
+    HostStageTimer timer(HOST_STAGE_SD);
+    static const int WHENCE[] = {SEEK_SET, SEEK_CUR, SEEK_END};
+    return _file && fseek(_file.get(), position, WHENCE[mode]) == 0;
+}
+
+size_t File::position() const
+{
+    return _file ? (size_t)ftell(_file.get()) : 0;
+}
+
+size_t File::size() const
+{
+    struct stat info;
+    return _file && fstat(fileno(_file.get()), &info) == 0 ? (size_t)info.st_size : 0;
+}
+
+void File::close()
+{
+    HostStageTimer timer(HOST_STAGE_SD);
+    _file.reset();
+}
+
+File FS::open(const char *path, const char *mode, bool)
+{
+    HostStageTimer timer(HOST_STAGE_SD);
+    // Binary, and "w" may read back what it wrote, as on the card
+    const std::string hostMode = std::string(mode) + (mode[0] == 'r' ? "b" : "b+");
+    FILE *file = fopen(_path(path).c_str(), hostMode.c_str());
+    if (file == nullptr) {
+        return File();
+    }
+    return File(file, path);
+}
+
+bool FS::exists(const char *path)
+{
+    HostStageTimer timer(HOST_STAGE_SD);
+    struct stat info;
+    return stat(_path(path).c_str(), &info) == 0;
+}
+
+bool FS::remove(const char *path)
+{
+    HostStageTimer timer(HOST_STAGE_SD);
+    return ::remove(_path(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to)
+{
+    HostStageTimer timer(HOST_STAGE_SD);
+    return ::rename(_path(from).c_str(), _path(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path)
+{
+    HostStageTimer timer(HOST_STAGE_SD);
+    return ::mkdir(_path(path).c_str(), 0755) == 0;
+}
+
+bool FS::rmdir(const char *path)
+{
+    HostStageTimer timer(HOST_STAGE_SD);
+    return ::rmdir(_path(path).c_str()) == 0;
+}
+
+} // namespace fs
+
+// The card is the --sd directory, the mount options do not apply
+bool SDMMCFS::begin(const char *, bool, bool, int, uint8_t)
+{
+    struct stat info;
+    _mounted = !_root.empty() && stat(_root.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+    return _mounted;
+}
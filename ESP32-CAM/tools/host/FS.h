@@ -0,0 +1,90 @@
+// Host stand-in for the file system API of the Arduino core, on files of a
+// host directory that stands in for the card (see SD_MMC.h).
+#pragma once
+
+#include "Arduino.h"
+
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs
+{
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File : public Stream
+{
+  public:
+    File() = default;
+    File(FILE *file, const std::string &name);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t read(uint8_t *buffer, size_t size);
+    size_t readBytes(char *buffer, size_t length) override
+    {
+        return read((uint8_t *)buffer, length);
+    }
+
+    void flush();
+    bool seek(uint32_t position, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void close();
+    const char *name() const { return _name.c_str(); }
+
+    explicit operator bool() const { return _file != nullptr; }
+
+  private:
+    // Copies of a File share the open file, as on the target
+    std::shared_ptr<FILE> _file;
+    std::string _name;
+};
+
+class FS
+{
+  public:
+    explicit FS(const std::string &root = "") : _root(root) {}
+
+    File open(const char *path, const char *mode = FILE_READ, bool create = false);
+    File open(const String &path, const char *mode = FILE_READ, bool create = false)
+    {
+        return open(path.c_str(), mode, create);
+    }
+
+    bool exists(const char *path);
+    bool exists(const String &path) { return exists(path.c_str()); }
+    bool remove(const char *path);
+    bool remove(const String &path) { return remove(path.c_str()); }
+    bool rename(const char *from, const char *to);
+    bool rename(const String &from, const String &to) { return rename(from.c_str(), to.c_str()); }
+    bool mkdir(const char *path);
+    bool mkdir(const String &path) { return mkdir(path.c_str()); }
+    bool rmdir(const char *path);
+    bool rmdir(const String &path) { return rmdir(path.c_str()); }
+
+  protected:
+    std::string _path(const char *path) const { return _root + path; }
+
+    std::string _root;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekMode;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekSet;
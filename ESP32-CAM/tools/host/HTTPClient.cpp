@@ -0,0 +1,314 @@
+#include "HTTPClient.h"
+
+#include "host_stats.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+
+static std::atomic<unsigned long> openedConnections(0);
+
+unsigned long HTTPClient::connections()
+{
+    return openedConnections.load();
+}
+
+HTTPClient::~HTTPClient()
+{
+    _disconnect();
+}
+
+bool HTTPClient::begin(const String &url)
+{
+    std::string rest = url.c_str();
+    if (rest.compare(0, 7, "http://") != 0) {
+        return false;
+    }
+    rest.erase(0, 7);
+
+    const size_t slash = rest.find('/');
+    std::string hostPort = rest.substr(0, slash);
+    const std::string uri = slash == std::string::npos ? "/" : rest.substr(slash);
+
+    uint16_t port = 80;
+    const size_t colon = hostPort.find(':');
+    if (colon != std::string::npos) {
+        port = (uint16_t)atoi(hostPort.c_str() + colon + 1);
+        hostPort.erase(colon);
+    }
+
+    // A connection to another server is no use for this request
+    if (_fd >= 0 && (_host != hostPort.c_str() || _port != port)) {
+        _disconnect();
+    }
+    _host = hostPort.c_str();
+    _port = port;
+    _uri = uri.c_str();
+    return true;
+}
+
+void HTTPClient::end()
+{
+    if (_fd >= 0) {
+        // What is left of the body has to go before the next response can
+        // be read off the same connection
+        while (_reuse && _canReuse && _remaining > 0 && _readByte() >= 0) {
+            _remaining--;
+        }
+        if (!_reuse || !_canReuse || _remaining > 0 || !connected()) {
+            _disconnect();
+        }
+    }
+    _size = -1;
+    _remaining = 0;
+    _bodyToClose = false;
+}
+
+bool HTTPClient::connected()
+{
+    if (_fd < 0) {
+        return false;
+    }
+    if (_start < _end) {
+        return true;
+    }
+    pollfd p = {_fd, POLLIN, 0};
+    if (poll(&p, 1, 0) > 0) {
+        char c;
+        // Readable with nothing to read: the server closed it
+        if (recv(_fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) <= 0) {
+            _disconnect();
+            return false;
+        }
+    }
+    return true;
+}
+
+int HTTPClient::GET()
+{
+    if (!connected() && !_connect()) {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    std::string header = "GET ";
+    header += _uri.c_str();
+    header += _useHTTP10 ? " HTTP/1.0\r\n" : " HTTP/1.1\r\n";
+    header += "Host: ";
+    header += _host.c_str();
+    if (_port != 80) {
+        header += ":" + std::to_string(_port);
+    }
+    header += "\r\nUser-Agent: ESP32HTTPClient\r\nConnection: ";
+    header += _reuse ? "keep-alive" : "close";
+    if (!_useHTTP10) {
+        header += "\r\nAccept-Encoding: identity;q=1,chunked;q=0.1,*;q=0";
+    }
+    header += "\r\n\r\n";
+
+    HostStageTimer timer(HOST_STAGE_NETWORK);
+    size_t sent = 0;
+    while (sent < header.size()) {
+        const ssize_t n = send(_fd, header.data() + sent, header.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            _disconnect();
+            return HTTPC_ERROR_SEND_HEADER_FAILED;
+        }
+        sent += n;
+    }
+
+    _canReuse = _reuse;
+    const int code = _readHeaders();
+    if (code <= 0) {
+        _disconnect();
+    }
+    return code;
+}
+
+String HTTPClient::getString()
+{
+    String body;
+    int c;
+    while ((c = _body.read()) >= 0) {
+        body += (char)c;
+    }
+    return body;
+}
+
+bool HTTPClient::_connect()
+{
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *address = nullptr;
+    HostStageTimer timer(HOST_STAGE_NETWORK);
+    if (getaddrinfo(_host.c_str(), std::to_string(_port).c_str(), &hints, &address) != 0) {
+        return false;
+    }
+
+    _fd = socket(address->ai_family, address->ai_socktype, 0);
+    if (_fd >= 0 && connect(_fd, address->ai_addr, address->ai_addrlen) != 0) {
+        close(_fd);
+        _fd = -1;
+    }
+    freeaddrinfo(address);
+    if (_fd < 0) {
+        return false;
+    }
+
+    const int on = 1;
+    setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    _start = _end = 0;
+    openedConnections++;
+    return true;
+}
+
+void HTTPClient::_disconnect()
+{
+    if (_fd >= 0) {
+        close(_fd);
+        _fd = -1;
+    }
+    _start = _end = 0;
+    _canReuse = false;
+}
+
+bool HTTPClient::_fill(int timeoutMs)
+{
+    if (_fd < 0) {
+        return false;
+    }
+    HostStageTimer timer(HOST_STAGE_NETWORK);
+    pollfd p = {_fd, POLLIN, 0};
+    if (poll(&p, 1, timeoutMs) <= 0) {
+        return false;
+    }
+    const ssize_t n = recv(_fd, _buffer, sizeof(_buffer), 0);
+    if (n <= 0) {
+        return false;
+    }
+    _start = 0;
+    _end = n;
+    return true;
+}
+
+int HTTPClient::_readByte()
+{
+    if (_start == _end && !_fill(_timeout)) {
+        return -1;
+    }
+    return (uint8_t)_buffer[_start++];
+}
+
+bool HTTPClient::_readLine(std::string &line)
+{
+    line.clear();
+    int c;
+    while ((c = _readByte()) >= 0) {
+        if (c == '\n') {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            return true;
+        }
+        line += (char)c;
+    }
+    return false;
+}
+
+int HTTPClient::_readHeaders()
+{
+    std::string line;
+    if (!_readLine(line)) {
+        return connected() ? HTTPC_ERROR_READ_TIMEOUT : HTTPC_ERROR_CONNECTION_LOST;
+    }
+    if (line.compare(0, 7, "HTTP/1.") != 0 || line.size() < 12) {
+        return HTTPC_ERROR_NO_HTTP_SERVER;
+    }
+    // An HTTP/1.0 server closes the connection after the response
+    if (line[7] == '0') {
+        _canReuse = false;
+    }
+    const int code = atoi(line.c_str() + 9);
+
+    _size = -1;
+    bool chunked = false;
+    for (;;) {
+        if (!_readLine(line)) {
+            return HTTPC_ERROR_READ_TIMEOUT;
+        }
+        if (line.empty()) {
+            break;
+        }
+        const size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        String name = line.substr(0, colon);
+        String value = line.substr(colon + 1);
+        value.trim();
+        value.toLowerCase();
+        if (name.equalsIgnoreCase("Content-Length")) {
+            _size = value.toInt();
+        } else if (name.equalsIgnoreCase("Connection")) {
+            if (value.indexOf("close") >= 0 && value.indexOf("keep-alive") < 0) {
+                _canReuse = false;
+            }
+        } else if (name.equalsIgnoreCase("Transfer-Encoding")) {
+            chunked = value.indexOf("chunked") >= 0;
+        }
+    }
+
+    if (chunked) {
+        // Not decoded here; the API, and tools/api_server.cpp, send a
+        // Content-Length, which the identity first Accept-Encoding asks for
+        return HTTPC_ERROR_ENCODING;
+    }
+
+    _remaining = _size;
+    _bodyToClose = _size < 0;
+    if (_bodyToClose) {
+        _canReuse = false;
+    }
+    return code;
+}
+
+int HTTPClient::BodyStream::available()
+{
+    if (_client._start == _client._end) {
+        _client._fill(0);
+    }
+    long buffered = (long)(_client._end - _client._start);
+    if (!_client._bodyToClose && buffered > _client._remaining) {
+        buffered = _client._remaining;
+    }
+    return (int)buffered;
+}
+
+int HTTPClient::BodyStream::read()
+{
+    if (!_client._bodyToClose && _client._remaining <= 0) {
+        return -1;
+    }
+    const int c = _client._readByte();
+    if (c >= 0) {
+        _client._remaining--;
+    }
+    return c;
+}
+
+int HTTPClient::BodyStream::peek()
+{
+    if (!_client._bodyToClose && _client._remaining <= 0) {
+        return -1;
+    }
+    if (_client._start == _client._end && !_client._fill(_client._timeout)) {
+        return -1;
+    }
+    return (uint8_t)_client._buffer[_client._start];
+}
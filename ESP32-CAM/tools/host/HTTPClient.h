@@ -0,0 +1,101 @@
+// Host stand-in for the HTTPClient of the ESP32 Arduino core, on a plain TCP
+// socket. It keeps the behaviour the firmware's timings depend on: begin()
+// and GET() reuse the open connection to the same host while the server
+// allows it (not after an HTTP/1.0 status line or a "Connection: close"),
+// end() keeps it open for the next request, and getStream() hands the
+// connection to the parser as the body comes in. http:// only, no redirects.
+#pragma once
+
+#include "Arduino.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM (-8)
+#define HTTPC_ERROR_ENCODING (-9)
+#define HTTPC_ERROR_STREAM_WRITE (-10)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+#define HTTPCLIENT_DEFAULT_TCP_TIMEOUT (5000)
+
+class HTTPClient
+{
+  public:
+    HTTPClient() = default;
+    ~HTTPClient();
+
+    HTTPClient(const HTTPClient &) = delete;
+    HTTPClient &operator=(const HTTPClient &) = delete;
+
+    bool begin(const String &url);
+    void end();
+
+    // As in the ESP32 core, HTTP/1.0 also turns connection reuse off
+    void useHTTP10(bool useHTTP10 = true)
+    {
+        _useHTTP10 = useHTTP10;
+        _reuse = !useHTTP10;
+    }
+    void setReuse(bool reuse) { _reuse = reuse; }
+    void setTimeout(uint16_t timeoutMs) { _timeout = timeoutMs; }
+
+    bool connected();
+
+    // The status code, or one of HTTPC_ERROR_*
+    int GET();
+
+    int getSize() const { return _size; }
+
+    // The connection, read up to the end of the body
+    Stream &getStream() { return _body; }
+
+    String getString();
+
+    // Connections opened, by every client, to see what reuse saves
+    static unsigned long connections();
+
+  private:
+    // The body of the response under way, off the socket
+    class BodyStream : public Stream
+    {
+      public:
+        // read() itself waits for the socket, up to the client's timeout
+        explicit BodyStream(HTTPClient &client) : _client(client) { setTimeout(0); }
+
+        int available() override;
+        int read() override;
+        int peek() override;
+        size_t write(uint8_t) override { return 0; }
+
+      private:
+        HTTPClient &_client;
+    };
+
+    bool _connect();
+    void _disconnect();
+    // One byte off the connection, waiting up to the timeout; -1 if none
+    int _readByte();
+    bool _fill(int timeoutMs);
+    bool _readLine(std::string &line);
+    int _readHeaders();
+
+    String _host;
+    uint16_t _port = 80;
+    String _uri;
+    int _fd = -1;
+    bool _useHTTP10 = false;
+    bool _reuse = true;
+    bool _canReuse = false;
+    uint16_t _timeout = HTTPCLIENT_DEFAULT_TCP_TIMEOUT;
+    int _size = -1;      // Content-Length, -1 when the server did not say
+    long _remaining = 0; // of the body, not read yet
+    bool _bodyToClose = false; // the body runs until the server closes
+    char _buffer[1460];
+    size_t _start = 0;
+    size_t _end = 0;
+    BodyStream _body{*this};
+};
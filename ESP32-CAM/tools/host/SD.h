@@ -0,0 +1,5 @@
+// Host stand-in for the SD library; the firmware takes the card through
+// SD_MMC and only File from here.
+#pragma once
+
+#include "FS.h"
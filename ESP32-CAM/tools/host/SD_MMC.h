@@ -0,0 +1,29 @@
+// Host stand-in for the SD_MMC card: a host directory, set with
+// sd_mmc_host_root() before begin(). No directory, no card.
+#pragma once
+
+#include "FS.h"
+
+typedef enum { CARD_NONE, CARD_MMC, CARD_SD, CARD_SDHC, CARD_UNKNOWN } sdcard_type_t;
+
+class SDMMCFS : public fs::FS
+{
+  public:
+    bool begin(const char *mountpoint = "/sdcard", bool mode1bit = false,
+               bool format_if_mount_failed = false, int sdmmc_frequency = 20000,
+               uint8_t maxOpenFiles = 5);
+    void end() { _mounted = false; }
+    sdcard_type_t cardType() const { return _mounted ? CARD_SDHC : CARD_NONE; }
+
+    void setRoot(const char *directory) { _root = directory; }
+
+  private:
+    bool _mounted = false;
+};
+
+extern SDMMCFS SD_MMC;
+
+inline void sd_mmc_host_root(const char *directory)
+{
+    SD_MMC.setRoot(directory);
+}
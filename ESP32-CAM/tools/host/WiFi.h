@@ -0,0 +1,120 @@
+// Host stand-in for the WiFi library: the host is on the network already, so
+// the addresses are the loopback ones. A connection comes up at once, or after
+// the association time set with wifi_host_connect_ms(): a scan for the access
+// point, or the shorter direct connection to the channel and BSSID of the
+// WiFi cache.
+#pragma once
+
+#include "Arduino.h"
+
+#include <stdio.h>
+
+// netinet/in.h has one of its own, the Arduino one is an address
+#ifdef INADDR_NONE
+#undef INADDR_NONE
+#endif
+
+class IPAddress
+{
+  public:
+    IPAddress(uint32_t address = 0) : _address(address) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : _address(a | b << 8 | c << 16 | (uint32_t)d << 24)
+    {
+    }
+
+    // Stored as the ESP32 core does, the first octet in the low byte
+    operator uint32_t() const { return _address; }
+
+    bool fromString(const char *text)
+    {
+        unsigned int a, b, c, d;
+        char extra;
+        if (sscanf(text, "%u.%u.%u.%u%c", &a, &b, &c, &d, &extra) != 4 || a > 255 ||
+            b > 255 || c > 255 || d > 255) {
+            return false;
+        }
+        *this = IPAddress(a, b, c, d);
+        return true;
+    }
+
+  private:
+    uint32_t _address;
+};
+
+static const IPAddress INADDR_NONE(0);
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+class WiFiClass
+{
+  public:
+    bool config(IPAddress ip, IPAddress gateway, IPAddress mask,
+                IPAddress dns = INADDR_NONE)
+    {
+        _ip = ip;
+        _gateway = gateway;
+        _mask = mask;
+        _dns = dns;
+        return true;
+    }
+
+    wl_status_t begin(const char *, const char *, int32_t channel = 0,
+                      const uint8_t *bssid = nullptr)
+    {
+        _beginAt = millis();
+        _associationMs = channel != 0 && bssid != nullptr ? _cachedMs : _scanMs;
+        _status = WL_CONNECTED;
+        return status();
+    }
+
+    bool disconnect()
+    {
+        _status = WL_DISCONNECTED;
+        return true;
+    }
+
+    wl_status_t status() const
+    {
+        if (_status == WL_CONNECTED && millis() - _beginAt < _associationMs) {
+            return WL_DISCONNECTED; // Still associating
+        }
+        return _status;
+    }
+
+    uint8_t *BSSID() { return _bssid; }
+    int32_t channel() const { return 1; }
+    IPAddress localIP() const { return _ip != 0 ? _ip : IPAddress(127, 0, 0, 1); }
+    IPAddress gatewayIP() const { return _gateway != 0 ? _gateway : IPAddress(127, 0, 0, 1); }
+    IPAddress subnetMask() const { return _mask != 0 ? _mask : IPAddress(255, 0, 0, 0); }
+    IPAddress dnsIP() const { return _dns != 0 ? _dns : IPAddress(127, 0, 0, 1); }
+
+    void setConnectMs(uint32_t scanMs, uint32_t cachedMs)
+    {
+        _scanMs = scanMs;
+        _cachedMs = cachedMs;
+    }
+
+  private:
+    wl_status_t _status = WL_IDLE_STATUS;
+    unsigned long _beginAt = 0;
+    uint32_t _associationMs = 0;
+    uint32_t _scanMs = 0;
+    uint32_t _cachedMs = 0;
+    uint8_t _bssid[6] = {0x02, 0, 0, 0, 0, 0x01};
+    IPAddress _ip, _gateway, _mask, _dns;
+};
+
+inline WiFiClass WiFi;
+
+// Association time of the connections from here on, 0 (the default) for none
+inline void wifi_host_connect_ms(uint32_t scanMs, uint32_t cachedMs)
+{
+    WiFi.setConnectMs(scanMs, cachedMs);
+}
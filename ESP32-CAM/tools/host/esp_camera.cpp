@@ -0,0 +1,287 @@
+#include "esp_camera.h"
+
+#include "host_stats.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+
+const resolution_info_t resolution[] = {
+    {96, 96, ASPECT_RATIO_1X1},     // 96x96
+    {160, 120, ASPECT_RATIO_4X3},   // QQVGA
+    {176, 144, ASPECT_RATIO_5X4},   // QCIF
+    {240, 176, ASPECT_RATIO_4X3},   // HQVGA
+    {240, 240, ASPECT_RATIO_1X1},   // 240x240
+    {320, 240, ASPECT_RATIO_4X3},   // QVGA
+    {400, 296, ASPECT_RATIO_4X3},   // CIF
+    {480, 320, ASPECT_RATIO_3X2},   // HVGA
+    {640, 480, ASPECT_RATIO_4X3},   // VGA
+    {800, 600, ASPECT_RATIO_4X3},   // SVGA
+    {1024, 768, ASPECT_RATIO_4X3},  // XGA
+    {1280, 720, ASPECT_RATIO_16X9}, // HD
+    {1280, 1024, ASPECT_RATIO_5X4}, // SXGA
+    {1600, 1200, ASPECT_RATIO_4X3}, // UXGA
+};
+
+namespace
+{
+
+struct frame_file_t {
+    std::vector<uint8_t> jpeg;
+    uint16_t width;
+    uint16_t height;
+};
+
+struct frame_buffer_t {
+    camera_fb_t fb;
+    std::vector<uint8_t> data;
+    bool taken;
+};
+
+std::mutex cameraLock;
+std::string framesDirectory;
+std::vector<frame_file_t> frames;
+size_t nextFrame = 0;
+std::vector<frame_buffer_t> buffers;
+sensor_t sensor;
+bool initialised = false;
+
+// Width and height in the SOF marker, 0 if there is none
+void jpegSize(const std::vector<uint8_t> &jpeg, uint16_t &width, uint16_t &height)
+{
+    width = height = 0;
+    size_t i = 2;
+    while (i + 9 < jpeg.size() && jpeg[i] == 0xFF) {
+        const uint8_t marker = jpeg[i + 1];
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 &&
+            marker != 0xCC) {
+            height = jpeg[i + 5] << 8 | jpeg[i + 6];
+            width = jpeg[i + 7] << 8 | jpeg[i + 8];
+            return;
+        }
+        i += 2 + (jpeg[i + 2] << 8 | jpeg[i + 3]);
+    }
+}
+
+bool loadFrames()
+{
+    DIR *dir = opendir(framesDirectory.c_str());
+    if (dir == nullptr) {
+        return false;
+    }
+    std::vector<std::string> names;
+    while (dirent *entry = readdir(dir)) {
+        const char *dot = strrchr(entry->d_name, '.');
+        if (dot != nullptr && (strcasecmp(dot, ".jpg") == 0 || strcasecmp(dot, ".jpeg") == 0)) {
+            names.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+
+    frames.clear();
+    for (const std::string &name : names) {
+        FILE *file = fopen((framesDirectory + "/" + name).c_str(), "rb");
+        if (file == nullptr) {
+            continue;
+        }
+        frame_file_t frame;
+        uint8_t chunk[4096];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            frame.jpeg.insert(frame.jpeg.end(), chunk, chunk + n);
+        }
+        fclose(file);
+        jpegSize(frame.jpeg, frame.width, frame.height);
+        if (frame.width == 0) {
+            fprintf(stderr, "camera: %s is not a JPEG, skipped\n", name.c_str());
+            continue;
+        }
+        frames.push_back(std::move(frame));
+    }
+    return !frames.empty();
+}
+
+int setPixformat(sensor_t *s, pixformat_t pixformat)
+{
+    s->pixformat = pixformat;
+    return 0;
+}
+
+int setFramesize(sensor_t *s, framesize_t framesize)
+{
+    if (framesize >= FRAMESIZE_INVALID) {
+        return -1;
+    }
+    s->status.framesize = framesize;
+    return 0;
+}
+
+int setQuality(sensor_t *s, int quality)
+{
+    s->status.quality = quality;
+    return 0;
+}
+
+int setXclk(sensor_t *s, int, int xclk)
+{
+    s->xclk_freq_hz = xclk * 1000000;
+    return 0;
+}
+
+// The rest only land in the status, as far as the host cares
+int setLevel(sensor_t *, int)
+{
+    return 0;
+}
+
+int setGainceiling(sensor_t *s, gainceiling_t gainceiling)
+{
+    s->status.gainceiling = gainceiling;
+    return 0;
+}
+
+int setVflip(sensor_t *s, int enable)
+{
+    s->status.vflip = enable;
+    return 0;
+}
+
+int setHmirror(sensor_t *s, int enable)
+{
+    s->status.hmirror = enable;
+    return 0;
+}
+
+} // namespace
+
+void esp_camera_host_frames(const char *directory)
+{
+    framesDirectory = directory;
+}
+
+esp_err_t esp_camera_init(const camera_config_t *config)
+{
+    std::lock_guard<std::mutex> lock(cameraLock);
+    if (initialised) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!loadFrames()) {
+        fprintf(stderr, "camera: no JPEGs in '%s'\n", framesDirectory.c_str());
+        return ESP_ERR_NOT_FOUND; // As a camera that does not answer the probe
+    }
+
+    memset(&sensor, 0, sizeof(sensor));
+    sensor.id.PID = OV2640_PID;
+    sensor.pixformat = config->pixel_format;
+    sensor.xclk_freq_hz = config->xclk_freq_hz;
+    sensor.status.framesize = config->frame_size;
+    sensor.status.quality = config->jpeg_quality;
+    sensor.set_pixformat = setPixformat;
+    sensor.set_framesize = setFramesize;
+    sensor.set_quality = setQuality;
+    sensor.set_xclk = setXclk;
+    sensor.set_gainceiling = setGainceiling;
+    sensor.set_vflip = setVflip;
+    sensor.set_hmirror = setHmirror;
+    for (auto setter : {&sensor.set_contrast, &sensor.set_brightness, &sensor.set_saturation,
+                        &sensor.set_sharpness, &sensor.set_denoise, &sensor.set_colorbar,
+                        &sensor.set_whitebal, &sensor.set_gain_ctrl, &sensor.set_exposure_ctrl,
+                        &sensor.set_aec2, &sensor.set_awb_gain, &sensor.set_agc_gain,
+                        &sensor.set_aec_value, &sensor.set_special_effect, &sensor.set_wb_mode,
+                        &sensor.set_ae_level, &sensor.set_dcw, &sensor.set_bpc, &sensor.set_wpc,
+                        &sensor.set_raw_gma, &sensor.set_lenc}) {
+        *setter = setLevel;
+    }
+
+    // Buffers as large as the largest file, the driver's are sized for the
+    // largest frame
+    size_t largest = 0;
+    for (const frame_file_t &frame : frames) {
+        largest = std::max(largest, frame.jpeg.size());
+    }
+    buffers.assign(config->fb_count > 0 ? config->fb_count : 1, frame_buffer_t());
+    for (frame_buffer_t &buffer : buffers) {
+        buffer.data.resize(largest);
+        buffer.taken = false;
+    }
+    nextFrame = 0;
+    initialised = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_camera_deinit(void)
+{
+    std::lock_guard<std::mutex> lock(cameraLock);
+    if (!initialised) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    buffers.clear();
+    frames.clear();
+    initialised = false;
+    return ESP_OK;
+}
+
+camera_fb_t *esp_camera_fb_get(void)
+{
+    HostStageTimer timer(HOST_STAGE_CAMERA);
+    std::lock_guard<std::mutex> lock(cameraLock);
+    if (!initialised) {
+        return nullptr;
+    }
+    frame_buffer_t *buffer = nullptr;
+    for (frame_buffer_t &candidate : buffers) {
+        if (!candidate.taken) {
+            buffer = &candidate;
+            break;
+        }
+    }
+    if (buffer == nullptr) {
+        // The driver would wait for one to come back and time out
+        return nullptr;
+    }
+
+    const resolution_info_t &size = resolution[sensor.status.framesize];
+    size_t pick = nextFrame;
+    for (size_t i = 0; i < frames.size(); i++) {
+        const size_t at = (nextFrame + i) % frames.size();
+        if (frames[at].width == size.width && frames[at].height == size.height) {
+            pick = at;
+            break;
+        }
+    }
+    nextFrame = (pick + 1) % frames.size();
+
+    const frame_file_t &frame = frames[pick];
+    memcpy(buffer->data.data(), frame.jpeg.data(), frame.jpeg.size());
+    buffer->taken = true;
+    buffer->fb.buf = buffer->data.data();
+    buffer->fb.len = frame.jpeg.size();
+    buffer->fb.width = frame.width;
+    buffer->fb.height = frame.height;
+    buffer->fb.format = PIXFORMAT_JPEG;
+    gettimeofday(&buffer->fb.timestamp, nullptr);
+    return &buffer->fb;
+}
+
+void esp_camera_fb_return(camera_fb_t *fb)
+{
+    std::lock_guard<std::mutex> lock(cameraLock);
+    for (frame_buffer_t &buffer : buffers) {
+        if (&buffer.fb == fb) {
+            buffer.taken = false;
+        }
+    }
+}
+
+sensor_t *esp_camera_sensor_get(void)
+{
+    return initialised ? &sensor : nullptr;
+}
@@ -0,0 +1,103 @@
+// Host stand-in for the ESP-IDF HTTP server. There is none on the host:
+// httpd_start() fails, so a server never runs, and the rest is only there
+// for the firmware to build.
+#pragma once
+
+#include "esp_err.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef void *httpd_handle_t;
+
+typedef enum { HTTP_GET = 1, HTTP_POST = 3 } httpd_method_t;
+
+typedef enum {
+    HTTPD_400_BAD_REQUEST,
+    HTTPD_404_NOT_FOUND,
+    HTTPD_500_INTERNAL_SERVER_ERROR
+} httpd_err_code_t;
+
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    int method;
+    const char uri[513];
+    size_t content_len;
+    void *aux;
+    void *user_ctx;
+} httpd_req_t;
+
+typedef struct {
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *r);
+    void *user_ctx;
+} httpd_uri_t;
+
+typedef struct {
+    unsigned task_priority;
+    size_t stack_size;
+    int core_id;
+    uint16_t server_port;
+    uint16_t ctrl_port;
+    uint16_t max_open_sockets;
+    uint16_t max_uri_handlers;
+    uint16_t max_resp_headers;
+    uint16_t backlog_conn;
+    bool lru_purge_enable;
+    uint16_t recv_wait_timeout;
+    uint16_t send_wait_timeout;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG()                                                 \
+    {                                                                          \
+        5, 4096, 0x7FFFFFFF, 80, 32768, 7, 8, 8, 5, false, 5, 5                \
+    }
+
+typedef void (*httpd_work_fn_t)(void *arg);
+
+inline esp_err_t httpd_start(httpd_handle_t *, const httpd_config_t *)
+{
+    return ESP_FAIL;
+}
+inline esp_err_t httpd_stop(httpd_handle_t) { return ESP_OK; }
+inline esp_err_t httpd_register_uri_handler(httpd_handle_t, const httpd_uri_t *)
+{
+    return ESP_FAIL;
+}
+inline esp_err_t httpd_queue_work(httpd_handle_t, httpd_work_fn_t, void *)
+{
+    return ESP_FAIL;
+}
+
+inline esp_err_t httpd_resp_set_type(httpd_req_t *, const char *) { return ESP_FAIL; }
+inline esp_err_t httpd_resp_set_hdr(httpd_req_t *, const char *, const char *)
+{
+    return ESP_FAIL;
+}
+inline esp_err_t httpd_resp_set_status(httpd_req_t *, const char *) { return ESP_FAIL; }
+inline esp_err_t httpd_resp_send(httpd_req_t *, const char *, ssize_t)
+{
+    return ESP_FAIL;
+}
+inline esp_err_t httpd_resp_send_chunk(httpd_req_t *, const char *, ssize_t)
+{
+    return ESP_FAIL;
+}
+inline esp_err_t httpd_resp_send_err(httpd_req_t *, httpd_err_code_t, const char *)
+{
+    return ESP_FAIL;
+}
+inline esp_err_t httpd_resp_send_404(httpd_req_t *) { return ESP_FAIL; }
+inline esp_err_t httpd_resp_send_500(httpd_req_t *) { return ESP_FAIL; }
+
+inline size_t httpd_req_get_url_query_len(httpd_req_t *) { return 0; }
+inline esp_err_t httpd_req_get_url_query_str(httpd_req_t *, char *, size_t)
+{
+    return ESP_ERR_NOT_FOUND;
+}
+inline esp_err_t httpd_query_key_value(const char *, const char *, char *, size_t)
+{
+    return ESP_ERR_NOT_FOUND;
+}
@@ -0,0 +1,23 @@
+// Host stand-in for the FreeRTOS of ESP-IDF, on std::thread. A tick is a
+// millisecond, as configured for the Arduino core; priorities and cores are
+// taken and ignored.
+#pragma once
+
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t)1)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#define configMAX_PRIORITIES 25
+#define tskIDLE_PRIORITY ((UBaseType_t)0U)
+#define tskNO_AFFINITY ((BaseType_t)0x7FFFFFFF)
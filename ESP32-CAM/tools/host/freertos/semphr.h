@@ -0,0 +1,83 @@
+// Host stand-in for FreeRTOS semaphores and mutexes, on a condition variable.
+#pragma once
+
+#include "FreeRTOS.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+
+typedef struct {
+    std::mutex lock;
+    std::condition_variable changed;
+    UBaseType_t count;
+    UBaseType_t max;
+} StaticSemaphore_t;
+
+typedef StaticSemaphore_t *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t max, UBaseType_t initial,
+                                                        StaticSemaphore_t *buffer)
+{
+    SemaphoreHandle_t semaphore = new (buffer) StaticSemaphore_t();
+    semaphore->count = initial;
+    semaphore->max = max;
+    return semaphore;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer)
+{
+    return xSemaphoreCreateCountingStatic(1, 0, buffer);
+}
+
+// Not recursive, and without priority inheritance, which no host needs
+inline SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+    return xSemaphoreCreateCountingStatic(1, 1, buffer);
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    return xSemaphoreCreateCountingStatic(max, initial, new StaticSemaphore_t());
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lock(semaphore->lock);
+    const auto available = [semaphore] { return semaphore->count > 0; };
+    if (ticks == portMAX_DELAY) {
+        semaphore->changed.wait(lock, available);
+    } else if (!semaphore->changed.wait_for(lock, std::chrono::milliseconds(ticks), available)) {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    std::lock_guard<std::mutex> lock(semaphore->lock);
+    if (semaphore->count >= semaphore->max) {
+        return pdFALSE;
+    }
+    semaphore->count++;
+    semaphore->changed.notify_one();
+    return pdTRUE;
+}
+
+// Of the static ones only the object ends, the storage stays the caller's
+inline void vSemaphoreDelete(SemaphoreHandle_t semaphore)
+{
+    semaphore->~StaticSemaphore_t();
+}
@@ -0,0 +1,52 @@
+// Host stand-in for FreeRTOS tasks: a task is a detached std::thread.
+#pragma once
+
+#include "FreeRTOS.h"
+
+#include <pthread.h>
+
+#include <chrono>
+#include <thread>
+
+typedef void (*TaskFunction_t)(void *);
+typedef void *TaskHandle_t;
+
+// Name, stack depth, priority and core do not apply to a thread
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *, uint32_t,
+                                          void *parameters, UBaseType_t, TaskHandle_t *handle,
+                                          BaseType_t)
+{
+    std::thread thread(task, parameters);
+    if (handle != nullptr) {
+        *handle = (TaskHandle_t)thread.native_handle();
+    }
+    thread.detach();
+    return pdPASS;
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stackDepth,
+                              void *parameters, UBaseType_t priority, TaskHandle_t *handle)
+{
+    return xTaskCreatePinnedToCore(task, name, stackDepth, parameters, priority, handle,
+                                   tskNO_AFFINITY);
+}
+
+inline void vTaskDelay(TickType_t ticks)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+// Only a task ending itself, as the firmware's tasks do
+inline void vTaskDelete(TaskHandle_t task)
+{
+    if (task == nullptr) {
+        pthread_exit(nullptr);
+    }
+}
+
+inline TickType_t xTaskGetTickCount()
+{
+    return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
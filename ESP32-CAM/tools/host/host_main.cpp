@@ -0,0 +1,344 @@
+// Runs the whole application on Linux: src/ as it is, on the stand-ins of
+// this directory. The camera hands out the JPEGs of --frames, the SD card is
+// the directory --sd (config.txt, nutrition table, capture log), the network
+// is the host's, with WiFi associating in --wifi-ms SCAN,CACHED milliseconds
+// (none by default). setup() runs first, then each line of the script (or stdin)
+// goes to Serial as the app would get it from the host computer, followed by
+// one loop(). Lines starting with '#' are comments; "@wait MS" keeps calling
+// loop() for that long, for what the tasks do in the background.
+//
+// What the app writes on Serial comes out on stdout. On stderr, for every
+// command: the time it took, the part of it spent in the camera, JPEG decode,
+// SD and network stand-ins, the rest (resize, gate, DSP, inference, the app
+// itself), and the heap high-water mark while it ran. At the end, a summary
+// per command with percentiles, the heap high-water of the whole run and the
+// peak RSS; --report writes that summary as TSV too, for CI to compare.
+//
+// Build with PlatformIO, from ESP32-CAM/, and run:
+//   pio run -e native
+//   .pio/build/native/program --frames frames/ --sd sd/ --report times.tsv session.txt
+// A session: HELLO, INIT, "@wait 2000" for the network task to sync, then
+// TARE and CAPTUREs. Frames of every size the adaptive camera may pick keep
+// CAPTURE from skipping them as stale.
+#include "Arduino.h"
+#include "SD_MMC.h"
+#include "WiFi.h"
+#include "esp_camera.h"
+#include "host_stats.h"
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+
+// Heap in use and its high-water mark, over every thread, by standing in
+// for the allocator entry points of glibc
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+}
+
+static std::atomic<size_t> heapInUse{0};
+static std::atomic<size_t> heapPeak{0}; // Since the last command started
+
+static void *heapTaken(void *ptr)
+{
+    if (ptr != nullptr) {
+        const size_t now = heapInUse += malloc_usable_size(ptr);
+        size_t peak = heapPeak.load(std::memory_order_relaxed);
+        while (now > peak && !heapPeak.compare_exchange_weak(peak, now)) {
+        }
+    }
+    return ptr;
+}
+
+extern "C" {
+
+void *malloc(size_t size)
+{
+    return heapTaken(__libc_malloc(size));
+}
+
+void *calloc(size_t n, size_t size)
+{
+    return heapTaken(__libc_calloc(n, size));
+}
+
+void free(void *ptr)
+{
+    if (ptr != nullptr) {
+        heapInUse -= malloc_usable_size(ptr);
+        __libc_free(ptr);
+    }
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    const size_t before = ptr != nullptr ? malloc_usable_size(ptr) : 0;
+    void *moved = __libc_realloc(ptr, size);
+    if (moved != nullptr || size == 0) {
+        heapInUse -= before;
+        heapTaken(moved);
+    }
+    return moved;
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    return heapTaken(__libc_memalign(alignment, size));
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    *ptr = memalign(alignment, size);
+    return *ptr != nullptr ? 0 : ENOMEM;
+}
+
+} // extern "C"
+
+size_t host_heap_in_use()
+{
+    return heapInUse.load();
+}
+
+size_t host_heap_peak()
+{
+    return heapPeak.load();
+}
+
+void host_heap_reset_peak()
+{
+    heapPeak = heapInUse.load();
+}
+
+// The native tests (test/) bring their own main(), on the same stand-ins
+#ifndef PIO_UNIT_TESTING
+
+static size_t heapHighWater = 0; // Of the whole run, up to the last command
+
+namespace
+{
+
+static const char *STAGE_NAMES[HOST_STAGES] = {"camera", "decode", "sd", "network"};
+
+struct run_t {
+    uint64_t totalUs;
+    uint64_t stageUs[HOST_STAGES];
+    size_t heapPeak;
+};
+
+std::map<std::string, std::vector<run_t>> runs;
+
+void usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--frames DIR] [--sd DIR] [--wifi-ms SCAN,CACHED] [--report FILE] [script]\n", program);
+    exit(2);
+}
+
+double ms(uint64_t us)
+{
+    return us / 1000.0;
+}
+
+// Times one command, and the stages and heap it took
+template <typename F> run_t measure(F &&body)
+{
+    uint64_t stagesBefore[HOST_STAGES];
+    for (int stage = 0; stage < HOST_STAGES; stage++) {
+        stagesBefore[stage] = hostForegroundUs[stage];
+    }
+    heapHighWater = std::max(heapHighWater, heapPeak.load());
+    host_heap_reset_peak();
+
+    const uint64_t start = host_now_us();
+    body();
+    run_t run;
+    run.totalUs = host_now_us() - start;
+    for (int stage = 0; stage < HOST_STAGES; stage++) {
+        run.stageUs[stage] = hostForegroundUs[stage] - stagesBefore[stage];
+    }
+    run.heapPeak = heapPeak;
+    return run;
+}
+
+void report(const std::string &command, const run_t &run)
+{
+    uint64_t rest = run.totalUs;
+    fprintf(stderr, "host: %-14s %9.2f ms (", command.c_str(), ms(run.totalUs));
+    for (int stage = 0; stage < HOST_STAGES; stage++) {
+        fprintf(stderr, "%s %.2f, ", STAGE_NAMES[stage], ms(run.stageUs[stage]));
+        rest -= std::min(rest, run.stageUs[stage]);
+    }
+    fprintf(stderr, "rest %.2f), heap peak %zu KB\n", ms(rest), run.heapPeak / 1024);
+}
+
+uint64_t percentile(std::vector<uint64_t> values, int p)
+{
+    std::sort(values.begin(), values.end());
+    return values[(values.size() - 1) * p / 100];
+}
+
+void summary(FILE *out, bool tsv)
+{
+    const char *header =
+        tsv ? "command\tn\tp50_ms\tp90_ms\tmax_ms\tcamera_ms\tdecode_ms\tsd_ms\tnetwork_ms\t"
+              "rest_ms\theap_peak_kb\n"
+            : "host: command            n    p50 ms    p90 ms    max ms |  camera  decode      "
+              "sd network    rest (mean ms) | heap peak KB\n";
+    fputs(header, out);
+    for (const auto &entry : runs) {
+        const std::vector<run_t> &list = entry.second;
+        std::vector<uint64_t> totals;
+        double mean[HOST_STAGES] = {};
+        double meanTotal = 0;
+        size_t peak = 0;
+        for (const run_t &run : list) {
+            totals.push_back(run.totalUs);
+            meanTotal += ms(run.totalUs) / list.size();
+            for (int stage = 0; stage < HOST_STAGES; stage++) {
+                mean[stage] += ms(run.stageUs[stage]) / list.size();
+            }
+            peak = std::max(peak, run.heapPeak);
+        }
+        double rest = meanTotal;
+        for (int stage = 0; stage < HOST_STAGES; stage++) {
+            rest -= mean[stage];
+        }
+        rest = std::max(rest, 0.0);
+
+        const double p50 = ms(percentile(totals, 50));
+        const double p90 = ms(percentile(totals, 90));
+        const double max = ms(percentile(totals, 100));
+        if (tsv) {
+            fprintf(out, "%s\t%zu\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%zu\n",
+                    entry.first.c_str(), list.size(), p50, p90, max, mean[0], mean[1], mean[2],
+                    mean[3], rest, peak / 1024);
+        } else {
+            fprintf(out,
+                    "host: %-14s %5zu %9.2f %9.2f %9.2f | %7.2f %7.2f %7.2f %7.2f %7.2f           "
+                    "| %12zu\n",
+                    entry.first.c_str(), list.size(), p50, p90, max, mean[0], mean[1], mean[2],
+                    mean[3], rest, peak / 1024);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const char *frames = "frames";
+    const char *sd = "sd";
+    const char *reportPath = nullptr;
+    const char *scriptPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = argv[++i];
+        } else if (strcmp(argv[i], "--sd") == 0 && i + 1 < argc) {
+            sd = argv[++i];
+        } else if (strcmp(argv[i], "--wifi-ms") == 0 && i + 1 < argc) {
+            unsigned int scanMs, cachedMs;
+            if (sscanf(argv[++i], "%u,%u", &scanMs, &cachedMs) != 2) {
+                usage(argv[0]);
+            }
+            wifi_host_connect_ms(scanMs, cachedMs);
+        } else if (strcmp(argv[i], "--report") == 0 && i + 1 < argc) {
+            reportPath = argv[++i];
+        } else if (argv[i][0] != '-' && scriptPath == nullptr) {
+            scriptPath = argv[i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    FILE *script = scriptPath != nullptr ? fopen(scriptPath, "r") : stdin;
+    if (script == nullptr) {
+        fprintf(stderr, "host: cannot open %s\n", scriptPath);
+        return 1;
+    }
+    esp_camera_host_frames(frames);
+    sd_mmc_host_root(sd);
+    hostForeground = true; // This thread is the one of setup() and loop()
+
+    const run_t boot = measure([] { setup(); });
+    report("(setup)", boot);
+    runs["(setup)"].push_back(boot);
+
+    char line[512];
+    while (fgets(line, sizeof(line), script) != nullptr) {
+        line[strcspn(line, "\r\n")] = '\0';
+        const char *text = line + strspn(line, " \t");
+        if (text[0] == '\0' || text[0] == '#') {
+            continue;
+        }
+        if (strncmp(text, "@wait", 5) == 0) {
+            const unsigned long until = millis() + strtoul(text + 5, nullptr, 10);
+            while ((long)(until - millis()) > 0) {
+                loop();
+                delay(1);
+            }
+            continue;
+        }
+
+        std::string command(text, strcspn(text, " \t"));
+        for (char &c : command) {
+            c = toupper((unsigned char)c);
+        }
+        const run_t run = measure([text] {
+            Serial.feed(text, strlen(text));
+            Serial.feed("\n", 1);
+            loop();
+        });
+        report(command, run);
+        runs[command].push_back(run);
+    }
+    if (script != stdin) {
+        fclose(script);
+    }
+
+    summary(stderr, false);
+    fprintf(stderr, "host: background");
+    for (int stage = 0; stage < HOST_STAGES; stage++) {
+        fprintf(stderr, " %s %.2f ms", STAGE_NAMES[stage], ms(hostBackgroundUs[stage]));
+    }
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    heapHighWater = std::max(heapHighWater, heapPeak.load());
+    fprintf(stderr, "\nhost: heap high-water %zu KB, peak RSS %ld KB\n", heapHighWater / 1024,
+            usage.ru_maxrss);
+
+    if (reportPath != nullptr) {
+        FILE *out = fopen(reportPath, "w");
+        if (out == nullptr) {
+            fprintf(stderr, "host: cannot write %s\n", reportPath);
+            return 1;
+        }
+        summary(out, true);
+        fclose(out);
+    }
+    // The tasks are still running, do not wait for them
+    fflush(stdout);
+    _exit(0);
+}
+
+#endif // PIO_UNIT_TESTING
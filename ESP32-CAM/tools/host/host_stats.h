@@ -0,0 +1,53 @@
+// Time the host stand-ins spend in place of the hardware, by stage, for the
+// host build of the application (host_main.cpp). The thread that runs
+// loop() is the foreground one; the time of the others (the network task,
+// the stream stages) is kept apart.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+
+typedef enum {
+    HOST_STAGE_CAMERA,  // esp_camera_fb_get()
+    HOST_STAGE_DECODE,  // fmt2rgb888()
+    HOST_STAGE_SD,      // SD_MMC files
+    HOST_STAGE_NETWORK, // HTTPClient, connecting, sending and waiting on replies
+    HOST_STAGES
+} host_stage_t;
+
+inline std::atomic<uint64_t> hostForegroundUs[HOST_STAGES];
+inline std::atomic<uint64_t> hostBackgroundUs[HOST_STAGES];
+inline thread_local bool hostForeground = false;
+
+inline uint64_t host_now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Adds the time until it goes out of scope to a stage
+class HostStageTimer
+{
+  public:
+    explicit HostStageTimer(host_stage_t stage) : _stage(stage), _start(host_now_us()) {}
+
+    ~HostStageTimer()
+    {
+        (hostForeground ? hostForegroundUs : hostBackgroundUs)[_stage] +=
+            host_now_us() - _start;
+    }
+
+  private:
+    host_stage_t _stage;
+    uint64_t _start;
+};
+
+// Heap in use over every thread, and its high-water mark since the last
+// host_heap_reset_peak(); host_main.cpp keeps them in place of the allocator
+size_t host_heap_in_use();
+size_t host_heap_peak();
+void host_heap_reset_peak();
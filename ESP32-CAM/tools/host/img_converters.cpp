@@ -0,0 +1,463 @@
+#include "img_converters.h"
+
+#include "host_stats.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <vector>
+
+namespace
+{
+
+// Zigzag order to the natural order of a block
+const uint8_t ZIGZAG[64] = {
+    0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6,  7,  14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+struct Huffman {
+    bool defined = false;
+    // Canonical code tables of the standard (F.2.2.3), by code length
+    int32_t maxCode[18];
+    int32_t valPtr[17];
+    int32_t minCode[17];
+    uint8_t values[256];
+};
+
+struct Component {
+    uint8_t id;
+    int h;
+    int v;
+    int tq;
+    int td;
+    int ta;
+    int pred;
+    int stride; // of the plane
+    std::vector<uint8_t> plane;
+};
+
+class Decoder
+{
+  public:
+    Decoder(const uint8_t *data, size_t length) : _data(data), _length(length) {}
+
+    bool decode(uint8_t *bgr);
+
+  private:
+    bool _marker(uint8_t &marker);
+    uint16_t _u16(size_t at) const { return _data[at] << 8 | _data[at + 1]; }
+    bool _readTables(uint8_t marker, size_t at, size_t length);
+    bool _scan(size_t at, size_t length);
+
+    int _bit();
+    int _bits(int count);
+    int _huffman(const Huffman &table);
+    bool _restart();
+    bool _block(Component &c, int x, int y);
+    void _idct(const float *in, uint8_t *out, int stride);
+    void _color(uint8_t *bgr);
+
+    const uint8_t *_data;
+    size_t _length;
+    size_t _at = 0;
+
+    uint16_t _qt[4][64];
+    Huffman _dc[4];
+    Huffman _ac[4];
+    Component _components[3];
+    int _count = 0;
+    int _width = 0;
+    int _height = 0;
+    int _hMax = 1;
+    int _vMax = 1;
+    int _restartInterval = 0;
+    bool _frame = false;
+
+    uint32_t _bitBuffer = 0;
+    int _bitCount = 0;
+    bool _ended = false; // ran into a marker
+};
+
+bool Decoder::_marker(uint8_t &marker)
+{
+    while (_at + 1 < _length && _data[_at] != 0xFF) {
+        _at++;
+    }
+    while (_at + 1 < _length && _data[_at + 1] == 0xFF) {
+        _at++; // Fill bytes
+    }
+    if (_at + 1 >= _length) {
+        return false;
+    }
+    marker = _data[_at + 1];
+    _at += 2;
+    return true;
+}
+
+bool Decoder::_readTables(uint8_t marker, size_t at, size_t length)
+{
+    const size_t end = at + length;
+    if (marker == 0xDB) {
+        while (at < end) {
+            const int precision = _data[at] >> 4, id = _data[at] & 3;
+            at++;
+            for (int k = 0; k < 64; k++) {
+                _qt[id][k] = precision ? _u16(at + 2 * k) : _data[at + k];
+            }
+            at += precision ? 128 : 64;
+        }
+        return at == end;
+    }
+
+    // DHT
+    while (at + 17 <= end) {
+        const int tableClass = _data[at] >> 4, id = _data[at] & 3;
+        Huffman &table = tableClass ? _ac[id] : _dc[id];
+        const uint8_t *counts = _data + at + 1;
+        at += 17;
+
+        int total = 0;
+        for (int i = 0; i < 16; i++) {
+            total += counts[i];
+        }
+        if (total > 256 || at + total > end) {
+            return false;
+        }
+        memcpy(table.values, _data + at, total);
+        at += total;
+
+        int code = 0, k = 0;
+        for (int length = 1; length <= 16; length++) {
+            table.valPtr[length] = k;
+            table.minCode[length] = code;
+            code += counts[length - 1];
+            k += counts[length - 1];
+            table.maxCode[length] = counts[length - 1] ? code - 1 : -1;
+            code <<= 1;
+        }
+        table.maxCode[17] = 0x7FFFFFFF;
+        table.defined = true;
+    }
+    return at == end;
+}
+
+int Decoder::_bit()
+{
+    if (_bitCount == 0) {
+        uint8_t byte = 0;
+        if (!_ended && _at < _length) {
+            byte = _data[_at++];
+            if (byte == 0xFF) {
+                const uint8_t next = _at < _length ? _data[_at] : 0;
+                if (next == 0x00) {
+                    _at++; // Stuffed zero
+                } else {
+                    // A marker: no more data in this interval, read zeros
+                    _ended = true;
+                    _at--;
+                    byte = 0;
+                }
+            }
+        }
+        _bitBuffer = byte;
+        _bitCount = 8;
+    }
+    _bitCount--;
+    return (_bitBuffer >> _bitCount) & 1;
+}
+
+int Decoder::_bits(int count)
+{
+    int value = 0;
+    for (int i = 0; i < count; i++) {
+        value = value << 1 | _bit();
+    }
+    return value;
+}
+
+int Decoder::_huffman(const Huffman &table)
+{
+    int code = 0;
+    for (int length = 1; length <= 16; length++) {
+        code = code << 1 | _bit();
+        if (table.maxCode[length] >= 0 && code <= table.maxCode[length]) {
+            return table.values[table.valPtr[length] + code - table.minCode[length]];
+        }
+    }
+    return -1;
+}
+
+bool Decoder::_restart()
+{
+    _bitCount = 0;
+    _ended = false;
+    // Skip to the RSTn marker
+    uint8_t marker;
+    if (!_marker(marker) || marker < 0xD0 || marker > 0xD7) {
+        return false;
+    }
+    for (int i = 0; i < _count; i++) {
+        _components[i].pred = 0;
+    }
+    return true;
+}
+
+void Decoder::_idct(const float *in, uint8_t *out, int stride)
+{
+    static float cosines[8][8];
+    static bool ready = false;
+    if (!ready) {
+        for (int x = 0; x < 8; x++) {
+            for (int u = 0; u < 8; u++) {
+                const float c = u == 0 ? sqrtf(0.5f) : 1.0f;
+                cosines[x][u] = c * cosf((2 * x + 1) * u * (float)M_PI / 16);
+            }
+        }
+        ready = true;
+    }
+
+    float rows[64];
+    for (int v = 0; v < 8; v++) {
+        for (int x = 0; x < 8; x++) {
+            float sum = 0;
+            for (int u = 0; u < 8; u++) {
+                sum += cosines[x][u] * in[v * 8 + u];
+            }
+            rows[v * 8 + x] = sum;
+        }
+    }
+    for (int x = 0; x < 8; x++) {
+        for (int y = 0; y < 8; y++) {
+            float sum = 0;
+            for (int v = 0; v < 8; v++) {
+                sum += cosines[y][v] * rows[v * 8 + x];
+            }
+            const int value = (int)lroundf(sum / 4 + 128);
+            out[y * stride + x] = value < 0 ? 0 : value > 255 ? 255 : value;
+        }
+    }
+}
+
+bool Decoder::_block(Component &c, int x, int y)
+{
+    float coefficients[64] = {0};
+    const uint16_t *q = _qt[c.tq];
+
+    const int size = _huffman(_dc[c.td]);
+    if (size < 0 || size > 16) {
+        return false;
+    }
+    int diff = size ? _bits(size) : 0;
+    if (size && diff < 1 << (size - 1)) {
+        diff -= (1 << size) - 1;
+    }
+    c.pred += diff;
+    coefficients[0] = (float)(c.pred * q[0]);
+
+    for (int k = 1; k < 64;) {
+        const int rs = _huffman(_ac[c.ta]);
+        if (rs < 0) {
+            return false;
+        }
+        const int run = rs >> 4, s = rs & 15;
+        if (s == 0) {
+            if (run != 15) {
+                break; // End of block
+            }
+            k += 16;
+            continue;
+        }
+        k += run;
+        if (k > 63) {
+            return false;
+        }
+        int value = _bits(s);
+        if (value < 1 << (s - 1)) {
+            value -= (1 << s) - 1;
+        }
+        coefficients[ZIGZAG[k]] = (float)(value * q[k]);
+        k++;
+    }
+
+    _idct(coefficients, c.plane.data() + y * c.stride + x, c.stride);
+    return true;
+}
+
+bool Decoder::_scan(size_t at, size_t length)
+{
+    const int count = _data[at];
+    if (count != _count || length < (size_t)(1 + 2 * count + 3)) {
+        return false; // Interleaved scans of every component only
+    }
+    for (int i = 0; i < count; i++) {
+        const uint8_t id = _data[at + 1 + 2 * i];
+        const uint8_t tables = _data[at + 2 + 2 * i];
+        Component *c = nullptr;
+        for (int j = 0; j < _count; j++) {
+            if (_components[j].id == id) {
+                c = &_components[j];
+            }
+        }
+        if (c == nullptr || !_dc[tables >> 4 & 3].defined || !_ac[tables & 3].defined) {
+            return false;
+        }
+        c->td = tables >> 4 & 3;
+        c->ta = tables & 3;
+        c->pred = 0;
+    }
+    _at = at + length;
+
+    const int mcuWidth = 8 * _hMax, mcuHeight = 8 * _vMax;
+    const int mcusX = (_width + mcuWidth - 1) / mcuWidth;
+    const int mcusY = (_height + mcuHeight - 1) / mcuHeight;
+    _bitCount = 0;
+    _ended = false;
+
+    int mcus = 0;
+    for (int my = 0; my < mcusY; my++) {
+        for (int mx = 0; mx < mcusX; mx++) {
+            if (_restartInterval && mcus > 0 && mcus % _restartInterval == 0 &&
+                !_restart()) {
+                return false;
+            }
+            mcus++;
+            for (int i = 0; i < _count; i++) {
+                Component &c = _components[i];
+                for (int by = 0; by < c.v; by++) {
+                    for (int bx = 0; bx < c.h; bx++) {
+                        if (!_block(c, (mx * c.h + bx) * 8, (my * c.v + by) * 8)) {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void Decoder::_color(uint8_t *bgr)
+{
+    for (int y = 0; y < _height; y++) {
+        for (int x = 0; x < _width; x++) {
+            int sample[3];
+            for (int i = 0; i < _count; i++) {
+                const Component &c = _components[i];
+                // Nearest sample of a subsampled component
+                sample[i] = c.plane[(y * c.v / _vMax) * c.stride + x * c.h / _hMax];
+            }
+            uint8_t *out = bgr + (y * _width + x) * 3;
+            if (_count == 1) {
+                out[0] = out[1] = out[2] = sample[0];
+                continue;
+            }
+            const float luma = sample[0], cb = sample[1] - 128.0f, cr = sample[2] - 128.0f;
+            const float rgb[3] = {luma + 1.402f * cr, luma - 0.344136f * cb - 0.714136f * cr,
+                                  luma + 1.772f * cb};
+            for (int k = 0; k < 3; k++) {
+                const int value = (int)lroundf(rgb[k]);
+                out[2 - k] = value < 0 ? 0 : value > 255 ? 255 : value;
+            }
+        }
+    }
+}
+
+bool Decoder::decode(uint8_t *bgr)
+{
+    if (_length < 4 || _data[0] != 0xFF || _data[1] != 0xD8) {
+        return false;
+    }
+    _at = 2;
+
+    uint8_t marker;
+    while (_marker(marker)) {
+        if (marker == 0xD9 || _at + 2 > _length) {
+            return false; // End of image before a scan
+        }
+        const size_t length = _u16(_at);
+        if (length < 2 || _at + length > _length) {
+            return false;
+        }
+        const size_t at = _at + 2;
+        _at += length;
+
+        switch (marker) {
+        case 0xC0: // Baseline
+        case 0xC1: // Extended sequential, Huffman
+            _height = _u16(at + 1);
+            _width = _u16(at + 3);
+            _count = _data[at + 5];
+            if (_data[at] != 8 || _width == 0 || _height == 0 ||
+                (_count != 1 && _count != 3)) {
+                return false;
+            }
+            for (int i = 0; i < _count; i++) {
+                Component &c = _components[i];
+                c.id = _data[at + 6 + 3 * i];
+                c.h = _data[at + 7 + 3 * i] >> 4;
+                c.v = _data[at + 7 + 3 * i] & 15;
+                c.tq = _data[at + 8 + 3 * i] & 3;
+                if (c.h < 1 || c.h > 2 || c.v < 1 || c.v > 2) {
+                    return false;
+                }
+                _hMax = c.h > _hMax ? c.h : _hMax;
+                _vMax = c.v > _vMax ? c.v : _vMax;
+            }
+            for (int i = 0; i < _count; i++) {
+                Component &c = _components[i];
+                const int mcusX = (_width + 8 * _hMax - 1) / (8 * _hMax);
+                const int mcusY = (_height + 8 * _vMax - 1) / (8 * _vMax);
+                c.stride = mcusX * c.h * 8;
+                c.plane.assign((size_t)c.stride * mcusY * c.v * 8, 0);
+            }
+            _frame = true;
+            break;
+        case 0xC2: // Progressive and the rest, TJpgDec does not take them
+        case 0xC3:
+        case 0xC5:
+        case 0xC6:
+        case 0xC7:
+        case 0xC9:
+        case 0xCA:
+        case 0xCB:
+        case 0xCD:
+        case 0xCE:
+        case 0xCF:
+            return false;
+        case 0xC4:
+        case 0xDB:
+            if (!_readTables(marker, at, length - 2)) {
+                return false;
+            }
+            break;
+        case 0xDD:
+            _restartInterval = _u16(at);
+            break;
+        case 0xDA:
+            if (!_frame || !_scan(at, length - 2)) {
+                return false;
+            }
+            _color(bgr);
+            return true;
+        default:
+            break; // APPn, COM
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool fmt2rgb888(const uint8_t *src_buf, size_t src_len, pixformat_t format,
+                uint8_t *rgb_buf)
+{
+    HostStageTimer timer(HOST_STAGE_DECODE);
+    if (format != PIXFORMAT_JPEG) {
+        return false;
+    }
+    Decoder decoder(src_buf, src_len);
+    return decoder.decode(rgb_buf);
+}
@@ -0,0 +1,14 @@
+// Host stand-in for the image converters of the esp32-camera driver: a
+// baseline JPEG decoder, no progressive JPEGs, like the TJpgDec the driver
+// decodes with.
+#pragma once
+
+#include "esp_camera.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A JPEG into 3 bytes a pixel, blue first as the driver writes them. False
+// for any other format and for a JPEG it cannot decode.
+bool fmt2rgb888(const uint8_t *src_buf, size_t src_len, pixformat_t format,
+                uint8_t *rgb_buf);
@@ -0,0 +1,171 @@
+// Benchmark of the grid based NMS (ei_nms_grid) against the TFLite reference
+// NonMaxSuppression in classifier/ei_nms.h, for 100 to 5000 candidate boxes.
+//
+// Candidates look like the output of a YOLO style head: clusters of jittered
+// proposals around a set of objects in a 640x640 frame, spread over 6 classes,
+// with a few proposals of the wrong class in each cluster. Three cases:
+//   - class agnostic, every candidate may be selected (what ei_run_nms() does)
+//   - class agnostic, top 10 only (early termination)
+//   - per class: the reference runs once per class, the grid NMS in one pass
+// Every case checks that both select the same boxes in the same order.
+//
+// Build and run on the host, from ESP32-CAM/:
+//   SRC=lib/smart_scale_inferencing/src
+//   g++ -std=c++17 -O2 -Wall -Wextra -DEI_PORTING_CLIB=1 -isystem $SRC -isystem $SRC/edge-impulse-sdk tools/nms_benchmark.cpp -o nms_benchmark -lm
+//   ./nms_benchmark
+
+#include "edge-impulse-sdk/classifier/ei_nms.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+const int kClasses = 6;
+const float kIouThreshold = 0.45f;
+const float kScoreThreshold = 0.1f;
+
+struct Candidates {
+    std::vector<float> boxes;   // [y1, x1, y2, x2]
+    std::vector<float> scores;
+    std::vector<int> classes;
+};
+
+Candidates Generate(std::mt19937 &rng, int count)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    Candidates c;
+    const int objects = std::max(1, count / 20);
+    std::vector<float> ox(objects), oy(objects), ow(objects), oh(objects);
+    std::vector<int> ocls(objects);
+    for (int o = 0; o < objects; o++) {
+        ow[o] = 16 + unit(rng) * 120;
+        oh[o] = 16 + unit(rng) * 120;
+        ox[o] = unit(rng) * (640 - ow[o]);
+        oy[o] = unit(rng) * (640 - oh[o]);
+        ocls[o] = rng() % kClasses;
+    }
+    // distinct scores, so both implementations see the same order
+    std::vector<float> scores(count);
+    for (int i = 0; i < count; i++) {
+        scores[i] = (float)(i + 1) / (float)(count + 1);
+    }
+    std::shuffle(scores.begin(), scores.end(), rng);
+
+    for (int i = 0; i < count; i++) {
+        const int o = rng() % objects;
+        const float jx = (unit(rng) - 0.5f) * 0.3f * ow[o], jy = (unit(rng) - 0.5f) * 0.3f * oh[o];
+        const float sw = 0.8f + unit(rng) * 0.4f, sh = 0.8f + unit(rng) * 0.4f;
+        const float x = ox[o] + jx, y = oy[o] + jy;
+        c.boxes.insert(c.boxes.end(), { y, x, y + oh[o] * sh, x + ow[o] * sw });
+        c.scores.push_back(scores[i]);
+        c.classes.push_back(rng() % 8 == 0 ? (int)(rng() % kClasses) : ocls[o]);
+    }
+    return c;
+}
+
+std::vector<int> ReferenceAgnostic(const Candidates &c, int max_output)
+{
+    const int n = c.scores.size();
+    std::vector<int> selected(n);
+    std::vector<float> selected_scores(n);
+    int count = 0;
+    NonMaxSuppression(c.boxes.data(), n, c.scores.data(), max_output, kIouThreshold, kScoreThreshold,
+        0.0f, selected.data(), selected_scores.data(), &count);
+    selected.resize(count);
+    return selected;
+}
+
+// one reference run per class, merged by score like the TAO decoders do
+std::vector<int> ReferencePerClass(const Candidates &c)
+{
+    std::vector<int> all;
+    std::vector<float> boxes, scores;
+    std::vector<int> map;
+    for (int cls = 0; cls < kClasses; cls++) {
+        boxes.clear(); scores.clear(); map.clear();
+        for (size_t i = 0; i < c.scores.size(); i++) {
+            if (c.classes[i] != cls) continue;
+            boxes.insert(boxes.end(), c.boxes.begin() + i * 4, c.boxes.begin() + i * 4 + 4);
+            scores.push_back(c.scores[i]);
+            map.push_back(i);
+        }
+        if (map.empty()) continue;
+        std::vector<int> selected(map.size());
+        std::vector<float> selected_scores(map.size());
+        int count = 0;
+        NonMaxSuppression(boxes.data(), map.size(), scores.data(), map.size(), kIouThreshold, kScoreThreshold,
+            0.0f, selected.data(), selected_scores.data(), &count);
+        for (int i = 0; i < count; i++) {
+            all.push_back(map[selected[i]]);
+        }
+    }
+    std::sort(all.begin(), all.end(), [&c](int a, int b) { return c.scores[a] > c.scores[b]; });
+    return all;
+}
+
+std::vector<int> Grid(const Candidates &c, int max_output, bool class_aware, std::vector<uint8_t> &workspace)
+{
+    const int n = c.scores.size();
+    std::vector<int> selected(n);
+    std::vector<float> selected_scores(n);
+    int count = ei_nms_grid(c.boxes.data(), n, c.scores.data(), c.classes.data(), max_output, kIouThreshold,
+        kScoreThreshold, class_aware, workspace.data(), selected.data(), selected_scores.data());
+    selected.resize(count);
+    return selected;
+}
+
+template<typename Fn>
+double TimeUs(int reps, Fn fn)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        fn();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(t1 - t0).count() / reps;
+}
+
+} // namespace
+
+int main()
+{
+    const int counts[] = { 100, 250, 500, 1000, 2000, 5000 };
+    std::mt19937 rng(42);
+    bool ok = true;
+
+    printf("%6s %6s | %12s %12s %6s | %12s %12s %6s | %12s %12s %6s\n",
+        "boxes", "kept", "ref us", "grid us", "x", "ref top10", "grid top10", "x", "ref class", "grid class", "x");
+
+    for (int count : counts) {
+        Candidates c = Generate(rng, count);
+        std::vector<uint8_t> workspace(ei_nms_workspace_size(count));
+        const int reps = std::max(3, 20000 / count);
+
+        const bool same_all = ReferenceAgnostic(c, count) == Grid(c, count, false, workspace);
+        const bool same_top = ReferenceAgnostic(c, 10) == Grid(c, 10, false, workspace);
+        const bool same_cls = ReferencePerClass(c) == Grid(c, count, true, workspace);
+        ok = ok && same_all && same_top && same_cls;
+
+        const double ref_all = TimeUs(reps, [&]() { ReferenceAgnostic(c, count); });
+        const double grid_all = TimeUs(reps, [&]() { Grid(c, count, false, workspace); });
+        const double ref_top = TimeUs(reps, [&]() { ReferenceAgnostic(c, 10); });
+        const double grid_top = TimeUs(reps, [&]() { Grid(c, 10, false, workspace); });
+        const double ref_cls = TimeUs(reps, [&]() { ReferencePerClass(c); });
+        const double grid_cls = TimeUs(reps, [&]() { Grid(c, count, true, workspace); });
+
+        printf("%6d %6zu | %12.1f %12.1f %5.1fx | %12.1f %12.1f %5.1fx | %12.1f %12.1f %5.1fx %s\n",
+            count, Grid(c, count, false, workspace).size(),
+            ref_all, grid_all, ref_all / grid_all,
+            ref_top, grid_top, ref_top / grid_top,
+            ref_cls, grid_cls, ref_cls / grid_cls,
+            same_all && same_top && same_cls ? "" : "MISMATCH");
+    }
+
+    printf("%s\n", ok ? "OK" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+// Check of the SD nutrition table (src/NutritionDB.cpp), on a file held in
+// memory.
+//
+// A table of synthetic foods is written, opened and every food looked up again,
+// under its name in another case too, along with names that are not in it.
+// Every lookup must read at most one block. The table is then rebuilt the way
+// the sync does it, from the old foods with a delta appended, and the updated
+// and added foods must come back with their new calories.
+//
+// Build and run on the host, from ESP32-CAM/:
+//   g++ -std=c++17 -O2 -Wall -Wextra -Iinclude tools/nutrition_db_check.cpp src/NutritionDB.cpp -o nutrition_db_check
+//   ./nutrition_db_check [foods]
+
+#include "NutritionDB.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+struct MemoryFile {
+    std::vector<uint8_t> bytes;
+    int reads = 0;
+    size_t readBytes = 0;
+};
+
+bool Read(void *file, uint32_t offset, void *data, size_t length)
+{
+    MemoryFile *f = (MemoryFile *)file;
+    if (offset + length > f->bytes.size()) {
+        return false;
+    }
+    memcpy(data, f->bytes.data() + offset, length);
+    f->reads++;
+    f->readBytes += length;
+    return true;
+}
+
+bool Write(void *file, const void *data, size_t length)
+{
+    MemoryFile *f = (MemoryFile *)file;
+    f->bytes.insert(f->bytes.end(), (const uint8_t *)data,
+                    (const uint8_t *)data + length);
+    return true;
+}
+
+NutritionDB::food_t Food(int i, float calories)
+{
+    NutritionDB::food_t food;
+    snprintf(food.name, sizeof(food.name), "food_%d", i);
+    food.calories = calories;
+    return food;
+}
+
+int failures = 0;
+
+void Expect(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const int count = argc > 1 ? atoi(argv[1]) : 5000;
+
+    std::vector<NutritionDB::food_t> foods;
+    for (int i = 0; i < count; i++) {
+        foods.push_back(Food(i, i * 0.25f));
+    }
+
+    MemoryFile file;
+    Expect(NutritionDB::write(Write, &file, 7, foods) == NutritionDB::NDB_OK, "write");
+
+    NutritionDB db;
+    Expect(db.open(Read, &file) == NutritionDB::NDB_OK, "open");
+    Expect(db.count() == (uint32_t)count && db.revision() == 7, "header");
+    printf("%d foods, %zu bytes, open read %zu bytes\n", count, file.bytes.size(), file.readBytes);
+
+    int maxReads = 0;
+    double totalUs = 0;
+    for (int i = 0; i < count; i++) {
+        char upper[NutritionDB::MAX_NAME_LENGTH];
+        snprintf(upper, sizeof(upper), "FOOD_%d", i);
+        const char *name = i % 2 ? upper : foods[i].name;
+
+        float calories = -1;
+        file.reads = 0;
+        const auto t0 = std::chrono::steady_clock::now();
+        const bool found = db.lookup(name, calories);
+        totalUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+        maxReads = std::max(maxReads, file.reads);
+        if (!found || calories != i * 0.25f) {
+            Expect(false, "every food found with its calories");
+            break;
+        }
+    }
+    for (int i = 0; i < 1000; i++) {
+        char name[NutritionDB::MAX_NAME_LENGTH];
+        snprintf(name, sizeof(name), "missing_%d", i);
+        float calories;
+        file.reads = 0;
+        Expect(!db.lookup(name, calories), "unknown food not found");
+        maxReads = std::max(maxReads, file.reads);
+    }
+    Expect(maxReads <= 1, "at most one block read per lookup");
+    printf("lookup: %.2f us on average, at most %d read\n", totalUs / count, maxReads);
+
+    // Rebuild with a delta, as the sync does
+    std::vector<NutritionDB::food_t> merged;
+    Expect(db.readAll(merged) == NutritionDB::NDB_OK && merged.size() == (size_t)count, "read all");
+    merged.push_back(Food(3, 999.0f));
+    merged.push_back(Food(count + 1, 42.0f));
+
+    MemoryFile updated;
+    Expect(NutritionDB::write(Write, &updated, 8, merged) == NutritionDB::NDB_OK, "rewrite");
+    NutritionDB next;
+    Expect(next.open(Read, &updated) == NutritionDB::NDB_OK, "reopen");
+    float calories = 0;
+    Expect(next.count() == (uint32_t)count + 1 && next.revision() == 8, "updated header");
+    Expect(next.lookup("food_3", calories) && calories == 999.0f, "delta replaces a food");
+    Expect(next.lookup("Food_4", calories) && calories == 1.0f, "other foods kept");
+    Expect(next.lookup(Food(count + 1, 0).name, calories) && calories == 42.0f, "delta adds a food");
+
+    // Damaged and empty files
+    MemoryFile bad = file;
+    bad.bytes[0] ^= 0xff;
+    Expect(NutritionDB().open(Read, &bad) == NutritionDB::NDB_ERR_FORMAT, "bad magic rejected");
+    MemoryFile empty;
+    std::vector<NutritionDB::food_t> none;
+    NutritionDB nothing;
+    Expect(NutritionDB::write(Write, &empty, 1, none) == NutritionDB::NDB_OK &&
+               nothing.open(Read, &empty) == NutritionDB::NDB_OK && !nothing.lookup("food_1", calories),
+        "empty table");
+
+    printf("%s\n", failures ? "FAIL" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,166 @@
+// Throughput and latency of the capture pipeline (src/CapturePipeline.cpp)
+// against the same three stages run one after the other, as handleCapture does.
+//
+// The stages are stand-ins that take a fixed time, by default about what one
+// frame costs on the ESP32-CAM: capture with JPEG decode and resize, the
+// impulse, and the HTTP lookup. The pipeline itself is the real code, built
+// with std::thread in place of the FreeRTOS tasks. Every frame carries its
+// sequence number in its pixels, so a slot handed out twice, or a result out
+// of order, shows up as a failure. Every tenth frame shows an empty platter
+// and must come out without a label, and without having gone through inference.
+//
+// Build and run on the host, from ESP32-CAM/:
+//   g++ -std=c++17 -O2 -Wall -Wextra -Iinclude tools/pipeline_benchmark.cpp src/CapturePipeline.cpp src/Signal.cpp -o pipeline_benchmark -lpthread
+//   ./pipeline_benchmark [frames] [capture_ms] [infer_ms] [lookup_ms]
+
+#include "CapturePipeline.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const size_t kFrameBytes = 96 * 96 * 3;
+
+int captureMs = 45;
+int inferMs = 80;
+int lookupMs = 60;
+
+void Work(int ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+bool Capture(CapturePipeline::frame_t &frame)
+{
+    Work(captureMs);
+    memset(frame.pixels, 0, kFrameBytes);
+    memcpy(frame.pixels, &frame.sequence, sizeof(frame.sequence));
+    memcpy(frame.pixels + kFrameBytes - sizeof(frame.sequence), &frame.sequence,
+           sizeof(frame.sequence));
+    frame.empty = frame.sequence % 10 == 9;
+    return true;
+}
+
+bool Infer(const CapturePipeline::frame_t &frame, CapturePipeline::result_t &result)
+{
+    Work(inferMs);
+    if (frame.empty) {
+        return false; // Should have been skipped
+    }
+    uint32_t head, tail;
+    memcpy(&head, frame.pixels, sizeof(head));
+    memcpy(&tail, frame.pixels + kFrameBytes - sizeof(tail), sizeof(tail));
+    if (head != frame.sequence || tail != frame.sequence) {
+        return false; // The slot was refilled under the network
+    }
+    snprintf(result.label, sizeof(result.label), "food%u", (unsigned)(frame.sequence % 6));
+    result.value = 0.9f;
+    return true;
+}
+
+bool Lookup(CapturePipeline::result_t &result)
+{
+    Work(lookupMs);
+    result.calories = (float)atoi(result.label + 4);
+    return true;
+}
+
+bool Check(const CapturePipeline::result_t &result)
+{
+    if (result.sequence % 10 == 9) {
+        return result.label[0] == '\0' && !result.found;
+    }
+    return result.found && result.calories == (float)(result.sequence % 6);
+}
+
+void Report(const char *name, double seconds, std::vector<double> &latencyMs)
+{
+    std::sort(latencyMs.begin(), latencyMs.end());
+    const size_t n = latencyMs.size();
+    printf("%-11s %8zu %8.2f %10.1f %10.1f %10.1f\n", name, n, n / seconds,
+        latencyMs[n / 2], latencyMs[n * 99 / 100], latencyMs[n - 1]);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const int frames = argc > 1 ? atoi(argv[1]) : 100;
+    captureMs = argc > 2 ? atoi(argv[2]) : captureMs;
+    inferMs = argc > 3 ? atoi(argv[3]) : inferMs;
+    lookupMs = argc > 4 ? atoi(argv[4]) : lookupMs;
+    bool ok = true;
+
+    printf("stages: capture %d ms, inference %d ms, lookup %d ms\n", captureMs, inferMs, lookupMs);
+    printf("%-11s %8s %8s %10s %10s %10s\n", "", "results", "fps", "p50 ms", "p99 ms", "max ms");
+
+    // One frame after the other
+    {
+        std::vector<uint8_t> pixels(kFrameBytes);
+        std::vector<double> latency;
+        const int64_t t0 = CapturePipeline::nowUs();
+        for (int i = 0; i < frames; i++) {
+            CapturePipeline::frame_t frame = { pixels.data(), (uint32_t)i, CapturePipeline::nowUs(), false };
+            CapturePipeline::result_t result = {};
+            result.sequence = frame.sequence;
+            Capture(frame);
+            if (!frame.empty) {
+                ok = Infer(frame, result) && ok;
+                result.found = Lookup(result);
+            }
+            ok = Check(result) && ok;
+            latency.push_back((CapturePipeline::nowUs() - frame.capturedUs) / 1000.0);
+        }
+        Report("sequential", (CapturePipeline::nowUs() - t0) / 1e6, latency);
+    }
+
+    // Pipelined, the first results are left out so only the steady state counts
+    {
+        const int warmup = 3;
+        CapturePipeline pipeline;
+        std::vector<double> latency;
+        int64_t t0 = 0;
+        int64_t last = -1;
+        int polled = 0;
+
+        if (pipeline.start(kFrameBytes, Capture, Infer, Lookup) != CapturePipeline::PIPELINE_OK) {
+            printf("start failed\n");
+            return 1;
+        }
+        while (polled < frames + warmup) {
+            CapturePipeline::result_t result;
+            if (!pipeline.poll(result)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            ok = Check(result) && (int64_t)result.sequence > last && ok;
+            last = result.sequence;
+            if (++polled == warmup) {
+                t0 = CapturePipeline::nowUs();
+            } else if (polled > warmup) {
+                latency.push_back((result.doneUs - result.capturedUs) / 1000.0);
+            }
+        }
+        const double seconds = (CapturePipeline::nowUs() - t0) / 1e6;
+        pipeline.stop();
+
+        const CapturePipeline::counters_t c = pipeline.counters();
+        Report("pipelined", seconds, latency);
+        printf("captured %u, rejected %u, failed %u, dropped %u, completed %u\n", c.captured,
+            c.rejected, c.failed, c.dropped, c.completed);
+        ok = ok && c.failed == 0 && c.rejected == 0;
+        ok = ok && c.captured >= c.completed + c.dropped;
+    }
+
+    const double bound = 1000.0 / std::max(1, std::max(captureMs, std::max(inferMs, lookupMs)));
+    printf("slowest stage bound: %.2f fps\n", bound);
+    printf("%s\n", ok ? "OK" : "FAIL");
+    return ok ? 0 : 1;
+}
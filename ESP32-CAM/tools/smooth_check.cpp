@@ -0,0 +1,272 @@
+// Compares the smoother of classifier/ei_classifier_smooth.h with reference versions of
+// its two modes, on random readings.
+//
+// Count mode runs against the smoother it replaces (RecountSmoother below, the window
+// shifted and recounted on every reading), over window sizes from 1 to 255 and a range
+// of min_readings_same. After every reading the label must be the same.
+// EMA mode runs against the average recomputed in double from the whole history of
+// scores. Every averaged score must be within 1e-4 of it and the label the same, except
+// where a score is that close to classifier_confidence or to another label's score.
+// A reading is a frame with a few boxes of random labels and scores. The label in view
+// changes now and then, so the window fills with it and labels get concluded.
+//
+// Build and run on the host, from ESP32-CAM/:
+//   SRC=lib/smart_scale_inferencing/src
+//   FLAGS="-O2 -DEI_PORTING_CLIB=1 -DTF_LITE_DISABLE_X86_NEON -Itools/host -isystem $SRC -isystem $SRC/edge-impulse-sdk"
+//   SDK=$(find $SRC/edge-impulse-sdk/tensorflow $SRC/edge-impulse-sdk/dsp $SRC/tflite-model -name '*.cc' -o -name '*.cpp')
+//   gcc $FLAGS -w -c $SRC/edge-impulse-sdk/tensorflow/lite/c/common.c
+//   g++ -std=c++17 $FLAGS -Wall -Wextra -c tools/smooth_check.cpp
+//   g++ -std=c++17 $FLAGS -w smooth_check.o common.o $SDK $SRC/edge-impulse-sdk/porting/clib/*.cpp -o smooth_check -lm
+//   ./smooth_check [readings]
+
+#include "smart_scale_inferencing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+const int kUncertain = -1;
+const int kAnomaly = -2;
+const size_t kMaxBoxes = 4;
+
+std::mt19937 rng(7);
+
+float Uniform(float lo, float hi)
+{
+    return std::uniform_real_distribution<float>(lo, hi)(rng);
+}
+
+int Pick(int n)
+{
+    return std::uniform_int_distribution<int>(0, n - 1)(rng);
+}
+
+// A frame of boxes and the score per label the smoother takes from it
+struct Frame {
+    ei_impulse_result_bounding_box_t boxes[kMaxBoxes];
+    ei_impulse_result_t result;
+    float scores[EI_CLASSIFIER_LABEL_COUNT];
+};
+
+// Some of the labels point at a copy, the smoother must compare them by value
+char label_copies[EI_CLASSIFIER_LABEL_COUNT][32];
+
+void MakeFrame(int in_view, Frame &frame)
+{
+    memset(&frame.result, 0, sizeof(frame.result));
+    frame.result.bounding_boxes = frame.boxes;
+    uint32_t count = 0;
+    if (in_view >= 0 && Uniform(0, 1) < 0.9f) {
+        frame.boxes[count++] = { ei_classifier_inferencing_categories[in_view], 10, 10, 8, 8, Uniform(0.6f, 1.0f) };
+    }
+    const int others = Pick(3);
+    for (int i = 0; i < others; i++) {
+        const int label = Pick(EI_CLASSIFIER_LABEL_COUNT);
+        const char *name = Pick(2) ? ei_classifier_inferencing_categories[label] : label_copies[label];
+        const float value = Pick(5) == 0 ? 0.0f : Uniform(0, 0.7f);
+        frame.boxes[count++] = { name, (uint32_t)Pick(80), (uint32_t)Pick(80), 8, 8, value };
+    }
+    frame.result.bounding_boxes_count = count;
+
+    for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+        frame.scores[ix] = 0;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+            if (strcmp(frame.boxes[i].label, ei_classifier_inferencing_categories[ix]) == 0) {
+                frame.scores[ix] = std::max(frame.scores[ix], frame.boxes[i].value);
+            }
+        }
+    }
+}
+
+// The smoother before the running counts: the window is shifted by one and recounted
+// on every reading
+struct RecountSmoother {
+    std::vector<int> last_readings;
+    uint8_t min_readings_same;
+    float classifier_confidence;
+    float anomaly_confidence;
+
+    RecountSmoother(size_t n_readings, uint8_t min_same, float confidence, float anomaly)
+        : last_readings(n_readings, kUncertain), min_readings_same(min_same),
+          classifier_confidence(confidence), anomaly_confidence(anomaly) {}
+
+    const char *Update(const float *scores, float anomaly)
+    {
+        uint8_t count[EI_CLASSIFIER_LABEL_COUNT + 2] = { 0 };
+        std::rotate(last_readings.begin(), last_readings.begin() + 1, last_readings.end());
+
+        int reading = kUncertain;
+        for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+            if (scores[ix] >= classifier_confidence) {
+                reading = (int)ix;
+            }
+        }
+#if EI_CLASSIFIER_HAS_ANOMALY
+        if (anomaly >= anomaly_confidence) {
+            reading = kAnomaly;
+        }
+#else
+        (void)anomaly;
+#endif
+        last_readings.back() = reading;
+
+        for (int r : last_readings) {
+            count[r >= 0 ? r : r == kUncertain ? EI_CLASSIFIER_LABEL_COUNT : EI_CLASSIFIER_LABEL_COUNT + 1]++;
+        }
+
+        uint8_t top_result = 0;
+        uint8_t top_count = 0;
+        bool met_confidence_threshold = false;
+        for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT + 2; ix++) {
+            if (count[ix] > top_count) {
+                top_result = ix;
+                top_count = count[ix];
+            }
+            if (count[ix] >= min_readings_same) {
+                met_confidence_threshold = true;
+            }
+        }
+        if (!met_confidence_threshold || top_result == EI_CLASSIFIER_LABEL_COUNT) {
+            return "uncertain";
+        }
+        if (top_result == EI_CLASSIFIER_LABEL_COUNT + 1) {
+            return "anomaly";
+        }
+        return ei_classifier_inferencing_categories[top_result];
+    }
+};
+
+// Next label in view: mostly the same one, sometimes another or nothing
+int NextInView(int in_view)
+{
+    if (Uniform(0, 1) < 0.995f) {
+        return in_view;
+    }
+    return Pick(EI_CLASSIFIER_LABEL_COUNT + 1) - 1;
+}
+
+int CheckCount(size_t window, uint8_t min_same, float confidence, int readings)
+{
+    ei_classifier_smooth_t smooth;
+    ei_classifier_smooth_init(&smooth, window, min_same, confidence);
+    RecountSmoother reference(window, min_same, confidence, 0.3f);
+
+    int mismatches = 0, concluded = 0, in_view = 0;
+    Frame frame;
+    for (int i = 0; i < readings; i++) {
+        in_view = NextInView(in_view);
+        MakeFrame(in_view, frame);
+        frame.result.anomaly = Uniform(0, 0.4f);
+        const char *label = ei_classifier_smooth_update(&smooth, &frame.result);
+        const char *expected = reference.Update(frame.scores, frame.result.anomaly);
+        if (strcmp(label, expected) != 0) {
+            if (mismatches++ < 5) {
+                printf("  reading %d: %s, expected %s\n", i, label, expected);
+            }
+        }
+        concluded += strcmp(expected, "uncertain") != 0;
+    }
+    ei_classifier_smooth_free(&smooth);
+
+    printf("count window %3zu min_same %3u confidence %.1f: %d readings, %d concluded, %d mismatches\n",
+        window, (unsigned)min_same, confidence, readings, concluded, mismatches);
+    return mismatches;
+}
+
+int CheckEma(float alpha, float confidence, int readings)
+{
+    ei_classifier_smooth_t smooth;
+    ei_classifier_smooth_init_ema(&smooth, alpha, confidence);
+
+    const double tolerance = 1e-4;
+    std::vector<std::vector<float>> history(EI_CLASSIFIER_LABEL_COUNT);
+    int mismatches = 0, concluded = 0, skipped = 0, in_view = 0;
+    double worst = 0;
+    Frame frame;
+    for (int i = 0; i < readings; i++) {
+        in_view = NextInView(in_view);
+        MakeFrame(in_view, frame);
+        const char *label = ei_classifier_smooth_update(&smooth, &frame.result);
+
+        double expected_score[EI_CLASSIFIER_LABEL_COUNT];
+        for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+            history[ix].push_back(frame.scores[ix]);
+            double sum = 0, weight = alpha;
+            for (size_t k = history[ix].size(); k-- > 0 && weight > 1e-12; weight *= 1.0 - alpha) {
+                sum += weight * history[ix][k];
+            }
+            expected_score[ix] = sum;
+            worst = std::max(worst, std::fabs(smooth.ema[ix] - sum));
+        }
+
+        int top = -1;
+        bool close = false;
+        for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+            close = close || std::fabs(expected_score[ix] - confidence) < tolerance;
+            if (expected_score[ix] >= confidence) {
+                close = close || (top >= 0 && std::fabs(expected_score[ix] - expected_score[top]) < tolerance);
+                if (top < 0 || expected_score[ix] >= expected_score[top]) {
+                    top = (int)ix;
+                }
+            }
+        }
+        if (close) {
+            skipped++;
+            continue;
+        }
+        const char *expected = top >= 0 ? ei_classifier_inferencing_categories[top] : "uncertain";
+        if (strcmp(label, expected) != 0) {
+            if (mismatches++ < 5) {
+                printf("  reading %d: %s, expected %s\n", i, label, expected);
+            }
+        }
+        concluded += top >= 0;
+    }
+    ei_classifier_smooth_free(&smooth);
+
+    printf("ema alpha %.2f confidence %.1f: %d readings, %d concluded, %d too close to call, "
+        "%d mismatches, largest difference %.2g\n", alpha, confidence, readings, concluded, skipped,
+        mismatches, worst);
+    return mismatches + (worst > tolerance ? 1 : 0);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const int readings = argc > 1 ? std::max(20, atoi(argv[1])) : 40000;
+    for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+        snprintf(label_copies[ix], sizeof(label_copies[ix]), "%s", ei_classifier_inferencing_categories[ix]);
+    }
+
+    struct CountCase { size_t window; uint8_t min_same; float confidence; };
+    const CountCase count_cases[] = {
+        { 1, 1, 0.5f }, { 2, 1, 0.8f }, { 5, 3, 0.6f }, { 10, 7, 0.8f },
+        { 37, 20, 0.5f }, { 100, 60, 0.7f }, { 200, 120, 0.6f }, { 255, 160, 0.5f },
+    };
+    struct EmaCase { float alpha; float confidence; };
+    const EmaCase ema_cases[] = { { 0.05f, 0.5f }, { 0.2f, 0.6f }, { 0.5f, 0.8f }, { 1.0f, 0.7f } };
+
+    // half of the readings for each mode
+    const int per_count = readings / 2 / (int)(sizeof(count_cases) / sizeof(count_cases[0]));
+    const int per_ema = readings / 2 / (int)(sizeof(ema_cases) / sizeof(ema_cases[0]));
+    int failures = 0;
+    for (const CountCase &c : count_cases) {
+        failures += CheckCount(c.window, c.min_same, c.confidence, per_count);
+    }
+    for (const EmaCase &c : ema_cases) {
+        failures += CheckEma(c.alpha, c.confidence, per_ema);
+    }
+
+    printf("%s\n", failures ? "FAIL" : "OK");
+    return failures ? 1 : 0;
+}
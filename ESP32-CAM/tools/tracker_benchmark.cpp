@@ -0,0 +1,150 @@
+// Benchmark of the object tracker in classifier/postprocessing/ei_object_tracking.h
+// at 1, 10 and 50 objects per frame.
+//
+// Objects move at a constant speed over a 640x480 frame, every frame some of them
+// are missed or reappear, and a detection is jittered by a few pixels, so traces get
+// matched, rolled forward on their prediction, closed and started. Per frame time is
+// reported as median / 99th percentile / maximum, together with the number of heap
+// allocations made while the frames ran, which must be zero.
+//
+// The tracker is built on its own (EI_OBJECT_TRACKER_ONLY), without the impulse glue
+// that needs a model with tracking enabled. Build and run on the host, from ESP32-CAM/:
+//   SRC=lib/smart_scale_inferencing/src
+//   FLAGS="-O2 -DEI_PORTING_CLIB=1 -DEI_OBJECT_TRACKING_MAX_TRACES=64 -DEI_OBJECT_TRACKING_MAX_DETECTIONS=64 -isystem $SRC -isystem $SRC/edge-impulse-sdk"
+//   g++ -std=c++17 $FLAGS -w -c $SRC/edge-impulse-sdk/porting/clib/ei_classifier_porting.cpp
+//   g++ -std=c++17 $FLAGS -Wall -Wextra tools/tracker_benchmark.cpp ei_classifier_porting.o -o tracker_benchmark -lm
+//   ./tracker_benchmark [frames]
+
+#include "edge-impulse-sdk/classifier/ei_model_types.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <tuple>
+#include <vector>
+
+// what the generated model_metadata.h has for a model with object tracking
+typedef struct {
+    uint32_t id;
+    uint32_t last_ground_truth_update_t;
+    const char *label;
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+    std::tuple<int, int, int, int> last_centroid_segment;
+} ei_object_tracking_trace_t;
+
+#define EI_OBJECT_TRACKER_ONLY
+#include "edge-impulse-sdk/classifier/postprocessing/ei_object_tracking.h"
+
+static size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *p = malloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace
+{
+
+const char *kLabels[] = { "apple", "banana", "carrot" };
+
+struct Object {
+    float x, y, w, h, vx, vy;
+    int label;
+    bool visible;
+};
+
+// detections of every frame, generated up front so the timing only covers the tracker
+std::vector<std::vector<ei_impulse_result_bounding_box_t>> Scene(std::mt19937 &rng, int count, int frames)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Object> objects(count);
+    for (auto &o : objects) {
+        o.w = 20 + unit(rng) * 60;
+        o.h = 20 + unit(rng) * 60;
+        o.x = unit(rng) * (640 - o.w);
+        o.y = unit(rng) * (480 - o.h);
+        o.vx = (unit(rng) - 0.5f) * 8;
+        o.vy = (unit(rng) - 0.5f) * 8;
+        o.label = rng() % 3;
+        o.visible = true;
+    }
+
+    std::vector<std::vector<ei_impulse_result_bounding_box_t>> scene(frames);
+    for (auto &detections : scene) {
+        for (auto &o : objects) {
+            o.x = std::min(std::max(o.x + o.vx, 0.0f), 640 - o.w);
+            o.y = std::min(std::max(o.y + o.vy, 0.0f), 480 - o.h);
+            if (rng() % 50 == 0) {
+                o.visible = !o.visible;
+            }
+            if (!o.visible || rng() % 10 == 0) {
+                continue;
+            }
+            ei_impulse_result_bounding_box_t bb = { kLabels[o.label],
+                (uint32_t)(o.x + unit(rng) * 4), (uint32_t)(o.y + unit(rng) * 4),
+                (uint32_t)(o.w + unit(rng) * 4), (uint32_t)(o.h + unit(rng) * 4), 0.5f + unit(rng) / 2 };
+            detections.push_back(bb);
+        }
+        std::shuffle(detections.begin(), detections.end(), rng);
+    }
+    return scene;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const int frames = argc > 1 ? atoi(argv[1]) : 2000;
+    const int counts[] = { 1, 10, 50 };
+    std::mt19937 rng(7);
+    bool ok = true;
+
+    printf("%8s %8s %10s %10s %10s %12s\n", "objects", "traces", "p50 us", "p99 us", "max us", "allocations");
+
+    for (int count : counts) {
+        const auto scene = Scene(rng, count, frames);
+        Tracker *tracker = new Tracker(5, 5, 0.5f);
+        std::vector<double> us(frames);
+        size_t traces = 0;
+
+        const size_t allocations_before = allocations;
+        for (int f = 0; f < frames; f++) {
+            auto t0 = std::chrono::steady_clock::now();
+            tracker->process_new_detections(scene[f].data(), scene[f].size());
+            auto t1 = std::chrono::steady_clock::now();
+            us[f] = std::chrono::duration<double, std::micro>(t1 - t0).count();
+            traces += tracker->object_tracking_output_count;
+        }
+        const size_t frame_allocations = allocations - allocations_before;
+        delete tracker;
+
+        std::sort(us.begin(), us.end());
+        printf("%8d %8.1f %10.2f %10.2f %10.2f %12zu\n", count, (double)traces / frames,
+            us[frames / 2], us[frames * 99 / 100], us[frames - 1], frame_allocations);
+        ok = ok && frame_allocations == 0;
+    }
+
+    printf("%s\n", ok ? "OK" : "FAIL");
+    return ok ? 0 : 1;
+}
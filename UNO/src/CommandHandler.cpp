@@ -2,7 +2,7 @@
 
 // Constructor
 CommandHandler::CommandHandler(Stream &serialStream)
-    : serial(serialStream), numRoutes(0), bufferIndex(0)
+    : numRoutes(0), serial(serialStream), bufferIndex(0)
 {
     memset(commandBuffer, 0, sizeof(commandBuffer));
 }
@@ -61,7 +61,7 @@ void CommandHandler::handleIncomingCommand()
             // Reset the buffer for the next command
             bufferIndex = 0;
             memset(commandBuffer, 0, sizeof(commandBuffer));
-        } else if (bufferIndex < (sizeof(commandBuffer) - 1)) {
+        } else if (bufferIndex < COMMAND_BUFFER_SIZE - 1) {
             // Add character to buffer (prevent overflow)
             commandBuffer[bufferIndex++] = incomingChar;
         }
@@ -38,7 +38,7 @@ status_t status = STATUS_BOOT;
 
 float capturedWeight = 0;
 
-void handleHello(const String &command)
+void handleHello(const String &)
 {
     commandHandler.sendCommand("READY");
     commandHandler.sendCommand("INIT");
@@ -48,7 +48,7 @@ void handleHello(const String &command)
     }
 }
 
-void handleReady(const String &command)
+void handleReady(const String &)
 {
     if (status == STATUS_BOOT) {
         status = STATUS_SYNCED;
@@ -57,7 +57,7 @@ void handleReady(const String &command)
     }
 }
 
-void handleNoSDCard(const String &command)
+void handleNoSDCard(const String &)
 {
     status = STATUS_NO_SDC;
     lcd.clear();
@@ -65,7 +65,7 @@ void handleNoSDCard(const String &command)
     lcd.print("No SD card!");
 }
 
-void handleBadWiFiConfig(const String &command)
+void handleBadWiFiConfig(const String &)
 {
     status = STATUS_BAD_WIFI_CONF;
     lcd.clear();
@@ -73,7 +73,7 @@ void handleBadWiFiConfig(const String &command)
     lcd.print("Bad WiFi config!");
 }
 
-void handleNoWiFiConnection(const String &command)
+void handleNoWiFiConnection(const String &)
 {
     status = STATUS_NO_WIFI_CONN;
     lcd.clear();
@@ -83,7 +83,7 @@ void handleNoWiFiConnection(const String &command)
     lcd.print("to WiFi...");
 }
 
-void handleCamInitFailed(const String &command)
+void handleCamInitFailed(const String &)
 {
     status = STATUS_CAM_INIT_FAIL;
     lcd.clear();
@@ -93,7 +93,7 @@ void handleCamInitFailed(const String &command)
     lcd.print("failed!");
 }
 
-void handleNoInternet(const String &command)
+void handleNoInternet(const String &)
 {
     status = STATUS_NO_INTERNET;
     lcd.clear();
@@ -103,7 +103,7 @@ void handleNoInternet(const String &command)
     lcd.print("connection...");
 }
 
-void handleInitSuccess(const String &command)
+void handleInitSuccess(const String &)
 {
     if (status == STATUS_SYNCED) {
         status = STATUS_READY;
@@ -138,7 +138,7 @@ void handleFoodInfo(const String &command)
     delay(5000); // Display for 5 seconds
 }
 
-void handleFoodNotRecognized(const String &command)
+void handleFoodNotRecognized(const String &)
 {
     lcd.clear();
     lcd.setCursor(1, 0);
@@ -147,7 +147,7 @@ void handleFoodNotRecognized(const String &command)
     lcd.print("recognized...");
     delay(2000); // Display for 2 seconds
 }
-void handleConfigFileNotCreated(const String &command)
+void handleConfigFileNotCreated(const String &)
 {
     status = STATUS_ERROR;
     lcd.clear();
@@ -200,10 +200,12 @@ void statusHandler(const String &command)
     case STATUS_NO_INTERNET:
         handleNoInternet("");
         break;
+    case STATUS_ERROR:
+        break;
     }
 }
 
-void handleAIFailure(const String &command)
+void handleAIFailure(const String &)
 {
     lcd.clear();
     lcd.setCursor(1, 0);
@@ -211,7 +213,7 @@ void handleAIFailure(const String &command)
     delay(2000); // Display for 2 seconds
 }
 
-void handleCaptureFail(const String &command)
+void handleCaptureFail(const String &)
 {
     lcd.clear();
     lcd.setCursor(1, 0);
@@ -219,6 +221,53 @@ void handleCaptureFail(const String &command)
     delay(2000); // Display for 2 seconds
 }
 
+// The camera stored the empty platter as the reference of its frame gate
+void handleTareDone(const String &)
+{
+    lcd.clear();
+    lcd.setCursor(0, 0);
+    lcd.print("Tared!");
+    delay(1000); // Display "Tared!" message
+}
+
+// The scale is tared but the camera kept its old reference, it may let
+// empty plates through or reject full ones until the next tare
+void handleTareFail(const String &)
+{
+    lcd.clear();
+    lcd.setCursor(1, 0);
+    lcd.print("Camera tare");
+    lcd.setCursor(1, 1);
+    lcd.print("failed!");
+    delay(2000); // Display for 2 seconds
+}
+
+// Replies to STREAM: the camera recognizes continuously and sends FOOD_INFO
+// (or FOOD_NOT_RECOG) whenever what is on the scale changes
+void handleStreamOn(const String &)
+{
+    lcd.clear();
+    lcd.setCursor(1, 0);
+    lcd.print("Streaming...");
+    delay(1000); // Display for 1 second
+}
+
+void handleStreamOff(const String &)
+{
+    lcd.clear();
+    lcd.setCursor(1, 0);
+    lcd.print("Stream stopped");
+    delay(1000); // Display for 1 second
+}
+
+void handleStreamFail(const String &)
+{
+    lcd.clear();
+    lcd.setCursor(1, 0);
+    lcd.print("Stream failed!");
+    delay(2000); // Display for 2 seconds
+}
+
 void setup()
 {
     Serial.begin(115200);
@@ -253,6 +302,11 @@ void setup()
     commandHandler.registerRoute("STATUS", statusHandler);
     commandHandler.registerRoute("AI_FAIL", handleAIFailure);
     commandHandler.registerRoute("CAPTURE_FAIL", handleCaptureFail);
+    commandHandler.registerRoute("TARE_DONE", handleTareDone);
+    commandHandler.registerRoute("TARE_FAIL", handleTareFail);
+    commandHandler.registerRoute("STREAM_ON", handleStreamOn);
+    commandHandler.registerRoute("STREAM_OFF", handleStreamOff);
+    commandHandler.registerRoute("STREAM_FAIL", handleStreamFail);
 
     // Send HELLO
     commandHandler.sendCommand("HELLO");
@@ -311,11 +365,10 @@ void loop()
         lcd.setCursor(0, 0);
         lcd.print("Taring...");
         scale.tare(); // Reset the scale to 0
-        delay(1000);  // Give some time for taring
-        lcd.clear();
-        lcd.setCursor(0, 0);
-        lcd.print("Tared!");
-        delay(1000); // Display "Tared!" message
+        // The platter is empty now, the camera keeps it as its reference and
+        // answers with TARE_DONE or TARE_FAIL
+        commandHandler.sendCommand("TARE");
+        delay(1000); // Give some time for taring
     }
 
     // Check if capture button is pressed
@@ -325,7 +378,8 @@ void loop()
         lcd.setCursor(0, 0);
         lcd.print("Capturing...");
         capturedWeight = weight;
-        commandHandler.sendCommand("CAPTURE");
+        // The weight lets the camera tell a new serving from the last one
+        commandHandler.sendCommand("CAPTURE", String(weight, 1));
         delay(3000); // Display "Capturing..." message
     }
 